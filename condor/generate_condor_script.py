@@ -17,7 +17,7 @@ import argparse
 # List of config_name: Org, PU, L1, Rocco, ID, Iso, All
 # List of era: 2016APV, 2016, 2017, 2018
 
-def generate_python_scripts(process_name, base_output_directory, config_name, isMC, era, doPU, doL1, doRocco, doIDSF, doIso, doTrig):
+def generate_python_scripts(process_name, base_output_directory, config_name, isMC, era, doPU, doL1, doRocco, doIDSF, doIso, doTrig, normalize_index=None):
 
         # Determine the full output directory path
         full_output_directory = os.path.join(base_output_directory, process_name)
@@ -31,6 +31,9 @@ def generate_python_scripts(process_name, base_output_directory, config_name, is
         os.makedirs(os.path.join(log_condor_path, "err"), exist_ok=True)
         os.makedirs(os.path.join(log_condor_path, "out"), exist_ok=True)
 
+        # MC histograms normalized to the luminosity in the jobs, with the sums of weights of the sample index (see include/SampleIndex.h)
+        normalize_option = f" --normalize {normalize_index}" if normalize_index else ""
+
         # Define the shell script content without directory creation (pre-created at the Python level)
         exe_script_content = f'''#! /bin/bash
 
@@ -43,7 +46,7 @@ export INSTALL_DIR_PATH=$PWD
 export PATH=$PATH:$INSTALL_DIR_PATH/lib
 export LD_LIBRARY_PATH=$LD_LIBRARY_PATH:$INSTALL_DIR_PATH/lib
 
-./DYanalysis ${1} {era} {process_name} 0 {doPU} {doL1} {doRocco} {doIDSF} {doIso} {doTrig} {full_output_directory}/{process_name}_${{2}}.root
+./DYanalysis ${1} {era} {process_name} 0 {doPU} {doL1} {doRocco} {doIDSF} {doIso} {doTrig} {full_output_directory}/{process_name}_${{2}}.root --checkpoint-seconds 600 --resume --incremental
 '''
 
         if isMC:
@@ -58,7 +61,7 @@ export INSTALL_DIR_PATH=$PWD
 export PATH=$PATH:$INSTALL_DIR_PATH/lib
 export LD_LIBRARY_PATH=$LD_LIBRARY_PATH:$INSTALL_DIR_PATH/lib
 
-./DYanalysis ${1} {era} {process_name} 1 {doPU} {doL1} {doRocco} {doIDSF} {doIso} {doTrig} {full_output_directory}/{process_name}_${{2}}.root
+./DYanalysis ${1} {era} {process_name} 1 {doPU} {doL1} {doRocco} {doIDSF} {doIso} {doTrig} {full_output_directory}/{process_name}_${{2}}.root --checkpoint-seconds 600 --resume --incremental{normalize_option}
 '''
 
         sub_script_content = f'''universe = vanilla
@@ -115,10 +118,13 @@ queue InputFileList from /u/user/swkim/CMS/chargedDY_NanoAOD/chargedDY/fileList/
 
 
 # How to run:
-# python3 generate_condor_script.py -o /path/to/output/dir
+# python3 generate_condor_script.py -o /path/to/output/dir [--normalize-index /path/to/samples.index]
+# The index is built once per sample with
+# ./DYanalysis fileList/<era>/<process>.txt <era> <process> <IsMC> 0 0 0 0 0 0 unused.root --build-index /path/to/samples.index
 if __name__ == "__main__":
     parser = argparse.ArgumentParser(description="Generate condor scripts for DYanalysis jobs")
     parser.add_argument("-o", "--base_output_directory", help="Base output directory")
+    parser.add_argument("--normalize-index", default=None, help="Sample index, MC histograms are normalized to the luminosity in the jobs")
     args = parser.parse_args()
     
     # Define the eras (we always iterate over these four)
@@ -154,4 +160,4 @@ if __name__ == "__main__":
             for process in processes:
                 # Auto-detect isMC flag if desired.
                 isMC = 0 if "SingleMuon" in process else 1
-                generate_python_scripts(process, era_output_directory, config_name, isMC, era, doPU, doL1, doRocco, doIDSF, doIso, doTrig)
\ No newline at end of file
+                generate_python_scripts(process, era_output_directory, config_name, isMC, era, doPU, doL1, doRocco, doIDSF, doIso, doTrig, args.normalize_index)
\ No newline at end of file
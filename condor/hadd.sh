@@ -22,6 +22,14 @@ fi
 
 echo "Processing directory: $INPUT_PATH"
 
+# Use the native merger if it is installed (same outputs, parallel and in a single pass over the files)
+DYMERGE="$(cd "$(dirname "$0")" && pwd)/../install/DYmerge"
+if [ -x "$DYMERGE" ]; then
+    "$DYMERGE" -j "$(nproc)" "$INPUT_PATH"
+    exit $?
+fi
+echo "Warning: $DYMERGE not found, falling back to hadd"
+
 # Process individual directories first
 for process_dir in "$INPUT_PATH"/*; do
     if [ -d "$process_dir" ]; then
@@ -0,0 +1,105 @@
+import os
+import sys
+import json
+import glob
+import argparse
+from collections import defaultdict
+
+# Report of the DYanalysis telemetry (see include/Telemetry.h)
+# Reads the JSON lines written to stderr by each job, i.e. the condor error files:
+# base_directory/
+# -- process_name/
+# ---- log_condor/
+# ------ err/e_<job>.err
+# The last "summary" line of each job gives its throughput, peak memory and I/O.
+# Jobs without a summary line (still running, killed, failed) are reported with their last "progress" line.
+
+def read_telemetry(err_file):
+    last_progress = None
+    summary = None
+    with open(err_file, "r", errors="replace") as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith("{"):
+                continue
+            try:
+                record = json.loads(line)
+            except ValueError:
+                continue
+            if record.get("type") == "summary":
+                summary = record
+            elif record.get("type") == "progress":
+                last_progress = record
+    return summary, last_progress
+
+
+def print_stats(name, values, unit):
+    if not values:
+        return
+    values = sorted(values)
+    print(f"  {name:<16} min {values[0]:>10.1f}  median {values[len(values) // 2]:>10.1f}  max {values[-1]:>10.1f} {unit}")
+
+
+# How to run:
+# python3 telemetry_report.py /path/to/output/dir [--slowest 10]
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Report of the DYanalysis telemetry in the condor error files")
+    parser.add_argument("directory", help="Directory of the process directories")
+    parser.add_argument("--slowest", type=int, default=10, help="Number of slowest jobs to list")
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.directory):
+        print(f"Error: Directory '{args.directory}' does not exist")
+        sys.exit(1)
+
+    jobs = defaultdict(list)
+    unfinished = []
+    for err_file in sorted(glob.glob(os.path.join(args.directory, "*", "log_condor", "err", "e_*.err"))):
+        process_name = os.path.basename(os.path.dirname(os.path.dirname(os.path.dirname(err_file))))
+        summary, last_progress = read_telemetry(err_file)
+        if summary is not None:
+            jobs[process_name].append((err_file, summary))
+        elif last_progress is not None:
+            unfinished.append((err_file, last_progress))
+
+    all_jobs = [job for process_jobs in jobs.values() for job in process_jobs]
+    print(f"Telemetry report for {args.directory}")
+    print("==================================")
+    print(f"Finished jobs: {len(all_jobs)}, unfinished jobs: {len(unfinished)}")
+    if not all_jobs:
+        sys.exit(0)
+
+    print("\nOverall:")
+    print_stats("Rate", [s["rate_avg"] for _, s in all_jobs], "evt/s")
+    print_stats("Peak RSS", [s["peak_rss_mb"] for _, s in all_jobs], "MB")
+    print_stats("Read", [s.get("bytes_read", 0) / 1024 ** 2 for _, s in all_jobs], "MB")
+
+    # Share of the event loop time per stage
+    stage_times = defaultdict(float)
+    for _, s in all_jobs:
+        for stage, seconds in s.get("stages_s", {}).items():
+            stage_times[stage] += seconds
+    total_time = sum(stage_times.values())
+    if total_time > 0:
+        print("\nStages:")
+        for stage, seconds in stage_times.items():
+            print(f"  {stage:<16} {100 * seconds / total_time:5.1f} %")
+        unzip_time = sum(s.get("unzip_s", 0) for _, s in all_jobs)
+        print(f"  {'(unzip)':<16} {100 * unzip_time / total_time:5.1f} %")
+
+    print("\nPer process:")
+    for process_name in sorted(jobs):
+        process_jobs = jobs[process_name]
+        rates = [s["rate_avg"] for _, s in process_jobs]
+        peak_rss = max(s["peak_rss_mb"] for _, s in process_jobs)
+        print(f"  {process_name} (Jobs: {len(process_jobs)}) average rate {sum(rates) / len(rates):.1f} evt/s, max peak RSS {peak_rss:.1f} MB")
+
+    # Slow nodes or storage : lowest rates, with the host and the share of unzip time
+    print("\nSlowest jobs:")
+    for err_file, s in sorted(all_jobs, key=lambda job: job[1]["rate_avg"])[:args.slowest]:
+        print(f"  {s['rate_avg']:>10.1f} evt/s  {s.get('host', ''):<24} unzip {s.get('unzip_s', 0):8.1f} s  {err_file}")
+
+    if unfinished:
+        print("\nUnfinished jobs (last progress line):")
+        for err_file, s in unfinished:
+            print(f"  {s['events']}/{s['total']} events  {s.get('host', ''):<24} {err_file}")
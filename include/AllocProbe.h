@@ -0,0 +1,22 @@
+#ifndef AllocProbe_h
+#define AllocProbe_h
+
+// ROOT classes
+#include "Rtypes.h"
+
+// Heap allocation probe of the event loop
+// Built with -DDYANALYSIS_ALLOC_PROBE=ON, the global operator new is replaced by one counting its calls in each thread,
+// and DYanalyzer::Analyze() prints the heap allocations made while processing the events after the warm-up,
+// with a warning if there are any (./DYanalysis --alloc-check then exits with code 4).
+// Otherwise nothing is replaced and the counters stay at 0.
+// malloc() calls of C code (e.g. the decompression of the baskets) are not counted.
+namespace AllocProbe {
+    // Events not counted : the first ones grow the arena, the caches and the buffers of the readers
+    constexpr Int_t kWarmUpEvents = 100;
+
+    Bool_t IsEnabled();
+    // # of operator new calls made by the calling thread
+    ULong64_t GetNAllocations();
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef AnalysisCorrections_h
+#define AnalysisCorrections_h
+
+// DYanalysis classes
+#include "PU.h"
+#include "EfficiencySF.h"
+#include "RoccoR.h"
+
+// C++ classes
+#include <string>
+#include <memory>
+#include <iostream>
+#include <stdexcept>
+
+// Corrections of an era : PU weights, muon efficiency SFs and Rochester correction
+// Building them (RoccoR parsing, calibration tables, correctionlib files) is the fixed cost of an analyzer,
+// they are read-only once built, so the analyzers of several samples of the same era can share one instance
+// (see DYanalyzer::SetCorrections() and DYmulti.cc), also from concurrent threads.
+class AnalysisCorrections {
+    public :
+        struct Config {
+            std::string sEra;
+            std::string sHistName_ID;
+            std::string sHistName_Iso;
+            std::string sHistName_Trig;
+            std::string sRoccoFileName;
+            // Optional correctionlib files, the ROOT files are used if empty
+            std::string sPUCorrectionFileName;
+            std::string sMuonSFCorrectionFileName;
+            // Tabulated CrystalBall of RoccoR, for iRoccoSet/iRoccoMember or for all replicas
+            Bool_t bFastRocco = false;
+            Bool_t bRoccoReplicas = false;
+            Int_t iRoccoSet = 5;
+            Int_t iRoccoMember = 0;
+
+            // Muon SF histogram names and Rochester correction file of the era
+            static Config ForEra(const std::string& era);
+            // Analyzers can share the corrections if their configurations give the same string
+            std::string ToString() const;
+        };
+
+    private :
+        Config cConfig;
+        std::unique_ptr<PU> pPU;
+        std::unique_ptr<EfficiencySF> pEfficiencySF;
+        std::unique_ptr<RoccoR> pRochesterCorrection;
+
+    public :
+        // Builds and initializes all corrections
+        AnalysisCorrections(const Config& config);
+        AnalysisCorrections(const AnalysisCorrections&) = delete;
+        AnalysisCorrections& operator=(const AnalysisCorrections&) = delete;
+
+        const Config& GetConfig() const { return cConfig; }
+        PU& GetPU() const { return *pPU; }
+        EfficiencySF& GetEffSF() const { return *pEfficiencySF; }
+        RoccoR& GetRocco() const { return *pRochesterCorrection; }
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef AnalysisServer_h
+#define AnalysisServer_h
+
+// DYanalysis classes
+#include "DYanalyzer.h"
+
+// C++ classes
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <iostream>
+#include <stdexcept>
+
+// Resident analysis process serving requests over a Unix domain socket (DYanalysis --daemon <socket>)
+// For the edit-run cycle of the selection : the corrections of each configuration (RoccoR parsing, SF maps,
+// correctionlib files) and the numbers of entries of the input files are kept between requests,
+// so that a request only pays for its event loop.
+// A request is the arguments of DYanalysis without the output file name (DYanalysis --client <socket> ...),
+// with the selection overrides (--cut) and the list of histograms to send back (--hists).
+// The reply is the output file of the request (histograms and manifest), written in memory.
+// Requests are served one at a time. Changed input files (size or mtime) are counted again,
+// changed correction files are only read again after a restart of the daemon.
+// The socket is created with mode 0600, only the user of the daemon can send requests. An existing file at the socket path
+// is only replaced if it is the socket of a daemon that is gone, the daemon refuses to start otherwise.
+//
+// Messages, integers of 8 bytes in the byte order of the machine :
+//   request : <size> <arguments separated by '\0'>
+//   reply   : <status> <size> <output file if status is 0, error message otherwise>
+class AnalysisServer {
+    public :
+        struct Request {
+            std::string sInputFileList;
+            std::string sEra;
+            std::string sProcessName;
+            Bool_t bIsMC = true;
+            Bool_t bDoPUCorrection = false;
+            Bool_t bDoL1PreFiringCorrection = false;
+            Bool_t bDoRocco = false;
+            Bool_t bDoIDSF = false;
+            Bool_t bDoIsoSF = false;
+            Bool_t bDoTrigSF = false;
+            Bool_t bFastRocco = false;
+            Bool_t bRoccoReplicas = false;
+            std::string sPUCorrectionFileName;
+            std::string sMuonSFCorrectionFileName;
+            std::string sNormalizeIndexFileName;
+            SelectionCuts cCuts;
+            std::string sHistogramList;
+        };
+
+    private :
+        struct FileEntries {
+            Long64_t nSize = -1;
+            Long64_t nMTime = -1;
+            Long64_t nEntries = 0;
+        };
+
+        std::string sSocketPath;
+        Int_t iListenFd = -1;
+        // Corrections by configuration (AnalysisCorrections::Config::ToString())
+        std::map<std::string, std::shared_ptr<AnalysisCorrections>> mCorrections;
+        // Numbers of entries of the input files, valid while their size and mtime do not change
+        std::map<std::string, FileEntries> mFileEntries;
+        Long64_t nRequests = 0;
+
+        std::map<std::string, Long64_t> GetKnownEntries(const std::string& inputFileList);
+        std::shared_ptr<AnalysisCorrections> GetCorrections(const AnalysisCorrections::Config& config);
+        // Output file of the request
+        std::string Process(const Request& request);
+        void Reply(Int_t fd, ULong64_t status, const std::string& payload);
+
+    public :
+        AnalysisServer(const std::string& socketPath): sSocketPath(socketPath)
+        {};
+        ~AnalysisServer();
+
+        // <Input file list> <Era> <Process name> <IsMC> <DoPUCorrection> <DoL1PreFiringCorrection> <DoRocco> <DoIDSF> <DoIsoSF> <DoTrigSF>
+        // [--fast-rocco] [--rocco-replicas] [--pu-json <file>] [--muon-sf-json <file>] [--normalize <file>] [--cut <name>=<value>]... [--hists <list>]
+        // Throws if the arguments are invalid
+        static Request ParseRequest(const std::vector<std::string>& args);
+
+        // Serves requests until SIGINT or SIGTERM, the current request is finished before stopping
+        void Serve();
+
+        // Sends a request to the daemon and returns its output file, throws if the request fails
+        static std::string Send(const std::string& socketPath, const std::vector<std::string>& args);
+};
+
+#endif
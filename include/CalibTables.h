@@ -0,0 +1,44 @@
+#ifndef CalibTables_h
+#define CalibTables_h
+
+// C++ classes
+#include <string>
+
+// Histogram of a calibration file, embedded at build time by tools/MakeCalibTables.cc
+// The arrays are constexpr in the generated source (read-only memory, shared between forked processes)
+// 1D : nY = 0, pYEdges = nullptr, contents indexed by iX
+// 2D : contents indexed by iX * nY + iY
+// Under/overflow bins are not stored
+struct CalibHist {
+    const char* sFileName; // Relative to the source directory, e.g. "muonSF/2018_ID.root"
+    const char* sHistName;
+    int nX;
+    int nY;
+    const double* pXEdges; // nX + 1 edges
+    const double* pYEdges; // nY + 1 edges
+    const double* pContent;
+    const double* pError;
+};
+
+// Text file embedded at build time (correctionlib JSON files of corrections/, sample registry of samples/)
+struct CalibText {
+    const char* sFileName; // Relative to the source directory, e.g. "corrections/met_xy_UL.json"
+    const char* pText;
+    unsigned long nSize;
+};
+
+namespace CalibTables {
+    // All embedded histograms, defined in the generated source
+    extern const CalibHist kHists[];
+    extern const int nHists;
+
+    extern const CalibText kTexts[];
+    extern const int nTexts;
+
+    // nullptr if the histogram was not embedded at build time : the caller then falls back to the ROOT file
+    const CalibHist* Find(const std::string& fileName, const std::string& histName);
+    // nullptr if the file was not embedded at build time
+    const CalibText* FindText(const std::string& fileName);
+}
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef Correction_h
+#define Correction_h
+
+// ROOT classes
+#include "Rtypes.h"
+
+// C++ classes
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+// Input of Correction::Evaluate(), either a number or a string
+struct CorrectionValue {
+    Double_t dValue = 0.;
+    std::string sValue;
+    Bool_t bIsString = false;
+
+    CorrectionValue(Double_t value) : dValue(value) {}
+    CorrectionValue(Int_t value) : dValue(value) {}
+    CorrectionValue(const char* value) : sValue(value), bIsString(true) {}
+    CorrectionValue(const std::string& value) : sValue(value), bIsString(true) {}
+};
+
+// One correction of a CMS correctionlib JSON file (schema version 2)
+// Supported nodes : binning, multibinning, category, formula, formularef and constants
+// The node tree is compiled at load time into a flat program :
+// - All inputs are numbers, string inputs are replaced by the id of the string (see GetStringId()),
+//   so a categorical node on a string input is a direct table lookup
+// - Bin edges, constants and formula parameters are stored in one contiguous array
+// - Formulas are compiled to a postfix program evaluated on a fixed-size stack
+class Correction {
+    public :
+        enum class InputType : UInt_t {kReal = 0, kInt, kString};
+
+        // Operations of the compiled formulas
+        enum class Op : UInt_t {
+            kConst = 0, kInput,
+            kAdd, kSub, kMul, kDiv, kPow, kNeg,
+            kLess, kGreater, kLessEq, kGreaterEq, kEqual, kNotEqual,
+            kExp, kLog, kLog10, kSqrt, kAbs, kErf, kCos, kSin, kTan, kAcos, kAsin, kAtan,
+            kCosh, kSinh, kTanh, kAcosh, kAsinh, kAtanh,
+            kAtan2, kMax, kMin
+        };
+        struct FormulaOp {
+            Op eOp;
+            Int_t iArg; // Input index for kInput
+            Double_t dArg; // Value for kConst
+        };
+
+        enum class NodeType : UInt_t {kConstant = 0, kBinning, kMultiBinning, kCategory, kFormula};
+        // Flow of binning nodes, or index of the default node (>= 0)
+        static constexpr Int_t kFlowError = -1;
+        static constexpr Int_t kFlowClamp = -2;
+
+        struct Node {
+            NodeType eType;
+            Int_t iInput = -1;   // Input of binning and category nodes
+            Int_t nEntries = 0;  // # of bins, keys, formula ops, or inputs of a multibinning node
+            Int_t iData = 0;     // Offset in vData : value of a constant, edges of a binning, keys of an integer category
+            Int_t iChildren = 0; // Offset in vIndex : child nodes, inputs/sizes/strides of a multibinning ; offset in vOps for formulas
+            Int_t iDefault = kFlowError; // Flow of a binning node, default of a category node
+            Bool_t bUniform = false; // Uniform binning : edges are {low, high, n / (high - low)}
+        };
+
+    private :
+        std::string sName;
+        std::string sDescription;
+        std::vector<std::string> vInputNames;
+        std::vector<InputType> vInputTypes;
+        std::string sOutputName;
+
+        // Strings of each input, their position is the id used in the flat program
+        std::vector<std::vector<std::string>> vStrings;
+
+        std::vector<Node> vNodes; // vNodes[0] is the root
+        std::vector<Double_t> vData;
+        std::vector<Int_t> vIndex;
+        std::vector<FormulaOp> vOps;
+        Int_t nMaxStack = 0;
+
+        friend class CorrectionCompiler;
+
+        [[noreturn]] void ThrowOutOfRange(const Node& node, Double_t x) const;
+        Double_t EvaluateFormula(const Node& node, const Double_t* inputs) const;
+
+    public :
+        static constexpr Int_t kMaxStack = 64;
+
+        Correction() {};
+
+        const std::string& GetName() const { return sName; }
+        const std::string& GetDescription() const { return sDescription; }
+        const std::string& GetOutputName() const { return sOutputName; }
+        Int_t GetNInputs() const { return (Int_t)vInputNames.size(); }
+        const std::string& GetInputName(Int_t input) const { return vInputNames.at(input); }
+        InputType GetInputType(Int_t input) const { return vInputTypes.at(input); }
+        Int_t GetNNodes() const { return (Int_t)vNodes.size(); }
+
+        // -1 if there is no input of this name
+        Int_t GetInputIndex(const std::string& name) const;
+        // Id of a string value of a string input, -1 if the string does not appear in the correction
+        Double_t GetStringId(Int_t input, const std::string& value) const;
+        Bool_t HasString(Int_t input, const std::string& value) const { return GetStringId(input, value) >= 0.; }
+        // Lowest bin edge of the binning nodes on an input, -inf if the input is not binned
+        Double_t GetInputLowEdge(Int_t input) const;
+
+        // Flat evaluation, inputs[i] is the value of input i (the string id for string inputs)
+        Double_t Evaluate(const Double_t* inputs) const;
+        // Batch version : n rows of GetNInputs() values, row-major
+        void Evaluate(std::size_t n, const Double_t* inputs, Double_t* output) const;
+        // Convenience version, resolves the strings on each call
+        Double_t Evaluate(const std::vector<CorrectionValue>& inputs) const;
+};
+
+// All corrections of a correctionlib JSON file
+class CorrectionSet {
+    private :
+        std::string sFileName;
+        Int_t iSchemaVersion = 0;
+        std::vector<std::unique_ptr<Correction>> vCorrections;
+
+        // Sets opened by Open(), shared by all clients of the job
+        static std::mutex cCacheMutex;
+        static std::map<std::string, std::shared_ptr<const CorrectionSet>> mCache;
+
+    public :
+        // Parse a JSON document
+        CorrectionSet(const std::string& json, const std::string& fileName);
+
+        // Load a file, first from the tables embedded at build time (see CalibTables.h), then from the path as given,
+        // then relative to the source directory (../). The set is parsed once per job and shared.
+        static std::shared_ptr<const CorrectionSet> Open(const std::string& fileName);
+
+        const std::string& GetFileName() const { return sFileName; }
+        Int_t GetSchemaVersion() const { return iSchemaVersion; }
+        Int_t GetNCorrections() const { return (Int_t)vCorrections.size(); }
+        const Correction& GetCorrection(Int_t i) const { return *vCorrections.at(i); }
+
+        // nullptr if there is no correction of this name
+        const Correction* Find(const std::string& name) const;
+        // Throws if there is no correction of this name
+        const Correction& At(const std::string& name) const;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef CorrectionStore_h
+#define CorrectionStore_h
+
+// ROOT classes
+#include "Rtypes.h"
+
+// C++ classes
+#include <string>
+#include <memory>
+#include <functional>
+#include <cstddef>
+
+// Read-only block of correction state, either mapped from the node-wide store (shared between processes) or private
+class CorrectionSegment {
+    private :
+        void* pMap = nullptr;
+        std::size_t nMapSize = 0;
+        std::string sPrivate;
+        const char* pData = nullptr;
+        std::size_t nSize = 0;
+        Bool_t bIsShared = false;
+
+        friend class CorrectionStore;
+
+    public :
+        CorrectionSegment() {};
+        ~CorrectionSegment();
+        CorrectionSegment(const CorrectionSegment&) = delete;
+        CorrectionSegment& operator=(const CorrectionSegment&) = delete;
+
+        // The payload is aligned to 64 bytes
+        const char* GetData() const { return pData; }
+        std::size_t GetSize() const { return nSize; }
+        Bool_t IsShared() const { return bIsShared; }
+};
+
+// Node-wide store of materialized correction state
+// Condor runs many single-core jobs on one node : the first job that needs a state builds it and publishes it
+// as a file in the store directory (a per-user subdirectory of /tmp), the other jobs map the same pages read-only.
+// Files are named by the state name and the checksum of its inputs, so a changed input gives a new file.
+// Publishing writes a temporary file and renames it, so a file is either complete or absent.
+// The payload carries its own checksum, verified by the publisher once the file is renamed; other jobs only check the header.
+// Before the first publish, files of the user older than the maximum age are removed, then the oldest ones until the store fits the cap.
+// Any failure falls back to the privately built state.
+class CorrectionStore {
+    private :
+        static Int_t iEnabled; // -1 : not decided yet (environment), 0 : disabled, 1 : enabled
+        static std::string sDirectory;
+        static Double_t dMaxAgeHours;
+        static ULong64_t nMaxBytes;
+        static Bool_t bIsCleaned;
+
+        static std::string GetPath(const std::string& name, ULong64_t checksum);
+        static std::shared_ptr<const CorrectionSegment> Attach(const std::string& path, const std::string& name, ULong64_t checksum, Bool_t verifyPayload);
+        static Bool_t Publish(const std::string& path, const std::string& name, ULong64_t checksum, const std::string& payload);
+        static void RemoveStale();
+
+    public :
+        static constexpr std::size_t kAlignment = 64;
+
+        // Enabled by default, DYANALYSIS_STORE_DIR=none disables it, any other value sets the directory
+        // The memory-backed /dev/shm is only used if asked for, with DYANALYSIS_STORE_DIR=/dev/shm
+        static void SetEnabled(Bool_t enabled) { iEnabled = enabled; }
+        static Bool_t IsEnabled();
+        static void SetDirectory(const std::string& directory) { sDirectory = directory; }
+        static const std::string& GetDirectory();
+        // Limits of the stale-file cleanup : 72 hours and 2 GB by default
+        static void SetMaxAgeHours(Double_t maxAgeHours) { dMaxAgeHours = maxAgeHours; }
+        static void SetMaxBytes(ULong64_t maxBytes) { nMaxBytes = maxBytes; }
+
+        // Attach to the state <name> built from inputs of the given checksum, build and publish it if it does not exist yet
+        // build() returns the payload, it is only called if the state is not in the store
+        static std::shared_ptr<const CorrectionSegment> Get(const std::string& name, ULong64_t checksum, const std::function<std::string()>& build);
+
+        // FNV-1a, 64 bits
+        static ULong64_t Checksum(const char* data, std::size_t size, ULong64_t seed = 14695981039346656037ULL);
+        static ULong64_t Checksum(const std::string& data, ULong64_t seed = 14695981039346656037ULL) { return Checksum(data.data(), data.size(), seed); }
+        // Checksum of the content of a file, 0 if the file cannot be read
+        static ULong64_t ChecksumFile(const std::string& fileName, ULong64_t seed = 14695981039346656037ULL);
+};
+
+#endif
@@ -3,36 +3,119 @@
 
 // DYanalyzer classes
 #include "Data.h"
-#include "PU.h"
-#include "EfficiencySF.h"
-#include "RoccoR.h"
+#include "AnalysisCorrections.h"
 #include "GenPtc.h"
 #include "Muon.h"
 #include "Electron.h"
 #include "MET.h"
+#include "EventArena.h"
+#include "AllocProbe.h"
+#include "Telemetry.h"
+#include "SampleRegistry.h"
+#include "SparseHist.h"
+#include "Manifest.h"
 
 // ROOT classes
-#include "TRandom.h"
+#include "TRandom3.h"
 #include "TFile.h"
+#include "TNamed.h"
+#include "TParameter.h"
 #include "TH1.h"
 #include "TH2.h"
 
 // C++ classes
 #include <string>
 #include <vector>
+#include <set>
+#include <map>
+#include <memory>
 #include <iostream>
 #include <stdexcept>
-#include <regex>
 #include <algorithm>
 #include <iomanip>
+#include <utility>
+#include <chrono>
+
+// Data-taking era, resolved once from the era string at Init()
+enum class Era : UInt_t {k2016APV = 0, k2016, k2017, k2018};
+
+// Era-dependent trigger paths and noise filters
+struct EraTraits {
+    Bool_t bIsoMu24;
+    Bool_t bIsoTkMu24;
+    Bool_t bIsoMu27;
+    Bool_t bEcalBadCalibFilter;
+};
+// Indexed by Era
+constexpr EraTraits kEraTraits[] = {
+    {true,  true,  false, true},  // 2016APV : IsoMu24 || IsoTkMu24
+    {true,  true,  false, true},  // 2016    : IsoMu24 || IsoTkMu24
+    {false, false, true,  false}, // 2017    : IsoMu27
+    {true,  false, false, false}, // 2018    : IsoMu24
+};
+
+// Configuration bits of the event loop, used as a template parameter
+namespace LoopConfig {
+    constexpr UInt_t kIsMC      = 1u << 0;
+    constexpr UInt_t kDoPU      = 1u << 1;
+    constexpr UInt_t kDoL1      = 1u << 2;
+    constexpr UInt_t kDoRocco   = 1u << 3;
+    constexpr UInt_t kDoIDSF    = 1u << 4;
+    constexpr UInt_t kDoIsoSF   = 1u << 5;
+    constexpr UInt_t kDoTrigSF  = 1u << 6;
+    // Generic event loop : the flags above are read at run time from iConfigFlags
+    constexpr UInt_t kRuntime   = 1u << 31;
+}
+
+// Stages of the event loop timed by Telemetry, in the order of the stage names given at Init()
+namespace LoopStage {
+    constexpr Int_t kRead        = 0; // Next entry and object initialization (branches are read on access)
+    constexpr Int_t kCorrections = 1; // Event weights
+    constexpr Int_t kSelection   = 2; // Selection and histograms
+    constexpr Int_t kCheckpoint  = 3;
+}
+
+// Thresholds of the selection that can be changed without recompiling (DYanalysis --cut <name>=<value>)
+// The histogram names keep the default thresholds (e.g. _Wmass50, _Wmass200)
+struct SelectionCuts {
+    MuonCuts cMuon;
+    Double_t dW_MT_low = 50.;
+    Double_t dW_MT_high = 200.;
+
+    // Names of the thresholds : muon.tightPt, muon.tightEta, muon.tightIso, muon.loosePt, muon.looseEta, wmt.low, wmt.high
+    std::vector<std::pair<std::string, Double_t*>> Fields();
+    // "<name>=<value>", throws if the name is unknown or the value is not a number
+    void Set(const std::string& assignment);
+    // Thresholds that differ from the defaults, "<name>=<value>,...", empty if none
+    std::string ToString() const;
+};
 
 class DYanalyzer {
     private :
         // Classes that will be created only once, at the beginning of the analysis
-        Data* cData; // Class for loading Ntuple
-        PU* cPU; // Class for loading PU files and calculating PU weights
-        EfficiencySF* cEfficiencySF; // Class for loading efficiency SF files and calculating SFs
-        RoccoR* cRochesterCorrection; // Class for loading Rochester correction file and applying correction
+        Data* cData = nullptr; // Class for loading Ntuple
+        // Corrections of the era, built at Init() or shared with other analyzers (see SetCorrections())
+        std::shared_ptr<AnalysisCorrections> pCorrections;
+        PU* cPU = nullptr; // Class for loading PU files and calculating PU weights
+        EfficiencySF* cEfficiencySF = nullptr; // Class for loading efficiency SF files and calculating SFs
+        RoccoR* cRochesterCorrection = nullptr; // Class for loading Rochester correction file and applying correction
+        EventArena* cEventArena = nullptr; // Per-event arena for the object holders, reset at the top of each event
+        Telemetry* cTelemetry = nullptr; // Throughput, memory and I/O of the event loop
+
+        // Object classes, created at the beginning of the event loop
+        Muons* cMuons = nullptr;
+        Electrons* cElectrons = nullptr;
+        MET* cMET = nullptr;
+        GenPtcs* cGenPtcs = nullptr;
+
+        // Memoized per-event quantities, reset at the top of each event
+        Bool_t bEvtDidRocco = false;
+        Bool_t bEvtDidMuonSel = false;
+        Bool_t bEvtDidElectronSel = false;
+        Bool_t bEvtDidEffSF = false;
+        Bool_t bEvtDidPFMETCorr = false;
+        Double_t dEvtEffSFWeight = 1.0;
+        std::pair<Double_t, Double_t> pEvtPFMETCorr;
         
         // Flags for the class
         std::string sInputFileList;
@@ -42,6 +125,9 @@ class DYanalyzer {
         std::string sHistName_ID;
         std::string sHistName_Iso;
         std::string sHistName_Trig;
+        // Optional correctionlib files for PU weights and muon SFs, the ROOT files are used if empty
+        std::string sPUCorrectionFileName;
+        std::string sMuonSFCorrectionFileName;
 
         Bool_t bIsInit = false;
 
@@ -53,6 +139,26 @@ class DYanalyzer {
         Bool_t bDoIsoSF = false;
         Bool_t bDoTrigSF = false;
         Bool_t bDoRocco = false;
+        Bool_t bFastRocco = false; // Tabulated CrystalBall cdf/invcdf in RoccoR, opt-in
+        Bool_t bRoccoReplicas = false; // Fill histograms for all sets and members of RoccoR, opt-in
+        Bool_t bPUVariations = false; // PU up/down histograms, only with PU correction and up/down data profiles (set at Init())
+
+        // Set and member of the Rochester correction applied to the muons
+        Int_t iRoccoSet = 5;
+        Int_t iRoccoMember = 0;
+        // Per-event inputs and outputs of the batch Rocco evaluation, reused across events
+        std::vector<Int_t> vRoccoCharge;
+        std::vector<Double_t> vRoccoPt;
+        std::vector<Double_t> vRoccoEta;
+        std::vector<Double_t> vRoccoPhi;
+        std::vector<Double_t> vRoccoGenPt;
+        std::vector<Int_t> vRoccoNLayers;
+        std::vector<Double_t> vRoccoRandom;
+        std::vector<Double_t> vRoccoSF;
+        std::vector<Double_t> vRoccoReplicaSF;
+
+        // Metadata of the process, from the sample registry at Init()
+        const SampleInfo* pSampleInfo = nullptr;
 
         // Check process name and determine whether to perform Gen-lv patching
         Bool_t bIsInclusiveW = false;
@@ -66,8 +172,109 @@ class DYanalyzer {
         Double_t dW_mass_cut_high = 1e9; //Default to infinity
 
         Long64_t nTotalEvents = 0;
+        // Entry range of the input chain, all entries if nLastEntry < 0 (see Data::SetEntryRange())
+        Long64_t nFirstEntry = 0;
+        Long64_t nLastEntry = -1;
+        // Files of the input list that are not read (see Manifest.h)
+        std::set<std::string> sSkipInputFiles;
+        // Known numbers of entries of input files (see Data::SetKnownEntries())
+        std::map<std::string, Long64_t> mKnownEntries;
+        // Check of the inputs done before Init(), e.g. once for all slices of --jobs (see Data::CheckInputs())
+        std::shared_ptr<const Data::InputCheck> pInputCheck;
+        // Retries of unreadable inputs (see Data::SetInputRetries())
+        Int_t nInputRetries = 3;
+        Double_t dInputRetryDelay = 2.;
+
+        // Selection thresholds, and histograms written by WriteHistograms() (all if empty, a trailing "*" matches any suffix)
+        SelectionCuts cCuts;
+        std::vector<std::string> vHistogramList;
+        Bool_t IsHistogramListed(const std::string& name);
 
         Double_t dSumOfGenEvtWeight = 0;
+        Double_t dSumOfGenEvtWeight_PUUp = 0;
+        Double_t dSumOfGenEvtWeight_PUDown = 0;
+        // Scale of the written histograms (cross section * luminosity / sum of weights of the sample, see SampleIndex.h), 0 : not normalized
+        Double_t dNormalizationScale = 0.;
+
+        // Random numbers of the Rocco smearing (not matched muons), its state is part of the checkpoints
+        TRandom3 cRandom;
+        UInt_t iRandomSeed = 4357; // Default seed of TRandom3, same as gRandom
+
+        // Checkpoints of the event loop : histograms, sums of weights, random number state, next chain entry,
+        // files of the chain and inputs not read so far, written every nCheckpointEvents events and/or every dCheckpointSeconds seconds (disabled if both are 0)
+        std::string sCheckpointFileName;
+        Long64_t nCheckpointEvents = 0;
+        Double_t dCheckpointSeconds = 0;
+        Bool_t bResume = false;
+        // Telemetry output ("-" : stderr, "none" : disabled) and minimum interval between two lines
+        std::string sTelemetryFileName = "-";
+        Double_t dTelemetryInterval = 60.;
+        Bool_t bTelemetryIOStats = true;
+        // Checkpoint to resume from, open between Init() steps, and the chain entry it stopped at
+        TFile* fResumeCheckpoint = nullptr;
+        Long64_t nResumeEntry = -1;
+        // Chain and skipped inputs of the checkpoint : the resumed job reads the same files, so that the chain entry is the same event
+        std::shared_ptr<const Data::InputCheck> pResumeInputCheck;
+        std::chrono::steady_clock::time_point tLastCheckpoint;
+
+        // PF MET xy-shift correction coefficients, resolved once at Init()
+        METXYCorrParams cMETXYCorrParams;
+
+        // Number of upstream (malloc) allocations of the arena after the first event, to check the steady state
+        ULong64_t nArenaUpstreamAllocs_firstEvt = 0;
+        // Heap allocations while processing the events after the warm-up, counted with the allocation probe (see include/AllocProbe.h)
+        ULong64_t nHeapAllocs_afterWarmUp = 0;
+        ULong64_t nHeapAllocs_maxPerEvt = 0;
+        Long64_t nHeapAllocEvts_afterWarmUp = 0;
+
+        // Era and configuration bits of the event loop, set at Init()
+        Era eEra = Era::k2016APV;
+        UInt_t iConfigFlags = 0;
+
+        // Configuration checks, resolved at compile time unless F is the generic LoopConfig::kRuntime
+        // HasFlag requires all given bits, HasAnyFlag at least one of them
+        template <UInt_t F>
+        Bool_t HasFlag(UInt_t bits) const {
+            if constexpr ((F & LoopConfig::kRuntime) != 0) return (iConfigFlags & bits) == bits;
+            else return (F & bits) == bits;
+        }
+        template <UInt_t F>
+        Bool_t HasAnyFlag(UInt_t bits) const {
+            if constexpr ((F & LoopConfig::kRuntime) != 0) return (iConfigFlags & bits) != 0;
+            else return (F & bits) != 0;
+        }
+
+        // Event loop specialized on era and configuration, selected once per Analyze() call
+        using EventLoopFunc = void (DYanalyzer::*)();
+        template <Era E, UInt_t F> void EventLoop();
+        template <Era E, std::size_t... I> EventLoopFunc SelectEventLoop(std::index_sequence<I...>);
+        EventLoopFunc SelectEventLoop();
+        UInt_t BuildConfigFlags();
+        static Era ParseEra(const std::string& era);
+
+        // Lazily evaluated per-event quantities
+        void ResetEventCache();
+        void PrepareRoccoInputs();
+        template <UInt_t F> void ApplyRocco();
+        template <UInt_t F> void DoMuonSelection();
+        void DoElectronSelection();
+        template <UInt_t F> Double_t GetEffSFWeight();
+        const std::pair<Double_t, Double_t>& GetPFMETXYCorr();
+
+        // Checkpoints (see SetCheckpoint())
+        // Configuration the checkpoint belongs to, a checkpoint of another configuration is not resumed
+        std::string GetCheckpointConfig();
+        Bool_t IsCheckpointDue(Long64_t iEvt);
+        void WriteCheckpoint(Long64_t nextEntry);
+        // OpenCheckpoint() sets the entry to restart from (before Data::Init()), RestoreCheckpoint() the state (after DeclareHistograms())
+        void OpenCheckpoint();
+        void RestoreCheckpoint();
+
+        // Histogram of the registry to write : the booked one, or the expansion of a sparse one into expanded
+        TH1* GetWritableHistogram(std::size_t iHist, std::unique_ptr<TH1D>& expanded);
+
+        // Fill the Rocco replica histograms for the selected muon
+        void FillRoccoReplicas(MuonHolder& muon, Double_t W_MT, Double_t W_MT_PFMET_corr, Double_t eventWeight);
 
     public :
         DYanalyzer( const std::string& inputFileList, const std::string& processName, const std::string& era,
@@ -94,10 +301,18 @@ class DYanalyzer {
         void PrintInitInfo();
         // Check process name and determine whether to perform Gen-lv patching
         void CheckGenPatching();
-        // Simple utility to print progress
-        void PrintProgress(const int currentStep);
         // Write histograms to file
         void WriteHistograms(TFile* f_output);
+        // Configuration that changes the histograms, without the inputs (see Manifest.h)
+        std::string GetAnalysisConfig();
+        // Inputs covered by the histograms and inputs skipped because they could not be read, should be called after Analyze()
+        Manifest GetManifest();
+        // Configuration of the corrections this analyzer needs, an instance built for it can be shared (see SetCorrections())
+        AnalysisCorrections::Config GetCorrectionConfig();
+        // All booked histograms, in booking order (nullptr for the sparse ones, see vSparseHistograms)
+        const std::vector<TH1*>& GetHistograms() {return vHistograms;}
+        // Heap allocations of the event loop after the warm-up, 0 without the allocation probe, should be called after Analyze()
+        ULong64_t GetNHeapAllocs() {return nHeapAllocs_afterWarmUp;}
 
         // Getters
         Bool_t IsMC() {return bIsMC;}
@@ -107,6 +322,9 @@ class DYanalyzer {
         Bool_t DoIsoSF() {return bDoIsoSF;}
         Bool_t DoTrigSF() {return bDoTrigSF;}
         Bool_t DoRocco() {return bDoRocco;}
+        Bool_t FastRocco() {return bFastRocco;}
+        Bool_t RoccoReplicas() {return bRoccoReplicas;}
+        Bool_t PUVariations() {return bPUVariations;}
         Bool_t DoGenPatching() {return bDoGenPatching;}
 
         Bool_t IsInclusiveW() {return bIsInclusiveW;}
@@ -114,6 +332,7 @@ class DYanalyzer {
         Bool_t IsOffshellW() {return bIsOffshellW;}
         Bool_t IsOffshellWToTauNu() {return bIsOffshellWToTauNu;}
 
+        const SampleInfo& GetSampleInfo() {return *pSampleInfo;}
         Double_t GetHT_cut_high() {return dHT_cut_high;}
         Double_t GetW_mass_cut_high() {return dW_mass_cut_high;}
 
@@ -125,6 +344,9 @@ class DYanalyzer {
         PU& GetPU() {return *cPU;}
         EfficiencySF& GetEffSF() {return *cEfficiencySF;}
         RoccoR& GetRocco() {return *cRochesterCorrection;}
+        const std::shared_ptr<AnalysisCorrections>& GetCorrections() {return pCorrections;}
+        EventArena& GetEventArena() {return *cEventArena;}
+        Telemetry& GetTelemetry() {return *cTelemetry;}
 
         // Setters
         void SetDoPUCorrection(Bool_t doPUCorrection) {bDoPUCorrection = doPUCorrection;}
@@ -133,80 +355,131 @@ class DYanalyzer {
         void SetDoIsoSF(Bool_t doIsoSF) {bDoIsoSF = doIsoSF;}
         void SetDoTrigSF(Bool_t doTrigSF) {bDoTrigSF = doTrigSF;}
         void SetDoRocco(Bool_t doRocco) {bDoRocco = doRocco;}
+        void SetFastRocco(Bool_t fastRocco) {bFastRocco = fastRocco;}
+        void SetRoccoReplicas(Bool_t roccoReplicas) {bRoccoReplicas = roccoReplicas;}
         void SetDoGenPatching(Bool_t doGenPatching) {bDoGenPatching = doGenPatching;}
+        void SetPUCorrectionFileName(const std::string& fileName) {sPUCorrectionFileName = fileName;}
+        void SetMuonSFCorrectionFileName(const std::string& fileName) {sMuonSFCorrectionFileName = fileName;}
+        void SetEntryRange(Long64_t firstEntry, Long64_t lastEntry) {nFirstEntry = firstEntry; nLastEntry = lastEntry;}
+        void SetSkipInputFiles(const std::set<std::string>& skipFiles) {sSkipInputFiles = skipFiles;}
+        void SetKnownEntries(const std::map<std::string, Long64_t>& knownEntries) {mKnownEntries = knownEntries;}
+        void SetInputCheck(const std::shared_ptr<const Data::InputCheck>& inputCheck) {pInputCheck = inputCheck;}
+        void SetInputRetries(Int_t retries, Double_t delaySeconds) {nInputRetries = retries; dInputRetryDelay = delaySeconds;}
+        void SetCuts(const SelectionCuts& cuts) {cCuts = cuts;}
+        const SelectionCuts& GetCuts() {return cCuts;}
+        // Comma-separated names of the histograms to write, e.g. "hW_MT_after*,hMuon_pT_after"
+        void SetHistogramList(const std::string& histograms);
+        void SetRandomSeed(UInt_t seed) {iRandomSeed = seed; cRandom.SetSeed(seed);}
+        // Should be called before Init(), resume restarts from the checkpoint if it exists and matches the configuration
+        void SetCheckpoint(const std::string& fileName, Long64_t everyEvents, Double_t everySeconds) {sCheckpointFileName = fileName; nCheckpointEvents = everyEvents; dCheckpointSeconds = everySeconds;}
+        void SetResume(Bool_t resume) {bResume = resume;}
+        // I/O statistics use the global gPerfStats of ROOT, they should be disabled if analyzers run in concurrent threads
+        void SetTelemetry(const std::string& fileName, Double_t intervalSeconds, Bool_t ioStats = true) {sTelemetryFileName = fileName; dTelemetryInterval = intervalSeconds; bTelemetryIOStats = ioStats;}
+        // Should be called before Init(), the configuration of the corrections must be GetCorrectionConfig()
+        void SetCorrections(const std::shared_ptr<AnalysisCorrections>& corrections) {pCorrections = corrections;}
+        // Histograms are scaled at WriteHistograms(), except the sums of weights (hGenEvtWeight*)
+        void SetNormalizationScale(Double_t scale) {dNormalizationScale = scale;}
 
         ////////////////////////////////////////////////////////////
         //////////////////////// Histograms ////////////////////////
         ////////////////////////////////////////////////////////////
+        // Registry of the histograms, every histogram is booked with Sumw2() and written to the output
+        // (name = title, fixed binning : outputs can be merged bin by bin, see HistMerger.h)
+        // The fine spectra are booked sparse, owned by the analyzer and written as TH1D (see SparseHist.h),
+        // vSparseHistograms[i] is set and vHistograms[i] is nullptr for them
+        std::vector<TH1*> vHistograms;
+        std::vector<std::unique_ptr<SparseTH1D>> vSparseHistograms;
+        TH1D* BookTH1D(const char* name, Int_t nBinsX, Double_t xLow, Double_t xHigh) {
+            TH1D* h = new TH1D(name, name, nBinsX, xLow, xHigh);
+            h->Sumw2();
+            vHistograms.push_back(h);
+            vSparseHistograms.emplace_back(nullptr);
+            return h;
+        }
+        SparseTH1D* BookSparseTH1D(const char* name, Int_t nBinsX, Double_t xLow, Double_t xHigh) {
+            vSparseHistograms.emplace_back(new SparseTH1D(name, nBinsX, xLow, xHigh));
+            vHistograms.push_back(nullptr);
+            return vSparseHistograms.back().get();
+        }
+        TH2D* BookTH2D(const char* name, Int_t nBinsX, Double_t xLow, Double_t xHigh, Int_t nBinsY, Double_t yLow, Double_t yHigh) {
+            TH2D* h = new TH2D(name, name, nBinsX, xLow, xHigh, nBinsY, yLow, yHigh);
+            h->Sumw2();
+            vHistograms.push_back(h);
+            vSparseHistograms.emplace_back(nullptr);
+            return h;
+        }
 
         ////////////////////////////////////////////////////////////
         // GenLevel event weights, before and after each correction
         ////////////////////////////////////////////////////////////
         TH1D* hGenEvtWeight;
+        // With the PU weight varied by the minimum-bias cross-section uncertainty
+        TH1D* hGenEvtWeight_PUUp = nullptr;
+        TH1D* hGenEvtWeight_PUDown = nullptr;
 
         ////////////////////////////////////////////////////////////
         // Before event selection
         ////////////////////////////////////////////////////////////
 
         // GenLevel Object histograms
-        TH1D* hGen_Muon_pT;
+        SparseTH1D* hGen_Muon_pT;
         TH1D* hGen_Muon_phi;
         TH1D* hGen_Muon_eta;
 
-        TH1D* hGen_Nu_pT;
+        SparseTH1D* hGen_Nu_pT;
         TH1D* hGen_Nu_phi;
         TH1D* hGen_Nu_eta;
 
         TH1D* hGen_MET_phi;
-        TH1D* hGen_MET_pT;
+        SparseTH1D* hGen_MET_pT;
 
         // For GenLevel W decaying to muon and neutrino
-        TH1D* hGen_WToMuNu_pT;
+        SparseTH1D* hGen_WToMuNu_pT;
         TH1D* hGen_WToMuNu_eta;
         TH1D* hGen_WToMuNu_phi;
-        TH1D* hGen_WToMuNu_mass;
-        TH1D* hGen_WToMuNu_MT;
+        SparseTH1D* hGen_WToMuNu_mass;
+        SparseTH1D* hGen_WToMuNu_MT;
 
         // For GenLevel inclusive decaying W
-        TH1D* hGen_W_pT;
+        SparseTH1D* hGen_W_pT;
         TH1D* hGen_W_eta;
         TH1D* hGen_W_phi;
-        TH1D* hGen_W_mass;
-        TH1D* hGen_W_MT;
+        SparseTH1D* hGen_W_mass;
+        SparseTH1D* hGen_W_MT;
 
         // For LHE HT
-        TH1D* hLHE_HT;
+        SparseTH1D* hLHE_HT;
 
-        // Object histograms
-        TH1D* hMuon_pT;
+        // Object histograms, filled after the trigger and noise filters
+        SparseTH1D* hMuon_pT;
         TH1D* hMuon_phi;
         TH1D* hMuon_eta;
         TH1D* hMuon_mass;
 
         TH1D* hMET_phi;
-        TH1D* hMET_pT;
-        TH1D* hMET_sumET;
+        SparseTH1D* hMET_pT;
+        SparseTH1D* hMET_sumET;
 
         TH1D* hPFMET_phi;
-        TH1D* hPFMET_pT;
-        TH1D* hPFMET_sumET;
+        SparseTH1D* hPFMET_pT;
+        SparseTH1D* hPFMET_sumET;
 
         TH1D* hPFMET_corr_phi;
-        TH1D* hPFMET_corr_pT;
-        TH1D* hPFMET_corr_sumET;
+        SparseTH1D* hPFMET_corr_pT;
+        SparseTH1D* hPFMET_corr_sumET;
 
         // Balance between muon and MET
         TH1D* hPt_Mu_over_MET;
 
         // Reconstructed W histograms
         TH1D* hDeltaPhi_Mu_MET;
-        TH1D* hW_MT;
+        SparseTH1D* hW_MT;
 
         TH1D* hDeltaPhi_Mu_PFMET;
-        TH1D* hW_MT_PFMET;
+        SparseTH1D* hW_MT_PFMET;
 
         TH1D* hDeltaPhi_Mu_PFMET_corr;
-        TH1D* hW_MT_PFMET_corr;
+        SparseTH1D* hW_MT_PFMET_corr;
 
         // For NPV, NPU, NTrueInt before event selection
         // For NTrueInt -> Only present in MC
@@ -219,37 +492,37 @@ class DYanalyzer {
         ////////////////////////////////////////////////////////////
 
         // GenLevel Object histograms
-        TH1D* hGen_Muon_pT_after;
+        SparseTH1D* hGen_Muon_pT_after;
         TH1D* hGen_Muon_phi_after;
         TH1D* hGen_Muon_eta_after;
 
-        TH1D* hGen_Nu_pT_after;
+        SparseTH1D* hGen_Nu_pT_after;
         TH1D* hGen_Nu_phi_after;
         TH1D* hGen_Nu_eta_after;
 
         TH1D* hGen_MET_phi_after;
-        TH1D* hGen_MET_pT_after;
+        SparseTH1D* hGen_MET_pT_after;
 
         // For GenLevel W decaying to muon and neutrino
-        TH1D* hGen_WToMuNu_pT_after;
+        SparseTH1D* hGen_WToMuNu_pT_after;
         TH1D* hGen_WToMuNu_eta_after;
         TH1D* hGen_WToMuNu_phi_after;
-        TH1D* hGen_WToMuNu_mass_after;
-        TH1D* hGen_WToMuNu_MT_after;
+        SparseTH1D* hGen_WToMuNu_mass_after;
+        SparseTH1D* hGen_WToMuNu_MT_after;
 
         // For GenLevel inclusive decaying W
         // This cannot exist because after event selection, muon filtering is already done
-        TH1D* hGen_W_pT_after;
+        SparseTH1D* hGen_W_pT_after;
         TH1D* hGen_W_eta_after;
         TH1D* hGen_W_phi_after;
-        TH1D* hGen_W_mass_after;
-        TH1D* hGen_W_MT_after;
+        SparseTH1D* hGen_W_mass_after;
+        SparseTH1D* hGen_W_MT_after;
 
         // For LHE HT
-        TH1D* hLHE_HT_after;
+        SparseTH1D* hLHE_HT_after;
 
         // Object histograms
-        TH1D* hMuon_pT_after;
+        SparseTH1D* hMuon_pT_after;
         TH1D* hMuon_pT_after_40GeVBin;
         TH1D* hMuon_pT_after_80GeVBin;
         TH1D* hMuon_phi_after;
@@ -257,42 +530,53 @@ class DYanalyzer {
         TH1D* hMuon_mass_after;
 
         TH1D* hMET_phi_after;
-        TH1D* hMET_pT_after;
+        SparseTH1D* hMET_pT_after;
         TH1D* hMET_pT_after_40GeVBin;
         TH1D* hMET_pT_after_80GeVBin;
-        TH1D* hMET_sumET_after;
+        SparseTH1D* hMET_sumET_after;
 
         TH1D* hPFMET_phi_after;
-        TH1D* hPFMET_pT_after;
+        SparseTH1D* hPFMET_pT_after;
         TH1D* hPFMET_pT_after_40GeVBin;
         TH1D* hPFMET_pT_after_80GeVBin;
-        TH1D* hPFMET_sumET_after;
+        SparseTH1D* hPFMET_sumET_after;
 
         TH1D* hPFMET_corr_phi_after;
-        TH1D* hPFMET_corr_pT_after;
+        SparseTH1D* hPFMET_corr_pT_after;
         TH1D* hPFMET_corr_pT_after_40GeVBin;
         TH1D* hPFMET_corr_pT_after_80GeVBin;
-        TH1D* hPFMET_corr_sumET_after;
+        SparseTH1D* hPFMET_corr_sumET_after;
 
         // Balance between muon and MET
         TH1D* hPt_Mu_over_MET_after;
 
         // Reconstructed W histograms
         TH1D* hDeltaPhi_Mu_MET_after;
-        TH1D* hW_MT_after;
+        SparseTH1D* hW_MT_after;
+        SparseTH1D* hW_MT_after_PUUp = nullptr;
+        SparseTH1D* hW_MT_after_PUDown = nullptr;
         TH1D* hW_MT_after_40GeVBin;
         TH1D* hW_MT_after_80GeVBin;
 
         TH1D* hDeltaPhi_Mu_PFMET_after;
-        TH1D* hW_MT_PFMET_after;
+        SparseTH1D* hW_MT_PFMET_after;
+        SparseTH1D* hW_MT_PFMET_after_PUUp = nullptr;
+        SparseTH1D* hW_MT_PFMET_after_PUDown = nullptr;
         TH1D* hW_MT_PFMET_after_40GeVBin;
         TH1D* hW_MT_PFMET_after_80GeVBin;
 
         TH1D* hDeltaPhi_Mu_PFMET_corr_after;
-        TH1D* hW_MT_PFMET_corr_after;
+        SparseTH1D* hW_MT_PFMET_corr_after;
+        SparseTH1D* hW_MT_PFMET_corr_after_PUUp = nullptr;
+        SparseTH1D* hW_MT_PFMET_corr_after_PUDown = nullptr;
         TH1D* hW_MT_PFMET_corr_after_40GeVBin;
         TH1D* hW_MT_PFMET_corr_after_80GeVBin;
 
+        // Rochester correction replicas, only if enabled
+        TH2D* hMuon_pT_after_RoccoReplica = nullptr;
+        TH2D* hW_MT_after_RoccoReplica = nullptr;
+        TH2D* hW_MT_PFMET_corr_after_RoccoReplica = nullptr;
+
         // For NPV, NPU, NTrueInt before event selection
         // For NTrueInt -> Only present in MC
         TH1D* hNPV_after;
@@ -304,7 +588,7 @@ class DYanalyzer {
         ////////////////////////////////////////////////////////////
 
         // Object histograms
-        TH1D* hMuon_pT_after_Wmass50;
+        SparseTH1D* hMuon_pT_after_Wmass50;
         TH1D* hMuon_pT_after_Wmass50_40GeVBin;
         TH1D* hMuon_pT_after_Wmass50_80GeVBin;
         TH1D* hMuon_phi_after_Wmass50;
@@ -312,39 +596,39 @@ class DYanalyzer {
         TH1D* hMuon_mass_after_Wmass50;
 
         TH1D* hMET_phi_after_Wmass50;
-        TH1D* hMET_pT_after_Wmass50;
+        SparseTH1D* hMET_pT_after_Wmass50;
         TH1D* hMET_pT_after_Wmass50_40GeVBin;
         TH1D* hMET_pT_after_Wmass50_80GeVBin;
-        TH1D* hMET_sumET_after_Wmass50;
+        SparseTH1D* hMET_sumET_after_Wmass50;
 
         TH1D* hPFMET_phi_after_Wmass50;
-        TH1D* hPFMET_pT_after_Wmass50;
+        SparseTH1D* hPFMET_pT_after_Wmass50;
         TH1D* hPFMET_pT_after_Wmass50_40GeVBin;
         TH1D* hPFMET_pT_after_Wmass50_80GeVBin;
-        TH1D* hPFMET_sumET_after_Wmass50;
+        SparseTH1D* hPFMET_sumET_after_Wmass50;
 
         TH1D* hPFMET_corr_phi_after_Wmass50;
-        TH1D* hPFMET_corr_pT_after_Wmass50;
+        SparseTH1D* hPFMET_corr_pT_after_Wmass50;
         TH1D* hPFMET_corr_pT_after_Wmass50_40GeVBin;
         TH1D* hPFMET_corr_pT_after_Wmass50_80GeVBin;
-        TH1D* hPFMET_corr_sumET_after_Wmass50;
+        SparseTH1D* hPFMET_corr_sumET_after_Wmass50;
 
         // Balance between muon and MET
         TH1D* hPt_Mu_over_MET_after_Wmass50;
 
         // Reconstructed W histograms
         TH1D* hDeltaPhi_Mu_MET_after_Wmass50;
-        TH1D* hW_MT_after_Wmass50;
+        SparseTH1D* hW_MT_after_Wmass50;
         TH1D* hW_MT_after_Wmass50_40GeVBin;
         TH1D* hW_MT_after_Wmass50_80GeVBin;
 
         TH1D* hDeltaPhi_Mu_PFMET_after_Wmass50;
-        TH1D* hW_MT_PFMET_after_Wmass50;
+        SparseTH1D* hW_MT_PFMET_after_Wmass50;
         TH1D* hW_MT_PFMET_after_Wmass50_40GeVBin;
         TH1D* hW_MT_PFMET_after_Wmass50_80GeVBin;
 
         TH1D* hDeltaPhi_Mu_PFMET_corr_after_Wmass50;
-        TH1D* hW_MT_PFMET_corr_after_Wmass50;
+        SparseTH1D* hW_MT_PFMET_corr_after_Wmass50;
         TH1D* hW_MT_PFMET_corr_after_Wmass50_40GeVBin;
         TH1D* hW_MT_PFMET_corr_after_Wmass50_80GeVBin;
 
@@ -359,7 +643,7 @@ class DYanalyzer {
         ////////////////////////////////////////////////////////////
 
         // Object histograms
-        TH1D* hMuon_pT_after_Wmass200;
+        SparseTH1D* hMuon_pT_after_Wmass200;
         TH1D* hMuon_pT_after_Wmass200_40GeVBin;
         TH1D* hMuon_pT_after_Wmass200_80GeVBin;
         TH1D* hMuon_phi_after_Wmass200;
@@ -367,39 +651,39 @@ class DYanalyzer {
         TH1D* hMuon_mass_after_Wmass200;
 
         TH1D* hMET_phi_after_Wmass200;
-        TH1D* hMET_pT_after_Wmass200;
+        SparseTH1D* hMET_pT_after_Wmass200;
         TH1D* hMET_pT_after_Wmass200_40GeVBin;
         TH1D* hMET_pT_after_Wmass200_80GeVBin;
-        TH1D* hMET_sumET_after_Wmass200;
+        SparseTH1D* hMET_sumET_after_Wmass200;
 
         TH1D* hPFMET_phi_after_Wmass200;
-        TH1D* hPFMET_pT_after_Wmass200;
+        SparseTH1D* hPFMET_pT_after_Wmass200;
         TH1D* hPFMET_pT_after_Wmass200_40GeVBin;
         TH1D* hPFMET_pT_after_Wmass200_80GeVBin;
-        TH1D* hPFMET_sumET_after_Wmass200;
+        SparseTH1D* hPFMET_sumET_after_Wmass200;
 
         TH1D* hPFMET_corr_phi_after_Wmass200;
-        TH1D* hPFMET_corr_pT_after_Wmass200;
+        SparseTH1D* hPFMET_corr_pT_after_Wmass200;
         TH1D* hPFMET_corr_pT_after_Wmass200_40GeVBin;
         TH1D* hPFMET_corr_pT_after_Wmass200_80GeVBin;
-        TH1D* hPFMET_corr_sumET_after_Wmass200;
+        SparseTH1D* hPFMET_corr_sumET_after_Wmass200;
 
         // Balance between muon and MET
         TH1D* hPt_Mu_over_MET_after_Wmass200;
 
         // Reconstructed W histograms
         TH1D* hDeltaPhi_Mu_MET_after_Wmass200;
-        TH1D* hW_MT_after_Wmass200;
+        SparseTH1D* hW_MT_after_Wmass200;
         TH1D* hW_MT_after_Wmass200_40GeVBin;
         TH1D* hW_MT_after_Wmass200_80GeVBin;
 
         TH1D* hDeltaPhi_Mu_PFMET_after_Wmass200;
-        TH1D* hW_MT_PFMET_after_Wmass200;
+        SparseTH1D* hW_MT_PFMET_after_Wmass200;
         TH1D* hW_MT_PFMET_after_Wmass200_40GeVBin;
         TH1D* hW_MT_PFMET_after_Wmass200_80GeVBin;
 
         TH1D* hDeltaPhi_Mu_PFMET_corr_after_Wmass200;
-        TH1D* hW_MT_PFMET_corr_after_Wmass200;
+        SparseTH1D* hW_MT_PFMET_corr_after_Wmass200;
         TH1D* hW_MT_PFMET_corr_after_Wmass200_40GeVBin;
         TH1D* hW_MT_PFMET_corr_after_Wmass200_80GeVBin;
 
@@ -413,11 +697,11 @@ class DYanalyzer {
         // For Z peak mass study
         ////////////////////////////////////////////////////////////
 
-        TH1D* hDilepton_org_mass;
-        TH1D* hDilepton_rocco_mass;
+        SparseTH1D* hDilepton_org_mass;
+        SparseTH1D* hDilepton_rocco_mass;
 
-        TH1D* hDilepton_org_mass_after;
-        TH1D* hDilepton_rocco_mass_after;
+        SparseTH1D* hDilepton_org_mass_after;
+        SparseTH1D* hDilepton_rocco_mass_after;
 };
 
 #endif
\ No newline at end of file
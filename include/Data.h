@@ -10,11 +10,43 @@
 // C++ classes
 #include <string>
 #include <vector>
+#include <set>
+#include <map>
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
+#include <algorithm>
 
 class Data {
+    public :
+        // Concurrent opens of CheckInputs() at Init(), the files are usually remote (xrootd, /pnfs)
+        static constexpr Int_t kInputCheckThreads = 8;
+
+        // Entries [nFirstEntry, nLastEntry) of an input that were not read, nLastEntry < 0 if the file could not be opened (entries unknown)
+        struct SkippedInput {
+            std::string sFileName;
+            Long64_t nFirstEntry = 0;
+            Long64_t nLastEntry = -1;
+            std::string sReason;
+        };
+        // Result of CheckInputs() : readable files with their numbers of entries, in the order of the list, and the unreadable ones
+        struct InputCheck {
+            std::vector<std::string> vFileNames;
+            std::vector<Long64_t> vEntries;
+            std::vector<SkippedInput> vSkipped;
+            Long64_t GetTotalEntries() const;
+            Bool_t HasSameChain(const InputCheck& other) const { return vFileNames == other.vFileNames && vEntries == other.vEntries; }
+
+            // Text form, one tab-separated line per file and per skipped input, kept with the checkpoints (see DYanalyzer::WriteCheckpoint())
+            std::string ToString() const;
+            // Throws if the text is invalid
+            static InputCheck FromString(const std::string& text);
+            // False if the file does not exist, throws if it is invalid
+            Bool_t Read(const std::string& fileName);
+            // Written to a temporary file and renamed
+            Bool_t Write(const std::string& fileName) const;
+        };
+
     private :
         std::string sProcessName;
         std::string sEra;
@@ -27,6 +59,26 @@ class Data {
 
         Bool_t bIsInit = false;
         Long64_t nTotalEvents = 0;
+        // Entries [nFirstEntry, nLastEntry) of the chain, up to the last entry if nLastEntry < 0
+        Long64_t nFirstEntry = 0;
+        Long64_t nLastEntry = -1;
+        // Files of the input list that are not read (already processed, see Manifest.h), and the files of the chain
+        std::set<std::string> sSkipFiles;
+        std::vector<std::string> vFileNames;
+        // Numbers of entries of files that are already known (see AnalysisServer.h), these files are not opened by TChain::Add()
+        std::map<std::string, Long64_t> mKnownEntries;
+
+        // Inputs are checked before the chain is built (see CheckInputs()), unless the result is given (SetInputCheck())
+        // A file that cannot be opened or read is retried nInputRetries times, with a delay of dInputRetryDelay seconds doubled at each retry
+        Bool_t bHasInputCheck = false;
+        InputCheck cInputCheck;
+        Int_t nInputRetries = 3;
+        Double_t dInputRetryDelay = 2.;
+        // Inputs skipped at Init() or during the event loop
+        std::vector<SkippedInput> vSkippedInputs;
+
+        // Retries the entry of a read error, then skips the rest of its file, false at the end of the entries
+        Bool_t RecoverNextEntry();
 
     public :
         Data(const std::string& processName, const std::string& era, const std::string& inputFileList, Bool_t isMC)
@@ -40,6 +92,38 @@ class Data {
         void LoadBranches();
         void PrintInitInfo();
 
+        // Should be called before Init()
+        void SetEntryRange(Long64_t firstEntry, Long64_t lastEntry) {
+            nFirstEntry = firstEntry;
+            nLastEntry = lastEntry;
+        }
+
+        void SetSkipFiles(const std::set<std::string>& skipFiles) {
+            sSkipFiles = skipFiles;
+        }
+
+        void SetKnownEntries(const std::map<std::string, Long64_t>& knownEntries) {
+            mKnownEntries = knownEntries;
+        }
+
+        void SetInputCheck(const InputCheck& inputCheck) {
+            cInputCheck = inputCheck;
+            bHasInputCheck = true;
+        }
+
+        void SetInputRetries(Int_t retries, Double_t delaySeconds) {
+            nInputRetries = retries;
+            dInputRetryDelay = delaySeconds;
+        }
+
+        // Non-empty lines of the input file list, without the skipped files, lines ending with .txt are file lists read recursively
+        static std::vector<std::string> ReadFileList(const std::string& inputFileList, const std::set<std::string>& skipFiles = {});
+        // Opens each file and reads the header of its Events tree, with nThreads concurrent threads (ROOT thread safety is then enabled)
+        // Files whose entries are in knownEntries are not opened
+        // A file that cannot be opened is retried with backoff, a file without Events tree or not closed properly is skipped at once
+        static InputCheck CheckInputs(const std::vector<std::string>& fileNames, const std::map<std::string, Long64_t>& knownEntries,
+                                      Int_t nThreads, Int_t nRetries, Double_t retryDelay);
+
         // Should be called after Init()
         Long64_t GetTotalEvents() { return nTotalEvents; }
         Bool_t ReadNextEntry() {
@@ -47,8 +131,17 @@ class Data {
                 std::cerr << "[ERROR] Data::ReadNextEntry() - Data is not initialized" << std::endl;
                 return false;
             }
-            return fReader->Next();
+            if (fReader->Next()) return true;
+            return RecoverNextEntry();
         }
+        // Chain entry of the current event
+        Long64_t GetCurrentEntry() { return fReader->GetCurrentEntry(); }
+
+        // Files of the chain and their numbers of entries
+        const std::vector<std::string>& GetFileNames() { return vFileNames; }
+        std::vector<Long64_t> GetFileEntries();
+        // Inputs of the list that were not read, entirely or partly
+        const std::vector<SkippedInput>& GetSkippedInputs() { return vSkippedInputs; }
 
         // Getters
         TChain*      GetChain()  { return fChain; }
@@ -1,6 +1,11 @@
 #ifndef EfficiencySF_h
 #define EfficiencySF_h
 
+// DYanalysis classes
+#include "CalibTables.h"
+#include "Correction.h"
+#include "CorrectionStore.h"
+
 // ROOT classes
 #include "TFile.h"
 #include "TH2F.h"
@@ -9,41 +14,137 @@
 // C++ classes
 #include <string>
 #include <vector>
+#include <array>
+#include <memory>
 #include <iostream>
 #include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+// ID, Iso and Trig SFs of a single muon, with their uncertainties
+struct EfficiencySFResult {
+    Double_t dID = 0.;
+    Double_t dIso = 0.;
+    Double_t dTrig = 0.;
+    Double_t dIDErr = 0.;
+    Double_t dIsoErr = 0.;
+    Double_t dTrigErr = 0.;
+};
+
+// SF map of a TH2F (X-axis : |eta|, Y-axis : pT) flattened into contiguous arrays
+// Values are stored pt-major : index = iEta * nPt + iPt
+// The arrays point either to the tables embedded at build time (CalibTables.h)
+// or to a segment of the node-wide correction store (CorrectionStore.h) if the table is read from a ROOT file
+struct SFTable2D {
+    Int_t nEta = 0;
+    Int_t nPt = 0;
+    const Double_t* pEtaEdges = nullptr; // nEta + 1 edges
+    const Double_t* pPtEdges = nullptr;  // nPt + 1 edges
+    const Double_t* pValue = nullptr;
+    const Double_t* pError = nullptr;
+
+    // Keeps the segment mapped, null for embedded tables
+    std::shared_ptr<const CorrectionSegment> pSegment;
+
+    void SetView(const CalibHist& hist) {
+        nEta = hist.nX;
+        nPt = hist.nY;
+        pEtaEdges = hist.pXEdges;
+        pPtEdges = hist.pYEdges;
+        pValue = hist.pContent;
+        pError = hist.pError;
+        pSegment.reset();
+    }
+    // Segment layout : nEta, nPt, eta edges, pt edges, values, errors, all as doubles
+    void SetView(const std::shared_ptr<const CorrectionSegment>& segment) {
+        const Double_t* data = (const Double_t*)segment->GetData();
+        nEta = (Int_t)data[0];
+        nPt = (Int_t)data[1];
+        if (segment->GetSize() != (2 + (nEta + 1) + (nPt + 1) + 2 * nEta * nPt) * sizeof(Double_t)) {
+            throw std::runtime_error("[Runtime Error] SFTable2D::SetView() - Invalid SF table segment");
+        }
+        pEtaEdges = data + 2;
+        pPtEdges = pEtaEdges + nEta + 1;
+        pValue = pPtEdges + nPt + 1;
+        pError = pValue + nEta * nPt;
+        pSegment = segment;
+    }
+
+    Int_t GetNEta() const { return nEta; }
+    Int_t GetNPt() const { return nPt; }
+    Int_t GetNCells() const { return nEta * nPt; }
+    Double_t GetPtMin() const { return pPtEdges[0]; }
+    Double_t GetPtMax() const { return pPtEdges[nPt]; }
+    Double_t GetEtaMin() const { return pEtaEdges[0]; }
+    Double_t GetEtaMax() const { return pEtaEdges[nEta]; }
+
+    // Bin index along an axis of n bins, values outside of the axis are clamped to the first or the last bin
+    static Int_t FindBin(const Double_t* edges, Int_t n, Double_t x) {
+        Int_t bin = (Int_t)(std::upper_bound(edges, edges + n + 1, x) - edges) - 1;
+        return (bin < 0) ? 0 : (bin > n - 1) ? n - 1 : bin;
+    }
+    Int_t FindCell(Double_t pt, Double_t absEta) const {
+        return FindBin(pEtaEdges, nEta, absEta) * nPt + FindBin(pPtEdges, nPt, pt);
+    }
+    Bool_t HasSameBinning(const SFTable2D& other) const {
+        return nEta == other.nEta && nPt == other.nPt
+            && std::equal(pEtaEdges, pEtaEdges + nEta + 1, other.pEtaEdges)
+            && std::equal(pPtEdges, pPtEdges + nPt + 1, other.pPtEdges);
+    }
+};
+
+// Muon POG correctionlib SF, inputs : abseta (or eta), pt, and the type of value (scale_factors or ValType)
+struct SFCorrection {
+    const Correction* pCorrection = nullptr;
+    Int_t iEtaInput = 0;
+    Int_t iPtInput = 1;
+    Int_t iTypeInput = 2;
+    Bool_t bIsAbsEta = true;
+    Double_t dNominalId = -1.; // "nominal" or "sf"
+    Double_t dSystId = -1.;    // -1 if not available
+    Double_t dStatId = -1.;    // -1 if not available
+    Double_t dPtMin = 0.;      // Lowest pt edge of the map
+
+    Double_t Evaluate(Double_t pt, Double_t eta, Double_t typeId) const {
+        Double_t inputs[3];
+        inputs[iEtaInput] = bIsAbsEta ? std::abs(eta) : eta;
+        inputs[iPtInput] = pt;
+        inputs[iTypeInput] = typeId;
+        return pCorrection->Evaluate(inputs);
+    }
+    // Syst and stat uncertainties added in quadrature
+    Double_t EvaluateError(Double_t pt, Double_t eta) const {
+        Double_t syst = (dSystId >= 0.) ? Evaluate(pt, eta, dSystId) : 0.;
+        Double_t stat = (dStatId >= 0.) ? Evaluate(pt, eta, dStatId) : 0.;
+        return std::sqrt(syst * syst + stat * stat);
+    }
+};
 
 class EfficiencySF {
     private :
-        
-        TFile* fFile_ID = nullptr;
-        TFile* fFile_Iso = nullptr;
-        TFile* fFile_Trig = nullptr;
-
-        TH2F* hHist_ID = nullptr;
-        TH2F* hHist_Iso = nullptr;
-        TH2F* hHist_Trig = nullptr;
-
-        TAxis* tAxis_ID_pt    = nullptr;
-        TAxis* tAxis_ID_eta   = nullptr;
-        TAxis* tAxis_Iso_pt   = nullptr;
-        TAxis* tAxis_Iso_eta  = nullptr;
-        TAxis* tAxis_Trig_pt  = nullptr;
-        TAxis* tAxis_Trig_eta = nullptr;
-
-        Double_t dValidPtMin_ID;
-        Double_t dValidPtMax_ID;
-        Double_t dValidEtaMin_ID;
-        Double_t dValidEtaMax_ID;
-
-        Double_t dValidPtMin_Iso;
-        Double_t dValidPtMax_Iso;
-        Double_t dValidEtaMin_Iso;
-        Double_t dValidEtaMax_Iso;
-        
-        Double_t dValidPtMin_Trig;
-        Double_t dValidPtMax_Trig;
-        Double_t dValidEtaMin_Trig;
-        Double_t dValidEtaMax_Trig;
+
+        // Flat tables, embedded at build time or converted from the histograms at Init() (the ROOT files are closed afterwards)
+        SFTable2D cTable_ID;
+        SFTable2D cTable_Iso;
+        SFTable2D cTable_Trig;
+
+        // If the three maps share the same binning, a single lookup serves all of them,
+        // and the product ID*Iso*Trig is precomputed per cell
+        Bool_t bIsSharedBinning = false;
+        std::vector<Double_t> vProduct;
+
+        // Optional correctionlib backend, used instead of the ROOT maps if set
+        // The corrections are looked up by histogram name, with and without the "_abseta_pt" suffix
+        std::string sCorrectionFileName;
+        std::shared_ptr<const CorrectionSet> pCorrectionSet;
+        SFCorrection cCorrection_ID;
+        SFCorrection cCorrection_Iso;
+        SFCorrection cCorrection_Trig;
+        Bool_t bUseCorrection = false;
+
+        std::string sFileName_ID;
+        std::string sFileName_Iso;
+        std::string sFileName_Trig;
 
         std::string sHistName_ID;
         std::string sHistName_Iso;
@@ -52,8 +153,17 @@ class EfficiencySF {
         Bool_t bIsInit = false;
         std::string sEra;
 
+        // Number of tables found in the embedded calibration tables, the others are read from the ROOT files
+        Int_t nEmbeddedTables = 0;
+        // Number of tables attached from the node-wide correction store
+        Int_t nSharedTables = 0;
+
+        void LoadTable(const std::string& fileName, const std::string& histName, SFTable2D& table);
+        std::string ReadTable(const std::string& fileName, const std::string& histName);
+        void LoadCorrection(const std::string& histName, SFCorrection& correction);
+
     public :
-                
+
         EfficiencySF(const std::string& era, const std::string& histName_ID, const std::string& histName_Iso, const std::string& histName_Trig) :
             sEra(era), sHistName_ID(histName_ID), sHistName_Iso(histName_Iso), sHistName_Trig(histName_Trig) {};
         virtual ~EfficiencySF();
@@ -65,11 +175,28 @@ class EfficiencySF {
             sHistName_Trig = histName_Trig;
         }
 
+        void SetCorrection(const std::string& fileName) {sCorrectionFileName = fileName;}
+
         void Init();
         void Clear();
         void PrintInitInfo();
 
-        std::vector<Double_t> GetEfficiency(Double_t pt, Double_t eta);
+        // Returns {ID, Iso, Trig}, fixed size so that no heap allocation is done per call
+        std::array<Double_t, 3> GetEfficiency(Double_t pt, Double_t eta);
+        // All three SFs and their uncertainties
+        EfficiencySFResult GetSF(Double_t pt, Double_t eta);
+        // ID*Iso*Trig
+        Double_t GetSFProduct(Double_t pt, Double_t eta);
+
+        // Batch versions, for n muons (or events) at once
+        void GetSF(std::size_t n, const Double_t* pt, const Double_t* eta, EfficiencySFResult* sf);
+        void GetSFProduct(std::size_t n, const Double_t* pt, const Double_t* eta, Double_t* sfProduct);
+
+        // Getters
+        const SFTable2D& GetTable_ID() { return cTable_ID; }
+        const SFTable2D& GetTable_Iso() { return cTable_Iso; }
+        const SFTable2D& GetTable_Trig() { return cTable_Trig; }
+        Bool_t IsSharedBinning() { return bIsSharedBinning; }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -3,6 +3,7 @@
 
 // DYanalysis classes
 #include "Data.h"
+#include "EventArena.h"
 
 // ROOT classes
 #include "TLorentzVector.h"
@@ -64,28 +65,30 @@ class ElectronHolder {
 
 class Electrons {
     private :
-        std::vector<ElectronHolder> vElectronVec;
+        ArenaVector<ElectronHolder> vElectronVec;
         Data* cData;
         // Flags for the class
         Bool_t bIsInit = false;
         Bool_t bDidObjSel = false;
 
     public :
-        Electrons(Data* data) 
-            : cData(data)
+        // Holders are allocated from the per-event arena if given, from the heap otherwise
+        Electrons(Data* data, EventArena* arena = nullptr)
+            : vElectronVec(arena ? (std::pmr::memory_resource*) arena : std::pmr::get_default_resource()), cData(data)
         {};
         ~Electrons() {};
 
         void Init();
+        // Drops the holders without touching the arena, must be called before EventArena::Reset()
         void Reset() {
-            vElectronVec.clear();
+            ArenaVector<ElectronHolder>(vElectronVec.get_allocator()).swap(vElectronVec);
             bIsInit = false;
             bDidObjSel = false;
         };
         void DoObjSel();
         
-        std::vector<ElectronHolder>& GetElectrons();
-        std::vector<ElectronHolder> GetLooseElectrons();
+        ArenaVector<ElectronHolder>& GetElectrons();
+        ArenaVector<ElectronHolder> GetLooseElectrons();
 
         UInt_t GetNElectrons() { return **(cData->nElectron); }
 };
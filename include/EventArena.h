@@ -0,0 +1,72 @@
+#ifndef EventArena_h
+#define EventArena_h
+
+// ROOT classes
+#include "Rtypes.h"
+
+// C++ classes
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <memory_resource>
+
+// Per-event monotonic arena
+// Memory is handed out by bumping a pointer inside preallocated blocks, deallocate() does nothing
+// Reset() rewinds to the first block in O(1) and keeps the blocks, so after the first events the arena does not need new blocks
+// The counters below only see the arena : the heap allocations of the whole event processing are counted by AllocProbe
+// One arena per DYanalyzer, i.e. per thread : the arena is not thread-safe
+class EventArena : public std::pmr::memory_resource {
+    private :
+        struct Block {
+            char* pBegin;
+            std::size_t nSize;
+        };
+        std::vector<Block> vBlocks;
+        std::size_t iCurBlock = 0;
+        char* pCur = nullptr;
+        char* pEnd = nullptr;
+        std::size_t nBlockSize;
+
+        // Allocation counters
+        ULong64_t nAllocations = 0; // # of allocate() calls, i.e. allocations served by the arena instead of the heap
+        ULong64_t nUpstreamAllocations = 0; // # of new blocks, i.e. actual malloc calls
+        std::size_t nBytesInUse = 0; // Bytes handed out since the last Reset()
+        std::size_t nPeakBytesInUse = 0;
+        ULong64_t nResets = 0;
+
+        void AddBlock(std::size_t minSize);
+
+    protected :
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void*, std::size_t, std::size_t) override {}; // Released all at once by Reset()
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    public :
+        EventArena(std::size_t blockSize = 64 * 1024)
+            : nBlockSize(blockSize)
+        {};
+        virtual ~EventArena();
+
+        // Everything allocated since the last Reset() becomes invalid
+        void Reset() {
+            iCurBlock = 0;
+            pCur = vBlocks.empty() ? nullptr : vBlocks[0].pBegin;
+            pEnd = vBlocks.empty() ? nullptr : vBlocks[0].pBegin + vBlocks[0].nSize;
+            nBytesInUse = 0;
+            nResets++;
+        };
+        void PrintStats();
+
+        // Getters
+        ULong64_t GetNAllocations() { return nAllocations; }
+        ULong64_t GetNUpstreamAllocations() { return nUpstreamAllocations; }
+        std::size_t GetBytesInUse() { return nBytesInUse; }
+        std::size_t GetPeakBytesInUse() { return nPeakBytesInUse; }
+        std::size_t GetNBlocks() { return vBlocks.size(); }
+};
+
+// Vector drawing its memory from an EventArena (or from the default heap if no arena is given)
+template <typename T>
+using ArenaVector = std::pmr::vector<T>;
+
+#endif
@@ -3,6 +3,7 @@
 
 // DYanalysis classes
 #include "Data.h"
+#include "EventArena.h"
 
 // ROOT classes
 #include "TLorentzVector.h"
@@ -12,6 +13,8 @@
 #include <vector>
 #include <string>
 #include <bitset>
+#include <utility>
+#include <initializer_list>
 
 // Class of a single gen particle
 class GenPtcHolder {
@@ -89,15 +92,80 @@ class GenPtcHolder {
         Bool_t IsTauNeutrino() { return ( std::abs(iGenPtcPDGID) == 16 ); }
 };
 
+// Class of the decay tree of all gen particles in an event
+// Children are stored in a CSR layout (offsets + indices) built from GenPart_genPartIdxMother
+// The next copy of a particle is its first child with the same pdgId, e.g. the same lepton before and after FSR
+class GenPtcTree {
+    private :
+        Data* cData;
+        // Flags for the class
+        Bool_t bIsInit = false;
+
+        Int_t nGenPtcs = 0;
+        std::vector<Int_t> vPdgId;
+        std::vector<Int_t> vMotherIdx; // -1 if there is no (valid) mother
+        std::vector<Int_t> vChildOffset; // Children of idx are vChildIdx[vChildOffset[idx]] ... vChildIdx[vChildOffset[idx+1]-1]
+        std::vector<Int_t> vChildIdx;
+        std::vector<Int_t> vCopyChildIdx; // Next copy of the particle, -1 if it is the last copy
+        std::vector<Int_t> vFirstCopyIdx;
+        std::vector<Int_t> vLastCopyIdx;
+
+    public :
+        GenPtcTree(Data* data) : cData(data) {};
+        ~GenPtcTree() {};
+        void Init();
+        void Reset() {
+            bIsInit = false;
+            nGenPtcs = 0;
+        };
+
+        // Getters
+        Bool_t IsInit() const { return bIsInit; }
+        Int_t GetNGenPtcs() const { return nGenPtcs; }
+        Bool_t IsValidIdx(Int_t idx) const { return (idx >= 0 && idx < nGenPtcs); }
+        Int_t GetPDGID(Int_t idx) const { return IsValidIdx(idx) ? vPdgId[idx] : 0; }
+        Int_t GetMotherIdx(Int_t idx) const { return IsValidIdx(idx) ? vMotherIdx[idx] : -1; }
+        Int_t GetNChildren(Int_t idx) const { return IsValidIdx(idx) ? (vChildOffset[idx + 1] - vChildOffset[idx]) : 0; }
+        std::pair<const Int_t*, const Int_t*> GetChildren(Int_t idx) const;
+        Int_t GetFirstCopy(Int_t idx) const { return IsValidIdx(idx) ? vFirstCopyIdx[idx] : -1; }
+        Int_t GetLastCopy(Int_t idx) const { return IsValidIdx(idx) ? vLastCopyIdx[idx] : -1; }
+        Bool_t IsFirstCopy(Int_t idx) const { return IsValidIdx(idx) && (vFirstCopyIdx[idx] == idx); }
+        Bool_t IsLastCopy(Int_t idx) const { return IsValidIdx(idx) && (vLastCopyIdx[idx] == idx); }
+
+        // Ancestry queries, O(depth)
+        Int_t GetParentIdx(Int_t idx) const; // Mother of the first copy, i.e. the particle that actually produced idx
+        Bool_t IsAncestor(Int_t ancestorIdx, Int_t idx) const;
+        Bool_t IsDescendant(Int_t idx, Int_t ancestorIdx) const { return IsAncestor(ancestorIdx, idx); }
+        Int_t FindAncestor(Int_t idx, Int_t absPdgId) const;
+        Bool_t IsFromDecayChain(Int_t idx, std::initializer_list<Int_t> absPdgIds) const;
+        Int_t GetLastCopyBeforeFSR(Int_t idx) const;
+};
+
 // Class of all gen particles in an event
 class GenPtcs {
     private :
-        std::vector<GenPtcHolder> vGenPtcVec;
+        ArenaVector<GenPtcHolder> vGenPtcVec; // Holders of the gen particles passing the pdgId/statusFlags prefilter
+        ArenaVector<GenPtcHolder> vGenPtcVecFull; // Holders of all gen particles, decoded on demand for debugging
+        GenPtcTree cGenPtcTree; // Decay tree, built on demand
         Data* cData;
         // Flags for the class
         Bool_t bIsInit = false;
+        Bool_t bIsFullDecoded = false;
         Bool_t bDoPatching = false;
 
+        // Buffers for the prefilter, reused over the events : they only grow on the heap up to the largest event
+        std::vector<Int_t> vPdgIdBuf;
+        std::vector<Int_t> vStatusFlagsBuf;
+        std::vector<UChar_t> vSelMask;
+
+        // statusFlags bits relevant for Gen-lv patching
+        // isPrompt, isTauDecayProduct, isPromptTauDecayProduct, isDirectTauDecayProduct, isDirectPromptTauDecayProduct,
+        // isHardProcess, fromHardProcess, isHardProcessTauDecayProduct, isDirectHardProcessTauDecayProduct, fromHardProcessBeforeFSR
+        static constexpr Int_t iSelStatusFlags = (1 << 0) | (1 << 2) | (1 << 3) | (1 << 4) | (1 << 5) | (1 << 7) | (1 << 8) | (1 << 9) | (1 << 10) | (1 << 11);
+
+        GenPtcHolder MakeGenPtcHolder(Int_t idx);
+        ArenaVector<GenPtcHolder> SelectGenPtcs(UInt_t absPdgIdMask);
+
         // Flags for the class
         // For All Gen-lv patching channel
         Int_t iFoundW = 0; // # of reconstructed Gen-lv W boson (l+nu)
@@ -125,14 +193,20 @@ class GenPtcs {
         Bool_t bIsOffshellWToTauNu = false;
 
     public :
-        GenPtcs(Data* data, Bool_t isInclusiveW, Bool_t isBoostedW, Bool_t isOffshellW, Bool_t isOffshellWToTauNu)
-            : cData(data), bIsInclusiveW(isInclusiveW), bIsBoostedW(isBoostedW), bIsOffshellW(isOffshellW), bIsOffshellWToTauNu(isOffshellWToTauNu)
+        // Holders are allocated from the per-event arena if given, from the heap otherwise
+        GenPtcs(Data* data, Bool_t isInclusiveW, Bool_t isBoostedW, Bool_t isOffshellW, Bool_t isOffshellWToTauNu, EventArena* arena = nullptr)
+            : vGenPtcVec(arena ? (std::pmr::memory_resource*) arena : std::pmr::get_default_resource()), vGenPtcVecFull(vGenPtcVec.get_allocator()), cGenPtcTree(data), cData(data), bIsInclusiveW(isInclusiveW), bIsBoostedW(isBoostedW), bIsOffshellW(isOffshellW), bIsOffshellWToTauNu(isOffshellWToTauNu)
         {};
         ~GenPtcs() {};
         void Init();
+        void DecodeAll();
+        // Drops the holders without touching the arena, must be called before EventArena::Reset()
         void Reset() {
-            vGenPtcVec.clear();
+            ArenaVector<GenPtcHolder>(vGenPtcVec.get_allocator()).swap(vGenPtcVec);
+            ArenaVector<GenPtcHolder>(vGenPtcVecFull.get_allocator()).swap(vGenPtcVecFull);
+            cGenPtcTree.Reset();
             bIsInit = false;
+            bIsFullDecoded = false;
             bDoPatching = false;
             iFoundW = 0;
             iFoundLepton = 0;
@@ -152,11 +226,15 @@ class GenPtcs {
         void PrintGenPtcChain();
 
         // Getters for GenPtcHolder
-        std::vector<GenPtcHolder>& GetGenPtcs();
-        std::vector<GenPtcHolder> GetGenMuons();
-        std::vector<GenPtcHolder> GetGenElectrons();
-        std::vector<GenPtcHolder> GetGenTaus();
-        std::vector<GenPtcHolder> GetGenNeutrinos();
+        // GetGenPtcs() returns only the prefiltered leptons and neutrinos, GetAllGenPtcs() decodes every gen particle
+        // GetGenMuons() ... GetGenNeutrinos() return every gen particle of their flavour, whatever its statusFlags
+        ArenaVector<GenPtcHolder>& GetGenPtcs();
+        ArenaVector<GenPtcHolder>& GetAllGenPtcs();
+        const GenPtcTree& GetDecayTree();
+        ArenaVector<GenPtcHolder> GetGenMuons();
+        ArenaVector<GenPtcHolder> GetGenElectrons();
+        ArenaVector<GenPtcHolder> GetGenTaus();
+        ArenaVector<GenPtcHolder> GetGenNeutrinos();
 
         // Getters
         UInt_t GetNGenPtcs() { return **(cData->nGenPart); }
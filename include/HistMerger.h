@@ -0,0 +1,68 @@
+#ifndef HistMerger_h
+#define HistMerger_h
+
+// DYanalysis classes
+#include "Manifest.h"
+
+// ROOT classes
+#include "TFile.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TH1.h"
+#include "TH2.h"
+#include "TNamed.h"
+
+// C++ classes
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <stdexcept>
+
+// Sums DYanalysis outputs (see DYanalyzer::BookTH1D()) bin by bin
+// Every histogram of the outputs has a fixed binning and Sumw2(), so merging is the sum of the flat arrays
+// of bin contents and sums of squared weights, plus the statistics and the number of entries.
+// The 1-bin sum-of-weights histograms (hGenEvtWeight, hGenEvtWeight_PUUp/Down) are summed the same way.
+// The manifests of the inputs (see Manifest.h) are merged, other objects (TNamed metadata) are taken from the first input.
+class HistMerger {
+    private :
+        // Accumulated histograms, detached from any file, in the order of the first input
+        std::vector<TH1*> vHists;
+        std::map<std::string, std::size_t> mHistIndex;
+        std::vector<TObject*> vObjects;
+        ULong64_t nInputs = 0;
+
+    public :
+        HistMerger() {};
+        ~HistMerger();
+        HistMerger(const HistMerger&) = delete;
+        HistMerger& operator=(const HistMerger&) = delete;
+
+        void Clear();
+
+        // Add all histograms of a file, false if the file cannot be read
+        Bool_t AddFile(const std::string& fileName);
+        // Add all histograms of an open file or directory (e.g. a TMemFile received from a worker)
+        void AddDirectory(TDirectory* dir);
+        // Add one histogram, cloned the first time its name is seen
+        void AddHist(const TH1* h);
+        // Add a non-histogram object, owned by the merger
+        void AddObject(TObject* obj);
+        // Add the accumulated histograms of another merger
+        void Add(const HistMerger& other);
+
+        // Write to a temporary file and rename it, so that the output is either complete or absent
+        Bool_t Write(const std::string& fileName) const;
+
+        const std::vector<TH1*>& GetHists() const { return vHists; }
+        ULong64_t GetNInputs() const { return nInputs; }
+
+        // Merge files with nThreads threads : each thread sums a slice of the files, then the partial sums are added pairwise
+        static void MergeFiles(const std::vector<std::string>& fileNames, Int_t nThreads, HistMerger& result);
+
+        static Bool_t HasSameBinning(const TH1* a, const TH1* b);
+        // target += source, the binning must be the same
+        static void AddArrays(TH1* target, const TH1* source);
+};
+
+#endif
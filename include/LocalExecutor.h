@@ -0,0 +1,50 @@
+#ifndef LocalExecutor_h
+#define LocalExecutor_h
+
+// DYanalysis classes
+#include "HistMerger.h"
+
+// ROOT classes
+#include "TFile.h"
+
+// C++ classes
+#include <string>
+#include <vector>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+
+// Runs the analysis of one input file list with forked worker processes on the local machine (DYanalysis --jobs N)
+// The entry range of the chain is split into balanced slices, one per worker.
+// Each worker writes its histograms into a TMemFile, whose bytes are sent to the parent through a pipe,
+// the parent sums the slices in slice order with HistMerger (same result whatever the order of completion).
+// A worker that fails (non-zero exit code, signal, incomplete output) is retried on a fresh process.
+class LocalExecutor {
+    public :
+        // Processes the entries [firstEntry, lastEntry) and writes the histograms to output, runs in the worker
+        typedef std::function<void(Long64_t firstEntry, Long64_t lastEntry, Int_t iSlice, TFile* output)> SliceFunc;
+
+    private :
+        struct Worker {
+            Int_t pid = -1;
+            Int_t fd = -1;
+            Int_t iSlice = -1;
+            std::string sBuffer;
+        };
+
+        Int_t nJobs;
+        Int_t nMaxRetries = 2;
+
+        Worker Spawn(Int_t iSlice, Long64_t firstEntry, Long64_t lastEntry, const SliceFunc& func, const std::vector<Worker>& running);
+
+    public :
+        LocalExecutor(Int_t jobs): nJobs(jobs)
+        {};
+
+        void SetMaxRetries(Int_t maxRetries) {nMaxRetries = maxRetries;}
+
+        // Throws if a slice still fails after nMaxRetries retries
+        void Run(Long64_t nEntries, const SliceFunc& func, HistMerger& result);
+};
+
+#endif
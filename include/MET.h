@@ -2,18 +2,45 @@
 #define MET_h
 
 #include "Data.h"
+#include "Correction.h"
 
 #include <string>
+#include <vector>
 #include <utility>
+#include <memory>
 #include <cmath>
 
 #include "TMath.h"
 
+// PF MET xy-shift correction : MET_x -= shift_x(NPV), same for y
+// The shifts are the correctionlib corrections of corrections/met_xy_UL.json, per run period (data) or era (MC)
+// The key of a process is given by the sample registry (see SampleRegistry.h)
+// Resolved once per job, see MET::FindXYCorrParams() : the shifts of every NPV value of NanoAOD (PV_npvs is an 8-bit column)
+// are evaluated there, the event loop only reads them from the tables
+struct METXYCorrParams {
+    static constexpr Int_t kNTabulatedNPV = 256;
+    std::vector<Double_t> vShiftX; // Shifts of NPV = 0 ... kNTabulatedNPV - 1
+    std::vector<Double_t> vShiftY;
+    // Correction evaluated for NPV outside the tables
+    std::shared_ptr<const CorrectionSet> pCorrectionSet; // Keeps pCorrection alive
+    const Correction* pCorrection = nullptr;
+    // Positions of the inputs of the correction, and the ids of the string inputs
+    Int_t iKeyInput = 0;
+    Int_t iComponentInput = 1;
+    Int_t iNPVInput = 2;
+    Double_t dKey = -1.;
+    Double_t dComponentX = -1.;
+    Double_t dComponentY = -1.;
+    Bool_t bIsFound = false; // False if no correction is defined for the process, the correction is then zero
+};
+
 class MET {
     private :
         Data* cData;
         Bool_t bIsInit = false;
 
+        METXYCorrParams cXYCorrParams;
+
         Float_t fMET_pt = -999;
         Float_t fMET_phi = -999;
         Float_t fMET_sumEt = -999;
@@ -23,8 +50,8 @@ class MET {
         Float_t fPuppiMET_sumEt = -999;
 
     public :
-        MET(Data* data) 
-            : cData(data)
+        MET(Data* data, const METXYCorrParams& xyCorrParams = METXYCorrParams())
+            : cData(data), cXYCorrParams(xyCorrParams)
         {};
         ~MET() {};
         
@@ -47,7 +74,27 @@ class MET {
         Float_t GetPuppiMET_phi() { return fPuppiMET_phi; }
         Float_t GetPuppiMET_sumEt() { return fPuppiMET_sumEt; }
 
-        std::pair<Double_t, Double_t> GetPFMETXYCorr(std::string processName, std::string era, Bool_t isMC, Int_t NPV);
+        // Corrected (pt, phi) of the PF MET of the current event
+        std::pair<Double_t, Double_t> GetPFMETXYCorr(Int_t NPV);
+        const METXYCorrParams& GetXYCorrParams() { return cXYCorrParams; }
+        void SetXYCorrParams(const METXYCorrParams& xyCorrParams) { cXYCorrParams = xyCorrParams; }
+
+        static constexpr const char* kXYCorrFileName = "corrections/met_xy_UL.json";
+
+        // Look up the correction of the key (era for MC, run period for data), to be called once per job
+        static METXYCorrParams FindXYCorrParams(const std::string& key, Bool_t isMC);
+        // (x, y) shifts for NPV, zero if no correction is defined
+        static std::pair<Double_t, Double_t> GetXYShift(const METXYCorrParams& params, Int_t NPV) {
+            if (!params.bIsFound) return std::make_pair(0., 0.);
+            if (NPV >= 0 && NPV < METXYCorrParams::kNTabulatedNPV) return std::make_pair(params.vShiftX[NPV], params.vShiftY[NPV]);
+            return EvaluateXYShift(params, NPV);
+        }
+        // Evaluation of the correction, used to fill the tables
+        static std::pair<Double_t, Double_t> EvaluateXYShift(const METXYCorrParams& params, Int_t NPV);
+        // Correction of a single (pt, phi) and of a block of n events
+        static std::pair<Double_t, Double_t> ApplyXYCorr(const METXYCorrParams& params, Double_t pt, Double_t phi, Int_t NPV);
+        static void ApplyXYCorr(const METXYCorrParams& params, std::size_t n, const Float_t* pt, const Float_t* phi, const Int_t* NPV,
+                                Double_t* ptCorr, Double_t* phiCorr);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+#ifndef Manifest_h
+#define Manifest_h
+
+// ROOT classes
+#include "TDirectory.h"
+#include "TNamed.h"
+
+// C++ classes
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <utility>
+#include <limits>
+#include <iostream>
+#include <stdexcept>
+
+// Inputs covered by a DYanalysis output, stored in the output as the title of a TNamed "Manifest"
+// One line per record, tab-separated :
+//   code     <code version>
+//   config   <hash of the analysis configuration>   <configuration>
+//   input    <path>   <size>   <mtime>   <entries>   <first entry>   <last entry>
+//   skipped  <path>   <first entry>   <last entry>   <reason>
+// An input can have several entry ranges (e.g. one per slice of --jobs), they are coalesced by Merge().
+// Size and mtime are -1 when the file cannot be stat'ed (remote file), such an input is never considered unchanged.
+// Skipped entries could not be read (see Data::CheckInputs()), the last entry is -1 if the file could not be opened.
+// They are not covered : --incremental processes a skipped file again, and Merge() drops the skipped entries another output covers.
+class Manifest {
+    public :
+        static constexpr const char* kObjectName = "Manifest";
+
+        struct Input {
+            Long64_t nSize = -1;
+            Long64_t nMTime = -1;
+            Long64_t nEntries = 0;
+            // Sorted, disjoint [first, last) entry ranges of the file
+            std::vector<std::pair<Long64_t, Long64_t>> vRanges;
+
+            Bool_t IsComplete() const { return nEntries == 0 || (vRanges.size() == 1 && vRanges[0].first == 0 && vRanges[0].second == nEntries); }
+        };
+
+        // Entries of an input that were not read
+        struct Skipped {
+            // Sorted, disjoint [first, last) entry ranges, last is kUnknownEntry if the file could not be opened
+            std::vector<std::pair<Long64_t, Long64_t>> vRanges;
+            std::string sReason;
+        };
+        static constexpr Long64_t kUnknownEntry = std::numeric_limits<Long64_t>::max();
+
+        // Result of Plan()
+        struct Plan {
+            Bool_t bUpToDate = false;
+            // Full reprocessing needed, because of sReason
+            Bool_t bFull = false;
+            std::string sReason;
+            // Inputs of the current list already in the output, and the new ones
+            std::set<std::string> sCovered;
+            std::vector<std::string> vNew;
+        };
+
+    private :
+        std::string sCodeVersion;
+        std::string sConfig;
+        std::map<std::string, Input> mInputs;
+        std::map<std::string, Skipped> mSkipped;
+
+        static void Coalesce(std::vector<std::pair<Long64_t, Long64_t>>& ranges);
+        // ranges minus removed, both sorted and disjoint
+        static void Subtract(std::vector<std::pair<Long64_t, Long64_t>>& ranges, const std::vector<std::pair<Long64_t, Long64_t>>& removed);
+        // Drops the skipped entries that are covered by an input
+        void DropCoveredSkipped();
+
+    public :
+        Manifest() {};
+        Manifest(const std::string& config) : sCodeVersion(CurrentCodeVersion()), sConfig(config) {};
+
+        // git describe of the source tree at configure time (see CMakeLists.txt)
+        static std::string CurrentCodeVersion();
+        // FNV-1a, printed in hexadecimal
+        static std::string Hash(const std::string& text);
+        // Size and mtime of a local file, -1 if it cannot be stat'ed
+        static void Stat(const std::string& path, Long64_t& size, Long64_t& mtime);
+
+        // Files of the chain with their number of entries, the part inside the chain entry range [first, last) is covered
+        void AddChain(const std::vector<std::string>& fileNames, const std::vector<Long64_t>& fileEntries, Long64_t firstEntry, Long64_t lastEntry);
+        // Entries [first, last) of an input were not read (last < 0 : the file could not be opened), they are no more covered
+        void AddSkipped(const std::string& fileName, Long64_t firstEntry, Long64_t lastEntry, const std::string& reason);
+        // Union of the inputs, the code version or configuration becomes "mixed" if they differ
+        void Merge(const Manifest& other);
+
+        // Compare with the current input files and configuration
+        Plan MakePlan(const std::vector<std::string>& fileNames, const std::string& config) const;
+
+        std::string ToString() const;
+        void FromString(const std::string& text);
+        // The manifest of an output file, false if the file or its manifest does not exist
+        Bool_t Read(const std::string& fileName);
+        void Write(TDirectory* dir) const;
+
+        const std::string& GetCodeVersion() const { return sCodeVersion; }
+        const std::string& GetConfig() const { return sConfig; }
+        const std::map<std::string, Input>& GetInputs() const { return mInputs; }
+        const std::map<std::string, Skipped>& GetSkipped() const { return mSkipped; }
+};
+
+#endif
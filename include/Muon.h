@@ -3,6 +3,7 @@
 
 // DYanalysis classes
 #include "Data.h"
+#include "EventArena.h"
 
 // ROOT classes
 #include "TLorentzVector.h"
@@ -11,6 +12,17 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <array>
+
+// Thresholds of the muon object selection, the defaults are those of the analysis
+// The pT is the Rocco-corrected one if the Rocco SF is set
+struct MuonCuts {
+    Double_t dTightPt = 30.0;
+    Double_t dTightEta = 2.4;
+    Double_t dTightIso = 0.1; // PF relative isolation (dR = 0.4)
+    Double_t dLoosePt = 10.0;
+    Double_t dLooseEta = 2.4;
+};
 
 // Class of a single muon
 class MuonHolder {
@@ -31,6 +43,8 @@ class MuonHolder {
         Float_t fTunePRelPt = -1; // tunePpT / pt -> multiply with muon pT will return TuneP pT
         // Rochester correction
         Double_t dMuonRoccoSF = -1;
+        Double_t dRoccoGenPt = -1; // pT of the matched gen muon, -1 if not matched
+        Double_t dRoccoRandom = -1; // Random number used for smearing the not matched muon
         // Efficiency SFs
         Float_t fMuonIDSF = -1;
         Float_t fMuonIsoSF = -1;
@@ -72,7 +86,9 @@ class MuonHolder {
         void SetTkRelIso(Float_t iso) { fTkRelIso = iso; }
         void SetTunePRelPt(Float_t pt) { fTunePRelPt = pt; }
         void SetRoccoSF(Double_t sf) { dMuonRoccoSF = sf; }
-        void SetEfficiencySF(std::vector<double>& sf) { fMuonIDSF = sf[0]; fMuonIsoSF = sf[1]; fMuonTrigSF = sf[2]; }
+        void SetRoccoGenPt(Double_t pt) { dRoccoGenPt = pt; }
+        void SetRoccoRandom(Double_t u) { dRoccoRandom = u; }
+        void SetEfficiencySF(const std::array<Double_t, 3>& sf) { fMuonIDSF = sf[0]; fMuonIsoSF = sf[1]; fMuonTrigSF = sf[2]; }
         void SetIDSF(Double_t sf) { fMuonIDSF = sf; }
         void SetIsoSF(Double_t sf) { fMuonIsoSF = sf; }
         void SetTrigSF(Double_t sf) { fMuonTrigSF = sf; }
@@ -98,8 +114,8 @@ class MuonHolder {
             bTightObjSel = tightObjSel; bLooseObjSel = looseObjSel;
         }
         // Object selection
-        Bool_t DoTightObjSel();
-        Bool_t DoLooseObjSel();
+        Bool_t DoTightObjSel(const MuonCuts& cuts = MuonCuts());
+        Bool_t DoLooseObjSel(const MuonCuts& cuts = MuonCuts());
 
         // Muon fourvector
         const TLorentzVector& GetMuonOrgVec() { return MuonOrgVec; }
@@ -124,6 +140,8 @@ class MuonHolder {
         Float_t GetTkRelIso() { return fTkRelIso; }
         // Rochester correction
         Float_t GetRoccoSF() { return dMuonRoccoSF; }
+        Double_t GetRoccoGenPt() { return dRoccoGenPt; }
+        Double_t GetRoccoRandom() { return dRoccoRandom; }
         // Efficiency SFs
         Float_t GetIDSF() { return fMuonIDSF; }
         Float_t GetIsoSF() { return fMuonIsoSF; }
@@ -152,29 +170,31 @@ class MuonHolder {
 // Muons will be stored in a vector of MuonHolder
 class Muons {
     private :
-        std::vector<MuonHolder> vMuonVec;
+        ArenaVector<MuonHolder> vMuonVec;
         Data* cData;
         // Flags for the class
         Bool_t bIsInit = false;
         Bool_t bDidObjSel = false;
 
     public :
-        Muons(Data* data) 
-            : cData(data)
+        // Holders are allocated from the per-event arena if given, from the heap otherwise
+        Muons(Data* data, EventArena* arena = nullptr)
+            : vMuonVec(arena ? (std::pmr::memory_resource*) arena : std::pmr::get_default_resource()), cData(data)
         {};
         ~Muons() {};
 
         void Init();
+        // Drops the holders without touching the arena, must be called before EventArena::Reset()
         void Reset() {
-            vMuonVec.clear();
+            ArenaVector<MuonHolder>(vMuonVec.get_allocator()).swap(vMuonVec);
             bIsInit = false;
             bDidObjSel = false;
         };
-        void DoObjSel();
+        void DoObjSel(const MuonCuts& cuts = MuonCuts());
 
-        std::vector<MuonHolder>& GetMuons();
-        std::vector<MuonHolder> GetTightMuons();
-        std::vector<MuonHolder> GetLooseMuons();
+        ArenaVector<MuonHolder>& GetMuons();
+        ArenaVector<MuonHolder> GetTightMuons();
+        ArenaVector<MuonHolder> GetLooseMuons();
 
         UInt_t GetNMuons() { return **(cData->nMuon); }
 };
@@ -1,36 +1,105 @@
 #ifndef PU_h
 #define PU_h
 
+#include "CalibTables.h"
+#include "Correction.h"
+#include "CorrectionStore.h"
+
 #include "TFile.h"
 #include "TH1.h"
 
 #include <string>
 #include <vector>
+#include <memory>
 #include <iostream>
+#include <cmath>
+#include <stdexcept>
+#include <atomic>
+
+// Nominal and minimum-bias cross-section up/down PU weights of one event
+struct PUWeights {
+    Double_t dNom = 0.;
+    Double_t dUp = 0.;
+    Double_t dDown = 0.;
+};
 
 class PU {
     private :
-        TFile* fDataPUFile = nullptr;
-        TFile* fMCPUFile = nullptr;
-
-        TH1D* hDataPUHist = nullptr;
-        TH1D* hMCPUHist = nullptr;
-        TH1D* hPUWeights = nullptr;
+        // Minimum-bias cross-sections of the data profiles (ub), nominal 69.2 mb +- 4.6%
+        static constexpr const char* kXSecNom  = "69200ub";
+        static constexpr const char* kXSecUp   = "72400ub";
+        static constexpr const char* kXSecDown = "66000ub";
 
         std::string sEra;
+        std::string sDataPUFileName;
+        std::string sDataPUFileName_Up;
+        std::string sDataPUFileName_Down;
+        std::string sMCPUFileName;
+
+        // Weights indexed directly by the integer part of nTrueInt, the profiles have uniform bins of width 1
+        // The last entry (index nBins) is a zero sentinel for nTrueInt out of range
+        Double_t dPUMin = 0.;
+        Double_t dPUBinWidth = 1.;
+        Int_t nBins = 0;
+        std::vector<PUWeights> vPUWeights;
+        // Weights used for the lookup : vPUWeights, or the table mapped from the node-wide correction store
+        const PUWeights* pPUWeights = nullptr;
+        std::shared_ptr<const CorrectionSegment> pSegment;
+
+        Bool_t bHasVariations = false; // False if the up/down data profiles are not available, variations are then nominal and DYanalyzer does not book the PU up/down histograms
+        // Atomic : a PU instance can be shared by analyzers running in concurrent threads (see AnalysisCorrections.h)
+        std::atomic<ULong64_t> nOutOfRange{0};
 
+        // Optional correctionlib backend (LUM POG puWeights.json), used instead of the profiles if set
+        // Inputs : NumTrueInteractions (real), weights (string : nominal, up, down)
+        std::string sCorrectionFileName;
+        std::string sCorrectionName;
+        std::shared_ptr<const CorrectionSet> pCorrectionSet;
+        const Correction* pCorrection = nullptr;
+        Int_t iNTrueIntInput = 0;
+        Int_t iWeightsInput = 1;
+        Double_t dNomId = -1.;
+        Double_t dUpId = -1.;
+        Double_t dDownId = -1.;
+
+        Int_t nEmbeddedProfiles = 0; // Profiles found in the embedded calibration tables, the others are read from the ROOT files
         Bool_t bIsInit = false;
 
+        // Read the "pileup" histogram of a file (relative to the source directory) into a vector of nBins bin contents
+        std::vector<Double_t> ReadProfile(const std::string& fileName, Bool_t normalize);
+        std::vector<Double_t> MakeProfile(const std::string& fileName, Int_t n, const Double_t* edges, const Double_t* content, Bool_t normalize);
+        Bool_t HasProfile(const std::string& fileName);
+        void BuildWeights();
+        std::string SerializeWeights() const;
+        void ReadWeights(const CorrectionSegment& segment);
+        void InitCorrection();
+
     public :
         PU(const std::string& era): sEra(era)
         {};
         virtual ~PU();
 
+        // Use a correctionlib file, the default correction name is Collisions<YY>_UltraLegacy_goldenJSON
+        void SetCorrection(const std::string& fileName, const std::string& correctionName = "") {
+            sCorrectionFileName = fileName;
+            sCorrectionName = correctionName;
+        }
+
         void Init();
         void Clear();
         void PrintInitInfo();
 
+        // Index of the weight table, nBins if nTrueInt is out of range
+        Int_t GetIndex(Float_t nTrueInt) const {
+            Int_t idx = (Int_t)std::floor((nTrueInt - dPUMin) / dPUBinWidth);
+            return (idx < 0 || idx >= nBins) ? nBins : idx;
+        }
+
         Double_t GetPUWeight(Float_t nTrueInt);
+        PUWeights GetPUWeights(Float_t nTrueInt);
+
+        Bool_t HasVariations() { return bHasVariations; }
+        ULong64_t GetNOutOfRange() { return nOutOfRange; }
 };
 
 #endif
@@ -3,7 +3,16 @@
 
 #include <boost/math/special_functions/erf.hpp>
 
-struct CrystalBall{
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <memory>
+
+class CorrectionSegment;
+
+// Parameters of one CrystalBall: 16 doubles, also the layout of the cache image (RoccoR reads them in place)
+struct CrystalBallPar{
     static const double pi;
     static const double sqrtPiOver2;
     static const double sqrt2;
@@ -28,10 +37,6 @@ struct CrystalBall{
     double cdfMa;
     double cdfPa;
 
-    CrystalBall():m(0),s(1),a(10),n(10){
-	init();
-    }
-
     void init(){
 	double fa = fabs(a);
 	double ex = exp(-fa*fa/2);
@@ -52,8 +57,8 @@ struct CrystalBall{
 	F = 1-fa*fa/n; 
 	G = s*n/fa;    
 
-	cdfMa = cdf(m-a*s);
-	cdfPa = cdf(m+a*s);
+	cdfMa = cdfExact(m-a*s);
+	cdfPa = cdfExact(m+a*s);
     }
 
     double pdf(double x) const{ 
@@ -70,19 +75,153 @@ struct CrystalBall{
 	return N/ks*exp(-d*d/2);
     }
 
-    double cdf(double x) const{
+    double cdfExact(double x) const{
 	double d = (x-m)/s;
 	if(d<-a) return NC / pow(F-s*d/G, n-1);
 	if(d>a) return NC * (C - pow(F+s*d/G, 1-n) );
 	return Ns * (D - sqrtPiOver2 * erf(-d/sqrt2));
     }
 
-    double invcdf(double u) const{
+    double invcdfExact(double u) const{
 	if(u<cdfMa) return m + G*(F - pow(NC/u, k));
 	if(u>cdfPa) return m - G*(F - pow(C-u/NC, -k) );
 	return m - sqrt2 * s * boost::math::erf_inv((D - u/Ns )/sqrtPiOver2);
     }
 };
+static_assert(sizeof(CrystalBallPar)==16*sizeof(double), "CrystalBallPar is read in place from the cache image");
+
+struct CrystalBall : CrystalBallPar{
+    CrystalBall(){
+	m = 0;
+	s = 1;
+	a = 10;
+	n = 10;
+	init();
+    }
+
+    double cdf(double x) const{ return cdfExact(x); }
+    double invcdf(double u) const{ return invcdfExact(u); }
+};
+
+// Optional fast mode of one CrystalBallPar: cubic Hermite tables of cdf and invcdf in the gaussian core,
+// on a uniform grid in d=(x-m)/s over [-dTab, dTab], dTab=min(a, TABDMAX). Tails and |d|>dTab stay analytic
+// The grid nodes store x, cdf(x) and the slopes dcdf/dx and dx/dcdf, limited to keep both interpolants monotone
+// (checked by monotone() when the tables are built, they are dropped if the check fails)
+struct CrystalBallTab{
+    static const double TABDMAX;
+    bool useTab;
+    int tabN;
+    double tabX0;
+    double tabH;
+    double tabInvH;
+    std::vector<double> tabU;
+    std::vector<double> tabDUDX;
+    std::vector<double> tabDXDU;
+    // Guide for invcdf: node index for each of tabN uniform steps in u, refined by a short forward walk
+    double tabGuideInvDU;
+    std::vector<int> tabGuide;
+
+    CrystalBallTab():useTab(false),tabN(0),tabX0(0),tabH(0),tabInvH(0),tabGuideInvDU(0){}
+
+    void init(const CrystalBallPar& cb, int npoints){
+	tabN = npoints<4 ? 4 : npoints;
+	double dTab = std::min(fabs(cb.a), TABDMAX);
+	tabX0 = cb.m - dTab*cb.s;
+	tabH = 2*dTab*cb.s/(tabN-1);
+	tabInvH = 1.0/tabH;
+	tabU.resize(tabN);
+	tabDUDX.resize(tabN);
+	tabDXDU.resize(tabN);
+	for(int i=0; i<tabN; ++i){
+	    double x = tabX0 + i*tabH;
+	    double d = (x-cb.m)/cb.s;
+	    tabU[i] = cb.cdfExact(x);
+	    // Derivative of the core cdf as written in cdfExact, sqrtPiOver2 uses the truncated pi
+	    tabDUDX[i] = cb.Ns * CrystalBallPar::sqrtPiOver2 * M_2_SQRTPI / CrystalBallPar::sqrt2 / cb.s * exp(-d*d/2);
+	}
+	// Fritsch-Carlson limiter on both interpolants : a node slope is at most 3 times the secant of each neighbouring interval
+	// The secants of x(u) are 1/sec, so the steeper neighbouring interval of u(x) gives the bound of dx/du
+	for(int i=0; i<tabN; ++i){
+	    double secL = i>0 ? (tabU[i]-tabU[i-1])*tabInvH : -1;
+	    double secR = i<tabN-1 ? (tabU[i+1]-tabU[i])*tabInvH : -1;
+	    double secMin = secL<0 ? secR : secR<0 ? secL : std::min(secL, secR);
+	    double secMax = std::max(secL, secR);
+	    double dudx = std::min(tabDUDX[i], 3*secMin);
+	    double dxdu = tabDUDX[i]>0 ? 1.0/tabDUDX[i] : 0;
+	    if(secMax>0) dxdu = std::min(dxdu, 3.0/secMax);
+	    tabDUDX[i] = dudx;
+	    tabDXDU[i] = dxdu;
+	}
+	tabGuide.resize(tabN);
+	tabGuideInvDU = tabN/(tabU.back()-tabU.front());
+	for(int j=0, i=0; j<tabN; ++j){
+	    double u = tabU.front() + j/tabGuideInvDU;
+	    while(i<tabN-2 && tabU[i+1]<=u) ++i;
+	    tabGuide[j] = i;
+	}
+	// The tables are only used if both interpolants are monotone, the exact evaluation is kept otherwise
+	useTab = true;
+	if(!monotone(cb)) clear();
+    }
+
+    // Checks that cdf and invcdf are non-decreasing over the table, on nsub points inside each interval
+    bool monotone(const CrystalBallPar& cb, int nsub=16) const{
+	if(!useTab) return false;
+	double xPrev = invcdf(cb, tabU.front());
+	double uPrev = cdf(cb, tabX0);
+	for(int i=0; i<tabN-1; ++i){
+	    for(int j=1; j<=nsub; ++j){
+		double u = j<nsub ? tabU[i] + (tabU[i+1]-tabU[i])*j/nsub : tabU[i+1];
+		double x = invcdf(cb, u);
+		if(x<xPrev) return false;
+		xPrev = x;
+		double uc = cdf(cb, tabX0 + (i + (double)j/nsub)*tabH);
+		if(uc<uPrev) return false;
+		uPrev = uc;
+	    }
+	}
+	return true;
+    }
+
+    void clear(){
+	useTab = false;
+	tabN = 0;
+	std::vector<double>().swap(tabU);
+	std::vector<double>().swap(tabDUDX);
+	std::vector<double>().swap(tabDXDU);
+	std::vector<int>().swap(tabGuide);
+    }
+
+    double cdf(const CrystalBallPar& cb, double x) const{
+	if(useTab){
+	    double t = (x-tabX0)*tabInvH;
+	    if(t>=0 && t<=tabN-1){
+		int i = std::min((int)t, tabN-2);
+		double f = t-i;
+		double f2 = f*f, f3 = f2*f;
+		return (2*f3-3*f2+1)*tabU[i] + (f3-2*f2+f)*tabH*tabDUDX[i]
+		     + (-2*f3+3*f2)*tabU[i+1] + (f3-f2)*tabH*tabDUDX[i+1];
+	    }
+	}
+	return cb.cdfExact(x);
+    }
+
+    double invcdf(const CrystalBallPar& cb, double u) const{
+	if(useTab && u>=tabU.front() && u<=tabU.back()){
+	    int i = tabGuide[std::min((int)((u-tabU.front())*tabGuideInvDU), tabN-1)];
+	    while(i<tabN-2 && tabU[i+1]<=u) ++i;
+	    double du = tabU[i+1]-tabU[i];
+	    if(du>0){
+		double f = (u-tabU[i])/du;
+		double f2 = f*f, f3 = f2*f;
+		double x0 = tabX0 + i*tabH;
+		return (2*f3-3*f2+1)*x0 + (f3-2*f2+f)*du*tabDXDU[i]
+		     + (-2*f3+3*f2)*(x0+tabH) + (f3-f2)*du*tabDXDU[i+1];
+	    }
+	}
+	return cb.invcdfExact(u);
+    }
+};
 
 
 struct RocRes{
@@ -129,16 +268,20 @@ class RoccoR{
 	int NETA;
 	int NPHI; 
 	double DPHI;
-	std::vector<double> etabin;
+	const double* etabin;
 
+	// Resolution binning, shared by all sets and members
+	int RETA;
+	int NTRK;
+	int NMIN;
+	const double* resEta;
+
+	// Nested parameters of one set/member, only while the text file is parsed
 	struct CorParams{
 	    double M; 
 	    double A;
 	    double X;
 	    CorParams():M(1),A(0),X(0){}
-	    double k(int Q, double pt) const{
-		return 1.0/(M + Q*A*pt + X/pt);
-	    }
 	};
 
 	struct RocOne{
@@ -149,9 +292,48 @@ class RoccoR{
 	int nset;
 	std::vector<int> nmem;
 	std::vector<int> tvar;
-	std::vector<std::vector<RocOne>> RC;
 	template <typename T> double error(T f) const;
 
+	// Cache image of the state, header then payload, all in native byte order: written to <text file>.bin and published
+	// to the node-wide store (CorrectionStore.h), validated by the checksum of the text file.
+	// The tables are read in place from the image: the store segment when it is attached, otherwise the private copy
+	static const char CACHEMAGIC[8];
+	static const unsigned CACHEVERSION;
+	std::string version;
+	std::shared_ptr<const CorrectionSegment> segment;
+	std::vector<double> image;
+	const char* imageData;
+	size_t imageSize;
+	std::string parseText(const std::string& filename, unsigned long long sourceSize, unsigned long long sourceHash);
+	void initLocal(const std::string& filename, const std::string& cachename, unsigned long long sourceSize, unsigned long long sourceHash);
+	bool readCache(const std::string& cachename, unsigned long long sourceSize, unsigned long long sourceHash);
+	static bool writeImage(const std::string& cachename, const std::string& data);
+	bool attach(const char* data, size_t size, unsigned long long sourceSize, unsigned long long sourceHash);
+
+	// View of the parameters of one set/member in the image (structure of arrays)
+	// CP: [eta bin * NPHI + phi bin], resolution: [|eta| bin * NTRK + nTrk bin], nTrk edges: [|eta| bin * (NTRK+1) + i]
+	struct FlatOne{
+	    const double* cpM[2];
+	    const double* cpA[2];
+	    const double* cpX[2];
+	    const double* kRes[2];
+	    const double* nTrk[2];
+	    const double* rsPar[3];
+	    const CrystalBallPar* cb;
+	    // Fast mode tables (setFast), private to the process
+	    std::vector<CrystalBallTab> cbTab;
+	    double invcdf(int RT, double u) const{
+		return cbTab.empty() ? cb[RT].invcdfExact(u) : cbTab[RT].invcdf(cb[RT], u);
+	    }
+	};
+	std::vector<std::vector<FlatOne>> FL;
+	// Branch-free bin search: number of inner edges edge[1..n-1] below x
+	static int countBin(const double* edge, int n, double x){
+	    int bin = 0;
+	    for(int i=1; i<n; ++i) bin += (x>=edge[i]);
+	    return bin;
+	}
+
     protected:
 	int etaBin(double eta) const;
 	int phiBin(double phi) const;
@@ -161,15 +343,21 @@ class RoccoR{
 
 	RoccoR(); 
 	RoccoR(std::string filename); 
+	// The views point into the image
+	RoccoR(const RoccoR&) = delete;
+	RoccoR& operator=(const RoccoR&) = delete;
 
+	// Maps the state from the node-wide correction store (CorrectionStore.h) if another job published it,
+	// otherwise loads <filename>.bin if it matches the text file, or parses the text file and writes the cache
 	void init(std::string filename);
+	bool writeCache(const std::string& cachename, unsigned long long sourceSize, unsigned long long sourceHash) const;
+	static unsigned long long checksum(const char* data, size_t size);
 	void reset();
-	bool empty() const {return RC.empty();} 
-	const RocRes& getRes(int s=0, int m=0) const {return RC[s][m].RR;}
-	double getM(int T, int H, int F, int s=0, int m=0) const{return RC[s][m].CP[T][H][F].M;}
-	double getA(int T, int H, int F, int s=0, int m=0) const{return RC[s][m].CP[T][H][F].A;}
-	double getX(int T, int H, int F, int s=0, int m=0) const{return RC[s][m].CP[T][H][F].X;}
-	double getK(int T, int H, int s=0, int m=0)        const{return RC[s][m].RR.resol[H].kRes[T];}
+	bool empty() const {return FL.empty();} 
+	double getM(int T, int H, int F, int s=0, int m=0) const{return FL[s][m].cpM[T][H*NPHI+F];}
+	double getA(int T, int H, int F, int s=0, int m=0) const{return FL[s][m].cpA[T][H*NPHI+F];}
+	double getX(int T, int H, int F, int s=0, int m=0) const{return FL[s][m].cpX[T][H*NPHI+F];}
+	double getK(int T, int H, int s=0, int m=0)        const{return FL[s][m].kRes[T][H];}
 	double kGenSmear(double pt, double eta, double v, double u, RocRes::TYPE TT=RocRes::Data, int s=0, int m=0) const;
 	double kScaleMC(int Q, double pt, double eta, double phi, int s=0, int m=0) const;
 
@@ -180,6 +368,34 @@ class RoccoR{
 	double kScaleDTerror(int Q, double pt, double eta, double phi) const;
 	double kSpreadMCerror(int Q, double pt, double eta, double phi, double gt) const;
 	double kSmearMCerror(int Q, double pt, double eta, double phi, int n, double u) const;
+
+	// Fast mode: tabulated CrystalBall cdf/invcdf for set s, member m (all sets and members if s<0)
+	void setFast(bool fast, int s=-1, int m=-1, int npoints=256);
+	// Maximum deviation between fast and exact modes of the paths that use the CrystalBall (kSpreadMC does not):
+	// kCorrectMC of not gen-matched muons (kSmearMC) on nsample pseudo-random muons, and invcdf on a fixed grid in u
+	struct FastDeviation{
+	    double smear;
+	    double invcdf;
+	    int nExact; // CrystalBall of the set/member without tables (not monotone), evaluated exactly
+	};
+	FastDeviation validateFast(int s=0, int m=0, int nsample=100000);
+
+	// Batch versions over n muons, same results as the single-muon functions
+	// kCorrectMC applies kSpreadMC to the muons with gt>0 (gen-matched) and kSmearMC to the others
+	void kScaleDT(int nmu, const int* Q, const double* pt, const double* eta, const double* phi, double* k, int s=0, int m=0) const;
+	void kSpreadMC(int nmu, const int* Q, const double* pt, const double* eta, const double* phi, const double* gt, double* k, int s=0, int m=0) const;
+	void kSmearMC(int nmu, const int* Q, const double* pt, const double* eta, const double* phi, const int* n, const double* u, double* k, int s=0, int m=0) const;
+	void kCorrectMC(int nmu, const int* Q, const double* pt, const double* eta, const double* phi, const double* gt, const int* n, const double* u, double* k, int s=0, int m=0) const;
+
+	// All sets and members of one muon, bins looked up once
+	// k[nReplicas()] is filled set by set: index = sum(nmem[0..s-1]) + m
+	int nReplicas() const;
+	int replicaIndex(int s, int m) const;
+	void kScaleDTReplicas(int Q, double pt, double eta, double phi, double* k) const;
+	void kCorrectMCReplicas(int Q, double pt, double eta, double phi, double gt, int n, double u, double* k) const;
+	// Spread of the replica factors around the factor of set s, member m
+	// s=0, m=0 gives the same as k*error(), the corrections applied with another set (e.g. set 5 in DYanalyzer) need their own reference
+	double replicaError(const double* k, int s=0, int m=0) const;
 };
 
 #endif
@@ -0,0 +1,53 @@
+#ifndef SampleIndex_h
+#define SampleIndex_h
+
+// DYanalysis classes
+#include "SampleRegistry.h"
+
+// ROOT classes
+#include "Rtypes.h"
+
+// C++ classes
+#include <string>
+#include <map>
+#include <iostream>
+#include <stdexcept>
+
+// Index of the number of entries and the sum of generator weights of each sample, over all its files
+// Built once per sample (DYanalysis --build-index), read by the jobs to write histograms normalized to the luminosity :
+//   scale = cross section * luminosity / sum of generator weights of the group (extensions of the dataset, see SampleRegistry.h)
+// The sum of generator weights is the sum of sign(genWeight), as the sum of weights of the event loop without corrections.
+// Text file, one line per sample : <era> <process> <files> <entries> <sum of generator weights>
+class SampleIndex {
+    public :
+        struct Entry {
+            Long64_t nFiles = 0;
+            Long64_t nEntries = 0;
+            Double_t dSumOfGenEvtWeight = 0.;
+        };
+
+    private :
+        std::map<std::string, Entry> mEntries; // "<era>/<process>"
+
+    public :
+        SampleIndex() {};
+
+        // Entries and sum of sign(genWeight) of the files of the input file list (entries only for data)
+        static Entry Count(const std::string& inputFileList, Bool_t isMC);
+
+        void Set(const std::string& processName, const std::string& era, const Entry& entry) { mEntries[era + "/" + processName] = entry; }
+        // nullptr if the sample is not in the index
+        const Entry* Find(const std::string& processName, const std::string& era) const;
+
+        // Sum of generator weights of the samples of the group in the registry, throws if one of them is not in the index
+        Double_t GetGroupSumOfGenEvtWeight(const SampleInfo& info, const std::string& era) const;
+        // Normalization of the histograms of an MC sample to the luminosity of the era
+        Double_t GetNormalization(const std::string& processName, const std::string& era) const;
+
+        // False if the file does not exist, throws if it is invalid
+        Bool_t Read(const std::string& fileName);
+        // Written to a temporary file and renamed
+        Bool_t Write(const std::string& fileName) const;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef SampleRegistry_h
+#define SampleRegistry_h
+
+// ROOT classes
+#include "Rtypes.h"
+
+// C++ classes
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+// Gen-level patching (stitching) of the W samples, see DYanalyzer::CheckGenPatching()
+enum class Stitch {
+    kNone,
+    kInclusiveW,       // Inclusive W+jets : W mass and HT below the other samples
+    kBoostedW,         // HT-binned W+jets : W mass below the off-shell samples
+    kOffshellW,        // WToMuNu_M-* : W mass window
+    kOffshellWToTauNu  // WToTauNu_M-* : W mass window
+};
+
+// Metadata of a process in an era
+struct SampleInfo {
+    std::string sProcessName;
+    std::string sEra;       // "*" for every era
+    Bool_t bIsData = false;
+    // Extensions of the same dataset share a group, they are normalized together
+    std::string sGroup;
+    Double_t dCrossSection = 0.; // pb, 0 for data
+    Stitch eStitch = Stitch::kNone;
+    Double_t dW_mass_cut_low = 0.;
+    Double_t dW_mass_cut_high = 1e9;
+    Double_t dHT_cut_high = 1e9;
+    // Key of the PF MET xy-shift correction (see MET::FindXYCorrParams()), the era for MC, the run period for data
+    std::string sMETKey;
+};
+
+// Registry of the samples, parsed once from samples/samples.txt (embedded at build time, see CalibTables.h)
+// One line per process (and era, or "*" for all eras), plus the integrated luminosity of each era.
+// Lookups are two hash map finds : the era-specific line, then the line for all eras.
+class SampleRegistry {
+    private :
+        static constexpr const char* kFileName = "samples/samples.txt";
+
+        std::unordered_map<std::string, SampleInfo> mSamples; // "<era>/<process>"
+        std::unordered_map<std::string, Double_t> mLumi;      // pb^-1
+
+        SampleRegistry() {};
+        void Parse(const std::string& text);
+
+    public :
+        SampleRegistry(const SampleRegistry&) = delete;
+        SampleRegistry& operator=(const SampleRegistry&) = delete;
+
+        // Parsed at the first call, thread-safe
+        static const SampleRegistry& Get();
+
+        // nullptr if the process is not in the registry
+        const SampleInfo* Find(const std::string& processName, const std::string& era) const;
+        // Throws if the process is not in the registry
+        const SampleInfo& At(const std::string& processName, const std::string& era) const;
+        // Processes of the group in the era (era-specific lines and lines for all eras), sorted by name
+        std::vector<std::string> GetGroupMembers(const std::string& group, const std::string& era) const;
+        // Throws if the era is not in the registry
+        Double_t GetLumi(const std::string& era) const;
+        std::size_t GetNSamples() const { return mSamples.size(); }
+
+        static Stitch ParseStitch(const std::string& stitch);
+        static const char* StitchName(Stitch stitch);
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef SparseHist_h
+#define SparseHist_h
+
+// ROOT classes
+#include "TH1.h"
+
+// C++ classes
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <stdexcept>
+
+// 1D histogram of fixed binning whose bins are stored in pages allocated on first fill
+// The fine spectra (4000 bins of 1 GeV, at every stage) are mostly empty : a TH1D with Sumw2() always holds 64 KB,
+// this one only the pages of kPageSize bins that were filled (1 KB each).
+// Fill() gives the same contents, sums of squared weights and statistics as TH1D::Fill() with Sumw2(),
+// and the histogram is expanded into a TH1D to be written (ToTH1D()) : outputs and HistMerger are unchanged.
+class SparseTH1D {
+    private :
+        static constexpr Int_t kPageBits = 6;
+        static constexpr Int_t kPageSize = 1 << kPageBits;
+
+        std::string sName;
+        Int_t nBinsX;
+        Double_t dXLow;
+        Double_t dXHigh;
+        // Page i holds the bins [i * kPageSize, (i + 1) * kPageSize) : kPageSize sums of weights, then kPageSize sums of squared weights
+        std::vector<std::unique_ptr<Double_t[]>> vPages;
+        // Statistics of TH1 : number of entries, then sums of w, w^2, w*x and w*x^2 of the entries inside the axis range
+        Double_t dEntries = 0.;
+        Double_t dTsumw = 0.;
+        Double_t dTsumw2 = 0.;
+        Double_t dTsumwx = 0.;
+        Double_t dTsumwx2 = 0.;
+
+        Double_t* GetPage(Int_t bin) {
+            std::unique_ptr<Double_t[]>& page = vPages[bin >> kPageBits];
+            if (page == nullptr) page.reset(new Double_t[2 * kPageSize]()); // Zero-initialized
+            return page.get();
+        }
+
+    public :
+        SparseTH1D(const std::string& name, Int_t nBins, Double_t xLow, Double_t xHigh);
+        SparseTH1D(const SparseTH1D&) = delete;
+        SparseTH1D& operator=(const SparseTH1D&) = delete;
+
+        const char* GetName() const { return sName.c_str(); }
+        Int_t GetNbinsX() const { return nBinsX; }
+        Double_t GetEntries() const { return dEntries; }
+
+        // Same bin as TAxis::FindBin() of a fixed binning : 0 for the underflow, nBinsX + 1 for the overflow (and NaN)
+        Int_t FindBin(Double_t x) const {
+            if (x < dXLow) return 0;
+            if (!(x < dXHigh)) return nBinsX + 1;
+            return 1 + Int_t(nBinsX * (x - dXLow) / (dXHigh - dXLow));
+        }
+
+        // Same as TH1::Fill(x, w) with Sumw2(), the underflow and overflow are not in the statistics
+        void Fill(Double_t x, Double_t w = 1.) {
+            dEntries++;
+            const Int_t bin = FindBin(x);
+            Double_t* page = GetPage(bin);
+            const Int_t offset = bin & (kPageSize - 1);
+            page[offset] += w;
+            page[kPageSize + offset] += w * w;
+            if (bin == 0 || bin > nBinsX) return;
+            dTsumw += w;
+            dTsumw2 += w * w;
+            dTsumwx += w * x;
+            dTsumwx2 += w * x * x;
+        }
+
+        // Adds the contents, sums of squared weights, statistics and entries of a histogram of the same binning (checkpoints)
+        void Add(const TH1* h);
+        // New TH1D with Sumw2(), not attached to a directory, same as the TH1D that would have been filled
+        TH1D* ToTH1D() const;
+        // Allocated pages, and the bytes a TH1D with Sumw2() of the same binning would hold
+        std::size_t GetAllocatedBytes() const;
+        std::size_t GetDenseBytes() const { return 2 * sizeof(Double_t) * (nBinsX + 2); }
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef Telemetry_h
+#define Telemetry_h
+
+// ROOT classes
+#include "TTree.h"
+#include "TTreePerfStats.h"
+
+// C++ classes
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+// Throughput and resource telemetry of the event loop, one JSON object per line
+// Lines are written to stderr (default) or to a file, at most every dInterval seconds :
+//   {"type":"progress","label":...,"events":...,"total":...,"rate":...,"rate_avg":...,"eta_s":...,
+//    "rss_mb":...,"peak_rss_mb":...,"bytes_read":...,"bytes_unzipped":...,"unzip_s":...,"stages_s":{...},...}
+// and a last line with "type":"summary" at Stop(), also returned by GetSummary() (stored in the output file by DYanalyzer).
+// Stage times are accumulated by Lap(stage), which charges the time since the previous Lap() to the stage.
+class Telemetry {
+    private :
+        typedef std::chrono::steady_clock Clock;
+
+        std::vector<std::string> vStageNames;
+        std::vector<Clock::duration> vStageTimes;
+
+        std::string sLabel;
+        std::string sOutputFileName; // "-" : stderr, "none" : disabled
+        std::ofstream fOutput;
+        Double_t dInterval = 60.;
+
+        Long64_t nEvents = 0;
+        Long64_t nTotalEvents = 0;
+        // The clock is only read every kCheckEvery events
+        static constexpr Long64_t kCheckEvery = 1000;
+        Long64_t nNextCheck = kCheckEvery;
+        Long64_t nEventsLastReport = 0;
+        Clock::time_point tStart;
+        Clock::time_point tLap;
+        Clock::time_point tLastReport;
+
+        // I/O statistics of the input tree, owned, and their values when the loop stopped
+        TTree* fTree = nullptr;
+        TTreePerfStats* cPerfStats = nullptr;
+        Bool_t bIOStats = true;
+        Bool_t bHasIOStats = false;
+        Long64_t nBytesRead = 0;
+        Long64_t nReadCalls = 0;
+        Long64_t nBytesUnzipped = 0;
+        Double_t dUnzipTime = 0.;
+        Bool_t bIsRunning = false;
+        Clock::time_point tStop;
+
+        void UpdateIOStats();
+        void Report(const char* type);
+        std::string ToJSON(const char* type, Clock::time_point now);
+        std::ostream& GetStream();
+
+    public :
+        Telemetry(const std::vector<std::string>& stageNames)
+            : vStageNames(stageNames), vStageTimes(stageNames.size(), Clock::duration::zero())
+        {};
+        ~Telemetry();
+        Telemetry(const Telemetry&) = delete;
+        Telemetry& operator=(const Telemetry&) = delete;
+
+        // Should be called before Start()
+        void SetOutput(const std::string& fileName) {sOutputFileName = fileName;}
+        void SetInterval(Double_t seconds) {dInterval = seconds;}
+        void SetLabel(const std::string& label) {sLabel = label;}
+        // TTreePerfStats registers itself as the global gPerfStats, disable them if several loops run in concurrent threads
+        void SetIOStats(Bool_t ioStats) {bIOStats = ioStats;}
+        Bool_t IsEnabled() const {return sOutputFileName != "none";}
+
+        // tree may be null, then no I/O statistics are reported
+        void Start(Long64_t totalEvents, TTree* tree);
+        // Summary line, detaches the I/O statistics from the tree (the tree must still exist)
+        void Stop();
+
+        void Lap(Int_t stage) {
+            Clock::time_point now = Clock::now();
+            vStageTimes[stage] += now - tLap;
+            tLap = now;
+        }
+        void Event() {
+            if (++nEvents >= nNextCheck) {
+                nNextCheck += kCheckEvery;
+                if (std::chrono::duration<Double_t>(Clock::now() - tLastReport).count() >= dInterval) Report("progress");
+            }
+        }
+
+        // JSON summary of the run, final after Stop()
+        std::string GetSummary();
+
+        // Resident set size and its peak, in MB
+        static Double_t GetRSS();
+        static Double_t GetPeakRSS();
+};
+
+#endif
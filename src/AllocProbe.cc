@@ -0,0 +1,43 @@
+#include "AllocProbe.h"
+
+// C++ classes
+#include <cstdlib>
+#include <new>
+
+#ifdef DYANALYSIS_ALLOC_PROBE
+
+namespace {
+    // Per thread, so that the analyzers of DYmulti only see their own allocations
+    thread_local ULong64_t nAllocations = 0;
+}
+
+Bool_t AllocProbe::IsEnabled() { return true; }
+ULong64_t AllocProbe::GetNAllocations() { return nAllocations; }
+
+// Replacements of the global allocation functions : the other forms (arrays, nothrow) forward to these ones by default
+void* operator new(std::size_t size) {
+    nAllocations++;
+    if (size == 0) size = 1;
+    for (;;) {
+        void* ptr = std::malloc(size);
+        if (ptr != nullptr) return ptr;
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+#else
+
+Bool_t AllocProbe::IsEnabled() { return false; }
+ULong64_t AllocProbe::GetNAllocations() { return 0; }
+
+#endif
@@ -0,0 +1,57 @@
+#include "AnalysisCorrections.h"
+
+// C++ classes
+#include <sstream>
+
+AnalysisCorrections::Config AnalysisCorrections::Config::ForEra(const std::string& era) {
+    Config config;
+    config.sEra = era;
+    config.sHistName_ID = "NUM_TightID_DEN_TrackerMuons_abseta_pt";
+    config.sHistName_Iso = "NUM_TightRelIso_DEN_TightIDandIPCut_abseta_pt";
+    config.sHistName_Trig = "NUM_IsoMu24_DEN_CutBasedIdTight_and_PFIsoTight_abseta_pt";
+    if (era.find("2016") != std::string::npos) {
+        config.sHistName_Trig = "NUM_IsoMu24_or_IsoTkMu24_DEN_CutBasedIdTight_and_PFIsoTight_abseta_pt";
+    } else if (era == "2017") {
+        config.sHistName_Trig = "NUM_IsoMu27_DEN_CutBasedIdTight_and_PFIsoTight_abseta_pt";
+    }
+
+    if (era == "2016APV") {
+        config.sRoccoFileName = "../RoccoR/RoccoR2016aUL.txt";
+    } else if (era == "2016") {
+        config.sRoccoFileName = "../RoccoR/RoccoR2016bUL.txt";
+    } else if (era == "2017") {
+        config.sRoccoFileName = "../RoccoR/RoccoR2017UL.txt";
+    } else if (era == "2018") {
+        config.sRoccoFileName = "../RoccoR/RoccoR2018UL.txt";
+    }
+    return config;
+}
+
+std::string AnalysisCorrections::Config::ToString() const {
+    std::ostringstream config;
+    config << "era=" << sEra << ";id=" << sHistName_ID << ";iso=" << sHistName_Iso << ";trig=" << sHistName_Trig
+           << ";rocco=" << sRoccoFileName << ";puJson=" << sPUCorrectionFileName << ";muonSFJson=" << sMuonSFCorrectionFileName
+           << ";fastRocco=" << bFastRocco << ";roccoReplicas=" << bRoccoReplicas << ";roccoSet=" << iRoccoSet << "," << iRoccoMember;
+    return config.str();
+}
+
+AnalysisCorrections::AnalysisCorrections(const Config& config) : cConfig(config) {
+    pPU = std::make_unique<PU>(cConfig.sEra);
+    pEfficiencySF = std::make_unique<EfficiencySF>(cConfig.sEra, cConfig.sHistName_ID, cConfig.sHistName_Iso, cConfig.sHistName_Trig);
+    if (!cConfig.sPUCorrectionFileName.empty()) pPU->SetCorrection(cConfig.sPUCorrectionFileName);
+    if (!cConfig.sMuonSFCorrectionFileName.empty()) pEfficiencySF->SetCorrection(cConfig.sMuonSFCorrectionFileName);
+    pRochesterCorrection = std::make_unique<RoccoR>(cConfig.sRoccoFileName); // Rocco is initialized here
+    if (cConfig.bFastRocco) {
+        // Tabulated CrystalBall for the set/member used in DYanalyzer::ApplyRocco() (all of them for replicas), checked against the exact evaluation
+        if (cConfig.bRoccoReplicas) pRochesterCorrection->setFast(true);
+        else pRochesterCorrection->setFast(true, cConfig.iRoccoSet, cConfig.iRoccoMember);
+        RoccoR::FastDeviation roccoDeviation = pRochesterCorrection->validateFast(cConfig.iRoccoSet, cConfig.iRoccoMember);
+        std::cout << "[Info] AnalysisCorrections::AnalysisCorrections() - Fast Rocco enabled, max deviation from exact: kSmearMC " << roccoDeviation.smear
+                  << ", CrystalBall invcdf " << roccoDeviation.invcdf << std::endl;
+        if (roccoDeviation.nExact > 0) {
+            std::cerr << "[Warning] AnalysisCorrections::AnalysisCorrections() - " << roccoDeviation.nExact << " CrystalBall tables are not monotone, evaluated exactly" << std::endl;
+        }
+    }
+    pPU->Init();
+    pEfficiencySF->Init();
+}
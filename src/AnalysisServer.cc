@@ -0,0 +1,332 @@
+#include "AnalysisServer.h"
+
+// DYanalysis classes
+#include "Manifest.h"
+#include "SampleIndex.h"
+
+// ROOT classes
+#include "TMemFile.h"
+
+// C++ classes
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <chrono>
+
+// POSIX
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    // Requests are a few hundred bytes, a larger size is not a request
+    constexpr ULong64_t kMaxRequestSize = 1 << 20;
+
+    volatile std::sig_atomic_t gStopRequested = 0;
+    void OnStopSignal(int) { gStopRequested = 1; }
+
+    Bool_t WriteAll(int fd, const char* data, std::size_t size) {
+        while (size > 0) {
+            ssize_t n = write(fd, data, size);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    Bool_t ReadAll(int fd, char* data, std::size_t size) {
+        while (size > 0) {
+            ssize_t n = read(fd, data, size);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    sockaddr_un SocketAddress(const std::string& socketPath) {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("[Runtime Error] AnalysisServer - Invalid socket path: " + socketPath);
+        }
+        std::strcpy(address.sun_path, socketPath.c_str());
+        return address;
+    }
+}
+
+AnalysisServer::~AnalysisServer() {
+    if (iListenFd >= 0) {
+        close(iListenFd);
+        unlink(sSocketPath.c_str());
+    }
+}
+
+AnalysisServer::Request AnalysisServer::ParseRequest(const std::vector<std::string>& args) {
+    if (args.size() < 10) {
+        throw std::runtime_error("[Runtime Error] AnalysisServer::ParseRequest() - Expected <Input file list> <Era> <Process name> <IsMC> <DoPUCorrection> <DoL1PreFiringCorrection> <DoRocco> <DoIDSF> <DoIsoSF> <DoTrigSF> [options]");
+    }
+    auto ParseFlag = [](const std::string& value) {
+        if (value != "0" && value != "1") throw std::runtime_error("[Runtime Error] AnalysisServer::ParseRequest() - Invalid flag: " + value);
+        return value == "1";
+    };
+    Request request;
+    request.sInputFileList = args[0];
+    request.sEra = args[1];
+    request.sProcessName = args[2];
+    request.bIsMC = ParseFlag(args[3]);
+    request.bDoPUCorrection = ParseFlag(args[4]);
+    request.bDoL1PreFiringCorrection = ParseFlag(args[5]);
+    request.bDoRocco = ParseFlag(args[6]);
+    request.bDoIDSF = ParseFlag(args[7]);
+    request.bDoIsoSF = ParseFlag(args[8]);
+    request.bDoTrigSF = ParseFlag(args[9]);
+    for (std::size_t iArg = 10; iArg < args.size(); iArg++) {
+        const std::string& option = args[iArg];
+        const Bool_t hasValue = iArg + 1 < args.size();
+        if (option == "--fast-rocco") {
+            request.bFastRocco = true;
+        } else if (option == "--rocco-replicas") {
+            request.bRoccoReplicas = true;
+        } else if (option == "--pu-json" && hasValue) {
+            request.sPUCorrectionFileName = args[++iArg];
+        } else if (option == "--muon-sf-json" && hasValue) {
+            request.sMuonSFCorrectionFileName = args[++iArg];
+        } else if (option == "--normalize" && hasValue) {
+            request.sNormalizeIndexFileName = args[++iArg];
+        } else if (option == "--cut" && hasValue) {
+            request.cCuts.Set(args[++iArg]);
+        } else if (option == "--hists" && hasValue) {
+            request.sHistogramList = args[++iArg];
+        } else {
+            throw std::runtime_error("[Runtime Error] AnalysisServer::ParseRequest() - Unknown option for the daemon: " + option);
+        }
+    }
+    return request;
+}
+
+std::map<std::string, Long64_t> AnalysisServer::GetKnownEntries(const std::string& inputFileList) {
+    std::map<std::string, Long64_t> knownEntries;
+    for (const std::string& fileName : Data::ReadFileList(inputFileList)) {
+        auto cached = mFileEntries.find(fileName);
+        if (cached == mFileEntries.end()) continue;
+        Long64_t size, mtime;
+        Manifest::Stat(fileName, size, mtime);
+        if (size == cached->second.nSize && mtime == cached->second.nMTime) knownEntries[fileName] = cached->second.nEntries;
+        else mFileEntries.erase(cached);
+    }
+    return knownEntries;
+}
+
+std::shared_ptr<AnalysisCorrections> AnalysisServer::GetCorrections(const AnalysisCorrections::Config& config) {
+    std::shared_ptr<AnalysisCorrections>& corrections = mCorrections[config.ToString()];
+    if (corrections == nullptr) {
+        auto start = std::chrono::steady_clock::now();
+        corrections = std::make_shared<AnalysisCorrections>(config);
+        std::cout << "[Info] AnalysisServer::GetCorrections() - Corrections built in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+                  << " s, " << mCorrections.size() << " configurations in memory" << std::endl;
+    }
+    return corrections;
+}
+
+std::string AnalysisServer::Process(const Request& request) {
+    auto start = std::chrono::steady_clock::now();
+    nRequests++;
+    std::cout << "[Info] AnalysisServer::Process() - Request " << nRequests << ": " << request.sProcessName << " (" << request.sEra << "), " << request.sInputFileList << std::endl;
+
+    // Normalization of the histograms to the luminosity, data are not scaled
+    Double_t normalizationScale = 0.;
+    if (!request.sNormalizeIndexFileName.empty() && request.bIsMC) {
+        SampleIndex index;
+        if (!index.Read(request.sNormalizeIndexFileName)) {
+            throw std::runtime_error("[Runtime Error] AnalysisServer::Process() - Cannot open " + request.sNormalizeIndexFileName);
+        }
+        normalizationScale = index.GetNormalization(request.sProcessName, request.sEra);
+    }
+
+    AnalysisCorrections::Config eraConfig = AnalysisCorrections::Config::ForEra(request.sEra);
+    DYanalyzer analyzer(request.sInputFileList, request.sProcessName, request.sEra, eraConfig.sHistName_ID, eraConfig.sHistName_Iso, eraConfig.sHistName_Trig, eraConfig.sRoccoFileName,
+                        request.bIsMC, request.bDoPUCorrection, request.bDoL1PreFiringCorrection, request.bDoRocco, request.bDoIDSF, request.bDoIsoSF, request.bDoTrigSF);
+    analyzer.SetFastRocco(request.bFastRocco);
+    analyzer.SetRoccoReplicas(request.bRoccoReplicas);
+    analyzer.SetPUCorrectionFileName(request.sPUCorrectionFileName);
+    analyzer.SetMuonSFCorrectionFileName(request.sMuonSFCorrectionFileName);
+    analyzer.SetNormalizationScale(normalizationScale);
+    analyzer.SetCuts(request.cCuts);
+    analyzer.SetHistogramList(request.sHistogramList);
+    analyzer.SetKnownEntries(GetKnownEntries(request.sInputFileList));
+    analyzer.SetCorrections(GetCorrections(analyzer.GetCorrectionConfig()));
+    analyzer.SetTelemetry("none", 0., false);
+
+    // The histograms of the analyzer are not owned by a directory, they are deleted with the request
+    std::string buffer;
+    try {
+        analyzer.Init();
+        analyzer.Analyze();
+
+        // Numbers of entries of the inputs for the next requests, only for local files
+        const std::vector<std::string>& fileNames = analyzer.GetData().GetFileNames();
+        std::vector<Long64_t> fileEntries = analyzer.GetData().GetFileEntries();
+        for (std::size_t i = 0; i < fileNames.size(); i++) {
+            FileEntries entries;
+            Manifest::Stat(fileNames[i], entries.nSize, entries.nMTime);
+            if (entries.nSize < 0) continue;
+            entries.nEntries = fileEntries[i];
+            mFileEntries[fileNames[i]] = entries;
+        }
+
+        TMemFile output("DYanalysis_request.root", "RECREATE");
+        analyzer.WriteHistograms(&output);
+        analyzer.GetManifest().Write(&output);
+        output.Write();
+        Long64_t size = output.GetSize();
+        buffer.assign(size, '\0');
+        output.CopyTo(&buffer[0], size);
+        output.Close();
+    } catch (...) {
+        for (TH1* h : analyzer.GetHistograms()) delete h;
+        throw;
+    }
+    for (TH1* h : analyzer.GetHistograms()) delete h;
+
+    std::cout << "[Info] AnalysisServer::Process() - Request " << nRequests << " served in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+              << " s, " << analyzer.GetTotalEvents() << " events, " << buffer.size() << " bytes" << std::endl;
+    return buffer;
+}
+
+void AnalysisServer::Reply(Int_t fd, ULong64_t status, const std::string& payload) {
+    ULong64_t header[2] = {status, payload.size()};
+    if (!WriteAll(fd, reinterpret_cast<const char*>(header), sizeof(header)) || !WriteAll(fd, payload.data(), payload.size())) {
+        std::cerr << "[Warning] AnalysisServer::Reply() - The client is gone before the end of the reply" << std::endl;
+    }
+}
+
+void AnalysisServer::Serve() {
+    // A client that is gone must not stop the daemon
+    signal(SIGPIPE, SIG_IGN);
+    // Without SA_RESTART, accept() returns when the daemon is stopped
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = OnStopSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    sockaddr_un address = SocketAddress(sSocketPath);
+    // Socket of a previous daemon : replaced if nothing listens on it any more, any other file is left alone
+    struct stat st;
+    if (lstat(sSocketPath.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            throw std::runtime_error("[Runtime Error] AnalysisServer::Serve() - " + sSocketPath + " exists and is not a socket");
+        }
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        Bool_t isListening = fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        if (fd >= 0) close(fd);
+        if (isListening) {
+            throw std::runtime_error("[Runtime Error] AnalysisServer::Serve() - Another daemon is listening on " + sSocketPath);
+        }
+        unlink(sSocketPath.c_str());
+    } else if (errno != ENOENT) {
+        throw std::runtime_error("[Runtime Error] AnalysisServer::Serve() - Cannot check " + sSocketPath + ": " + std::strerror(errno));
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("[Runtime Error] AnalysisServer::Serve() - Cannot create a socket");
+    }
+    // Only the user can connect : the socket file is created with mode 0600
+    mode_t previousMask = umask(0177);
+    Bool_t isBound = bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    int bindErrno = errno;
+    umask(previousMask);
+    if (!isBound || listen(fd, 16) != 0) {
+        std::string error = std::strerror(isBound ? errno : bindErrno);
+        close(fd);
+        // The path is only removed when the socket is the one of this daemon
+        if (isBound) unlink(sSocketPath.c_str());
+        throw std::runtime_error("[Runtime Error] AnalysisServer::Serve() - Cannot listen on " + sSocketPath + ": " + error);
+    }
+    iListenFd = fd;
+    // Histograms of the requests are written explicitly into their output
+    TH1::AddDirectory(kFALSE);
+    std::cout << "[Info] AnalysisServer::Serve() - Listening on " << sSocketPath << std::endl;
+
+    while (!gStopRequested) {
+        int fd = accept(iListenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("[Runtime Error] AnalysisServer::Serve() - Cannot accept a connection: " + std::string(std::strerror(errno)));
+        }
+        ULong64_t size = 0;
+        std::string message;
+        if (!ReadAll(fd, reinterpret_cast<char*>(&size), sizeof(size)) || size > kMaxRequestSize) {
+            std::cerr << "[Warning] AnalysisServer::Serve() - Invalid request" << std::endl;
+            close(fd);
+            continue;
+        }
+        message.resize(size);
+        if (!ReadAll(fd, &message[0], size)) {
+            std::cerr << "[Warning] AnalysisServer::Serve() - Incomplete request" << std::endl;
+            close(fd);
+            continue;
+        }
+        std::vector<std::string> args;
+        for (std::size_t begin = 0, end; begin < message.size(); begin = end + 1) {
+            end = message.find('\0', begin);
+            if (end == std::string::npos) end = message.size();
+            args.push_back(message.substr(begin, end - begin));
+        }
+
+        try {
+            std::string output = Process(ParseRequest(args));
+            Reply(fd, 0, output);
+        } catch (const std::exception& e) {
+            std::cerr << "[Error] AnalysisServer::Serve() - " << e.what() << std::endl;
+            Reply(fd, 1, e.what());
+        }
+        close(fd);
+    }
+
+    std::cout << "[Info] AnalysisServer::Serve() - Stopped after " << nRequests << " requests" << std::endl;
+    close(iListenFd);
+    unlink(sSocketPath.c_str());
+    iListenFd = -1;
+}
+
+std::string AnalysisServer::Send(const std::string& socketPath, const std::vector<std::string>& args) {
+    sockaddr_un address = SocketAddress(socketPath);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (fd >= 0) close(fd);
+        throw std::runtime_error("[Runtime Error] AnalysisServer::Send() - Cannot connect to " + socketPath + ": " + std::strerror(errno));
+    }
+
+    std::string message;
+    for (const std::string& arg : args) {
+        message += arg;
+        message += '\0';
+    }
+    ULong64_t size = message.size();
+    ULong64_t header[2] = {0, 0};
+    std::string payload;
+    Bool_t isComplete = WriteAll(fd, reinterpret_cast<const char*>(&size), sizeof(size)) && WriteAll(fd, message.data(), message.size())
+                     && ReadAll(fd, reinterpret_cast<char*>(header), sizeof(header));
+    if (isComplete) {
+        payload.resize(header[1]);
+        isComplete = ReadAll(fd, &payload[0], payload.size());
+    }
+    close(fd);
+    if (!isComplete) {
+        throw std::runtime_error("[Runtime Error] AnalysisServer::Send() - Connection to " + socketPath + " closed before the reply");
+    }
+    if (header[0] != 0) {
+        throw std::runtime_error(payload);
+    }
+    return payload;
+}
@@ -0,0 +1,16 @@
+#include "CalibTables.h"
+
+// Linear search, only called at Init()
+const CalibHist* CalibTables::Find(const std::string& fileName, const std::string& histName) {
+    for (int i = 0; i < nHists; i++) {
+        if (fileName == kHists[i].sFileName && histName == kHists[i].sHistName) return &kHists[i];
+    }
+    return nullptr;
+}
+
+const CalibText* CalibTables::FindText(const std::string& fileName) {
+    for (int i = 0; i < nTexts; i++) {
+        if (fileName == kTexts[i].sFileName) return &kTexts[i];
+    }
+    return nullptr;
+}
@@ -0,0 +1,913 @@
+#include "Correction.h"
+#include "CalibTables.h"
+
+// C++ classes
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <cctype>
+
+////////////////////////////////////////////////////////////
+//////////////////////// JSON parser ///////////////////////
+////////////////////////////////////////////////////////////
+namespace {
+
+struct JsonValue {
+    enum class Type : UInt_t {kNull = 0, kBool, kNumber, kString, kArray, kObject};
+    Type eType = Type::kNull;
+    Bool_t bValue = false;
+    Double_t dValue = 0.;
+    std::string sValue;
+    std::vector<JsonValue> vArray;
+    std::vector<std::pair<std::string, JsonValue>> vObject;
+
+    Bool_t IsNumber() const { return eType == Type::kNumber; }
+    Bool_t IsString() const { return eType == Type::kString; }
+    Bool_t IsArray() const { return eType == Type::kArray; }
+    Bool_t IsObject() const { return eType == Type::kObject; }
+
+    const JsonValue* Find(const std::string& key) const {
+        for (const auto& member : vObject) {
+            if (member.first == key) return &member.second;
+        }
+        return nullptr;
+    }
+    const JsonValue& At(const std::string& key) const {
+        const JsonValue* value = Find(key);
+        if (value == nullptr) throw std::runtime_error("[Runtime Error] Correction - Missing JSON key: " + key);
+        return *value;
+    }
+    Double_t Number() const {
+        if (!IsNumber()) throw std::runtime_error("[Runtime Error] Correction - JSON value is not a number");
+        return dValue;
+    }
+    const std::string& String() const {
+        if (!IsString()) throw std::runtime_error("[Runtime Error] Correction - JSON value is not a string");
+        return sValue;
+    }
+    const std::vector<JsonValue>& Array() const {
+        if (!IsArray()) throw std::runtime_error("[Runtime Error] Correction - JSON value is not an array");
+        return vArray;
+    }
+};
+
+class JsonParser {
+    private :
+        const char* pCur;
+        const char* pEnd;
+        const std::string& sFileName;
+
+        [[noreturn]] void Fail(const std::string& message) {
+            throw std::runtime_error("[Runtime Error] CorrectionSet - JSON parse error in " + sFileName + ": " + message);
+        }
+        void SkipSpace() {
+            while (pCur < pEnd && (*pCur == ' ' || *pCur == '\n' || *pCur == '\r' || *pCur == '\t')) pCur++;
+        }
+        void Expect(char c) {
+            SkipSpace();
+            if (pCur >= pEnd || *pCur != c) Fail(std::string("expected '") + c + "'");
+            pCur++;
+        }
+        void ExpectWord(const char* word) {
+            std::size_t n = std::strlen(word);
+            if ((std::size_t)(pEnd - pCur) < n || std::strncmp(pCur, word, n) != 0) Fail(std::string("expected ") + word);
+            pCur += n;
+        }
+
+        static void AppendUTF8(std::string& out, UInt_t code) {
+            if (code < 0x80) {
+                out += (char)code;
+            } else if (code < 0x800) {
+                out += (char)(0xC0 | (code >> 6));
+                out += (char)(0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                out += (char)(0xE0 | (code >> 12));
+                out += (char)(0x80 | ((code >> 6) & 0x3F));
+                out += (char)(0x80 | (code & 0x3F));
+            } else {
+                out += (char)(0xF0 | (code >> 18));
+                out += (char)(0x80 | ((code >> 12) & 0x3F));
+                out += (char)(0x80 | ((code >> 6) & 0x3F));
+                out += (char)(0x80 | (code & 0x3F));
+            }
+        }
+        UInt_t ParseHex4() {
+            if (pEnd - pCur < 4) Fail("truncated \\u escape");
+            UInt_t code = 0;
+            for (Int_t i = 0; i < 4; i++) {
+                char c = *pCur++;
+                code <<= 4;
+                if (c >= '0' && c <= '9') code |= c - '0';
+                else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+                else Fail("invalid \\u escape");
+            }
+            return code;
+        }
+
+        std::string ParseString() {
+            Expect('"');
+            std::string out;
+            while (true) {
+                if (pCur >= pEnd) Fail("unterminated string");
+                char c = *pCur++;
+                if (c == '"') break;
+                if (c != '\\') {
+                    out += c;
+                    continue;
+                }
+                if (pCur >= pEnd) Fail("unterminated string");
+                char e = *pCur++;
+                switch (e) {
+                    case '"': out += '"'; break;
+                    case '\\': out += '\\'; break;
+                    case '/': out += '/'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    case 'u': {
+                        UInt_t code = ParseHex4();
+                        // Surrogate pair
+                        if (code >= 0xD800 && code < 0xDC00 && pEnd - pCur >= 6 && pCur[0] == '\\' && pCur[1] == 'u') {
+                            pCur += 2;
+                            UInt_t low = ParseHex4();
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        AppendUTF8(out, code);
+                        break;
+                    }
+                    default: Fail("invalid escape");
+                }
+            }
+            return out;
+        }
+
+    public :
+        JsonParser(const std::string& text, const std::string& fileName)
+            : pCur(text.data()), pEnd(text.data() + text.size()), sFileName(fileName) {}
+
+        JsonValue ParseDocument() {
+            JsonValue value = ParseValue();
+            SkipSpace();
+            if (pCur != pEnd) Fail("trailing characters");
+            return value;
+        }
+
+        JsonValue ParseValue() {
+            SkipSpace();
+            if (pCur >= pEnd) Fail("unexpected end of document");
+            JsonValue value;
+            char c = *pCur;
+            if (c == '{') {
+                value.eType = JsonValue::Type::kObject;
+                pCur++;
+                SkipSpace();
+                if (pCur < pEnd && *pCur == '}') {
+                    pCur++;
+                    return value;
+                }
+                while (true) {
+                    std::string key = ParseString();
+                    Expect(':');
+                    value.vObject.emplace_back(std::move(key), ParseValue());
+                    SkipSpace();
+                    if (pCur < pEnd && *pCur == ',') { pCur++; continue; }
+                    Expect('}');
+                    break;
+                }
+            } else if (c == '[') {
+                value.eType = JsonValue::Type::kArray;
+                pCur++;
+                SkipSpace();
+                if (pCur < pEnd && *pCur == ']') {
+                    pCur++;
+                    return value;
+                }
+                while (true) {
+                    value.vArray.push_back(ParseValue());
+                    SkipSpace();
+                    if (pCur < pEnd && *pCur == ',') { pCur++; continue; }
+                    Expect(']');
+                    break;
+                }
+            } else if (c == '"') {
+                value.eType = JsonValue::Type::kString;
+                value.sValue = ParseString();
+            } else if (c == 't') {
+                ExpectWord("true");
+                value.eType = JsonValue::Type::kBool;
+                value.bValue = true;
+            } else if (c == 'f') {
+                ExpectWord("false");
+                value.eType = JsonValue::Type::kBool;
+            } else if (c == 'n') {
+                ExpectWord("null");
+            } else {
+                // strtod needs a terminated buffer, the number token is copied
+                const char* begin = pCur;
+                while (pCur < pEnd && (std::strchr("+-0123456789.eE", *pCur) != nullptr)) pCur++;
+                std::string token(begin, pCur);
+                char* tokenEnd = nullptr;
+                value.eType = JsonValue::Type::kNumber;
+                value.dValue = std::strtod(token.c_str(), &tokenEnd);
+                if (token.empty() || *tokenEnd != '\0') Fail("invalid number '" + token + "'");
+            }
+            return value;
+        }
+};
+
+} // namespace
+
+////////////////////////////////////////////////////////////
+/////////////////// Formula expressions ////////////////////
+////////////////////////////////////////////////////////////
+namespace {
+
+// Recursive descent parser of the TFormula subset used in correctionlib files
+// Variables x, y, z, t are the inputs listed in "variables", [i] are the "parameters"
+class FormulaParser {
+    private :
+        using Op = Correction::Op;
+        using FormulaOp = Correction::FormulaOp;
+
+        const std::string& sExpr;
+        std::size_t iPos = 0;
+        const std::vector<Int_t>& vVariables;
+        const std::vector<Double_t>& vParameters;
+        std::vector<FormulaOp>& vOps;
+        Int_t nDepth = 0;
+        Int_t nMaxDepth = 0;
+
+        [[noreturn]] void Fail(const std::string& message) {
+            throw std::runtime_error("[Runtime Error] Correction - Cannot parse formula '" + sExpr + "': " + message);
+        }
+        void SkipSpace() {
+            while (iPos < sExpr.size() && std::isspace((unsigned char)sExpr[iPos])) iPos++;
+        }
+        Bool_t Accept(const char* token) {
+            SkipSpace();
+            std::size_t n = std::strlen(token);
+            if (sExpr.compare(iPos, n, token) != 0) return false;
+            iPos += n;
+            return true;
+        }
+        // Stack depth bookkeeping : pushes add one entry, binary operations remove one
+        void Emit(Op op, Int_t iArg = 0, Double_t dArg = 0.) {
+            vOps.push_back(FormulaOp{op, iArg, dArg});
+            if (op == Op::kConst || op == Op::kInput) nDepth++;
+            else if (op >= Op::kAdd && op <= Op::kNotEqual && op != Op::kNeg) nDepth--;
+            else if (op >= Op::kAtan2) nDepth--;
+            nMaxDepth = std::max(nMaxDepth, nDepth);
+        }
+
+        void ParseComparison() {
+            ParseSum();
+            while (true) {
+                if (Accept("<=")) { ParseSum(); Emit(Op::kLessEq); }
+                else if (Accept(">=")) { ParseSum(); Emit(Op::kGreaterEq); }
+                else if (Accept("==")) { ParseSum(); Emit(Op::kEqual); }
+                else if (Accept("!=")) { ParseSum(); Emit(Op::kNotEqual); }
+                else if (Accept("<")) { ParseSum(); Emit(Op::kLess); }
+                else if (Accept(">")) { ParseSum(); Emit(Op::kGreater); }
+                else break;
+            }
+        }
+        void ParseSum() {
+            ParseProduct();
+            while (true) {
+                if (Accept("+")) { ParseProduct(); Emit(Op::kAdd); }
+                else if (Accept("-")) { ParseProduct(); Emit(Op::kSub); }
+                else break;
+            }
+        }
+        void ParseProduct() {
+            ParseUnary();
+            while (true) {
+                if (Accept("*")) { ParseUnary(); Emit(Op::kMul); }
+                else if (Accept("/")) { ParseUnary(); Emit(Op::kDiv); }
+                else break;
+            }
+        }
+        // -x^2 = -(x^2)
+        void ParseUnary() {
+            if (Accept("-")) { ParseUnary(); Emit(Op::kNeg); return; }
+            if (Accept("+")) { ParseUnary(); return; }
+            ParsePower();
+        }
+        // Right associative
+        void ParsePower() {
+            ParsePrimary();
+            if (Accept("^")) { ParseUnary(); Emit(Op::kPow); }
+        }
+        void ParsePrimary() {
+            SkipSpace();
+            if (iPos >= sExpr.size()) Fail("unexpected end");
+            char c = sExpr[iPos];
+
+            if (c == '(') {
+                iPos++;
+                ParseComparison();
+                if (!Accept(")")) Fail("expected ')'");
+                return;
+            }
+            if (c == '[') {
+                iPos++;
+                std::size_t end = sExpr.find(']', iPos);
+                if (end == std::string::npos) Fail("expected ']'");
+                Int_t iPar = std::atoi(sExpr.substr(iPos, end - iPos).c_str());
+                if (iPar < 0 || iPar >= (Int_t)vParameters.size()) Fail("parameter out of range");
+                iPos = end + 1;
+                Emit(Op::kConst, 0, vParameters[iPar]);
+                return;
+            }
+            if (std::isdigit((unsigned char)c) || c == '.') {
+                const char* begin = sExpr.c_str() + iPos;
+                char* end = nullptr;
+                Double_t value = std::strtod(begin, &end);
+                if (end == begin) Fail("invalid number");
+                iPos += end - begin;
+                Emit(Op::kConst, 0, value);
+                return;
+            }
+            if (std::isalpha((unsigned char)c)) {
+                std::size_t begin = iPos;
+                while (iPos < sExpr.size() && (std::isalnum((unsigned char)sExpr[iPos]) || sExpr[iPos] == '_' || sExpr[iPos] == ':')) iPos++;
+                std::string name = sExpr.substr(begin, iPos - begin);
+                if (name.compare(0, 7, "TMath::") == 0) name = name.substr(7);
+                std::transform(name.begin(), name.end(), name.begin(), [](unsigned char ch) { return std::tolower(ch); });
+
+                const char* kVariableNames = "xyzt";
+                if (name.size() == 1 && std::strchr(kVariableNames, name[0]) != nullptr) {
+                    std::size_t iVar = std::strchr(kVariableNames, name[0]) - kVariableNames;
+                    if (iVar >= vVariables.size()) Fail("variable " + name + " is not defined");
+                    Emit(Op::kInput, vVariables[iVar]);
+                    return;
+                }
+
+                static const std::pair<const char*, Op> kFunc1[] = {
+                    {"exp", Op::kExp}, {"log", Op::kLog}, {"log10", Op::kLog10}, {"sqrt", Op::kSqrt}, {"abs", Op::kAbs}, {"fabs", Op::kAbs},
+                    {"erf", Op::kErf}, {"cos", Op::kCos}, {"sin", Op::kSin}, {"tan", Op::kTan}, {"acos", Op::kAcos}, {"asin", Op::kAsin},
+                    {"atan", Op::kAtan}, {"cosh", Op::kCosh}, {"sinh", Op::kSinh}, {"tanh", Op::kTanh}, {"acosh", Op::kAcosh},
+                    {"asinh", Op::kAsinh}, {"atanh", Op::kAtanh},
+                };
+                static const std::pair<const char*, Op> kFunc2[] = {
+                    {"pow", Op::kPow}, {"atan2", Op::kAtan2}, {"max", Op::kMax}, {"min", Op::kMin},
+                };
+                if (!Accept("(")) Fail("expected '(' after " + name);
+                for (const auto& func : kFunc1) {
+                    if (name != func.first) continue;
+                    ParseComparison();
+                    if (!Accept(")")) Fail("expected ')'");
+                    Emit(func.second);
+                    return;
+                }
+                for (const auto& func : kFunc2) {
+                    if (name != func.first) continue;
+                    ParseComparison();
+                    if (!Accept(",")) Fail("expected ','");
+                    ParseComparison();
+                    if (!Accept(")")) Fail("expected ')'");
+                    Emit(func.second);
+                    return;
+                }
+                Fail("unknown function " + name);
+            }
+            Fail(std::string("unexpected character '") + c + "'");
+        }
+
+    public :
+        FormulaParser(const std::string& expr, const std::vector<Int_t>& variables, const std::vector<Double_t>& parameters,
+                      std::vector<FormulaOp>& ops)
+            : sExpr(expr), vVariables(variables), vParameters(parameters), vOps(ops) {}
+
+        // Returns the maximum stack depth of the program
+        Int_t Parse() {
+            ParseComparison();
+            SkipSpace();
+            if (iPos != sExpr.size()) Fail("trailing characters");
+            return nMaxDepth;
+        }
+};
+
+} // namespace
+
+////////////////////////////////////////////////////////////
+///////////////////////// Compiler /////////////////////////
+////////////////////////////////////////////////////////////
+class CorrectionCompiler {
+    private :
+        using Node = Correction::Node;
+        using NodeType = Correction::NodeType;
+
+        Correction& cCorr;
+        const JsonValue* pGenericFormulas = nullptr;
+        // String categories, turned into id tables once all strings are known
+        std::vector<Int_t> vStringCategories;
+
+        [[noreturn]] void Fail(const std::string& message) {
+            throw std::runtime_error("[Runtime Error] Correction - " + cCorr.sName + ": " + message);
+        }
+
+        Int_t InputIndex(const std::string& name) {
+            Int_t index = cCorr.GetInputIndex(name);
+            if (index < 0) Fail("unknown input " + name);
+            return index;
+        }
+        Int_t AddString(Int_t input, const std::string& value) {
+            std::vector<std::string>& strings = cCorr.vStrings[input];
+            auto it = std::find(strings.begin(), strings.end(), value);
+            if (it != strings.end()) return (Int_t)(it - strings.begin());
+            strings.push_back(value);
+            return (Int_t)strings.size() - 1;
+        }
+        Int_t AddNode(NodeType type) {
+            Node node;
+            node.eType = type;
+            cCorr.vNodes.push_back(node);
+            return (Int_t)cCorr.vNodes.size() - 1;
+        }
+
+        // Edges of a binning : explicit list, or {"n", "low", "high"} for uniform bins (stored as low, high, n / (high - low)).
+        // Returns the offset in vData.
+        Int_t AddEdges(const JsonValue& edges, Int_t& nBins, Bool_t& isUniform) {
+            Int_t offset = (Int_t)cCorr.vData.size();
+            if (edges.IsObject()) {
+                nBins = (Int_t)edges.At("n").Number();
+                Double_t low = edges.At("low").Number();
+                Double_t high = edges.At("high").Number();
+                if (nBins <= 0 || !(high > low)) Fail("invalid uniform binning");
+                cCorr.vData.push_back(low);
+                cCorr.vData.push_back(high);
+                cCorr.vData.push_back(nBins / (high - low));
+                isUniform = true;
+                return offset;
+            }
+            const std::vector<JsonValue>& list = edges.Array();
+            if (list.size() < 2) Fail("binning with less than 2 edges");
+            for (std::size_t i = 0; i < list.size(); i++) {
+                cCorr.vData.push_back(list[i].Number());
+                if (i > 0 && !(cCorr.vData[offset + i] > cCorr.vData[offset + i - 1])) Fail("bin edges are not increasing");
+            }
+            nBins = (Int_t)list.size() - 1;
+            isUniform = false;
+            return offset;
+        }
+        Int_t CompileFlow(const JsonValue* flow) {
+            if (flow == nullptr) return Correction::kFlowError;
+            if (flow->IsString()) {
+                if (flow->sValue == "clamp") return Correction::kFlowClamp;
+                if (flow->sValue == "error") return Correction::kFlowError;
+                Fail("unknown flow " + flow->sValue);
+            }
+            return Compile(*flow);
+        }
+        Int_t CompileFormula(const std::string& expr, const std::vector<Int_t>& variables, const std::vector<Double_t>& parameters) {
+            Int_t index = AddNode(NodeType::kFormula);
+            Int_t offset = (Int_t)cCorr.vOps.size();
+            Int_t depth = FormulaParser(expr, variables, parameters, cCorr.vOps).Parse();
+            if (depth > Correction::kMaxStack) Fail("formula is too deep: " + expr);
+            cCorr.nMaxStack = std::max(cCorr.nMaxStack, depth);
+            cCorr.vNodes[index].iChildren = offset;
+            cCorr.vNodes[index].nEntries = (Int_t)cCorr.vOps.size() - offset;
+            return index;
+        }
+
+    public :
+        CorrectionCompiler(Correction& corr) : cCorr(corr) {}
+
+        void CompileCorrection(const JsonValue& json) {
+            cCorr.sName = json.At("name").String();
+            if (const JsonValue* description = json.Find("description")) {
+                if (description->IsString()) cCorr.sDescription = description->sValue;
+            }
+            for (const JsonValue& input : json.At("inputs").Array()) {
+                cCorr.vInputNames.push_back(input.At("name").String());
+                const std::string& type = input.At("type").String();
+                if (type == "real") cCorr.vInputTypes.push_back(Correction::InputType::kReal);
+                else if (type == "int") cCorr.vInputTypes.push_back(Correction::InputType::kInt);
+                else if (type == "string") cCorr.vInputTypes.push_back(Correction::InputType::kString);
+                else Fail("unknown input type " + type);
+            }
+            cCorr.vStrings.resize(cCorr.vInputNames.size());
+            cCorr.sOutputName = json.At("output").At("name").String();
+            pGenericFormulas = json.Find("generic_formulas");
+
+            Compile(json.At("data"));
+            FinalizeStringCategories();
+        }
+
+        // Returns the index of the node, the node is added before its children so the root is vNodes[0]
+        Int_t Compile(const JsonValue& json) {
+            if (json.IsNumber()) {
+                Int_t index = AddNode(NodeType::kConstant);
+                cCorr.vNodes[index].iData = (Int_t)cCorr.vData.size();
+                cCorr.vData.push_back(json.dValue);
+                return index;
+            }
+            const std::string& type = json.At("nodetype").String();
+
+            if (type == "binning") {
+                Int_t index = AddNode(NodeType::kBinning);
+                Int_t nBins = 0;
+                Bool_t isUniform = false;
+                Int_t input = InputIndex(json.At("input").String());
+                Int_t iData = AddEdges(json.At("edges"), nBins, isUniform);
+                const std::vector<JsonValue>& content = json.At("content").Array();
+                if ((Int_t)content.size() != nBins) Fail("# of bins and contents differ");
+
+                Int_t iChildren = (Int_t)cCorr.vIndex.size();
+                cCorr.vIndex.resize(iChildren + nBins);
+                for (Int_t i = 0; i < nBins; i++) {
+                    Int_t child = Compile(content[i]);
+                    cCorr.vIndex[iChildren + i] = child;
+                }
+                Int_t flow = CompileFlow(json.Find("flow"));
+
+                Node& node = cCorr.vNodes[index];
+                node.iInput = input;
+                node.nEntries = nBins;
+                node.iData = iData;
+                node.iChildren = iChildren;
+                node.iDefault = flow;
+                node.bUniform = isUniform;
+                return index;
+            }
+
+            if (type == "multibinning") {
+                Int_t index = AddNode(NodeType::kMultiBinning);
+                const std::vector<JsonValue>& inputs = json.At("inputs").Array();
+                const std::vector<JsonValue>& edges = json.At("edges").Array();
+                if (inputs.size() != edges.size() || inputs.empty()) Fail("multibinning inputs and edges differ");
+                Int_t nDim = (Int_t)inputs.size();
+
+                // Per dimension : input, # of bins, offset of the edges, uniform flag ; then the children
+                Int_t iChildren = (Int_t)cCorr.vIndex.size();
+                cCorr.vIndex.resize(iChildren + 4 * nDim);
+                Int_t nCells = 1;
+                for (Int_t iDim = 0; iDim < nDim; iDim++) {
+                    Int_t nBins = 0;
+                    Bool_t isUniform = false;
+                    cCorr.vIndex[iChildren + iDim] = InputIndex(inputs[iDim].String());
+                    Int_t iData = AddEdges(edges[iDim], nBins, isUniform);
+                    cCorr.vIndex[iChildren + nDim + iDim] = nBins;
+                    cCorr.vIndex[iChildren + 2 * nDim + iDim] = iData;
+                    cCorr.vIndex[iChildren + 3 * nDim + iDim] = isUniform;
+                    nCells *= nBins;
+                }
+                // Flattened content, the last input varies fastest
+                const std::vector<JsonValue>& content = json.At("content").Array();
+                if ((Int_t)content.size() != nCells) Fail("# of cells and contents differ");
+                Int_t iCells = (Int_t)cCorr.vIndex.size();
+                cCorr.vIndex.resize(iCells + nCells);
+                for (Int_t i = 0; i < nCells; i++) {
+                    Int_t child = Compile(content[i]);
+                    cCorr.vIndex[iCells + i] = child;
+                }
+                Int_t flow = CompileFlow(json.Find("flow"));
+
+                Node& node = cCorr.vNodes[index];
+                node.nEntries = nDim;
+                node.iChildren = iChildren;
+                node.iDefault = flow;
+                return index;
+            }
+
+            if (type == "category") {
+                Int_t index = AddNode(NodeType::kCategory);
+                Int_t input = InputIndex(json.At("input").String());
+                Bool_t isString = (cCorr.vInputTypes[input] == Correction::InputType::kString);
+                const std::vector<JsonValue>& content = json.At("content").Array();
+                Int_t nKeys = (Int_t)content.size();
+
+                // Keys (string ids for string inputs) in vData, children in vIndex
+                Int_t iData = (Int_t)cCorr.vData.size();
+                for (const JsonValue& item : content) {
+                    const JsonValue& key = item.At("key");
+                    cCorr.vData.push_back(isString ? (Double_t)AddString(input, key.String()) : key.Number());
+                }
+                Int_t iChildren = (Int_t)cCorr.vIndex.size();
+                cCorr.vIndex.resize(iChildren + nKeys);
+                for (Int_t i = 0; i < nKeys; i++) {
+                    Int_t child = Compile(content[i].At("value"));
+                    cCorr.vIndex[iChildren + i] = child;
+                }
+                const JsonValue* def = json.Find("default");
+                Int_t iDefault = (def != nullptr && def->eType != JsonValue::Type::kNull) ? Compile(*def) : Correction::kFlowError;
+
+                Node& node = cCorr.vNodes[index];
+                node.iInput = input;
+                node.nEntries = nKeys;
+                node.iData = iData;
+                node.iChildren = iChildren;
+                node.iDefault = iDefault;
+                if (isString) vStringCategories.push_back(index);
+                return index;
+            }
+
+            if (type == "formula") {
+                std::vector<Int_t> variables;
+                for (const JsonValue& variable : json.At("variables").Array()) variables.push_back(InputIndex(variable.String()));
+                std::vector<Double_t> parameters;
+                if (const JsonValue* pars = json.Find("parameters")) {
+                    for (const JsonValue& par : pars->Array()) parameters.push_back(par.Number());
+                }
+                return CompileFormula(json.At("expression").String(), variables, parameters);
+            }
+
+            if (type == "formularef") {
+                if (pGenericFormulas == nullptr) Fail("formularef without generic_formulas");
+                Int_t iFormula = (Int_t)json.At("index").Number();
+                const std::vector<JsonValue>& formulas = pGenericFormulas->Array();
+                if (iFormula < 0 || iFormula >= (Int_t)formulas.size()) Fail("formularef index out of range");
+                const JsonValue& formula = formulas[iFormula];
+                std::vector<Int_t> variables;
+                for (const JsonValue& variable : formula.At("variables").Array()) variables.push_back(InputIndex(variable.String()));
+                std::vector<Double_t> parameters;
+                for (const JsonValue& par : json.At("parameters").Array()) parameters.push_back(par.Number());
+                return CompileFormula(formula.At("expression").String(), variables, parameters);
+            }
+
+            Fail("unsupported node type " + type);
+        }
+
+        // A category on a string input becomes a table indexed by the string id, unknown ids go to the default
+        void FinalizeStringCategories() {
+            for (Int_t index : vStringCategories) {
+                Node& node = cCorr.vNodes[index];
+                Int_t nStrings = (Int_t)cCorr.vStrings[node.iInput].size();
+                Int_t iTable = (Int_t)cCorr.vIndex.size();
+                cCorr.vIndex.resize(iTable + nStrings, node.iDefault);
+                for (Int_t i = 0; i < node.nEntries; i++) {
+                    Int_t id = (Int_t)cCorr.vData[node.iData + i];
+                    cCorr.vIndex[iTable + id] = cCorr.vIndex[node.iChildren + i];
+                }
+                node.nEntries = nStrings;
+                node.iChildren = iTable;
+                node.iData = -1;
+            }
+        }
+};
+
+////////////////////////////////////////////////////////////
+//////////////////////// Correction ////////////////////////
+////////////////////////////////////////////////////////////
+Int_t Correction::GetInputIndex(const std::string& name) const {
+    for (std::size_t i = 0; i < vInputNames.size(); i++) {
+        if (vInputNames[i] == name) return (Int_t)i;
+    }
+    return -1;
+}
+
+Double_t Correction::GetStringId(Int_t input, const std::string& value) const {
+    const std::vector<std::string>& strings = vStrings.at(input);
+    auto it = std::find(strings.begin(), strings.end(), value);
+    return (it == strings.end()) ? -1. : (Double_t)(it - strings.begin());
+}
+
+Double_t Correction::GetInputLowEdge(Int_t input) const {
+    Double_t low = std::numeric_limits<Double_t>::infinity();
+    for (const Node& node : vNodes) {
+        if (node.eType == NodeType::kBinning && node.iInput == input) {
+            low = std::min(low, vData[node.iData]);
+        } else if (node.eType == NodeType::kMultiBinning) {
+            for (Int_t iDim = 0; iDim < node.nEntries; iDim++) {
+                if (vIndex[node.iChildren + iDim] == input) low = std::min(low, vData[vIndex[node.iChildren + 2 * node.nEntries + iDim]]);
+            }
+        }
+    }
+    return std::isinf(low) ? -std::numeric_limits<Double_t>::infinity() : low;
+}
+
+void Correction::ThrowOutOfRange(const Node& node, Double_t x) const {
+    const char* type = (node.eType == NodeType::kCategory) ? "category" : "binning";
+    std::string input = (node.iInput >= 0) ? vInputNames[node.iInput] : std::string("multibinning input");
+    throw std::runtime_error("[Runtime Error] Correction::Evaluate() - " + sName + ": value " + std::to_string(x) + " of " + input
+                             + " is out of the " + type + " and no flow/default is defined");
+}
+
+namespace {
+    // Bin of x in a binning of n bins, -1 below and n above the range
+    inline Int_t FindBin(const Double_t* edges, Int_t n, Bool_t isUniform, Double_t x) {
+        if (isUniform) {
+            if (!(x >= edges[0])) return -1;
+            if (x >= edges[1]) return n;
+            Int_t bin = (Int_t)((x - edges[0]) * edges[2]);
+            return (bin < n) ? bin : n - 1;
+        }
+        if (!(x >= edges[0])) return -1;
+        return (Int_t)(std::upper_bound(edges, edges + n + 1, x) - edges) - 1;
+    }
+}
+
+Double_t Correction::Evaluate(const Double_t* inputs) const {
+    const Node* node = &vNodes[0];
+    while (true) {
+        switch (node->eType) {
+            case NodeType::kConstant:
+                return vData[node->iData];
+
+            case NodeType::kFormula:
+                return EvaluateFormula(*node, inputs);
+
+            case NodeType::kBinning: {
+                Double_t x = inputs[node->iInput];
+                Int_t n = node->nEntries;
+                Int_t bin = FindBin(&vData[node->iData], n, node->bUniform, x);
+                if (bin < 0 || bin >= n) {
+                    if (node->iDefault == kFlowError) ThrowOutOfRange(*node, x);
+                    if (node->iDefault != kFlowClamp) {
+                        node = &vNodes[node->iDefault];
+                        break;
+                    }
+                    bin = (bin < 0) ? 0 : n - 1;
+                }
+                node = &vNodes[vIndex[node->iChildren + bin]];
+                break;
+            }
+
+            case NodeType::kMultiBinning: {
+                const Int_t nDim = node->nEntries;
+                const Int_t* layout = &vIndex[node->iChildren];
+                Int_t cell = 0;
+                Int_t next = -1;
+                for (Int_t iDim = 0; iDim < nDim; iDim++) {
+                    Double_t x = inputs[layout[iDim]];
+                    Int_t n = layout[nDim + iDim];
+                    Int_t bin = FindBin(&vData[layout[2 * nDim + iDim]], n, layout[3 * nDim + iDim], x);
+                    if (bin < 0 || bin >= n) {
+                        if (node->iDefault == kFlowError) ThrowOutOfRange(*node, x);
+                        if (node->iDefault != kFlowClamp) {
+                            next = node->iDefault;
+                            break;
+                        }
+                        bin = (bin < 0) ? 0 : n - 1;
+                    }
+                    cell = cell * n + bin;
+                }
+                node = &vNodes[(next >= 0) ? next : layout[4 * nDim + cell]];
+                break;
+            }
+
+            case NodeType::kCategory: {
+                Double_t x = inputs[node->iInput];
+                Int_t next = node->iDefault;
+                if (node->iData < 0) {
+                    // String input : table indexed by the string id
+                    if (x >= 0. && x < node->nEntries) next = vIndex[node->iChildren + (Int_t)x];
+                } else {
+                    for (Int_t i = 0; i < node->nEntries; i++) {
+                        if (vData[node->iData + i] == x) {
+                            next = vIndex[node->iChildren + i];
+                            break;
+                        }
+                    }
+                }
+                if (next < 0) ThrowOutOfRange(*node, x);
+                node = &vNodes[next];
+                break;
+            }
+        }
+    }
+}
+
+Double_t Correction::EvaluateFormula(const Node& node, const Double_t* inputs) const {
+    Double_t stack[kMaxStack];
+    Int_t top = -1;
+    const FormulaOp* op = &vOps[node.iChildren];
+    const FormulaOp* end = op + node.nEntries;
+    for (; op != end; op++) {
+        switch (op->eOp) {
+            case Op::kConst: stack[++top] = op->dArg; break;
+            case Op::kInput: stack[++top] = inputs[op->iArg]; break;
+            case Op::kAdd: top--; stack[top] = stack[top] + stack[top + 1]; break;
+            case Op::kSub: top--; stack[top] = stack[top] - stack[top + 1]; break;
+            case Op::kMul: top--; stack[top] = stack[top] * stack[top + 1]; break;
+            case Op::kDiv: top--; stack[top] = stack[top] / stack[top + 1]; break;
+            case Op::kPow: top--; stack[top] = std::pow(stack[top], stack[top + 1]); break;
+            case Op::kNeg: stack[top] = -stack[top]; break;
+            case Op::kLess: top--; stack[top] = stack[top] < stack[top + 1]; break;
+            case Op::kGreater: top--; stack[top] = stack[top] > stack[top + 1]; break;
+            case Op::kLessEq: top--; stack[top] = stack[top] <= stack[top + 1]; break;
+            case Op::kGreaterEq: top--; stack[top] = stack[top] >= stack[top + 1]; break;
+            case Op::kEqual: top--; stack[top] = stack[top] == stack[top + 1]; break;
+            case Op::kNotEqual: top--; stack[top] = stack[top] != stack[top + 1]; break;
+            case Op::kExp: stack[top] = std::exp(stack[top]); break;
+            case Op::kLog: stack[top] = std::log(stack[top]); break;
+            case Op::kLog10: stack[top] = std::log10(stack[top]); break;
+            case Op::kSqrt: stack[top] = std::sqrt(stack[top]); break;
+            case Op::kAbs: stack[top] = std::abs(stack[top]); break;
+            case Op::kErf: stack[top] = std::erf(stack[top]); break;
+            case Op::kCos: stack[top] = std::cos(stack[top]); break;
+            case Op::kSin: stack[top] = std::sin(stack[top]); break;
+            case Op::kTan: stack[top] = std::tan(stack[top]); break;
+            case Op::kAcos: stack[top] = std::acos(stack[top]); break;
+            case Op::kAsin: stack[top] = std::asin(stack[top]); break;
+            case Op::kAtan: stack[top] = std::atan(stack[top]); break;
+            case Op::kCosh: stack[top] = std::cosh(stack[top]); break;
+            case Op::kSinh: stack[top] = std::sinh(stack[top]); break;
+            case Op::kTanh: stack[top] = std::tanh(stack[top]); break;
+            case Op::kAcosh: stack[top] = std::acosh(stack[top]); break;
+            case Op::kAsinh: stack[top] = std::asinh(stack[top]); break;
+            case Op::kAtanh: stack[top] = std::atanh(stack[top]); break;
+            case Op::kAtan2: top--; stack[top] = std::atan2(stack[top], stack[top + 1]); break;
+            case Op::kMax: top--; stack[top] = std::max(stack[top], stack[top + 1]); break;
+            case Op::kMin: top--; stack[top] = std::min(stack[top], stack[top + 1]); break;
+        }
+    }
+    return stack[0];
+}
+
+void Correction::Evaluate(std::size_t n, const Double_t* inputs, Double_t* output) const {
+    const std::size_t nInputs = vInputNames.size();
+    for (std::size_t i = 0; i < n; i++) {
+        output[i] = Evaluate(inputs + i * nInputs);
+    }
+}
+
+Double_t Correction::Evaluate(const std::vector<CorrectionValue>& inputs) const {
+    if (inputs.size() != vInputNames.size()) {
+        throw std::runtime_error("[Runtime Error] Correction::Evaluate() - " + sName + ": expected " + std::to_string(vInputNames.size())
+                                 + " inputs, got " + std::to_string(inputs.size()));
+    }
+    std::vector<Double_t> values(inputs.size());
+    for (std::size_t i = 0; i < inputs.size(); i++) {
+        if ((vInputTypes[i] == InputType::kString) != inputs[i].bIsString) {
+            throw std::runtime_error("[Runtime Error] Correction::Evaluate() - " + sName + ": wrong type of input " + vInputNames[i]);
+        }
+        values[i] = inputs[i].bIsString ? GetStringId(i, inputs[i].sValue) : inputs[i].dValue;
+    }
+    return Evaluate(values.data());
+}
+
+////////////////////////////////////////////////////////////
+////////////////////// CorrectionSet ///////////////////////
+////////////////////////////////////////////////////////////
+std::mutex CorrectionSet::cCacheMutex;
+std::map<std::string, std::shared_ptr<const CorrectionSet>> CorrectionSet::mCache;
+
+CorrectionSet::CorrectionSet(const std::string& json, const std::string& fileName) : sFileName(fileName) {
+    JsonValue document = JsonParser(json, fileName).ParseDocument();
+    if (const JsonValue* version = document.Find("schema_version")) iSchemaVersion = (Int_t)version->Number();
+    if (iSchemaVersion != 2) {
+        std::cerr << "[Warning] CorrectionSet::CorrectionSet() - Schema version " << iSchemaVersion << " of " << fileName
+                  << ", only version 2 is supported" << std::endl;
+    }
+    for (const JsonValue& correction : document.At("corrections").Array()) {
+        vCorrections.push_back(std::make_unique<Correction>());
+        CorrectionCompiler(*vCorrections.back()).CompileCorrection(correction);
+    }
+    if (const JsonValue* compound = document.Find("compound_corrections")) {
+        if (compound->IsArray() && !compound->vArray.empty()) {
+            std::cerr << "[Warning] CorrectionSet::CorrectionSet() - Compound corrections of " << fileName << " are not supported and ignored" << std::endl;
+        }
+    }
+}
+
+std::shared_ptr<const CorrectionSet> CorrectionSet::Open(const std::string& fileName) {
+    std::lock_guard<std::mutex> lock(cCacheMutex);
+    auto it = mCache.find(fileName);
+    if (it != mCache.end()) return it->second;
+
+    std::string json;
+    const CalibText* text = CalibTables::FindText(fileName);
+    if (text != nullptr) {
+        json.assign(text->pText, text->nSize);
+    } else {
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file.is_open()) file.open("../" + fileName, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("[Runtime Error] CorrectionSet::Open() - Cannot open " + fileName);
+        }
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        json = buffer.str();
+    }
+
+    std::shared_ptr<const CorrectionSet> set = std::make_shared<const CorrectionSet>(json, fileName);
+    std::cout << "[Info] CorrectionSet::Open() - " << set->GetNCorrections() << " corrections loaded from " << fileName
+              << ((text != nullptr) ? " (embedded)" : "") << std::endl;
+    mCache[fileName] = set;
+    return set;
+}
+
+const Correction* CorrectionSet::Find(const std::string& name) const {
+    for (const auto& correction : vCorrections) {
+        if (correction->GetName() == name) return correction.get();
+    }
+    return nullptr;
+}
+
+const Correction& CorrectionSet::At(const std::string& name) const {
+    const Correction* correction = Find(name);
+    if (correction == nullptr) {
+        throw std::runtime_error("[Runtime Error] CorrectionSet::At() - No correction " + name + " in " + sFileName);
+    }
+    return *correction;
+}
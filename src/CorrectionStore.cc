@@ -0,0 +1,289 @@
+#include "CorrectionStore.h"
+
+// C++ classes
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cctype>
+#include <cerrno>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+
+// POSIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+namespace {
+    const char kStoreMagic[8] = {'D','Y','S','T','O','R','E','2'};
+    const std::string kStorePrefix = "DYanalysis-";
+
+    // Header of a store file, the payload starts at kAlignment
+    struct StoreHeader {
+        char magic[8];
+        UInt_t nHeaderSize;
+        UInt_t nSizeofDouble;
+        ULong64_t nChecksum;
+        ULong64_t nPayloadSize;
+        ULong64_t nPayloadChecksum;
+        char sName[24]; // Truncated name, only used to detect hash collisions of the file name
+    };
+    static_assert(sizeof(StoreHeader) <= CorrectionStore::kAlignment, "Store header must fit before the payload");
+
+    void FillName(char* out, const std::string& name) {
+        std::memset(out, 0, sizeof(StoreHeader::sName));
+        std::strncpy(out, name.c_str(), sizeof(StoreHeader::sName) - 1);
+    }
+
+    Bool_t IsWritableDirectory(const std::string& directory) {
+        struct stat st;
+        return !directory.empty() && stat(directory.c_str(), &st) == 0 && S_ISDIR(st.st_mode) && access(directory.c_str(), W_OK) == 0;
+    }
+
+    // Per-user subdirectory of a node-wide directory, created if needed : it must be a real directory of the current user
+    Bool_t MakeUserDirectory(const std::string& directory) {
+        if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) return false;
+        struct stat st;
+        return lstat(directory.c_str(), &st) == 0 && S_ISDIR(st.st_mode) && st.st_uid == getuid() && access(directory.c_str(), W_OK) == 0;
+    }
+
+    // Store files and leftover temporary files of the current user
+    Bool_t IsUserStoreFile(const std::string& fileName) {
+        if (fileName.compare(0, kStorePrefix.size(), kStorePrefix) != 0) return false;
+        std::string userTag = "-u" + std::to_string((int)getuid()) + ".store";
+        std::size_t pos = fileName.rfind(userTag);
+        return pos != std::string::npos && (pos + userTag.size() == fileName.size() || fileName.compare(pos + userTag.size(), 4, ".tmp") == 0);
+    }
+}
+
+Int_t CorrectionStore::iEnabled = -1;
+std::string CorrectionStore::sDirectory = "";
+Double_t CorrectionStore::dMaxAgeHours = 72.;
+ULong64_t CorrectionStore::nMaxBytes = 2ULL << 30;
+Bool_t CorrectionStore::bIsCleaned = false;
+
+CorrectionSegment::~CorrectionSegment() {
+    if (pMap != nullptr) munmap(pMap, nMapSize);
+}
+
+Bool_t CorrectionStore::IsEnabled() {
+    if (iEnabled < 0) {
+        const char* env = std::getenv("DYANALYSIS_STORE_DIR");
+        iEnabled = !(env != nullptr && std::string(env) == "none");
+    }
+    return iEnabled == 1 && !GetDirectory().empty();
+}
+
+// Node-local directory shared by all jobs of the node, in a per-user subdirectory : /tmp, then /var/tmp
+// The job scratch directories ($_CONDOR_SCRATCH_DIR, $TMPDIR under condor) are private to each job, they would never be shared.
+// /dev/shm is opt-in, since it is charged to the memory of the node. A pool that mounts /tmp per job should set DYANALYSIS_STORE_DIR.
+const std::string& CorrectionStore::GetDirectory() {
+    if (!sDirectory.empty()) return sDirectory;
+    const char* env = std::getenv("DYANALYSIS_STORE_DIR");
+    if (env != nullptr && std::string(env) != "none") {
+        sDirectory = env;
+        return sDirectory;
+    }
+    for (const std::string& base : {std::string("/tmp"), std::string("/var/tmp")}) {
+        std::string candidate = base + "/DYanalysis-store-u" + std::to_string((int)getuid());
+        if (IsWritableDirectory(base) && MakeUserDirectory(candidate)) {
+            sDirectory = candidate;
+            break;
+        }
+    }
+    return sDirectory;
+}
+
+std::string CorrectionStore::GetPath(const std::string& name, ULong64_t checksum) {
+    // Keep the file name portable, the user id avoids clashes between users sharing the node
+    std::string safeName;
+    for (char c : name) safeName += (std::isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.') ? c : '_';
+    char suffix[64];
+    std::snprintf(suffix, sizeof(suffix), "-%016llx-u%d.store", (unsigned long long)checksum, (int)getuid());
+    return GetDirectory() + "/" + kStorePrefix + safeName + suffix;
+}
+
+std::shared_ptr<const CorrectionSegment> CorrectionStore::Attach(const std::string& path, const std::string& name, ULong64_t checksum, Bool_t verifyPayload) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    // Only trust files of the current user
+    if (fstat(fd, &st) != 0 || st.st_uid != getuid() || (std::size_t)st.st_size < kAlignment) {
+        close(fd);
+        return nullptr;
+    }
+    std::size_t size = st.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return nullptr;
+
+    StoreHeader header;
+    std::memcpy(&header, map, sizeof(header));
+    char expectedName[sizeof(StoreHeader::sName)];
+    FillName(expectedName, name);
+    Bool_t isValid = std::memcmp(header.magic, kStoreMagic, sizeof(header.magic)) == 0
+                  && header.nHeaderSize == kAlignment
+                  && header.nSizeofDouble == sizeof(Double_t)
+                  && header.nChecksum == checksum
+                  && header.nPayloadSize == size - kAlignment
+                  && std::memcmp(header.sName, expectedName, sizeof(expectedName)) == 0;
+    // The payload is only read through by its publisher, right after the rename : a file is complete once renamed,
+    // and reading it all at every attach would touch every page in every job
+    // A corrupted payload is removed, so that the state is published again
+    if (isValid && verifyPayload && Checksum((const char*)map + kAlignment, (std::size_t)header.nPayloadSize) != header.nPayloadChecksum) {
+        std::cerr << "[Warning] CorrectionStore::Attach() - Payload checksum mismatch in " << path << ", removing it" << std::endl;
+        std::remove(path.c_str());
+        isValid = false;
+    }
+    if (!isValid) {
+        munmap(map, size);
+        return nullptr;
+    }
+    // Refresh the modification time, so that the cleanup removes the least recently used files first
+    utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+
+    auto segment = std::make_shared<CorrectionSegment>();
+    segment->pMap = map;
+    segment->nMapSize = size;
+    segment->pData = (const char*)map + kAlignment;
+    segment->nSize = header.nPayloadSize;
+    segment->bIsShared = true;
+    return segment;
+}
+
+Bool_t CorrectionStore::Publish(const std::string& path, const std::string& name, ULong64_t checksum, const std::string& payload) {
+    StoreHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kStoreMagic, sizeof(header.magic));
+    header.nHeaderSize = kAlignment;
+    header.nSizeofDouble = sizeof(Double_t);
+    header.nChecksum = checksum;
+    header.nPayloadSize = payload.size();
+    header.nPayloadChecksum = Checksum(payload);
+    FillName(header.sName, name);
+
+    char block[kAlignment];
+    std::memset(block, 0, sizeof(block));
+    std::memcpy(block, &header, sizeof(header));
+
+    // Temporary file in the same directory, renamed once complete
+    std::string tmpPath = path + ".tmp" + std::to_string((long)getpid());
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    Bool_t isWritten = (write(fd, block, sizeof(block)) == (ssize_t)sizeof(block));
+    std::size_t offset = 0;
+    while (isWritten && offset < payload.size()) {
+        ssize_t n = write(fd, payload.data() + offset, payload.size() - offset);
+        if (n <= 0) isWritten = false;
+        else offset += n;
+    }
+    isWritten = (close(fd) == 0) && isWritten;
+    if (!isWritten || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void CorrectionStore::RemoveStale() {
+    if (bIsCleaned) return;
+    bIsCleaned = true;
+    DIR* dir = opendir(GetDirectory().c_str());
+    if (dir == nullptr) return;
+
+    struct StoreFile {
+        std::string sPath;
+        time_t tModified;
+        ULong64_t nSize;
+    };
+    std::vector<StoreFile> vFiles;
+    time_t now = std::time(nullptr);
+    Int_t nRemoved = 0;
+    while (struct dirent* entry = readdir(dir)) {
+        std::string fileName = entry->d_name;
+        if (!IsUserStoreFile(fileName)) continue;
+        std::string path = GetDirectory() + "/" + fileName;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != getuid()) continue;
+        // Jobs that already mapped a removed file keep their pages, the others rebuild the state
+        if (std::difftime(now, st.st_mtime) > dMaxAgeHours * 3600.) {
+            if (std::remove(path.c_str()) == 0) nRemoved++;
+            continue;
+        }
+        // Temporary files may still be written by another job, they only expire by age
+        if (fileName.size() < 6 || fileName.compare(fileName.size() - 6, 6, ".store") != 0) continue;
+        vFiles.push_back({path, st.st_mtime, (ULong64_t)st.st_size});
+    }
+    closedir(dir);
+
+    // Oldest first, until the store fits the cap
+    std::sort(vFiles.begin(), vFiles.end(), [](const StoreFile& a, const StoreFile& b) { return a.tModified < b.tModified; });
+    ULong64_t nTotalBytes = 0;
+    for (const StoreFile& file : vFiles) nTotalBytes += file.nSize;
+    for (const StoreFile& file : vFiles) {
+        if (nTotalBytes <= nMaxBytes) break;
+        if (std::remove(file.sPath.c_str()) == 0) nRemoved++;
+        nTotalBytes -= file.nSize;
+    }
+    if (nRemoved > 0) std::cout << "[Info] CorrectionStore::RemoveStale() - Removed " << nRemoved << " stale files from " << GetDirectory() << std::endl;
+}
+
+std::shared_ptr<const CorrectionSegment> CorrectionStore::Get(const std::string& name, ULong64_t checksum, const std::function<std::string()>& build) {
+    std::string path;
+    if (IsEnabled()) {
+        path = GetPath(name, checksum);
+        std::shared_ptr<const CorrectionSegment> segment = Attach(path, name, checksum, false);
+        if (segment) {
+            std::cout << "[Info] CorrectionStore::Get() - " << name << " attached from " << path << std::endl;
+            return segment;
+        }
+    }
+
+    std::string payload = build();
+    if (!path.empty()) {
+        RemoveStale();
+        if (Publish(path, name, checksum, payload)) {
+            std::shared_ptr<const CorrectionSegment> segment = Attach(path, name, checksum, true);
+            if (segment) {
+                std::cout << "[Info] CorrectionStore::Get() - " << name << " published to " << path << std::endl;
+                return segment;
+            }
+        }
+        std::cerr << "[Warning] CorrectionStore::Get() - Cannot publish " << name << " to " << path << ", using a private copy" << std::endl;
+    }
+
+    // Private copy, the payload is moved to an aligned buffer
+    auto segment = std::make_shared<CorrectionSegment>();
+    segment->sPrivate.assign(kAlignment + payload.size(), '\0');
+    std::size_t misalign = reinterpret_cast<std::uintptr_t>(segment->sPrivate.data()) % kAlignment;
+    std::size_t offset = (misalign == 0) ? 0 : kAlignment - misalign;
+    std::memcpy(&segment->sPrivate[offset], payload.data(), payload.size());
+    segment->pData = segment->sPrivate.data() + offset;
+    segment->nSize = payload.size();
+    segment->bIsShared = false;
+    return segment;
+}
+
+ULong64_t CorrectionStore::Checksum(const char* data, std::size_t size, ULong64_t seed) {
+    ULong64_t h = seed;
+    for (std::size_t i = 0; i < size; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+ULong64_t CorrectionStore::ChecksumFile(const std::string& fileName, ULong64_t seed) {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in.is_open()) return 0;
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    return Checksum(buffer.str(), seed);
+}
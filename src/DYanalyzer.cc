@@ -1,5 +1,15 @@
 #include "DYanalyzer.h"
 
+// DYanalyzer classes
+#include "HistMerger.h"
+
+// C++ classes
+#include <cstdio>
+#include <sstream>
+
+// POSIX
+#include <unistd.h>
+
 ////////////////////////////////////////////////////////////
 //////////////// Actual event loop is here! ////////////////
 ////////////////////////////////////////////////////////////
@@ -10,140 +20,174 @@ void DYanalyzer::Analyze() {
     }
 
     // Declare object classes
-    Muons* muons = new Muons(cData);
-    Electrons* electrons = new Electrons(cData);
-    MET* met = new MET(cData);
-    GenPtcs* genPtcs = nullptr;
+    // Holders are allocated from the per-event arena
+    cMuons = new Muons(cData, cEventArena);
+    cElectrons = new Electrons(cData, cEventArena);
+    cMET = new MET(cData, cMETXYCorrParams);
+    cGenPtcs = nullptr;
     if (bIsMC) {
-        genPtcs = new GenPtcs(cData, bIsInclusiveW, bIsBoostedW, bIsOffshellW, bIsOffshellWToTauNu);
+        cGenPtcs = new GenPtcs(cData, bIsInclusiveW, bIsBoostedW, bIsOffshellW, bIsOffshellWToTauNu, cEventArena);
     }
+    nArenaUpstreamAllocs_firstEvt = 0;
+
+    // Dispatch once to the event loop specialized on the era and the configuration
+    EventLoopFunc eventLoop = SelectEventLoop();
+    (this->*eventLoop)();
+    cTelemetry->Stop();
+
+    //////////////////////////////////////////////////////////
+    ///////// Fill histograms after event loop ///////////////
+    //////////////////////////////////////////////////////////
+    hGenEvtWeight->SetBinContent(1, dSumOfGenEvtWeight);
+    if (bPUVariations) {
+        hGenEvtWeight_PUUp->SetBinContent(1, dSumOfGenEvtWeight_PUUp);
+        hGenEvtWeight_PUDown->SetBinContent(1, dSumOfGenEvtWeight_PUDown);
+    }
+
+    std::cout << "[Info] DYanalyzer::Analyze() - End of event loop" << std::endl;
+    for (const Data::SkippedInput& skipped : cData->GetSkippedInputs()) {
+        std::cerr << "[Warning] DYanalyzer::Analyze() - Not read: " << skipped.sFileName << ", entries " << skipped.nFirstEntry << " - "
+                  << ((skipped.nLastEntry < 0) ? std::string("unknown") : std::to_string(skipped.nLastEntry)) << " (" << skipped.sReason << ")" << std::endl;
+    }
+    std::cout << "[Info] DYanalyzer::Analyze() - Total sum of weight: " << std::fixed << std::setprecision(2) << dSumOfGenEvtWeight << std::endl;
+
+    // Delete object classes before the arena they allocate from
+    delete cMuons;
+    delete cElectrons;
+    delete cMET;
+    delete cGenPtcs;
+    cMuons = nullptr;
+    cElectrons = nullptr;
+    cMET = nullptr;
+    cGenPtcs = nullptr;
+
+    // Allocation counters of the event arena
+    // After the first event, the arena should not need any new block (malloc) in a steady state
+    // The other heap allocations of the event processing are only counted in a build with the allocation probe
+    cEventArena->PrintStats();
+    std::cout << "[Info] DYanalyzer::Analyze() - Arena upstream allocations after the first event: " << cEventArena->GetNUpstreamAllocations() - nArenaUpstreamAllocs_firstEvt << std::endl;
+    if (AllocProbe::IsEnabled()) {
+        std::cout << "[Info] DYanalyzer::Analyze() - Heap allocations after the first " << AllocProbe::kWarmUpEvents << " events: " << nHeapAllocs_afterWarmUp
+                  << " (at most " << nHeapAllocs_maxPerEvt << " in one event)" << std::endl;
+        // The event loop should not allocate in a steady state, any allocation left is a regression
+        if (nHeapAllocs_afterWarmUp > 0) {
+            std::cerr << "[Warning] DYanalyzer::Analyze() - " << nHeapAllocEvts_afterWarmUp << " events allocated on the heap after the warm-up, "
+                      << nHeapAllocs_afterWarmUp << " allocations in total" << std::endl;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+/////// Event loop, specialized on era and configuration ///
+////////////////////////////////////////////////////////////
+// Era and correction flags are template parameters, so their branches are resolved at compile time
+// F == LoopConfig::kRuntime is the generic version reading the flags at run time
+template <Era E, UInt_t F>
+void DYanalyzer::EventLoop() {
+    // Trigger and noise filter settings of the era
+    constexpr EraTraits eraTraits = kEraTraits[static_cast<UInt_t>(E)];
 
     ////////////////////////////////////////////////////////////
     ////////////////////// Event loop //////////////////////////
     ////////////////////////////////////////////////////////////
     std::cout << "[Info] DYanalyzer::Analyze() - Start event loop" << std::endl;
     int iEvt = 0;
-    while (cData->ReadNextEntry()) {
-        // Print progress and set current event number
-        if (iEvt % 10000 == 0) PrintProgress(iEvt);
-        iEvt++;
+    tLastCheckpoint = std::chrono::steady_clock::now();
+    // Heap allocations of the processing of an event, from the reset of the object classes to the end of the selection
+    const Bool_t doAllocProbe = AllocProbe::IsEnabled();
+    ULong64_t nHeapAllocs_evtStart = 0;
+    nHeapAllocs_afterWarmUp = 0;
+    nHeapAllocs_maxPerEvt = 0;
+    nHeapAllocEvts_afterWarmUp = 0;
+    cTelemetry->Start(nTotalEvents, cData->GetChain());
+    for (;;) {
+        if (doAllocProbe && iEvt > AllocProbe::kWarmUpEvents) {
+            ULong64_t nHeapAllocs = AllocProbe::GetNAllocations() - nHeapAllocs_evtStart;
+            nHeapAllocs_afterWarmUp += nHeapAllocs;
+            if (nHeapAllocs > 0) nHeapAllocEvts_afterWarmUp++;
+            if (nHeapAllocs > nHeapAllocs_maxPerEvt) nHeapAllocs_maxPerEvt = nHeapAllocs;
+        }
+        // The rest of the previous event (selection and histograms), then the next entry
+        cTelemetry->Lap(LoopStage::kSelection);
+        if (!cData->ReadNextEntry()) break;
+        cTelemetry->Event();
+
+        // Checkpoint before processing the entry, all previous entries are in the histograms
+        if (IsCheckpointDue(iEvt)) {
+            WriteCheckpoint(cData->GetCurrentEntry());
+            cTelemetry->Lap(LoopStage::kCheckpoint);
+        }
 
-        // Reset object classes
-        muons->Reset();
-        electrons->Reset();
-        met->Reset();
+        // Set current event number
+        iEvt++;
+        if (doAllocProbe) nHeapAllocs_evtStart = AllocProbe::GetNAllocations();
+
+        // Reset object classes, then release everything allocated in the previous event at once
+        cMuons->Reset();
+        cElectrons->Reset();
+        cMET->Reset();
+        if (HasFlag<F>(LoopConfig::kIsMC)) cGenPtcs->Reset();
+        if (iEvt == 2) nArenaUpstreamAllocs_firstEvt = cEventArena->GetNUpstreamAllocations();
+        cEventArena->Reset();
+        ResetEventCache();
         // Initialize object classes
-        muons->Init();
-        electrons->Init();
-        met->Init();
+        cMuons->Init();
+        cElectrons->Init();
+        cMET->Init();
         // Initialize genPtcs if MC
-        if (bIsMC) {
-            genPtcs->Reset();
-            genPtcs->Init();
+        if (HasFlag<F>(LoopConfig::kIsMC)) {
+            cGenPtcs->Init();
         }
-
-        // Get corrected PFMET
-        std::pair<Double_t, Double_t> correctedPFMET = met->GetPFMETXYCorr(sProcessName, sEra, bIsMC, **(cData->NPV));
-        Double_t dPFMET_corr = correctedPFMET.first;
-        Double_t dPFMET_corr_phi = correctedPFMET.second;
+        cTelemetry->Lap(LoopStage::kRead);
 
         // Set event weight
         // For data, event weight is 1.0
         Double_t eventWeight = 1.0;
-        if (bIsMC) {
+        if (HasFlag<F>(LoopConfig::kIsMC)) {
             eventWeight = **(cData->GenWeight) < 0 ? -1.0 : 1.0;
         }
+        // Event weights with the PU weight varied up/down, equal to the nominal one without PU correction
+        Double_t eventWeight_PUUp = eventWeight;
+        Double_t eventWeight_PUDown = eventWeight;
 
         ////////////////////////////////////////////////////////////
         ////////////////////// Corrections /////////////////////////
         ////////////////////////////////////////////////////////////
+        // Corrected PFMET, Rocco-corrected muons, object selection and efficiency SFs are evaluated lazily,
+        // only when something still needs them (see the "Lazily evaluated per-event quantities" functions)
         // Do PU correction
-        if (bIsMC && bDoPUCorrection) {
+        if (HasFlag<F>(LoopConfig::kIsMC | LoopConfig::kDoPU)) {
             // Get PU weight
             Float_t nTrueInt = **(cData->Pileup_nTrueInt);
-            eventWeight *= cPU->GetPUWeight(nTrueInt);
+            PUWeights puWeights = cPU->GetPUWeights(nTrueInt);
+            eventWeight *= puWeights.dNom;
+            eventWeight_PUUp *= puWeights.dUp;
+            eventWeight_PUDown *= puWeights.dDown;
         }
         // Do L1 pre-firing correction
-        if (bIsMC && bDoL1PreFiringCorrection) {
+        if (HasFlag<F>(LoopConfig::kIsMC | LoopConfig::kDoL1)) {
             eventWeight *= **(cData->L1PreFiringWeight_Nom);
+            eventWeight_PUUp *= **(cData->L1PreFiringWeight_Nom);
+            eventWeight_PUDown *= **(cData->L1PreFiringWeight_Nom);
         }
-        // Do Rocco before EffSF calculation
-        // If DoRocco, then Obj selection should be done after Rocco
-        if (bDoRocco) {
-            // Loop over muons
-            std::vector<MuonHolder>& muonCollection = muons->GetMuons();
-            for (MuonHolder& singleMuon : muonCollection) {
-                // Rocco for MC
-                if (bIsMC) {
-                    // Gen - Reco muon matching using dR
-                    Double_t min_dR = 999.;
-                    Bool_t matchedToGenMuon = false;
-                    Int_t matchedGenMuonIdx = -1;
-                    // Get gen muons
-                    std::vector<GenPtcHolder> genMuonCollection = genPtcs->GetGenMuons();
-                    for (Int_t idx = 0; idx < genMuonCollection.size(); idx++) {
-                        GenPtcHolder& singleGenMuon = genMuonCollection[idx];
-                        // Get dR between gen muon and reco muon
-                        Double_t dR = (singleGenMuon.GetGenPtcVec()).DeltaR(singleMuon.GetMuonOrgVec());
-                        if (dR < min_dR && dR < 0.1) {
-                            min_dR = dR;
-                            matchedToGenMuon = true;
-                            matchedGenMuonIdx = idx;
-                        }
-                    }
-                    // If well matched
-                    if (matchedToGenMuon) {
-                        Double_t roccoSF = cRochesterCorrection->kSpreadMC(singleMuon.Charge(), singleMuon.Pt(), singleMuon.Eta(), singleMuon.Phi(), genMuonCollection[matchedGenMuonIdx].GetGenPtcVec().Pt(), 5, 0);
-                        singleMuon.SetRoccoSF(roccoSF);
-                    }
-                    // If not matched
-                    else {
-                        Double_t randomSeed = gRandom->Rndm(); // Random seed btw 0 ~ 1
-                        Double_t roccoSF = cRochesterCorrection->kSmearMC(singleMuon.Charge(), singleMuon.Pt(), singleMuon.Eta(), singleMuon.Phi(), singleMuon.GetTrackerLayers(), randomSeed, 5, 0);
-                        singleMuon.SetRoccoSF(roccoSF);
-                    }
-                }
-                // Rocco for data
-                else {
-                    Double_t roccoSF = cRochesterCorrection->kScaleDT(singleMuon.Charge(), singleMuon.Pt(), singleMuon.Eta(), singleMuon.Phi(), 5, 0);
-                    singleMuon.SetRoccoSF(roccoSF);
-                }
-            }
-        }
-
-        // Do object selection here
-        muons->DoObjSel();
-        electrons->DoObjSel();
-
-        // Only calculate eff SF for tight muons
-        // Do efficiency SF correction
-        if (bIsMC && (bDoIDSF || bDoIsoSF || bDoTrigSF)) {
-            std::vector<double> efficiencySF = {1.0, 1.0, 1.0};
-
-            // Set efficiency SF over all muons
-            std::vector<MuonHolder> tightMuonCollection = muons->GetTightMuons();
-            if (tightMuonCollection.size() > 0) {
-                MuonHolder& leadingMuon = tightMuonCollection[0];
-                // Get efficiency SF
-                efficiencySF = cEfficiencySF->GetEfficiency(leadingMuon.Pt(), leadingMuon.Eta());
-                // Apply efficiency SF
-                leadingMuon.SetEfficiencySF(efficiencySF);
-            }
-
-            if (bDoIDSF)   eventWeight *= efficiencySF[0]; // ID SF
-            if (bDoIsoSF)  eventWeight *= efficiencySF[1]; // Iso SF
-            if (bDoTrigSF) eventWeight *= efficiencySF[2]; // Trig SF
-        }
+        // Gen-reco muon matching and random numbers for Rocco are prepared for every event,
+        // so that the random number sequence does not depend on which events evaluate Rocco
+        if (HasFlag<F>(LoopConfig::kIsMC | LoopConfig::kDoRocco)) PrepareRoccoInputs();
+        // The efficiency SFs need the Rocco-corrected tight muons, they are applied after the trigger and noise filters
+        cTelemetry->Lap(LoopStage::kCorrections);
 
         ////////////////////////////////////////////////////////////
-        ////// Sum up event weight here (after all corrections) ////
+        ////// Sum up event weight here (PU and L1 corrections) ////
         ////////////////////////////////////////////////////////////
+        // The efficiency SFs only apply to selected muons, they are not part of the normalization
         dSumOfGenEvtWeight += eventWeight;
+        dSumOfGenEvtWeight_PUUp += eventWeight_PUUp;
+        dSumOfGenEvtWeight_PUDown += eventWeight_PUDown;
         // Fill PU related histograms (NPU, NTrueInt only available for MC)
         // This should be done before gen-lv patching and muon filtering
         // (since PU has nothing to do with gen-lv patching and muon filtering)
         hNPV->Fill(**(cData->NPV), eventWeight);
-        if (bIsMC) {
+        if (HasFlag<F>(LoopConfig::kIsMC)) {
             hNPU->Fill(**(cData->Pileup_nPU), eventWeight);
             hNTrueInt->Fill(**(cData->Pileup_nTrueInt), eventWeight);
         }
@@ -151,19 +195,19 @@ void DYanalyzer::Analyze() {
         ////////////////////////////////////////////////////////////
         ////// Apply Gen-lv patching and Gen-lv muon filtering /////
         ////////////////////////////////////////////////////////////
-        if (bIsMC && bDoGenPatching) {
-            Bool_t passedGenPatching = genPtcs->PassGenPatching(dHT_cut_high, dW_mass_cut_high);
-            Bool_t passedMuonFiltering = genPtcs->PassMuonFiltering();
+        if (HasFlag<F>(LoopConfig::kIsMC) && bDoGenPatching) {
+            Bool_t passedGenPatching = cGenPtcs->PassGenPatching(dHT_cut_high, dW_mass_cut_high);
+            Bool_t passedMuonFiltering = cGenPtcs->PassMuonFiltering();
 
             // Skip event if Gen-lv patching failed
             if (!passedGenPatching) continue;
 
             // Fill Gen-lv inclusive W histograms before muon filtering
-            if (genPtcs->IsInclusiveW()) {
-                hGen_W_pT->Fill(genPtcs->GetGenW().Pt(), eventWeight);
-                hGen_W_eta->Fill(genPtcs->GetGenW().Eta(), eventWeight);
-                hGen_W_phi->Fill(genPtcs->GetGenW().Phi(), eventWeight);
-                hGen_W_mass->Fill(genPtcs->GetGenW().M(), eventWeight);
+            if (cGenPtcs->IsInclusiveW()) {
+                hGen_W_pT->Fill(cGenPtcs->GetGenW().Pt(), eventWeight);
+                hGen_W_eta->Fill(cGenPtcs->GetGenW().Eta(), eventWeight);
+                hGen_W_phi->Fill(cGenPtcs->GetGenW().Phi(), eventWeight);
+                hGen_W_mass->Fill(cGenPtcs->GetGenW().M(), eventWeight);
             }
 
             // Skip event if muon filtering failed
@@ -174,18 +218,18 @@ void DYanalyzer::Analyze() {
         ///////// Fill histograms before event selection ///////////
         ////////////////////////////////////////////////////////////
         // Fill Gen-lv histograms for MC
-        if (bIsMC) {
+        if (HasFlag<F>(LoopConfig::kIsMC)) {
             // Fill Gen W for W->mu+nu channel
             // or fill Gen W for W->tau+nu->mu+nu channel
-            if ( genPtcs->IsWToMuNu() || genPtcs->IsWToTauNuToMuNu() ) {
-                hGen_WToMuNu_pT->Fill(genPtcs->GetGenW().Pt(), eventWeight);
-                hGen_WToMuNu_eta->Fill(genPtcs->GetGenW().Eta(), eventWeight);
-                hGen_WToMuNu_phi->Fill(genPtcs->GetGenW().Phi(), eventWeight);
-                hGen_WToMuNu_mass->Fill(genPtcs->GetGenW().M(), eventWeight);
+            if ( cGenPtcs->IsWToMuNu() || cGenPtcs->IsWToTauNuToMuNu() ) {
+                hGen_WToMuNu_pT->Fill(cGenPtcs->GetGenW().Pt(), eventWeight);
+                hGen_WToMuNu_eta->Fill(cGenPtcs->GetGenW().Eta(), eventWeight);
+                hGen_WToMuNu_phi->Fill(cGenPtcs->GetGenW().Phi(), eventWeight);
+                hGen_WToMuNu_mass->Fill(cGenPtcs->GetGenW().M(), eventWeight);
             }
 
             // Fill Gen Muon
-            std::vector<GenPtcHolder> genMuonCollection = genPtcs->GetGenMuons();
+            ArenaVector<GenPtcHolder> genMuonCollection = cGenPtcs->GetGenMuons();
             // Sort genMuonCollection in descending order by Pt
             if (genMuonCollection.size() > 0) {
                 // std::vector<GenPtcHolder>::iterator type
@@ -202,7 +246,7 @@ void DYanalyzer::Analyze() {
             }
 
             // Fill Gen Neutrino
-            std::vector<GenPtcHolder> genNeutrinoCollection = genPtcs->GetGenNeutrinos();
+            ArenaVector<GenPtcHolder> genNeutrinoCollection = cGenPtcs->GetGenNeutrinos();
             // Sort genNeutrinoCollection in descending order by Pt
             if (genNeutrinoCollection.size() > 0) {
                 auto maxElemIt = std::max_element(genNeutrinoCollection.begin(), genNeutrinoCollection.end(),
@@ -221,15 +265,76 @@ void DYanalyzer::Analyze() {
             hGen_MET_pT->Fill(cData->GenMET_pt->At(0), eventWeight);
 
             // Fill LHE HT
-            if (genPtcs->IsInclusiveW() || genPtcs->IsBoostedW()) {
+            if (cGenPtcs->IsInclusiveW() || cGenPtcs->IsBoostedW()) {
                 hLHE_HT->Fill(**(cData->LHE_HT), eventWeight);
             }
         }
 
-        // Fill Object level histograms
+        ////////////////////////////////////////////////////////////
+        //////////////// Event selection here //////////////////////
+        ////////////////////////////////////////////////////////////
+        // 1. Trigger
+        // 2016APV : IsoMu24 || IsoTkMu24
+        // 2016 : IsoMu24 || IsoTkMu24
+        // 2017 : IsoMu27
+        // 2018 : IsoMu24
+        Bool_t passedTrigger = false;
+        if constexpr (eraTraits.bIsoMu24)   passedTrigger = passedTrigger || **(cData->HLT_IsoMu24);
+        if constexpr (eraTraits.bIsoTkMu24) passedTrigger = passedTrigger || **(cData->HLT_IsoTkMu24);
+        if constexpr (eraTraits.bIsoMu27)   passedTrigger = passedTrigger || **(cData->HLT_IsoMu27);
+        if (!passedTrigger) continue;
+
+        // 2. Noise filter
+        // For 2016: Do not use Flag_ecalBadCalibFilter, Flag_BadChargedCandidateFilter
+        // For 2017, 2018: Do not use Flag_BadChargedCandidateFilter
+        Bool_t flag_goodVertices                       =  **(cData->Flag_goodVertices);
+        Bool_t flag_globalSuperTightHalo2016Filter     =  **(cData->Flag_globalSuperTightHalo2016Filter);
+        Bool_t flag_HBHENoiseFilter                    =  **(cData->Flag_HBHENoiseFilter);
+        Bool_t flag_HBHENoiseIsoFilter                 =  **(cData->Flag_HBHENoiseIsoFilter);
+        Bool_t flag_EcalDeadCellTriggerPrimitiveFilter =  **(cData->Flag_EcalDeadCellTriggerPrimitiveFilter);
+        Bool_t flag_BadPFMuonFilter                    =  **(cData->Flag_BadPFMuonFilter);
+        Bool_t flag_BadPFMuonDzFilter                  =  **(cData->Flag_BadPFMuonDzFilter);
+        Bool_t flag_hfNoisyHitsFilter                  =  **(cData->Flag_hfNoisyHitsFilter);
+        Bool_t flag_eeBadScFilter                      =  **(cData->Flag_eeBadScFilter);
+        bool passed_filter = (  flag_goodVertices                      &&
+                                flag_globalSuperTightHalo2016Filter    &&
+                                flag_HBHENoiseFilter                   &&
+                                flag_HBHENoiseIsoFilter                &&
+                                flag_EcalDeadCellTriggerPrimitiveFilter&&
+                                flag_BadPFMuonFilter                   &&
+                                flag_BadPFMuonDzFilter                 &&
+                                flag_hfNoisyHitsFilter                 &&
+                                flag_eeBadScFilter                     
+                                );
+        if constexpr (eraTraits.bEcalBadCalibFilter) {
+            passed_filter = passed_filter && **(cData->Flag_ecalBadCalibFilter);
+        }
+        if (!passed_filter) continue; // Skip event if noise filter failed
+
+        // Do efficiency SF correction, only calculate eff SF for tight muons
+        // From here on the Rocco-corrected muon selection is needed
+        if (HasFlag<F>(LoopConfig::kIsMC) && HasAnyFlag<F>(LoopConfig::kDoIDSF | LoopConfig::kDoIsoSF | LoopConfig::kDoTrigSF)) {
+            Double_t effSFWeight = GetEffSFWeight<F>();
+            eventWeight *= effSFWeight;
+            eventWeight_PUUp *= effSFWeight;
+            eventWeight_PUDown *= effSFWeight;
+        }
+
+        // Get corrected PFMET
+        const std::pair<Double_t, Double_t>& correctedPFMET = GetPFMETXYCorr();
+        Double_t dPFMET_corr = correctedPFMET.first;
+        Double_t dPFMET_corr_phi = correctedPFMET.second;
+
+        ////////////////////////////////////////////////////////////
+        //// Fill histograms after trigger and noise filters ///////
+        ////////////////////////////////////////////////////////////
+        // Object level histograms need the Rocco-corrected muons and the corrected PFMET,
+        // they are filled after the event-level selection so that rejected events never evaluate them
         // Fill muon (tight muon only)
-        if (muons->GetTightMuons().size() > 0) {
-            MuonHolder& leadingMuon = muons->GetTightMuons()[0];
+        DoMuonSelection<F>();
+        ArenaVector<MuonHolder> tightMuons = cMuons->GetTightMuons();
+        if (tightMuons.size() > 0) {
+            MuonHolder& leadingMuon = tightMuons[0];
             TLorentzVector leadingMuonVec = leadingMuon.GetRoccoSF() == -1. ? leadingMuon.GetMuonOrgVec() : leadingMuon.GetMuonRoccoVec();
             
             hMuon_pT->Fill(leadingMuonVec.Pt(), eventWeight);
@@ -239,38 +344,38 @@ void DYanalyzer::Analyze() {
         }
 
         // Fill MET
-        hMET_phi->Fill(met->GetPuppiMET_phi(), eventWeight);
-        hMET_pT->Fill(met->GetPuppiMET_pt(), eventWeight);
-        hMET_sumET->Fill(met->GetPuppiMET_sumEt(), eventWeight);
+        hMET_phi->Fill(cMET->GetPuppiMET_phi(), eventWeight);
+        hMET_pT->Fill(cMET->GetPuppiMET_pt(), eventWeight);
+        hMET_sumET->Fill(cMET->GetPuppiMET_sumEt(), eventWeight);
 
-        hPFMET_phi->Fill(met->GetMET_phi(), eventWeight);
-        hPFMET_pT->Fill(met->GetMET_pt(), eventWeight);
-        hPFMET_sumET->Fill(met->GetMET_sumEt(), eventWeight);
+        hPFMET_phi->Fill(cMET->GetMET_phi(), eventWeight);
+        hPFMET_pT->Fill(cMET->GetMET_pt(), eventWeight);
+        hPFMET_sumET->Fill(cMET->GetMET_sumEt(), eventWeight);
 
         hPFMET_corr_phi->Fill(dPFMET_corr_phi, eventWeight);
         hPFMET_corr_pT->Fill(dPFMET_corr, eventWeight);
 
         // Reco and fill W MT (tight muon only)
-        if (muons->GetTightMuons().size() > 0) {
-            MuonHolder& leadingMuon = muons->GetTightMuons()[0];
+        if (tightMuons.size() > 0) {
+            MuonHolder& leadingMuon = tightMuons[0];
             TLorentzVector leadingMuonVec = leadingMuon.GetRoccoSF() == -1. ? leadingMuon.GetMuonOrgVec() : leadingMuon.GetMuonRoccoVec();
 
             // Balance between muon and MET
-            hPt_Mu_over_MET->Fill(leadingMuonVec.Pt() / met->GetPuppiMET_pt(), eventWeight);
+            hPt_Mu_over_MET->Fill(leadingMuonVec.Pt() / cMET->GetPuppiMET_pt(), eventWeight);
 
-            Double_t deltaPhi = met->GetPuppiMET_phi() - leadingMuonVec.Phi();
+            Double_t deltaPhi = cMET->GetPuppiMET_phi() - leadingMuonVec.Phi();
             if (deltaPhi > M_PI) deltaPhi -= 2 * M_PI;
             if (deltaPhi < -M_PI) deltaPhi += 2 * M_PI;
-            Double_t W_MT = std::sqrt( 2 * leadingMuonVec.Pt() * met->GetPuppiMET_pt() * (1 - std::cos(deltaPhi)) );
+            Double_t W_MT = std::sqrt( 2 * leadingMuonVec.Pt() * cMET->GetPuppiMET_pt() * (1 - std::cos(deltaPhi)) );
             
             hDeltaPhi_Mu_MET->Fill(std::abs(deltaPhi), eventWeight);
             hW_MT->Fill(W_MT, eventWeight);
 
             // Using PFMET
-            Double_t deltaPhi_PFMET = met->GetMET_phi() - leadingMuonVec.Phi();
+            Double_t deltaPhi_PFMET = cMET->GetMET_phi() - leadingMuonVec.Phi();
             if (deltaPhi_PFMET > M_PI) deltaPhi_PFMET -= 2 * M_PI;
             if (deltaPhi_PFMET < -M_PI) deltaPhi_PFMET += 2 * M_PI;
-            Double_t W_MT_PFMET = std::sqrt( 2 * leadingMuonVec.Pt() * met->GetMET_pt() * (1 - std::cos(deltaPhi_PFMET)) );
+            Double_t W_MT_PFMET = std::sqrt( 2 * leadingMuonVec.Pt() * cMET->GetMET_pt() * (1 - std::cos(deltaPhi_PFMET)) );
             
             hDeltaPhi_Mu_PFMET->Fill(std::abs(deltaPhi_PFMET), eventWeight);
             hW_MT_PFMET->Fill(W_MT_PFMET, eventWeight);
@@ -285,75 +390,29 @@ void DYanalyzer::Analyze() {
             hW_MT_PFMET_corr->Fill(W_MT_PFMET_corr, eventWeight);
         }
 
-        ////////////////////////////////////////////////////////////
-        //////////////// Event selection here //////////////////////
-        ////////////////////////////////////////////////////////////
-        // 1. Trigger
-        // 2016APV : IsoMu24 || IsoTkMu24
-        // 2016 : IsoMu24 || IsoTkMu24
-        // 2017 : IsoMu27
-        // 2018 : IsoMu24
-        Bool_t passedTrigger = false;
-        if (sEra == "2016APV") {
-            passedTrigger = (**(cData->HLT_IsoMu24) || **(cData->HLT_IsoTkMu24));
-        } else if (sEra == "2016") {
-            passedTrigger = (**(cData->HLT_IsoMu24) || **(cData->HLT_IsoTkMu24));
-        } else if (sEra == "2017") {
-            passedTrigger = **(cData->HLT_IsoMu27);
-        } else if (sEra == "2018") {
-            passedTrigger = **(cData->HLT_IsoMu24);
-        }
-        if (!passedTrigger) continue;
-
-        // 2. Noise filter
-        // For 2016: Do not use Flag_ecalBadCalibFilter, Flag_BadChargedCandidateFilter
-        // For 2017, 2018: Do not use Flag_BadChargedCandidateFilter
-        Bool_t flag_goodVertices                       =  **(cData->Flag_goodVertices);
-        Bool_t flag_globalSuperTightHalo2016Filter     =  **(cData->Flag_globalSuperTightHalo2016Filter);
-        Bool_t flag_HBHENoiseFilter                    =  **(cData->Flag_HBHENoiseFilter);
-        Bool_t flag_HBHENoiseIsoFilter                 =  **(cData->Flag_HBHENoiseIsoFilter);
-        Bool_t flag_EcalDeadCellTriggerPrimitiveFilter =  **(cData->Flag_EcalDeadCellTriggerPrimitiveFilter);
-        Bool_t flag_BadPFMuonFilter                    =  **(cData->Flag_BadPFMuonFilter);
-        Bool_t flag_BadPFMuonDzFilter                  =  **(cData->Flag_BadPFMuonDzFilter);
-        Bool_t flag_hfNoisyHitsFilter                  =  **(cData->Flag_hfNoisyHitsFilter);
-        Bool_t flag_eeBadScFilter                      =  **(cData->Flag_eeBadScFilter);
-        bool passed_filter = (  flag_goodVertices                      &&
-                                flag_globalSuperTightHalo2016Filter    &&
-                                flag_HBHENoiseFilter                   &&
-                                flag_HBHENoiseIsoFilter                &&
-                                flag_EcalDeadCellTriggerPrimitiveFilter&&
-                                flag_BadPFMuonFilter                   &&
-                                flag_BadPFMuonDzFilter                 &&
-                                flag_hfNoisyHitsFilter                 &&
-                                flag_eeBadScFilter                     
-                                );
-        if (sEra.find("2016") != std::string::npos) {
-            passed_filter = passed_filter && **(cData->Flag_ecalBadCalibFilter);
-        }
-        if (!passed_filter) continue; // Skip event if noise filter failed
-
         // 3. Require only single tight muon
-        if( muons->GetTightMuons().size() != 1 ) continue;
+        if( tightMuons.size() != 1 ) continue;
 
         // 4. Additional loose lepton veto
         // 4-1. Additional loose muon veto
-        if( muons->GetLooseMuons().size() > 0 ) continue;
+        if( cMuons->GetLooseMuons().size() > 0 ) continue;
         // 4-2. Additional electron veto -> TODO: Implement this and see the effect
-        if (electrons->GetLooseElectrons().size() > 0) continue;
+        DoElectronSelection();
+        if (cElectrons->GetLooseElectrons().size() > 0) continue;
 
         // 5. Calculate W MT: Fill 3 different histograms (no W mass cut, W mass > 40 GeV, W mass > 200 GeV)
         // Using PUPPI MET for this cut
-        MuonHolder& leadingMuon = muons->GetTightMuons()[0];
+        MuonHolder& leadingMuon = tightMuons[0];
         TLorentzVector leadingMuonVec = leadingMuon.GetRoccoSF() == -1. ? leadingMuon.GetMuonOrgVec() : leadingMuon.GetMuonRoccoVec();
-        Double_t deltaPhi = met->GetPuppiMET_phi() - leadingMuonVec.Phi();
+        Double_t deltaPhi = cMET->GetPuppiMET_phi() - leadingMuonVec.Phi();
         if (deltaPhi > M_PI) deltaPhi -= 2 * M_PI;
         if (deltaPhi < -M_PI) deltaPhi += 2 * M_PI;
-        Double_t W_MT = std::sqrt( 2 * leadingMuonVec.Pt() * met->GetPuppiMET_pt() * (1 - std::cos(deltaPhi)) );
+        Double_t W_MT = std::sqrt( 2 * leadingMuonVec.Pt() * cMET->GetPuppiMET_pt() * (1 - std::cos(deltaPhi)) );
 
-        Double_t deltaPhi_PFMET = met->GetMET_phi() - leadingMuonVec.Phi();
+        Double_t deltaPhi_PFMET = cMET->GetMET_phi() - leadingMuonVec.Phi();
         if (deltaPhi_PFMET > M_PI) deltaPhi_PFMET -= 2 * M_PI;
         if (deltaPhi_PFMET < -M_PI) deltaPhi_PFMET += 2 * M_PI;
-        Double_t W_MT_PFMET = std::sqrt( 2 * leadingMuonVec.Pt() * met->GetMET_pt() * (1 - std::cos(deltaPhi_PFMET)) );
+        Double_t W_MT_PFMET = std::sqrt( 2 * leadingMuonVec.Pt() * cMET->GetMET_pt() * (1 - std::cos(deltaPhi_PFMET)) );
         
         Double_t deltaPhi_PFMET_corr = dPFMET_corr_phi - leadingMuonVec.Phi();
         if (deltaPhi_PFMET_corr > M_PI) deltaPhi_PFMET_corr -= 2 * M_PI;
@@ -363,18 +422,23 @@ void DYanalyzer::Analyze() {
         ////////////////////////////////////////////////////////////
         //////// Fill histograms after event selection /////////////
         ////////////////////////////////////////////////////////////
+        // Rochester correction replicas of the leading muon
+        if (bRoccoReplicas && HasFlag<F>(LoopConfig::kDoRocco)) {
+            FillRoccoReplicas(leadingMuon, W_MT, W_MT_PFMET_corr, eventWeight);
+        }
+
         // 1. No W mass cut
         // Fill PU related histograms (NPU, NTrueInt only available for MC)
         hNPV_after->Fill(**(cData->NPV), eventWeight);
         
         // Fill Gen-lv histograms after event selection
-        if (bIsMC) {
+        if (HasFlag<F>(LoopConfig::kIsMC)) {
             // Fill PU related histograms (NPU, NTrueInt only available for MC)
             hNPU_after->Fill(**(cData->Pileup_nPU), eventWeight);
             hNTrueInt_after->Fill(**(cData->Pileup_nTrueInt), eventWeight);
 
             // Fill Gen Muon
-            std::vector<GenPtcHolder> genMuonCollection = genPtcs->GetGenMuons();
+            ArenaVector<GenPtcHolder> genMuonCollection = cGenPtcs->GetGenMuons();
             // Sort genMuonCollection in descending order by Pt
             if (genMuonCollection.size() > 0) {
                 auto maxElemIt = std::max_element(genMuonCollection.begin(), genMuonCollection.end(),
@@ -389,7 +453,7 @@ void DYanalyzer::Analyze() {
             }
 
             // Fill Gen Neutrino
-            std::vector<GenPtcHolder> genNeutrinoCollection = genPtcs->GetGenNeutrinos();
+            ArenaVector<GenPtcHolder> genNeutrinoCollection = cGenPtcs->GetGenNeutrinos();
             // Sort genNeutrinoCollection in descending order by Pt
             if (genNeutrinoCollection.size() > 0) {
                 auto maxElemIt = std::max_element(genNeutrinoCollection.begin(), genNeutrinoCollection.end(),
@@ -408,24 +472,24 @@ void DYanalyzer::Analyze() {
             hGen_MET_pT_after->Fill(cData->GenMET_pt->At(0), eventWeight);
 
             // Fill LHE HT
-            if (genPtcs->IsInclusiveW() || genPtcs->IsBoostedW()) {
+            if (cGenPtcs->IsInclusiveW() || cGenPtcs->IsBoostedW()) {
                 hLHE_HT_after->Fill(**(cData->LHE_HT), eventWeight);
             }
             // Fill inclusive Gen W
             // But since this is after muon filtering, it should be same with WToMuNu histograms
-            if (genPtcs->FoundW()){
-                hGen_W_pT_after->Fill(genPtcs->GetGenW().Pt(), eventWeight);
-                hGen_W_eta_after->Fill(genPtcs->GetGenW().Eta(), eventWeight);
-                hGen_W_phi_after->Fill(genPtcs->GetGenW().Phi(), eventWeight);
-                hGen_W_mass_after->Fill(genPtcs->GetGenW().M(), eventWeight);
+            if (cGenPtcs->FoundW()){
+                hGen_W_pT_after->Fill(cGenPtcs->GetGenW().Pt(), eventWeight);
+                hGen_W_eta_after->Fill(cGenPtcs->GetGenW().Eta(), eventWeight);
+                hGen_W_phi_after->Fill(cGenPtcs->GetGenW().Phi(), eventWeight);
+                hGen_W_mass_after->Fill(cGenPtcs->GetGenW().M(), eventWeight);
             }
             // Fill Gen W for W->mu+nu channel
             // or fill Gen W for W->tau+nu->mu+nu channel
-            if ( genPtcs->IsWToMuNu() || genPtcs->IsWToTauNuToMuNu() ) {
-                hGen_WToMuNu_pT_after->Fill(genPtcs->GetGenW().Pt(), eventWeight);
-                hGen_WToMuNu_eta_after->Fill(genPtcs->GetGenW().Eta(), eventWeight);
-                hGen_WToMuNu_phi_after->Fill(genPtcs->GetGenW().Phi(), eventWeight);
-                hGen_WToMuNu_mass_after->Fill(genPtcs->GetGenW().M(), eventWeight);
+            if ( cGenPtcs->IsWToMuNu() || cGenPtcs->IsWToTauNuToMuNu() ) {
+                hGen_WToMuNu_pT_after->Fill(cGenPtcs->GetGenW().Pt(), eventWeight);
+                hGen_WToMuNu_eta_after->Fill(cGenPtcs->GetGenW().Eta(), eventWeight);
+                hGen_WToMuNu_phi_after->Fill(cGenPtcs->GetGenW().Phi(), eventWeight);
+                hGen_WToMuNu_mass_after->Fill(cGenPtcs->GetGenW().M(), eventWeight);
             }
         }
 
@@ -440,17 +504,17 @@ void DYanalyzer::Analyze() {
         hMuon_mass_after->Fill(leadingMuonVec.M(), eventWeight);
 
         // Fill MET
-        hMET_phi_after->Fill(met->GetPuppiMET_phi(), eventWeight);
-        hMET_pT_after->Fill(met->GetPuppiMET_pt(), eventWeight);
-        hMET_pT_after_40GeVBin->Fill(met->GetPuppiMET_pt(), eventWeight);
-        hMET_pT_after_80GeVBin->Fill(met->GetPuppiMET_pt(), eventWeight);
-        hMET_sumET_after->Fill(met->GetPuppiMET_sumEt(), eventWeight);
-
-        hPFMET_phi_after->Fill(met->GetMET_phi(), eventWeight);
-        hPFMET_pT_after->Fill(met->GetMET_pt(), eventWeight);
-        hPFMET_pT_after_40GeVBin->Fill(met->GetMET_pt(), eventWeight);
-        hPFMET_pT_after_80GeVBin->Fill(met->GetMET_pt(), eventWeight);
-        hPFMET_sumET_after->Fill(met->GetMET_sumEt(), eventWeight);
+        hMET_phi_after->Fill(cMET->GetPuppiMET_phi(), eventWeight);
+        hMET_pT_after->Fill(cMET->GetPuppiMET_pt(), eventWeight);
+        hMET_pT_after_40GeVBin->Fill(cMET->GetPuppiMET_pt(), eventWeight);
+        hMET_pT_after_80GeVBin->Fill(cMET->GetPuppiMET_pt(), eventWeight);
+        hMET_sumET_after->Fill(cMET->GetPuppiMET_sumEt(), eventWeight);
+
+        hPFMET_phi_after->Fill(cMET->GetMET_phi(), eventWeight);
+        hPFMET_pT_after->Fill(cMET->GetMET_pt(), eventWeight);
+        hPFMET_pT_after_40GeVBin->Fill(cMET->GetMET_pt(), eventWeight);
+        hPFMET_pT_after_80GeVBin->Fill(cMET->GetMET_pt(), eventWeight);
+        hPFMET_sumET_after->Fill(cMET->GetMET_sumEt(), eventWeight);
 
         hPFMET_corr_phi_after->Fill(dPFMET_corr_phi, eventWeight);
         hPFMET_corr_pT_after->Fill(dPFMET_corr, eventWeight);
@@ -458,28 +522,40 @@ void DYanalyzer::Analyze() {
         hPFMET_corr_pT_after_80GeVBin->Fill(dPFMET_corr, eventWeight);
 
         // Balance between muon and MET
-        hPt_Mu_over_MET_after->Fill(leadingMuonVec.Pt() / met->GetPuppiMET_pt(), eventWeight);
+        hPt_Mu_over_MET_after->Fill(leadingMuonVec.Pt() / cMET->GetPuppiMET_pt(), eventWeight);
 
         // Fill reconstructed W MT
         // Using PUPPI MET
         hDeltaPhi_Mu_MET_after->Fill(std::abs(deltaPhi), eventWeight);
         hW_MT_after->Fill(W_MT, eventWeight);
+        if (bPUVariations && HasFlag<F>(LoopConfig::kIsMC | LoopConfig::kDoPU)) {
+            hW_MT_after_PUUp->Fill(W_MT, eventWeight_PUUp);
+            hW_MT_after_PUDown->Fill(W_MT, eventWeight_PUDown);
+        }
         hW_MT_after_40GeVBin->Fill(W_MT, eventWeight);
         hW_MT_after_80GeVBin->Fill(W_MT, eventWeight);
         // Using PFMET
         hDeltaPhi_Mu_PFMET_after->Fill(std::abs(deltaPhi_PFMET), eventWeight);
         hW_MT_PFMET_after->Fill(W_MT_PFMET, eventWeight);
+        if (bPUVariations && HasFlag<F>(LoopConfig::kIsMC | LoopConfig::kDoPU)) {
+            hW_MT_PFMET_after_PUUp->Fill(W_MT_PFMET, eventWeight_PUUp);
+            hW_MT_PFMET_after_PUDown->Fill(W_MT_PFMET, eventWeight_PUDown);
+        }
         hW_MT_PFMET_after_40GeVBin->Fill(W_MT_PFMET, eventWeight);
         hW_MT_PFMET_after_80GeVBin->Fill(W_MT_PFMET, eventWeight);
         // Using corrected PFMET
         hDeltaPhi_Mu_PFMET_corr_after->Fill(std::abs(deltaPhi_PFMET_corr), eventWeight);
         hW_MT_PFMET_corr_after->Fill(W_MT_PFMET_corr, eventWeight);
+        if (bPUVariations && HasFlag<F>(LoopConfig::kIsMC | LoopConfig::kDoPU)) {
+            hW_MT_PFMET_corr_after_PUUp->Fill(W_MT_PFMET_corr, eventWeight_PUUp);
+            hW_MT_PFMET_corr_after_PUDown->Fill(W_MT_PFMET_corr, eventWeight_PUDown);
+        }
         hW_MT_PFMET_corr_after_40GeVBin->Fill(W_MT_PFMET_corr, eventWeight);
         hW_MT_PFMET_corr_after_80GeVBin->Fill(W_MT_PFMET_corr, eventWeight);
 
         // For simplicity, skip gen-level histograms
         // 2. W mass > 50 GeV
-        if (W_MT < 50.) continue;
+        if (W_MT < cCuts.dW_MT_low) continue;
         // Fill Object level histograms
         // Since this is after event selection, there's only one tight muon
         // Fill muon (tight muon only)
@@ -491,24 +567,24 @@ void DYanalyzer::Analyze() {
         hMuon_mass_after_Wmass50->Fill(leadingMuonVec.M(), eventWeight);
 
         // Fill MET
-        hMET_phi_after_Wmass50->Fill(met->GetPuppiMET_phi(), eventWeight);
-        hMET_pT_after_Wmass50->Fill(met->GetPuppiMET_pt(), eventWeight);
-        hMET_pT_after_Wmass50_40GeVBin->Fill(met->GetPuppiMET_pt(), eventWeight);
-        hMET_pT_after_Wmass50_80GeVBin->Fill(met->GetPuppiMET_pt(), eventWeight);
-        hMET_sumET_after_Wmass50->Fill(met->GetPuppiMET_sumEt(), eventWeight);
-
-        hPFMET_phi_after_Wmass50->Fill(met->GetMET_phi(), eventWeight);
-        hPFMET_pT_after_Wmass50->Fill(met->GetMET_pt(), eventWeight);
-        hPFMET_pT_after_Wmass50_40GeVBin->Fill(met->GetMET_pt(), eventWeight);
-        hPFMET_pT_after_Wmass50_80GeVBin->Fill(met->GetMET_pt(), eventWeight);
-        hPFMET_sumET_after_Wmass50->Fill(met->GetMET_sumEt(), eventWeight);
+        hMET_phi_after_Wmass50->Fill(cMET->GetPuppiMET_phi(), eventWeight);
+        hMET_pT_after_Wmass50->Fill(cMET->GetPuppiMET_pt(), eventWeight);
+        hMET_pT_after_Wmass50_40GeVBin->Fill(cMET->GetPuppiMET_pt(), eventWeight);
+        hMET_pT_after_Wmass50_80GeVBin->Fill(cMET->GetPuppiMET_pt(), eventWeight);
+        hMET_sumET_after_Wmass50->Fill(cMET->GetPuppiMET_sumEt(), eventWeight);
+
+        hPFMET_phi_after_Wmass50->Fill(cMET->GetMET_phi(), eventWeight);
+        hPFMET_pT_after_Wmass50->Fill(cMET->GetMET_pt(), eventWeight);
+        hPFMET_pT_after_Wmass50_40GeVBin->Fill(cMET->GetMET_pt(), eventWeight);
+        hPFMET_pT_after_Wmass50_80GeVBin->Fill(cMET->GetMET_pt(), eventWeight);
+        hPFMET_sumET_after_Wmass50->Fill(cMET->GetMET_sumEt(), eventWeight);
 
         hPFMET_corr_phi_after_Wmass50->Fill(dPFMET_corr_phi, eventWeight);
         hPFMET_corr_pT_after_Wmass50->Fill(dPFMET_corr, eventWeight);
         hPFMET_corr_pT_after_Wmass50_40GeVBin->Fill(dPFMET_corr, eventWeight);
 
         // Balance between muon and MET
-        hPt_Mu_over_MET_after_Wmass50->Fill(leadingMuonVec.Pt() / met->GetPuppiMET_pt(), eventWeight);
+        hPt_Mu_over_MET_after_Wmass50->Fill(leadingMuonVec.Pt() / cMET->GetPuppiMET_pt(), eventWeight);
         
         // Fill reconstructed W MT
         // Using PUPPI MET
@@ -528,7 +604,7 @@ void DYanalyzer::Analyze() {
         hW_MT_PFMET_corr_after_Wmass50_80GeVBin->Fill(W_MT_PFMET_corr, eventWeight);
 
         // 3. W mass > 200 GeV
-        if (W_MT < 200.) continue;
+        if (W_MT < cCuts.dW_MT_high) continue;
         // Fill Object level histograms
         // Since this is after event selection, there's only one tight muon
         // Fill muon (tight muon only)
@@ -540,15 +616,15 @@ void DYanalyzer::Analyze() {
         hMuon_mass_after_Wmass200->Fill(leadingMuonVec.M(), eventWeight);
 
         // Fill MET
-        hMET_phi_after_Wmass200->Fill(met->GetPuppiMET_phi(), eventWeight);
-        hMET_pT_after_Wmass200->Fill(met->GetPuppiMET_pt(), eventWeight);
-        hMET_pT_after_Wmass200_40GeVBin->Fill(met->GetPuppiMET_pt(), eventWeight);
-        hMET_pT_after_Wmass200_80GeVBin->Fill(met->GetPuppiMET_pt(), eventWeight);
-        hMET_sumET_after_Wmass200->Fill(met->GetPuppiMET_sumEt(), eventWeight);
+        hMET_phi_after_Wmass200->Fill(cMET->GetPuppiMET_phi(), eventWeight);
+        hMET_pT_after_Wmass200->Fill(cMET->GetPuppiMET_pt(), eventWeight);
+        hMET_pT_after_Wmass200_40GeVBin->Fill(cMET->GetPuppiMET_pt(), eventWeight);
+        hMET_pT_after_Wmass200_80GeVBin->Fill(cMET->GetPuppiMET_pt(), eventWeight);
+        hMET_sumET_after_Wmass200->Fill(cMET->GetPuppiMET_sumEt(), eventWeight);
 
-        hPFMET_phi_after_Wmass200->Fill(met->GetMET_phi(), eventWeight);
-        hPFMET_pT_after_Wmass200->Fill(met->GetMET_pt(), eventWeight);
-        hPFMET_sumET_after_Wmass200->Fill(met->GetMET_sumEt(), eventWeight);
+        hPFMET_phi_after_Wmass200->Fill(cMET->GetMET_phi(), eventWeight);
+        hPFMET_pT_after_Wmass200->Fill(cMET->GetMET_pt(), eventWeight);
+        hPFMET_sumET_after_Wmass200->Fill(cMET->GetMET_sumEt(), eventWeight);
 
         hPFMET_corr_phi_after_Wmass200->Fill(dPFMET_corr_phi, eventWeight);
         hPFMET_corr_pT_after_Wmass200->Fill(dPFMET_corr, eventWeight);
@@ -556,7 +632,7 @@ void DYanalyzer::Analyze() {
         hPFMET_corr_pT_after_Wmass200_80GeVBin->Fill(dPFMET_corr, eventWeight);
 
         // Balance between muon and MET
-        hPt_Mu_over_MET_after_Wmass200->Fill(leadingMuonVec.Pt() / met->GetPuppiMET_pt(), eventWeight);
+        hPt_Mu_over_MET_after_Wmass200->Fill(leadingMuonVec.Pt() / cMET->GetPuppiMET_pt(), eventWeight);
 
         // Fill reconstructed W MT
         // Using PUPPI MET
@@ -575,38 +651,295 @@ void DYanalyzer::Analyze() {
         hW_MT_PFMET_corr_after_Wmass200_40GeVBin->Fill(W_MT_PFMET_corr, eventWeight);
         hW_MT_PFMET_corr_after_Wmass200_80GeVBin->Fill(W_MT_PFMET_corr, eventWeight);
     } // End of event loop
+}
 
-    //////////////////////////////////////////////////////////
-    ///////// Fill histograms after event loop ///////////////
-    //////////////////////////////////////////////////////////
-    hGenEvtWeight->SetBinContent(1, dSumOfGenEvtWeight);
+////////////////////////////////////////////////////////////
+////////// Lazily evaluated per-event quantities ///////////
+////////////////////////////////////////////////////////////
+// Each quantity is computed at most once per event, when it is first asked for
+void DYanalyzer::ResetEventCache() {
+    bEvtDidRocco = false;
+    bEvtDidMuonSel = false;
+    bEvtDidElectronSel = false;
+    bEvtDidEffSF = false;
+    bEvtDidPFMETCorr = false;
+    dEvtEffSFWeight = 1.0;
+    pEvtPFMETCorr = std::make_pair(0., 0.);
+}
 
-    std::cout << "[Info] DYanalyzer::Analyze() - End of event loop" << std::endl;
-    std::cout << "[Info] DYanalyzer::Analyze() - Total sum of weight: " << std::fixed << std::setprecision(2) << dSumOfGenEvtWeight << std::endl;
+// Gen-reco muon matching (dR < 0.1) and random numbers for the not matched muons
+// The random numbers are drawn in the muon order, as they were when Rocco was applied to every event
+void DYanalyzer::PrepareRoccoInputs() {
+    ArenaVector<GenPtcHolder> genMuonCollection = cGenPtcs->GetGenMuons();
+    for (MuonHolder& singleMuon : cMuons->GetMuons()) {
+        Double_t min_dR = 999.;
+        Int_t matchedGenMuonIdx = -1;
+        for (Int_t idx = 0; idx < (Int_t) genMuonCollection.size(); idx++) {
+            // Get dR between gen muon and reco muon
+            Double_t dR = (genMuonCollection[idx].GetGenPtcVec()).DeltaR(singleMuon.GetMuonOrgVec());
+            if (dR < min_dR && dR < 0.1) {
+                min_dR = dR;
+                matchedGenMuonIdx = idx;
+            }
+        }
+        if (matchedGenMuonIdx >= 0) {
+            singleMuon.SetRoccoGenPt(genMuonCollection[matchedGenMuonIdx].GetGenPtcVec().Pt());
+        }
+        else {
+            singleMuon.SetRoccoRandom(cRandom.Rndm()); // Random seed btw 0 ~ 1
+        }
+    }
+}
+
+// Do Rocco before object selection and EffSF calculation
+template <UInt_t F>
+void DYanalyzer::ApplyRocco() {
+    if (bEvtDidRocco) return;
+    bEvtDidRocco = true;
+    if (!HasFlag<F>(LoopConfig::kDoRocco)) return;
+
+    // Gather the muons into the reused buffers and evaluate Rocco for all of them in one batch call
+    ArenaVector<MuonHolder>& muons = cMuons->GetMuons();
+    Int_t nMuons = muons.size();
+    vRoccoCharge.resize(nMuons);
+    vRoccoPt.resize(nMuons);
+    vRoccoEta.resize(nMuons);
+    vRoccoPhi.resize(nMuons);
+    vRoccoGenPt.resize(nMuons);
+    vRoccoNLayers.resize(nMuons);
+    vRoccoRandom.resize(nMuons);
+    vRoccoSF.resize(nMuons);
+    for (Int_t i = 0; i < nMuons; i++) {
+        MuonHolder& singleMuon = muons[i];
+        vRoccoCharge[i] = singleMuon.Charge();
+        vRoccoPt[i] = singleMuon.Pt();
+        vRoccoEta[i] = singleMuon.Eta();
+        vRoccoPhi[i] = singleMuon.Phi();
+        vRoccoGenPt[i] = singleMuon.GetRoccoGenPt();
+        vRoccoNLayers[i] = singleMuon.GetTrackerLayers();
+        vRoccoRandom[i] = singleMuon.GetRoccoRandom();
+    }
+
+    // Rocco for MC : kSpreadMC if well matched (gen pt > 0), kSmearMC if not matched
+    if (HasFlag<F>(LoopConfig::kIsMC)) {
+        cRochesterCorrection->kCorrectMC(nMuons, vRoccoCharge.data(), vRoccoPt.data(), vRoccoEta.data(), vRoccoPhi.data(),
+                                         vRoccoGenPt.data(), vRoccoNLayers.data(), vRoccoRandom.data(), vRoccoSF.data(), iRoccoSet, iRoccoMember);
+    }
+    // Rocco for data
+    else {
+        cRochesterCorrection->kScaleDT(nMuons, vRoccoCharge.data(), vRoccoPt.data(), vRoccoEta.data(), vRoccoPhi.data(),
+                                       vRoccoSF.data(), iRoccoSet, iRoccoMember);
+    }
+
+    for (Int_t i = 0; i < nMuons; i++) {
+        muons[i].SetRoccoSF(vRoccoSF[i]);
+    }
+}
+
+// All sets and members of Rocco for the selected muon, in one call sharing the bin lookup
+// Only the muon pT is varied : the event selection and the MET are those of the nominal correction,
+// so W MT scales as sqrt(k_replica / k_nominal)
+void DYanalyzer::FillRoccoReplicas(MuonHolder& muon, Double_t W_MT, Double_t W_MT_PFMET_corr, Double_t eventWeight) {
+    if (bIsMC) {
+        cRochesterCorrection->kCorrectMCReplicas(muon.Charge(), muon.Pt(), muon.Eta(), muon.Phi(),
+                                                 muon.GetRoccoGenPt(), muon.GetTrackerLayers(), muon.GetRoccoRandom(), vRoccoReplicaSF.data());
+    } else {
+        cRochesterCorrection->kScaleDTReplicas(muon.Charge(), muon.Pt(), muon.Eta(), muon.Phi(), vRoccoReplicaSF.data());
+    }
+
+    Double_t nominalSF = muon.GetRoccoSF();
+    for (Int_t iReplica = 0; iReplica < (Int_t) vRoccoReplicaSF.size(); iReplica++) {
+        Double_t replicaSF = vRoccoReplicaSF[iReplica];
+        Double_t scaleMT = std::sqrt(replicaSF / nominalSF);
+        hMuon_pT_after_RoccoReplica->Fill(replicaSF * muon.Pt(), iReplica, eventWeight);
+        hW_MT_after_RoccoReplica->Fill(W_MT * scaleMT, iReplica, eventWeight);
+        hW_MT_PFMET_corr_after_RoccoReplica->Fill(W_MT_PFMET_corr * scaleMT, iReplica, eventWeight);
+    }
+}
+
+// If DoRocco, then Obj selection should be done after Rocco
+template <UInt_t F>
+void DYanalyzer::DoMuonSelection() {
+    if (bEvtDidMuonSel) return;
+    ApplyRocco<F>();
+    cMuons->DoObjSel(cCuts.cMuon);
+    bEvtDidMuonSel = true;
+}
+
+void DYanalyzer::DoElectronSelection() {
+    if (bEvtDidElectronSel) return;
+    cElectrons->DoObjSel();
+    bEvtDidElectronSel = true;
+}
+
+// Product of the enabled efficiency SFs of the leading tight muon, 1 if there's no tight muon
+template <UInt_t F>
+Double_t DYanalyzer::GetEffSFWeight() {
+    if (bEvtDidEffSF) return dEvtEffSFWeight;
+    DoMuonSelection<F>();
+
+    constexpr UInt_t allSFs = LoopConfig::kDoIDSF | LoopConfig::kDoIsoSF | LoopConfig::kDoTrigSF;
+    std::array<Double_t, 3> efficiencySF = {1.0, 1.0, 1.0};
+    ArenaVector<MuonHolder> tightMuonCollection = cMuons->GetTightMuons();
+
+    // All SFs applied : single lookup in the precomputed ID*Iso*Trig table
+    if (HasFlag<F>(allSFs)) {
+        dEvtEffSFWeight = 1.0;
+        if (tightMuonCollection.size() > 0) {
+            dEvtEffSFWeight = cEfficiencySF->GetSFProduct(tightMuonCollection[0].Pt(), tightMuonCollection[0].Eta());
+        }
+        bEvtDidEffSF = true;
+        return dEvtEffSFWeight;
+    }
+
+    if (tightMuonCollection.size() > 0) {
+        MuonHolder& leadingMuon = tightMuonCollection[0];
+        // Get efficiency SF
+        efficiencySF = cEfficiencySF->GetEfficiency(leadingMuon.Pt(), leadingMuon.Eta());
+        // Apply efficiency SF
+        leadingMuon.SetEfficiencySF(efficiencySF);
+    }
+
+    dEvtEffSFWeight = 1.0;
+    if (HasFlag<F>(LoopConfig::kDoIDSF))   dEvtEffSFWeight *= efficiencySF[0]; // ID SF
+    if (HasFlag<F>(LoopConfig::kDoIsoSF))  dEvtEffSFWeight *= efficiencySF[1]; // Iso SF
+    if (HasFlag<F>(LoopConfig::kDoTrigSF)) dEvtEffSFWeight *= efficiencySF[2]; // Trig SF
+    bEvtDidEffSF = true;
+    return dEvtEffSFWeight;
+}
+
+const std::pair<Double_t, Double_t>& DYanalyzer::GetPFMETXYCorr() {
+    if (!bEvtDidPFMETCorr) {
+        pEvtPFMETCorr = cMET->GetPFMETXYCorr(**(cData->NPV));
+        bEvtDidPFMETCorr = true;
+    }
+    return pEvtPFMETCorr;
+}
+
+////////////////////////////////////////////////////////////
+///////////////// Event loop dispatching ///////////////////
+////////////////////////////////////////////////////////////
+// Configurations with a dedicated instantiation of the event loop : the cumulative correction sets used in
+// condor/generate_condor_script.py (Org, PU, L1, Rocco, ID, Iso, All), anything else runs the generic version
+// Gen-lv patching is not part of the configuration, it only depends on the process and is checked at run time
+namespace {
+    using namespace LoopConfig;
+    constexpr UInt_t kSpecializedConfigs[] = {
+        // Data, only Rocco applies
+        0,
+        kDoRocco,
+        // MC
+        kIsMC,
+        kIsMC | kDoPU,
+        kIsMC | kDoPU | kDoL1,
+        kIsMC | kDoPU | kDoL1 | kDoRocco,
+        kIsMC | kDoPU | kDoL1 | kDoRocco | kDoIDSF,
+        kIsMC | kDoPU | kDoL1 | kDoRocco | kDoIDSF | kDoIsoSF,
+        kIsMC | kDoPU | kDoL1 | kDoRocco | kDoIDSF | kDoIsoSF | kDoTrigSF,
+    };
+    constexpr std::size_t nSpecializedConfigs = sizeof(kSpecializedConfigs) / sizeof(kSpecializedConfigs[0]);
+}
+
+template <Era E, std::size_t... I>
+DYanalyzer::EventLoopFunc DYanalyzer::SelectEventLoop(std::index_sequence<I...>) {
+    EventLoopFunc eventLoop = &DYanalyzer::EventLoop<E, LoopConfig::kRuntime>;
+    ((iConfigFlags == kSpecializedConfigs[I] ? (eventLoop = &DYanalyzer::EventLoop<E, kSpecializedConfigs[I]>, true) : false) || ...);
+    return eventLoop;
+}
+
+DYanalyzer::EventLoopFunc DYanalyzer::SelectEventLoop() {
+    auto configs = std::make_index_sequence<nSpecializedConfigs>{};
+    EventLoopFunc eventLoop = nullptr;
+    switch (eEra) {
+        case Era::k2016APV : eventLoop = SelectEventLoop<Era::k2016APV>(configs); break;
+        case Era::k2016    : eventLoop = SelectEventLoop<Era::k2016>(configs); break;
+        case Era::k2017    : eventLoop = SelectEventLoop<Era::k2017>(configs); break;
+        case Era::k2018    : eventLoop = SelectEventLoop<Era::k2018>(configs); break;
+    }
+    Bool_t isSpecialized = false;
+    for (UInt_t config : kSpecializedConfigs) isSpecialized = isSpecialized || (config == iConfigFlags);
+    std::cout << "[Info] DYanalyzer::SelectEventLoop() - Configuration flags: 0x" << std::hex << iConfigFlags << std::dec
+              << (isSpecialized ? " (specialized event loop)" : " (generic event loop)") << std::endl;
+    return eventLoop;
+}
+
+// Bits of the configuration, MC-only corrections are dropped for data so that they share the same instantiation
+UInt_t DYanalyzer::BuildConfigFlags() {
+    UInt_t config = 0;
+    if (bDoRocco) config |= LoopConfig::kDoRocco;
+    if (bIsMC) {
+        config |= LoopConfig::kIsMC;
+        if (bDoPUCorrection) config |= LoopConfig::kDoPU;
+        if (bDoL1PreFiringCorrection) config |= LoopConfig::kDoL1;
+        if (bDoIDSF) config |= LoopConfig::kDoIDSF;
+        if (bDoIsoSF) config |= LoopConfig::kDoIsoSF;
+        if (bDoTrigSF) config |= LoopConfig::kDoTrigSF;
+    }
+    return config;
+}
+
+Era DYanalyzer::ParseEra(const std::string& era) {
+    if (era == "2016APV") return Era::k2016APV;
+    if (era == "2016") return Era::k2016;
+    if (era == "2017") return Era::k2017;
+    if (era == "2018") return Era::k2018;
+    throw std::runtime_error("[Runtime Error] DYanalyzer::ParseEra() - Unknown era: " + era);
 }
 
 ////////////////////////////////////////////////////////////
 //////////////// Class initialization //////////////////////
 ////////////////////////////////////////////////////////////
 void DYanalyzer::Init() {
+    // Era and configuration of the event loop
+    eEra = ParseEra(sEra);
+
     // Declare classes
     cData = new Data(sProcessName, sEra, sInputFileList, bIsMC);
-    cPU = new PU(sEra);
-    cEfficiencySF = new EfficiencySF(sEra, sHistName_ID, sHistName_Iso, sHistName_Trig);    
-    cRochesterCorrection = new RoccoR(sRoccoFileName); // Rocco is initialized here
+    if (!bDoRocco) bRoccoReplicas = false;
+    // PU, efficiency SF and Rocco are initialized here, unless they are shared with other analyzers
+    AnalysisCorrections::Config correctionConfig = GetCorrectionConfig();
+    if (pCorrections == nullptr) {
+        pCorrections = std::make_shared<AnalysisCorrections>(correctionConfig);
+    } else if (pCorrections->GetConfig().ToString() != correctionConfig.ToString()) {
+        throw std::runtime_error("[Runtime Error] DYanalyzer::Init() - Shared corrections of another configuration: " + pCorrections->GetConfig().ToString());
+    } else {
+        std::cout << "[Info] DYanalyzer::Init() - Using shared corrections" << std::endl;
+    }
+    cPU = &pCorrections->GetPU();
+    cEfficiencySF = &pCorrections->GetEffSF();
+    cRochesterCorrection = &pCorrections->GetRocco();
+    if (bRoccoReplicas) vRoccoReplicaSF.resize(cRochesterCorrection->nReplicas());
+    bPUVariations = bIsMC && bDoPUCorrection && cPU->HasVariations();
+    cEventArena = new EventArena();
+    cTelemetry = new Telemetry({"read", "corrections", "selection", "checkpoint"});
+    cTelemetry->SetOutput(sTelemetryFileName);
+    cTelemetry->SetInterval(dTelemetryInterval);
+    cTelemetry->SetIOStats(bTelemetryIOStats);
+    cTelemetry->SetLabel((nLastEntry >= 0) ? sProcessName + ":" + std::to_string(nFirstEntry) + "-" + std::to_string(nLastEntry) : sProcessName);
 
     // Initialize classes
+    // A resumed job restarts at the entry of its checkpoint
+    OpenCheckpoint();
+    cData->SetEntryRange((nResumeEntry >= 0) ? nResumeEntry : nFirstEntry, nLastEntry);
+    cData->SetSkipFiles(sSkipInputFiles);
+    cData->SetKnownEntries(mKnownEntries);
+    cData->SetInputRetries(nInputRetries, dInputRetryDelay);
+    if (pResumeInputCheck != nullptr) cData->SetInputCheck(*pResumeInputCheck);
+    else if (pInputCheck != nullptr) cData->SetInputCheck(*pInputCheck);
     cData->Init();
-    cPU->Init();
-    cEfficiencySF->Init();
 
     // Set total events
     nTotalEvents = cData->GetTotalEvents(); 
 
     // Check process name and determine whether to perform Gen-lv patching
     this->CheckGenPatching();
+    // PF MET xy-shift correction coefficients of this process
+    cMETXYCorrParams = MET::FindXYCorrParams(pSampleInfo->sMETKey.empty() ? sEra : pSampleInfo->sMETKey, bIsMC);
+    iConfigFlags = BuildConfigFlags();
     // Declare histograms
     this->DeclareHistograms();
+    // Histograms, sums of weights and random number state of the checkpoint
+    RestoreCheckpoint();
     // Print initialization information
     this->PrintInitInfo();
 
@@ -615,43 +948,20 @@ void DYanalyzer::Init() {
 
 // Check process name and determine whether to perform Gen-lv patching
 void DYanalyzer::CheckGenPatching() {
-    // Regex for WToMuNu
-    // Captures process names like
-    // WToMuNu_M-100, WToMuNu_M-200_v1, WToMuNu_M-500_ext-v1, ...
-    std::regex WToMuNuRegex("^WToMuNu_M-(\\d+)(?:_.*)?$");
-    std::smatch WToMuNuMatch;
-    // Regex for WToTauNu
-    // Captures process names like
-    // WToTauNu_M-100, WToTauNu_M-200_v1, WToTauNu_M-500_ext-v1, ...
-    std::regex WToTauNuRegex("^WToTauNu_M-(\\d+)(?:_.*)?$");
-    std::smatch WToTauNuMatch;
-
-    if (sProcessName == "WJetsToLNu") {
-        dW_mass_cut_high = 100;
-        dHT_cut_high = 100;
-        bIsInclusiveW = true;
-    } else if (sProcessName.find("WJetsToLNu_HT") != std::string::npos) {
-        dW_mass_cut_high = 100;
-        // dHT_cut_high = 100; // No need to restrict HT for boosted W
-        bIsBoostedW = true;
-    } else if (std::regex_match(sProcessName, WToMuNuMatch, WToMuNuRegex)) {
-        dW_mass_cut_low = std::stod(WToMuNuMatch[1]);
-        if(dW_mass_cut_low == 100) dW_mass_cut_high = 200;
-        else if(dW_mass_cut_low == 200) dW_mass_cut_high = 500;
-        else if(dW_mass_cut_low == 500) dW_mass_cut_high = 1000;
-        else if(dW_mass_cut_low == 1000) dW_mass_cut_high = 2000;
-        else dW_mass_cut_high = 1e9;
-        bIsOffshellW = true;
-    } else if (std::regex_match(sProcessName, WToTauNuMatch, WToTauNuRegex)) {
-        dW_mass_cut_low = std::stod(WToTauNuMatch[1]);
-        if(dW_mass_cut_low == 100) dW_mass_cut_high = 200;
-        else if(dW_mass_cut_low == 200) dW_mass_cut_high = 500;
-        else if(dW_mass_cut_low == 500) dW_mass_cut_high = 1000;
-        else if(dW_mass_cut_low == 1000) dW_mass_cut_high = 2000;
-        else dW_mass_cut_high = 1e9;
-        bIsOffshellWToTauNu = true;
+    // Stitching rule and windows of the process (see samples/samples.txt)
+    pSampleInfo = &SampleRegistry::Get().At(sProcessName, sEra);
+    if (pSampleInfo->bIsData == bIsMC) {
+        throw std::runtime_error("[Runtime Error] DYanalyzer::CheckGenPatching() - " + sProcessName + " is " + (pSampleInfo->bIsData ? "data" : "MC") + " in the sample registry");
     }
 
+    bIsInclusiveW = (pSampleInfo->eStitch == Stitch::kInclusiveW);
+    bIsBoostedW = (pSampleInfo->eStitch == Stitch::kBoostedW);
+    bIsOffshellW = (pSampleInfo->eStitch == Stitch::kOffshellW);
+    bIsOffshellWToTauNu = (pSampleInfo->eStitch == Stitch::kOffshellWToTauNu);
+    dW_mass_cut_low = pSampleInfo->dW_mass_cut_low;
+    dW_mass_cut_high = pSampleInfo->dW_mass_cut_high;
+    dHT_cut_high = pSampleInfo->dHT_cut_high;
+
     // Do Gen-lv patching if any of the conditions is true
     if (bIsInclusiveW || bIsBoostedW || bIsOffshellW || bIsOffshellWToTauNu)
         bDoGenPatching = true;
@@ -665,152 +975,101 @@ void DYanalyzer::PrintInitInfo() {
     std::cout << "[Info] DYanalyzer::PrintInitInfo() - Process name: " << sProcessName << std::endl;
     std::cout << "[Info] DYanalyzer::PrintInitInfo() - Era: " << sEra << std::endl;
     std::cout << "[Info] DYanalyzer::PrintInitInfo() - Is MC: " << bIsMC << std::endl;
-    std::cout << "[Info] DYanalyzer::PrintInitInfo() - Do gen patching: " << bDoGenPatching << std::endl;
+    std::cout << "[Info] DYanalyzer::PrintInitInfo() - Do gen patching: " << bDoGenPatching << " (" << SampleRegistry::StitchName(pSampleInfo->eStitch) << ")" << std::endl;
+    if (dNormalizationScale > 0.) std::cout << "[Info] DYanalyzer::PrintInitInfo() - Normalization scale: " << dNormalizationScale << std::endl;
     std::cout << "[Info] DYanalyzer::PrintInitInfo() - Do PU correction: " << bDoPUCorrection << std::endl;
+    std::cout << "[Info] DYanalyzer::PrintInitInfo() - PU up/down histograms: " << bPUVariations << std::endl;
     std::cout << "[Info] DYanalyzer::PrintInitInfo() - Do L1 pre-firing correction: " << bDoL1PreFiringCorrection << std::endl;
     std::cout << "[Info] DYanalyzer::PrintInitInfo() - Do ID SF: " << bDoIDSF << std::endl;
     std::cout << "[Info] DYanalyzer::PrintInitInfo() - Do Iso SF: " << bDoIsoSF << std::endl;
     std::cout << "[Info] DYanalyzer::PrintInitInfo() - Do Trig SF: " << bDoTrigSF << std::endl;
     std::cout << "[Info] DYanalyzer::PrintInitInfo() - Do rocco correction: " << bDoRocco << std::endl;
+    std::cout << "[Info] DYanalyzer::PrintInitInfo() - Fast rocco (tabulated CrystalBall): " << bFastRocco << std::endl;
+    std::cout << "[Info] DYanalyzer::PrintInitInfo() - Rocco replica histograms: " << bRoccoReplicas << std::endl;
+    if (!cCuts.ToString().empty()) std::cout << "[Info] DYanalyzer::PrintInitInfo() - Selection cuts: " << cCuts.ToString() << std::endl;
     std::cout << "-------------------------------------------------------------------------" << std::endl;
 }
 
-// Simple utility to print progress
-void DYanalyzer::PrintProgress(const int currentStep) {    
-    float progress = (float)currentStep / nTotalEvents;
-    int barWidth = 70;
-    std::cout << "[";
-    int pos = barWidth * progress;
-    for (int i = 0; i < barWidth; i++) {
-        if (i < pos)
-            std::cout << "=";
-        else if (i == pos)
-            std::cout << ">";
-        else
-            std::cout << " ";
-    }
-    std::cout << "]  " << currentStep << "/" << nTotalEvents << "  " << int(progress * 100.0) << "%\r";
-    std::cout.flush();
-}
-
 // Declare histograms
 void DYanalyzer::DeclareHistograms() {
     ////////////////////////////////////////////////////////////
     // GenLevel event weights, before and after each correction
     ////////////////////////////////////////////////////////////
-    hGenEvtWeight = new TH1D("hGenEvtWeight", "hGenEvtWeight", 1,0,1);
-    hGenEvtWeight->Sumw2();
+    hGenEvtWeight = BookTH1D("hGenEvtWeight", 1, 0, 1);
+    // PU up/down histograms only if the variations differ from the nominal weights, they would be copies of the nominal ones otherwise
+    if (bPUVariations) {
+        hGenEvtWeight_PUUp = BookTH1D("hGenEvtWeight_PUUp", 1, 0, 1);
+        hGenEvtWeight_PUDown = BookTH1D("hGenEvtWeight_PUDown", 1, 0, 1);
+    }
     ////////////////////////////////////////////////////////////
     // Before event selection
     ////////////////////////////////////////////////////////////
 
     // GenLevel Object histograms
-    hGen_Muon_pT  = new TH1D("hGen_Muon_pT",  "hGen_Muon_pT",  4000, 0, 4000);
-    hGen_Muon_pT->Sumw2();
-    hGen_Muon_phi = new TH1D("hGen_Muon_phi", "hGen_Muon_phi", 72, -M_PI, M_PI);
-    hGen_Muon_phi->Sumw2();
-    hGen_Muon_eta = new TH1D("hGen_Muon_eta", "hGen_Muon_eta", 50, -2.5, 2.5);
-    hGen_Muon_eta->Sumw2();
-
-    hGen_Nu_pT  = new TH1D("hGen_Nu_pT",  "hGen_Nu_pT",  4000, 0, 4000);
-    hGen_Nu_pT->Sumw2();
-    hGen_Nu_phi = new TH1D("hGen_Nu_phi", "hGen_Nu_phi", 72, -M_PI, M_PI);
-    hGen_Nu_phi->Sumw2();
-    hGen_Nu_eta = new TH1D("hGen_Nu_eta", "hGen_Nu_eta", 50, -2.5, 2.5);
-    hGen_Nu_eta->Sumw2();
-
-    hGen_MET_phi   = new TH1D("hGen_MET_phi", "hGen_MET_phi", 72, -M_PI, M_PI);
-    hGen_MET_phi->Sumw2();
-    hGen_MET_pT    = new TH1D("hGen_MET_pT", "hGen_MET_pT", 4000, 0, 4000);
-    hGen_MET_pT->Sumw2();
+    hGen_Muon_pT  = BookSparseTH1D("hGen_Muon_pT", 4000, 0, 4000);
+    hGen_Muon_phi = BookTH1D("hGen_Muon_phi", 72, -M_PI, M_PI);
+    hGen_Muon_eta = BookTH1D("hGen_Muon_eta", 50, -2.5, 2.5);
+
+    hGen_Nu_pT  = BookSparseTH1D("hGen_Nu_pT", 4000, 0, 4000);
+    hGen_Nu_phi = BookTH1D("hGen_Nu_phi", 72, -M_PI, M_PI);
+    hGen_Nu_eta = BookTH1D("hGen_Nu_eta", 50, -2.5, 2.5);
+
+    hGen_MET_phi   = BookTH1D("hGen_MET_phi", 72, -M_PI, M_PI);
+    hGen_MET_pT    = BookSparseTH1D("hGen_MET_pT", 4000, 0, 4000);
     
     // For GenLevel W decaying to muon and neutrino
-    hGen_WToMuNu_pT    = new TH1D("hGen_WToMuNu_pT", "hGen_WToMuNu_pT", 4000, 0, 4000);
-    hGen_WToMuNu_pT->Sumw2();
-    hGen_WToMuNu_eta   = new TH1D("hGen_WToMuNu_eta", "hGen_WToMuNu_eta", 50, -2.5, 2.5);
-    hGen_WToMuNu_eta->Sumw2();
-    hGen_WToMuNu_phi   = new TH1D("hGen_WToMuNu_phi", "hGen_WToMuNu_phi", 72, -M_PI, M_PI);
-    hGen_WToMuNu_phi->Sumw2();
-    hGen_WToMuNu_mass  = new TH1D("hGen_WToMuNu_mass", "hGen_WToMuNu_mass", 4000, 0, 4000);
-    hGen_WToMuNu_mass->Sumw2();
-    hGen_WToMuNu_MT    = new TH1D("hGen_WToMuNu_MT", "hGen_WToMuNu_MT", 4000, 0, 4000);
-    hGen_WToMuNu_MT->Sumw2();
+    hGen_WToMuNu_pT    = BookSparseTH1D("hGen_WToMuNu_pT", 4000, 0, 4000);
+    hGen_WToMuNu_eta   = BookTH1D("hGen_WToMuNu_eta", 50, -2.5, 2.5);
+    hGen_WToMuNu_phi   = BookTH1D("hGen_WToMuNu_phi", 72, -M_PI, M_PI);
+    hGen_WToMuNu_mass  = BookSparseTH1D("hGen_WToMuNu_mass", 4000, 0, 4000);
+    hGen_WToMuNu_MT    = BookSparseTH1D("hGen_WToMuNu_MT", 4000, 0, 4000);
 
     // For GenLevel inclusive decaying W
-    hGen_W_pT    = new TH1D("hGen_W_pT", "hGen_W_pT", 4000, 0, 4000);
-    hGen_W_pT->Sumw2();
-    hGen_W_eta   = new TH1D("hGen_W_eta", "hGen_W_eta", 50, -2.5, 2.5);
-    hGen_W_eta->Sumw2();
-    hGen_W_phi   = new TH1D("hGen_W_phi", "hGen_W_phi", 72, -M_PI, M_PI);
-    hGen_W_phi->Sumw2();
-    hGen_W_mass  = new TH1D("hGen_W_mass", "hGen_W_mass", 4000, 0, 4000);
-    hGen_W_mass->Sumw2();
-    hGen_W_MT    = new TH1D("hGen_W_MT", "hGen_W_MT", 4000, 0, 4000);
-    hGen_W_MT->Sumw2();
+    hGen_W_pT    = BookSparseTH1D("hGen_W_pT", 4000, 0, 4000);
+    hGen_W_eta   = BookTH1D("hGen_W_eta", 50, -2.5, 2.5);
+    hGen_W_phi   = BookTH1D("hGen_W_phi", 72, -M_PI, M_PI);
+    hGen_W_mass  = BookSparseTH1D("hGen_W_mass", 4000, 0, 4000);
+    hGen_W_MT    = BookSparseTH1D("hGen_W_MT", 4000, 0, 4000);
     
     // For LHE HT
-    hLHE_HT = new TH1D("hLHE_HT", "hLHE_HT", 4000, 0, 4000);
-    hLHE_HT->Sumw2();
+    hLHE_HT = BookSparseTH1D("hLHE_HT", 4000, 0, 4000);
 
-    // Object histograms
-    hMuon_pT  = new TH1D("hMuon_pT", "hMuon_pT", 4000, 0, 4000);
-    hMuon_pT->Sumw2();
-    hMuon_phi = new TH1D("hMuon_phi", "hMuon_phi", 72, -M_PI, M_PI);
-    hMuon_phi->Sumw2();
-    hMuon_eta = new TH1D("hMuon_eta", "hMuon_eta", 50, -2.5, 2.5);
-    hMuon_eta->Sumw2();
-    hMuon_mass = new TH1D("hMuon_mass", "hMuon_mass", 1000, 0, 1);
-    hMuon_mass->Sumw2();
-
-    hMET_phi   = new TH1D("hMET_phi", "hMET_phi", 72, -M_PI, M_PI);
-    hMET_phi->Sumw2();
-    hMET_pT    = new TH1D("hMET_pT", "hMET_pT", 4000, 0, 4000);
-    hMET_pT->Sumw2();
-    hMET_sumET = new TH1D("hMET_sumET", "hMET_sumET", 4000, 0, 4000);
-    hMET_sumET->Sumw2();
-
-    hPFMET_phi   = new TH1D("hPFMET_phi", "hPFMET_phi", 72, -M_PI, M_PI);
-    hPFMET_phi->Sumw2();
-    hPFMET_pT    = new TH1D("hPFMET_pT", "hPFMET_pT", 4000, 0, 4000);
-    hPFMET_pT->Sumw2();
-    hPFMET_sumET = new TH1D("hPFMET_sumET", "hPFMET_sumET", 4000, 0, 4000);
-    hPFMET_sumET->Sumw2();
-
-    hPFMET_corr_phi   = new TH1D("hPFMET_corr_phi", "hPFMET_corr_phi", 72, -M_PI, M_PI);
-    hPFMET_corr_phi->Sumw2();
-    hPFMET_corr_pT    = new TH1D("hPFMET_corr_pT", "hPFMET_corr_pT", 4000, 0, 4000);
-    hPFMET_corr_pT->Sumw2();
-    hPFMET_corr_sumET = new TH1D("hPFMET_corr_sumET", "hPFMET_corr_sumET", 4000, 0, 4000);
-    hPFMET_corr_sumET->Sumw2();
+    // Object histograms, filled after the trigger and noise filters
+    hMuon_pT  = BookSparseTH1D("hMuon_pT", 4000, 0, 4000);
+    hMuon_phi = BookTH1D("hMuon_phi", 72, -M_PI, M_PI);
+    hMuon_eta = BookTH1D("hMuon_eta", 50, -2.5, 2.5);
+    hMuon_mass = BookTH1D("hMuon_mass", 1000, 0, 1);
+
+    hMET_phi   = BookTH1D("hMET_phi", 72, -M_PI, M_PI);
+    hMET_pT    = BookSparseTH1D("hMET_pT", 4000, 0, 4000);
+    hMET_sumET = BookSparseTH1D("hMET_sumET", 4000, 0, 4000);
+
+    hPFMET_phi   = BookTH1D("hPFMET_phi", 72, -M_PI, M_PI);
+    hPFMET_pT    = BookSparseTH1D("hPFMET_pT", 4000, 0, 4000);
+    hPFMET_sumET = BookSparseTH1D("hPFMET_sumET", 4000, 0, 4000);
+
+    hPFMET_corr_phi   = BookTH1D("hPFMET_corr_phi", 72, -M_PI, M_PI);
+    hPFMET_corr_pT    = BookSparseTH1D("hPFMET_corr_pT", 4000, 0, 4000);
+    hPFMET_corr_sumET = BookSparseTH1D("hPFMET_corr_sumET", 4000, 0, 4000);
 
     // Balance between muon and MET
-    hPt_Mu_over_MET = new TH1D("hPt_Mu_over_MET", "hPt_Mu_over_MET", 100, 0, 5);
-    hPt_Mu_over_MET->Sumw2();
+    hPt_Mu_over_MET = BookTH1D("hPt_Mu_over_MET", 100, 0, 5);
 
     // Reconstructed W histograms
-    hDeltaPhi_Mu_MET = new TH1D("hDeltaPhi_Mu_MET", "hDeltaPhi_Mu_MET", 72, 0., M_PI);
-    hDeltaPhi_Mu_MET->Sumw2();
-    hW_MT            = new TH1D("hW_MT", "hW_MT", 4000, 0, 4000);
-    hW_MT->Sumw2();
+    hDeltaPhi_Mu_MET = BookTH1D("hDeltaPhi_Mu_MET", 72, 0., M_PI);
+    hW_MT            = BookSparseTH1D("hW_MT", 4000, 0, 4000);
 
-    hDeltaPhi_Mu_PFMET = new TH1D("hDeltaPhi_Mu_PFMET", "hDeltaPhi_Mu_PFMET", 72, 0., M_PI);
-    hDeltaPhi_Mu_PFMET->Sumw2();
-    hW_MT_PFMET        = new TH1D("hW_MT_PFMET", "hW_MT_PFMET", 4000, 0, 4000);
-    hW_MT_PFMET->Sumw2();
+    hDeltaPhi_Mu_PFMET = BookTH1D("hDeltaPhi_Mu_PFMET", 72, 0., M_PI);
+    hW_MT_PFMET        = BookSparseTH1D("hW_MT_PFMET", 4000, 0, 4000);
 
-    hDeltaPhi_Mu_PFMET_corr = new TH1D("hDeltaPhi_Mu_PFMET_corr", "hDeltaPhi_Mu_PFMET_corr", 72, 0., M_PI);
-    hDeltaPhi_Mu_PFMET_corr->Sumw2();
-    hW_MT_PFMET_corr        = new TH1D("hW_MT_PFMET_corr", "hW_MT_PFMET_corr", 4000, 0, 4000);
-    hW_MT_PFMET_corr->Sumw2();
+    hDeltaPhi_Mu_PFMET_corr = BookTH1D("hDeltaPhi_Mu_PFMET_corr", 72, 0., M_PI);
+    hW_MT_PFMET_corr        = BookSparseTH1D("hW_MT_PFMET_corr", 4000, 0, 4000);
 
     // For NPV, NPU, NTrueInt before event selection
     // For NTrueInt -> Only present in MC
-    hNPV = new TH1D("hNPV", "hNPV", 100, 0, 100);
-    hNPV->Sumw2();
-    hNPU = new TH1D("hNPU", "hNPU", 100, 0, 100);
-    hNPU->Sumw2();
-    hNTrueInt = new TH1D("hNTrueInt", "hNTrueInt", 100, 0, 100);
-    hNTrueInt->Sumw2();
+    hNPV = BookTH1D("hNPV", 100, 0, 100);
+    hNPU = BookTH1D("hNPU", 100, 0, 100);
+    hNTrueInt = BookTH1D("hNTrueInt", 100, 0, 100);
 
 
     ////////////////////////////////////////////////////////////
@@ -818,140 +1077,105 @@ void DYanalyzer::DeclareHistograms() {
     ////////////////////////////////////////////////////////////
 
     // GenLevel Object histograms    
-    hGen_Muon_pT_after = new TH1D("hGen_Muon_pT_after", "hGen_Muon_pT_after", 4000, 0, 4000);
-    hGen_Muon_pT_after->Sumw2();
-    hGen_Muon_phi_after = new TH1D("hGen_Muon_phi_after", "hGen_Muon_phi_after", 72, -M_PI, M_PI);
-    hGen_Muon_phi_after->Sumw2();
-    hGen_Muon_eta_after = new TH1D("hGen_Muon_eta_after", "hGen_Muon_eta_after", 50, -2.5, 2.5);
-    hGen_Muon_eta_after->Sumw2();
-
-    hGen_Nu_pT_after = new TH1D("hGen_Nu_pT_after", "hGen_Nu_pT_after", 4000, 0, 4000);
-    hGen_Nu_pT_after->Sumw2();
-    hGen_Nu_phi_after = new TH1D("hGen_Nu_phi_after", "hGen_Nu_phi_after", 72, -M_PI, M_PI);
-    hGen_Nu_phi_after->Sumw2();
-    hGen_Nu_eta_after = new TH1D("hGen_Nu_eta_after", "hGen_Nu_eta_after", 50, -2.5, 2.5);
-    hGen_Nu_eta_after->Sumw2();
-
-    hGen_MET_phi_after   = new TH1D("hGen_MET_phi_after", "hGen_MET_phi_after", 72, -M_PI, M_PI);
-    hGen_MET_phi_after->Sumw2();
-    hGen_MET_pT_after    = new TH1D("hGen_MET_pT_after", "hGen_MET_pT_after", 4000, 0, 4000);
-    hGen_MET_pT_after->Sumw2();
+    hGen_Muon_pT_after = BookSparseTH1D("hGen_Muon_pT_after", 4000, 0, 4000);
+    hGen_Muon_phi_after = BookTH1D("hGen_Muon_phi_after", 72, -M_PI, M_PI);
+    hGen_Muon_eta_after = BookTH1D("hGen_Muon_eta_after", 50, -2.5, 2.5);
+
+    hGen_Nu_pT_after = BookSparseTH1D("hGen_Nu_pT_after", 4000, 0, 4000);
+    hGen_Nu_phi_after = BookTH1D("hGen_Nu_phi_after", 72, -M_PI, M_PI);
+    hGen_Nu_eta_after = BookTH1D("hGen_Nu_eta_after", 50, -2.5, 2.5);
+
+    hGen_MET_phi_after   = BookTH1D("hGen_MET_phi_after", 72, -M_PI, M_PI);
+    hGen_MET_pT_after    = BookSparseTH1D("hGen_MET_pT_after", 4000, 0, 4000);
     
     // For GenLevel W decaying to muon and neutrino
-    hGen_WToMuNu_pT_after    = new TH1D("hGen_WToMuNu_pT_after", "hGen_WToMuNu_pT_after", 4000, 0, 4000);
-    hGen_WToMuNu_pT_after->Sumw2();
-    hGen_WToMuNu_eta_after   = new TH1D("hGen_WToMuNu_eta_after", "hGen_WToMuNu_eta_after", 50, -2.5, 2.5);
-    hGen_WToMuNu_eta_after->Sumw2();
-    hGen_WToMuNu_phi_after   = new TH1D("hGen_WToMuNu_phi_after", "hGen_WToMuNu_phi_after", 72, -M_PI, M_PI);
-    hGen_WToMuNu_phi_after->Sumw2();
-    hGen_WToMuNu_mass_after  = new TH1D("hGen_WToMuNu_mass_after", "hGen_WToMuNu_mass_after", 4000, 0, 4000);
-    hGen_WToMuNu_mass_after->Sumw2();
-    hGen_WToMuNu_MT_after    = new TH1D("hGen_WToMuNu_MT_after", "hGen_WToMuNu_MT_after", 4000, 0, 4000);
-    hGen_WToMuNu_MT_after->Sumw2();
+    hGen_WToMuNu_pT_after    = BookSparseTH1D("hGen_WToMuNu_pT_after", 4000, 0, 4000);
+    hGen_WToMuNu_eta_after   = BookTH1D("hGen_WToMuNu_eta_after", 50, -2.5, 2.5);
+    hGen_WToMuNu_phi_after   = BookTH1D("hGen_WToMuNu_phi_after", 72, -M_PI, M_PI);
+    hGen_WToMuNu_mass_after  = BookSparseTH1D("hGen_WToMuNu_mass_after", 4000, 0, 4000);
+    hGen_WToMuNu_MT_after    = BookSparseTH1D("hGen_WToMuNu_MT_after", 4000, 0, 4000);
 
     // For GenLevel inclusive decaying W
-    hGen_W_pT_after    = new TH1D("hGen_W_pT_after", "hGen_W_pT_after", 4000, 0, 4000);
-    hGen_W_pT_after->Sumw2();
-    hGen_W_eta_after   = new TH1D("hGen_W_eta_after", "hGen_W_eta_after", 50, -2.5, 2.5);
-    hGen_W_eta_after->Sumw2();
-    hGen_W_phi_after   = new TH1D("hGen_W_phi_after", "hGen_W_phi_after", 72, -M_PI, M_PI);
-    hGen_W_phi_after->Sumw2();
-    hGen_W_mass_after  = new TH1D("hGen_W_mass_after", "hGen_W_mass_after", 4000, 0, 4000);
-    hGen_W_mass_after->Sumw2();
-    hGen_W_MT_after    = new TH1D("hGen_W_MT_after", "hGen_W_MT_after", 4000, 0, 4000);
-    hGen_W_MT_after->Sumw2();
+    hGen_W_pT_after    = BookSparseTH1D("hGen_W_pT_after", 4000, 0, 4000);
+    hGen_W_eta_after   = BookTH1D("hGen_W_eta_after", 50, -2.5, 2.5);
+    hGen_W_phi_after   = BookTH1D("hGen_W_phi_after", 72, -M_PI, M_PI);
+    hGen_W_mass_after  = BookSparseTH1D("hGen_W_mass_after", 4000, 0, 4000);
+    hGen_W_MT_after    = BookSparseTH1D("hGen_W_MT_after", 4000, 0, 4000);
     
     // For LHE HT
-    hLHE_HT_after = new TH1D("hLHE_HT_after", "hLHE_HT_after", 4000, 0, 4000);
-    hLHE_HT_after->Sumw2();
+    hLHE_HT_after = BookSparseTH1D("hLHE_HT_after", 4000, 0, 4000);
 
     // Object histograms
-    hMuon_pT_after  = new TH1D("hMuon_pT_after", "hMuon_pT_after", 4000, 0, 4000);
-    hMuon_pT_after->Sumw2();
-    hMuon_pT_after_40GeVBin  = new TH1D("hMuon_pT_after_40GeVBin", "hMuon_pT_after_40GeVBin", 100, 0, 4000);
-    hMuon_pT_after_40GeVBin->Sumw2();
-    hMuon_pT_after_80GeVBin  = new TH1D("hMuon_pT_after_80GeVBin", "hMuon_pT_after_80GeVBin", 50, 0, 4000);
-    hMuon_pT_after_80GeVBin->Sumw2();
-    hMuon_phi_after = new TH1D("hMuon_phi_after", "hMuon_phi_after", 72, -M_PI, M_PI);
-    hMuon_phi_after->Sumw2();
-    hMuon_eta_after = new TH1D("hMuon_eta_after", "hMuon_eta_after", 50, -2.5, 2.5);
-    hMuon_eta_after->Sumw2();
-    hMuon_mass_after = new TH1D("hMuon_mass_after", "hMuon_mass_after", 1000, 0, 1);
-    hMuon_mass_after->Sumw2();
-
-    hMET_phi_after   = new TH1D("hMET_phi_after", "hMET_phi_after", 72, -M_PI, M_PI);
-    hMET_phi_after->Sumw2();
-    hMET_pT_after    = new TH1D("hMET_pT_after", "hMET_pT_after", 4000, 0, 4000);
-    hMET_pT_after->Sumw2();
-    hMET_pT_after_40GeVBin  = new TH1D("hMET_pT_after_40GeVBin", "hMET_pT_after_40GeVBin", 100, 0, 4000);
-    hMET_pT_after_40GeVBin->Sumw2();
-    hMET_pT_after_80GeVBin  = new TH1D("hMET_pT_after_80GeVBin", "hMET_pT_after_80GeVBin", 50, 0, 4000);
-    hMET_pT_after_80GeVBin->Sumw2();
-    hMET_sumET_after = new TH1D("hMET_sumET_after", "hMET_sumET_after", 4000, 0, 4000);
-    hMET_sumET_after->Sumw2();
+    hMuon_pT_after  = BookSparseTH1D("hMuon_pT_after", 4000, 0, 4000);
+    hMuon_pT_after_40GeVBin  = BookTH1D("hMuon_pT_after_40GeVBin", 100, 0, 4000);
+    hMuon_pT_after_80GeVBin  = BookTH1D("hMuon_pT_after_80GeVBin", 50, 0, 4000);
+    hMuon_phi_after = BookTH1D("hMuon_phi_after", 72, -M_PI, M_PI);
+    hMuon_eta_after = BookTH1D("hMuon_eta_after", 50, -2.5, 2.5);
+    hMuon_mass_after = BookTH1D("hMuon_mass_after", 1000, 0, 1);
+
+    hMET_phi_after   = BookTH1D("hMET_phi_after", 72, -M_PI, M_PI);
+    hMET_pT_after    = BookSparseTH1D("hMET_pT_after", 4000, 0, 4000);
+    hMET_pT_after_40GeVBin  = BookTH1D("hMET_pT_after_40GeVBin", 100, 0, 4000);
+    hMET_pT_after_80GeVBin  = BookTH1D("hMET_pT_after_80GeVBin", 50, 0, 4000);
+    hMET_sumET_after = BookSparseTH1D("hMET_sumET_after", 4000, 0, 4000);
     
-    hPFMET_phi_after   = new TH1D("hPFMET_phi_after", "hPFMET_phi_after", 72, -M_PI, M_PI);
-    hPFMET_phi_after->Sumw2();
-    hPFMET_pT_after    = new TH1D("hPFMET_pT_after", "hPFMET_pT_after", 4000, 0, 4000);
-    hPFMET_pT_after->Sumw2();
-    hPFMET_pT_after_40GeVBin  = new TH1D("hPFMET_pT_after_40GeVBin", "hPFMET_pT_after_40GeVBin", 100, 0, 4000);
-    hPFMET_pT_after_40GeVBin->Sumw2();
-    hPFMET_pT_after_80GeVBin  = new TH1D("hPFMET_pT_after_80GeVBin", "hPFMET_pT_after_80GeVBin", 50, 0, 4000);
-    hPFMET_pT_after_80GeVBin->Sumw2();
-    hPFMET_sumET_after = new TH1D("hPFMET_sumET_after", "hPFMET_sumET_after", 4000, 0, 4000);
-    hPFMET_sumET_after->Sumw2();
-
-    hPFMET_corr_phi_after   = new TH1D("hPFMET_corr_phi_after", "hPFMET_corr_phi_after", 72, -M_PI, M_PI);
-    hPFMET_corr_phi_after->Sumw2();
-    hPFMET_corr_pT_after    = new TH1D("hPFMET_corr_pT_after", "hPFMET_corr_pT_after", 4000, 0, 4000);
-    hPFMET_corr_pT_after->Sumw2();
-    hPFMET_corr_pT_after_40GeVBin  = new TH1D("hPFMET_corr_pT_after_40GeVBin", "hPFMET_corr_pT_after_40GeVBin", 100, 0, 4000);
-    hPFMET_corr_pT_after_40GeVBin->Sumw2();
-    hPFMET_corr_pT_after_80GeVBin  = new TH1D("hPFMET_corr_pT_after_80GeVBin", "hPFMET_corr_pT_after_80GeVBin", 50, 0, 4000);
-    hPFMET_corr_pT_after_80GeVBin->Sumw2();
-    hPFMET_corr_sumET_after = new TH1D("hPFMET_corr_sumET_after", "hPFMET_corr_sumET_after", 4000, 0, 4000);
-    hPFMET_corr_sumET_after->Sumw2();
+    hPFMET_phi_after   = BookTH1D("hPFMET_phi_after", 72, -M_PI, M_PI);
+    hPFMET_pT_after    = BookSparseTH1D("hPFMET_pT_after", 4000, 0, 4000);
+    hPFMET_pT_after_40GeVBin  = BookTH1D("hPFMET_pT_after_40GeVBin", 100, 0, 4000);
+    hPFMET_pT_after_80GeVBin  = BookTH1D("hPFMET_pT_after_80GeVBin", 50, 0, 4000);
+    hPFMET_sumET_after = BookSparseTH1D("hPFMET_sumET_after", 4000, 0, 4000);
+
+    hPFMET_corr_phi_after   = BookTH1D("hPFMET_corr_phi_after", 72, -M_PI, M_PI);
+    hPFMET_corr_pT_after    = BookSparseTH1D("hPFMET_corr_pT_after", 4000, 0, 4000);
+    hPFMET_corr_pT_after_40GeVBin  = BookTH1D("hPFMET_corr_pT_after_40GeVBin", 100, 0, 4000);
+    hPFMET_corr_pT_after_80GeVBin  = BookTH1D("hPFMET_corr_pT_after_80GeVBin", 50, 0, 4000);
+    hPFMET_corr_sumET_after = BookSparseTH1D("hPFMET_corr_sumET_after", 4000, 0, 4000);
 
     // Balance between muon and MET
-    hPt_Mu_over_MET_after = new TH1D("hPt_Mu_over_MET_after", "hPt_Mu_over_MET_after", 100, 0, 5);
-    hPt_Mu_over_MET_after->Sumw2();
+    hPt_Mu_over_MET_after = BookTH1D("hPt_Mu_over_MET_after", 100, 0, 5);
 
     // Reconstructed W histograms
-    hDeltaPhi_Mu_MET_after = new TH1D("hDeltaPhi_Mu_MET_after", "hDeltaPhi_Mu_MET_after", 72, 0., M_PI);
-    hDeltaPhi_Mu_MET_after->Sumw2();
-    hW_MT_after            = new TH1D("hW_MT_after", "hW_MT_after", 4000, 0, 4000);
-    hW_MT_after->Sumw2();
-    hW_MT_after_40GeVBin  = new TH1D("hW_MT_after_40GeVBin", "hW_MT_after_40GeVBin", 100, 0, 4000);
-    hW_MT_after_40GeVBin->Sumw2();
-    hW_MT_after_80GeVBin  = new TH1D("hW_MT_after_80GeVBin", "hW_MT_after_80GeVBin", 50, 0, 4000);
-    hW_MT_after_80GeVBin->Sumw2();
-
-    hDeltaPhi_Mu_PFMET_after = new TH1D("hDeltaPhi_Mu_PFMET_after", "hDeltaPhi_Mu_PFMET_after", 72, 0., M_PI);
-    hDeltaPhi_Mu_PFMET_after->Sumw2();
-    hW_MT_PFMET_after        = new TH1D("hW_MT_PFMET_after", "hW_MT_PFMET_after", 4000, 0, 4000);
-    hW_MT_PFMET_after->Sumw2();
-    hW_MT_PFMET_after_40GeVBin  = new TH1D("hW_MT_PFMET_after_40GeVBin", "hW_MT_PFMET_after_40GeVBin", 100, 0, 4000);
-    hW_MT_PFMET_after_40GeVBin->Sumw2();
-    hW_MT_PFMET_after_80GeVBin  = new TH1D("hW_MT_PFMET_after_80GeVBin", "hW_MT_PFMET_after_80GeVBin", 50, 0, 4000);
-    hW_MT_PFMET_after_80GeVBin->Sumw2();
-
-    hDeltaPhi_Mu_PFMET_corr_after = new TH1D("hDeltaPhi_Mu_PFMET_corr_after", "hDeltaPhi_Mu_PFMET_corr_after", 72, 0., M_PI);
-    hDeltaPhi_Mu_PFMET_corr_after->Sumw2();
-    hW_MT_PFMET_corr_after        = new TH1D("hW_MT_PFMET_corr_after", "hW_MT_PFMET_corr_after", 4000, 0, 4000);
-    hW_MT_PFMET_corr_after->Sumw2();
-    hW_MT_PFMET_corr_after_40GeVBin  = new TH1D("hW_MT_PFMET_corr_after_40GeVBin", "hW_MT_PFMET_corr_after_40GeVBin", 100, 0, 4000);
-    hW_MT_PFMET_corr_after_40GeVBin->Sumw2();
-    hW_MT_PFMET_corr_after_80GeVBin  = new TH1D("hW_MT_PFMET_corr_after_80GeVBin", "hW_MT_PFMET_corr_after_80GeVBin", 50, 0, 4000);
-    hW_MT_PFMET_corr_after_80GeVBin->Sumw2();
+    hDeltaPhi_Mu_MET_after = BookTH1D("hDeltaPhi_Mu_MET_after", 72, 0., M_PI);
+    hW_MT_after            = BookSparseTH1D("hW_MT_after", 4000, 0, 4000);
+    if (bPUVariations) {
+        hW_MT_after_PUUp   = BookSparseTH1D("hW_MT_after_PUUp", 4000, 0, 4000);
+        hW_MT_after_PUDown = BookSparseTH1D("hW_MT_after_PUDown", 4000, 0, 4000);
+    }
+    hW_MT_after_40GeVBin  = BookTH1D("hW_MT_after_40GeVBin", 100, 0, 4000);
+    hW_MT_after_80GeVBin  = BookTH1D("hW_MT_after_80GeVBin", 50, 0, 4000);
+
+    hDeltaPhi_Mu_PFMET_after = BookTH1D("hDeltaPhi_Mu_PFMET_after", 72, 0., M_PI);
+    hW_MT_PFMET_after        = BookSparseTH1D("hW_MT_PFMET_after", 4000, 0, 4000);
+    if (bPUVariations) {
+        hW_MT_PFMET_after_PUUp   = BookSparseTH1D("hW_MT_PFMET_after_PUUp", 4000, 0, 4000);
+        hW_MT_PFMET_after_PUDown = BookSparseTH1D("hW_MT_PFMET_after_PUDown", 4000, 0, 4000);
+    }
+    hW_MT_PFMET_after_40GeVBin  = BookTH1D("hW_MT_PFMET_after_40GeVBin", 100, 0, 4000);
+    hW_MT_PFMET_after_80GeVBin  = BookTH1D("hW_MT_PFMET_after_80GeVBin", 50, 0, 4000);
+
+    hDeltaPhi_Mu_PFMET_corr_after = BookTH1D("hDeltaPhi_Mu_PFMET_corr_after", 72, 0., M_PI);
+    hW_MT_PFMET_corr_after        = BookSparseTH1D("hW_MT_PFMET_corr_after", 4000, 0, 4000);
+    if (bPUVariations) {
+        hW_MT_PFMET_corr_after_PUUp   = BookSparseTH1D("hW_MT_PFMET_corr_after_PUUp", 4000, 0, 4000);
+        hW_MT_PFMET_corr_after_PUDown = BookSparseTH1D("hW_MT_PFMET_corr_after_PUDown", 4000, 0, 4000);
+    }
+    hW_MT_PFMET_corr_after_40GeVBin  = BookTH1D("hW_MT_PFMET_corr_after_40GeVBin", 100, 0, 4000);
+    hW_MT_PFMET_corr_after_80GeVBin  = BookTH1D("hW_MT_PFMET_corr_after_80GeVBin", 50, 0, 4000);
+
+    // Rochester correction replicas (Y-axis : replica index, see RoccoR::replicaIndex())
+    // Bins of 10 GeV, which can be rebinned to the 40 and 80 GeV bins : ~0.7 MB per histogram for the ~100 replicas, 10 times less than with 1 GeV bins
+    if (bRoccoReplicas) {
+        Int_t nReplicas = vRoccoReplicaSF.size();
+        hMuon_pT_after_RoccoReplica = BookTH2D("hMuon_pT_after_RoccoReplica", 400, 0, 4000, nReplicas, 0, nReplicas);
+        hW_MT_after_RoccoReplica = BookTH2D("hW_MT_after_RoccoReplica", 400, 0, 4000, nReplicas, 0, nReplicas);
+        hW_MT_PFMET_corr_after_RoccoReplica = BookTH2D("hW_MT_PFMET_corr_after_RoccoReplica", 400, 0, 4000, nReplicas, 0, nReplicas);
+    }
 
     // For NPV, NPU, NTrueInt before event selection
     // For NTrueInt -> Only present in MC
-    hNPV_after = new TH1D("hNPV_after", "hNPV_after", 100, 0, 100);
-    hNPV_after->Sumw2();
-    hNPU_after = new TH1D("hNPU_after", "hNPU_after", 100, 0, 100);
-    hNPU_after->Sumw2();
-    hNTrueInt_after = new TH1D("hNTrueInt_after", "hNTrueInt_after", 100, 0, 100);
-    hNTrueInt_after->Sumw2();
+    hNPV_after = BookTH1D("hNPV_after", 100, 0, 100);
+    hNPU_after = BookTH1D("hNPU_after", 100, 0, 100);
+    hNTrueInt_after = BookTH1D("hNTrueInt_after", 100, 0, 100);
 
 
     ////////////////////////////////////////////////////////////
@@ -959,480 +1183,395 @@ void DYanalyzer::DeclareHistograms() {
     ////////////////////////////////////////////////////////////
 
     // Object histograms
-    hMuon_pT_after_Wmass50  = new TH1D("hMuon_pT_after_Wmass50", "hMuon_pT_after_Wmass50", 4000, 0, 4000);
-    hMuon_pT_after_Wmass50->Sumw2();
-    hMuon_pT_after_Wmass50_40GeVBin  = new TH1D("hMuon_pT_after_Wmass50_40GeVBin", "hMuon_pT_after_Wmass50_40GeVBin", 100, 0, 4000);
-    hMuon_pT_after_Wmass50_40GeVBin->Sumw2();
-    hMuon_pT_after_Wmass50_80GeVBin  = new TH1D("hMuon_pT_after_Wmass50_80GeVBin", "hMuon_pT_after_Wmass50_80GeVBin", 50, 0, 4000);
-    hMuon_pT_after_Wmass50_80GeVBin->Sumw2();
-    hMuon_phi_after_Wmass50 = new TH1D("hMuon_phi_after_Wmass50", "hMuon_phi_after_Wmass50", 72, -M_PI, M_PI);
-    hMuon_phi_after_Wmass50->Sumw2();
-    hMuon_eta_after_Wmass50 = new TH1D("hMuon_eta_after_Wmass50", "hMuon_eta_after_Wmass50", 50, -2.5, 2.5);
-    hMuon_eta_after_Wmass50->Sumw2();
-    hMuon_mass_after_Wmass50 = new TH1D("hMuon_mass_after_Wmass50", "hMuon_mass_after_Wmass50", 1000, 0, 1);
-    hMuon_mass_after_Wmass50->Sumw2();
-
-    hMET_phi_after_Wmass50   = new TH1D("hMET_phi_after_Wmass50", "hMET_phi_after_Wmass50", 72, -M_PI, M_PI);
-    hMET_phi_after_Wmass50->Sumw2();
-    hMET_pT_after_Wmass50    = new TH1D("hMET_pT_after_Wmass50", "hMET_pT_after_Wmass50", 4000, 0, 4000);
-    hMET_pT_after_Wmass50->Sumw2();
-    hMET_pT_after_Wmass50_40GeVBin  = new TH1D("hMET_pT_after_Wmass50_40GeVBin", "hMET_pT_after_Wmass50_40GeVBin", 100, 0, 4000);
-    hMET_pT_after_Wmass50_40GeVBin->Sumw2();
-    hMET_pT_after_Wmass50_80GeVBin  = new TH1D("hMET_pT_after_Wmass50_80GeVBin", "hMET_pT_after_Wmass50_80GeVBin", 50, 0, 4000);
-    hMET_pT_after_Wmass50_80GeVBin->Sumw2();
-    hMET_sumET_after_Wmass50 = new TH1D("hMET_sumET_after_Wmass50", "hMET_sumET_after_Wmass50", 4000, 0, 4000);
-    hMET_sumET_after_Wmass50->Sumw2();
+    hMuon_pT_after_Wmass50  = BookSparseTH1D("hMuon_pT_after_Wmass50", 4000, 0, 4000);
+    hMuon_pT_after_Wmass50_40GeVBin  = BookTH1D("hMuon_pT_after_Wmass50_40GeVBin", 100, 0, 4000);
+    hMuon_pT_after_Wmass50_80GeVBin  = BookTH1D("hMuon_pT_after_Wmass50_80GeVBin", 50, 0, 4000);
+    hMuon_phi_after_Wmass50 = BookTH1D("hMuon_phi_after_Wmass50", 72, -M_PI, M_PI);
+    hMuon_eta_after_Wmass50 = BookTH1D("hMuon_eta_after_Wmass50", 50, -2.5, 2.5);
+    hMuon_mass_after_Wmass50 = BookTH1D("hMuon_mass_after_Wmass50", 1000, 0, 1);
+
+    hMET_phi_after_Wmass50   = BookTH1D("hMET_phi_after_Wmass50", 72, -M_PI, M_PI);
+    hMET_pT_after_Wmass50    = BookSparseTH1D("hMET_pT_after_Wmass50", 4000, 0, 4000);
+    hMET_pT_after_Wmass50_40GeVBin  = BookTH1D("hMET_pT_after_Wmass50_40GeVBin", 100, 0, 4000);
+    hMET_pT_after_Wmass50_80GeVBin  = BookTH1D("hMET_pT_after_Wmass50_80GeVBin", 50, 0, 4000);
+    hMET_sumET_after_Wmass50 = BookSparseTH1D("hMET_sumET_after_Wmass50", 4000, 0, 4000);
     
-    hPFMET_phi_after_Wmass50   = new TH1D("hPFMET_phi_after_Wmass50", "hPFMET_phi_after_Wmass50", 72, -M_PI, M_PI);
-    hPFMET_phi_after_Wmass50->Sumw2();
-    hPFMET_pT_after_Wmass50    = new TH1D("hPFMET_pT_after_Wmass50", "hPFMET_pT_after_Wmass50", 4000, 0, 4000);
-    hPFMET_pT_after_Wmass50->Sumw2();
-    hPFMET_pT_after_Wmass50_40GeVBin  = new TH1D("hPFMET_pT_after_Wmass50_40GeVBin", "hPFMET_pT_after_Wmass50_40GeVBin", 100, 0, 4000);
-    hPFMET_pT_after_Wmass50_40GeVBin->Sumw2();
-    hPFMET_pT_after_Wmass50_80GeVBin  = new TH1D("hPFMET_pT_after_Wmass50_80GeVBin", "hPFMET_pT_after_Wmass50_80GeVBin", 50, 0, 4000);
-    hPFMET_pT_after_Wmass50_80GeVBin->Sumw2();
-    hPFMET_sumET_after_Wmass50 = new TH1D("hPFMET_sumET_after_Wmass50", "hPFMET_sumET_after_Wmass50", 4000, 0, 4000);
-    hPFMET_sumET_after_Wmass50->Sumw2();
-
-    hPFMET_corr_phi_after_Wmass50   = new TH1D("hPFMET_corr_phi_after_Wmass50", "hPFMET_corr_phi_after_Wmass50", 72, -M_PI, M_PI);
-    hPFMET_corr_phi_after_Wmass50->Sumw2();
-    hPFMET_corr_pT_after_Wmass50    = new TH1D("hPFMET_corr_pT_after_Wmass50", "hPFMET_corr_pT_after_Wmass50", 4000, 0, 4000);
-    hPFMET_corr_pT_after_Wmass50->Sumw2();
-    hPFMET_corr_pT_after_Wmass50_40GeVBin  = new TH1D("hPFMET_corr_pT_after_Wmass50_40GeVBin", "hPFMET_corr_pT_after_Wmass50_40GeVBin", 100, 0, 4000);
-    hPFMET_corr_pT_after_Wmass50_40GeVBin->Sumw2();
-    hPFMET_corr_pT_after_Wmass50_80GeVBin  = new TH1D("hPFMET_corr_pT_after_Wmass50_80GeVBin", "hPFMET_corr_pT_after_Wmass50_80GeVBin", 50, 0, 4000);
-    hPFMET_corr_pT_after_Wmass50_80GeVBin->Sumw2();
-    hPFMET_corr_sumET_after_Wmass50 = new TH1D("hPFMET_corr_sumET_after_Wmass50", "hPFMET_corr_sumET_after_Wmass50", 4000, 0, 4000);
-    hPFMET_corr_sumET_after_Wmass50->Sumw2();
+    hPFMET_phi_after_Wmass50   = BookTH1D("hPFMET_phi_after_Wmass50", 72, -M_PI, M_PI);
+    hPFMET_pT_after_Wmass50    = BookSparseTH1D("hPFMET_pT_after_Wmass50", 4000, 0, 4000);
+    hPFMET_pT_after_Wmass50_40GeVBin  = BookTH1D("hPFMET_pT_after_Wmass50_40GeVBin", 100, 0, 4000);
+    hPFMET_pT_after_Wmass50_80GeVBin  = BookTH1D("hPFMET_pT_after_Wmass50_80GeVBin", 50, 0, 4000);
+    hPFMET_sumET_after_Wmass50 = BookSparseTH1D("hPFMET_sumET_after_Wmass50", 4000, 0, 4000);
+
+    hPFMET_corr_phi_after_Wmass50   = BookTH1D("hPFMET_corr_phi_after_Wmass50", 72, -M_PI, M_PI);
+    hPFMET_corr_pT_after_Wmass50    = BookSparseTH1D("hPFMET_corr_pT_after_Wmass50", 4000, 0, 4000);
+    hPFMET_corr_pT_after_Wmass50_40GeVBin  = BookTH1D("hPFMET_corr_pT_after_Wmass50_40GeVBin", 100, 0, 4000);
+    hPFMET_corr_pT_after_Wmass50_80GeVBin  = BookTH1D("hPFMET_corr_pT_after_Wmass50_80GeVBin", 50, 0, 4000);
+    hPFMET_corr_sumET_after_Wmass50 = BookSparseTH1D("hPFMET_corr_sumET_after_Wmass50", 4000, 0, 4000);
 
     // Balance between muon and MET
-    hPt_Mu_over_MET_after_Wmass50 = new TH1D("hPt_Mu_over_MET_after_Wmass50", "hPt_Mu_over_MET_after_Wmass50", 100, 0, 5);
-    hPt_Mu_over_MET_after_Wmass50->Sumw2();
+    hPt_Mu_over_MET_after_Wmass50 = BookTH1D("hPt_Mu_over_MET_after_Wmass50", 100, 0, 5);
 
     // Reconstructed W histograms
-    hDeltaPhi_Mu_MET_after_Wmass50 = new TH1D("hDeltaPhi_Mu_MET_after_Wmass50", "hDeltaPhi_Mu_MET_after_Wmass50", 72, 0., M_PI);
-    hDeltaPhi_Mu_MET_after_Wmass50->Sumw2();
-    hW_MT_after_Wmass50            = new TH1D("hW_MT_after_Wmass50", "hW_MT_after_Wmass50", 4000, 0, 4000);
-    hW_MT_after_Wmass50->Sumw2();
-    hW_MT_after_Wmass50_40GeVBin  = new TH1D("hW_MT_after_Wmass50_40GeVBin", "hW_MT_after_Wmass50_40GeVBin", 100, 0, 4000);
-    hW_MT_after_Wmass50_40GeVBin->Sumw2();
-    hW_MT_after_Wmass50_80GeVBin  = new TH1D("hW_MT_after_Wmass50_80GeVBin", "hW_MT_after_Wmass50_80GeVBin", 50, 0, 4000);
-    hW_MT_after_Wmass50_80GeVBin->Sumw2();
-
-    hDeltaPhi_Mu_PFMET_after_Wmass50 = new TH1D("hDeltaPhi_Mu_PFMET_after_Wmass50", "hDeltaPhi_Mu_PFMET_after_Wmass50", 72, 0., M_PI);
-    hDeltaPhi_Mu_PFMET_after_Wmass50->Sumw2();
-    hW_MT_PFMET_after_Wmass50        = new TH1D("hW_MT_PFMET_after_Wmass50", "hW_MT_PFMET_after_Wmass50", 4000, 0, 4000);
-    hW_MT_PFMET_after_Wmass50->Sumw2();
-    hW_MT_PFMET_after_Wmass50_40GeVBin  = new TH1D("hW_MT_PFMET_after_Wmass50_40GeVBin", "hW_MT_PFMET_after_Wmass50_40GeVBin", 100, 0, 4000);
-    hW_MT_PFMET_after_Wmass50_40GeVBin->Sumw2();
-    hW_MT_PFMET_after_Wmass50_80GeVBin  = new TH1D("hW_MT_PFMET_after_Wmass50_80GeVBin", "hW_MT_PFMET_after_Wmass50_80GeVBin", 50, 0, 4000);
-    hW_MT_PFMET_after_Wmass50_80GeVBin->Sumw2();
-
-    hDeltaPhi_Mu_PFMET_corr_after_Wmass50 = new TH1D("hDeltaPhi_Mu_PFMET_corr_after_Wmass50", "hDeltaPhi_Mu_PFMET_corr_after_Wmass50", 72, 0., M_PI);
-    hDeltaPhi_Mu_PFMET_corr_after_Wmass50->Sumw2();
-    hW_MT_PFMET_corr_after_Wmass50        = new TH1D("hW_MT_PFMET_corr_after_Wmass50", "hW_MT_PFMET_corr_after_Wmass50", 4000, 0, 4000);
-    hW_MT_PFMET_corr_after_Wmass50->Sumw2();
-    hW_MT_PFMET_corr_after_Wmass50_40GeVBin  = new TH1D("hW_MT_PFMET_corr_after_Wmass50_40GeVBin", "hW_MT_PFMET_corr_after_Wmass50_40GeVBin", 100, 0, 4000);
-    hW_MT_PFMET_corr_after_Wmass50_40GeVBin->Sumw2();
-    hW_MT_PFMET_corr_after_Wmass50_80GeVBin  = new TH1D("hW_MT_PFMET_corr_after_Wmass50_80GeVBin", "hW_MT_PFMET_corr_after_Wmass50_80GeVBin", 50, 0, 4000);
-    hW_MT_PFMET_corr_after_Wmass50_80GeVBin->Sumw2();
-
-    // For NPV, NPU, NTrueInt before event selection
-    // For NTrueInt -> Only present in MC
-    hNPV_after_Wmass50 = new TH1D("hNPV_after_Wmass50", "hNPV_after_Wmass50", 100, 0, 100);
-    hNPV_after_Wmass50->Sumw2();
-    hNPU_after_Wmass50 = new TH1D("hNPU_after_Wmass50", "hNPU_after_Wmass50", 100, 0, 100);
-    hNPU_after_Wmass50->Sumw2();
-    hNTrueInt_after_Wmass50 = new TH1D("hNTrueInt_after_Wmass50", "hNTrueInt_after_Wmass50", 100, 0, 100);
-    hNTrueInt_after_Wmass50->Sumw2();
+    hDeltaPhi_Mu_MET_after_Wmass50 = BookTH1D("hDeltaPhi_Mu_MET_after_Wmass50", 72, 0., M_PI);
+    hW_MT_after_Wmass50            = BookSparseTH1D("hW_MT_after_Wmass50", 4000, 0, 4000);
+    hW_MT_after_Wmass50_40GeVBin  = BookTH1D("hW_MT_after_Wmass50_40GeVBin", 100, 0, 4000);
+    hW_MT_after_Wmass50_80GeVBin  = BookTH1D("hW_MT_after_Wmass50_80GeVBin", 50, 0, 4000);
 
-    ////////////////////////////////////////////////////////////
-    // After event selection (W mass > 200 GeV cut)
-    ////////////////////////////////////////////////////////////
+    hDeltaPhi_Mu_PFMET_after_Wmass50 = BookTH1D("hDeltaPhi_Mu_PFMET_after_Wmass50", 72, 0., M_PI);
+    hW_MT_PFMET_after_Wmass50        = BookSparseTH1D("hW_MT_PFMET_after_Wmass50", 4000, 0, 4000);
+    hW_MT_PFMET_after_Wmass50_40GeVBin  = BookTH1D("hW_MT_PFMET_after_Wmass50_40GeVBin", 100, 0, 4000);
+    hW_MT_PFMET_after_Wmass50_80GeVBin  = BookTH1D("hW_MT_PFMET_after_Wmass50_80GeVBin", 50, 0, 4000);
 
-    // Object histograms
-    hMuon_pT_after_Wmass200  = new TH1D("hMuon_pT_after_Wmass200", "hMuon_pT_after_Wmass200", 4000, 0, 4000);
-    hMuon_pT_after_Wmass200->Sumw2();
-    hMuon_pT_after_Wmass200_40GeVBin  = new TH1D("hMuon_pT_after_Wmass200_40GeVBin", "hMuon_pT_after_Wmass200_40GeVBin", 100, 0, 4000);
-    hMuon_pT_after_Wmass200_40GeVBin->Sumw2();
-    hMuon_pT_after_Wmass200_80GeVBin  = new TH1D("hMuon_pT_after_Wmass200_80GeVBin", "hMuon_pT_after_Wmass200_80GeVBin", 50, 0, 4000);
-    hMuon_pT_after_Wmass200_80GeVBin->Sumw2();
-    hMuon_phi_after_Wmass200 = new TH1D("hMuon_phi_after_Wmass200", "hMuon_phi_after_Wmass200", 72, -M_PI, M_PI);
-    hMuon_phi_after_Wmass200->Sumw2();
-    hMuon_eta_after_Wmass200 = new TH1D("hMuon_eta_after_Wmass200", "hMuon_eta_after_Wmass200", 50, -2.5, 2.5);
-    hMuon_eta_after_Wmass200->Sumw2();
-    hMuon_mass_after_Wmass200 = new TH1D("hMuon_mass_after_Wmass200", "hMuon_mass_after_Wmass200", 1000, 0, 1);
-    hMuon_mass_after_Wmass200->Sumw2();
-
-    hMET_phi_after_Wmass200   = new TH1D("hMET_phi_after_Wmass200", "hMET_phi_after_Wmass200", 72, -M_PI, M_PI);
-    hMET_phi_after_Wmass200->Sumw2();
-    hMET_pT_after_Wmass200    = new TH1D("hMET_pT_after_Wmass200", "hMET_pT_after_Wmass200", 4000, 0, 4000);
-    hMET_pT_after_Wmass200->Sumw2();
-    hMET_pT_after_Wmass200_40GeVBin  = new TH1D("hMET_pT_after_Wmass200_40GeVBin", "hMET_pT_after_Wmass200_40GeVBin", 100, 0, 4000);
-    hMET_pT_after_Wmass200_40GeVBin->Sumw2();
-    hMET_pT_after_Wmass200_80GeVBin  = new TH1D("hMET_pT_after_Wmass200_80GeVBin", "hMET_pT_after_Wmass200_80GeVBin", 50, 0, 4000);
-    hMET_pT_after_Wmass200_80GeVBin->Sumw2();
-    hMET_sumET_after_Wmass200 = new TH1D("hMET_sumET_after_Wmass200", "hMET_sumET_after_Wmass200", 4000, 0, 4000);
-    hMET_sumET_after_Wmass200->Sumw2();
-    
-    hPFMET_phi_after_Wmass200   = new TH1D("hPFMET_phi_after_Wmass200", "hPFMET_phi_after_Wmass200", 72, -M_PI, M_PI);
-    hPFMET_phi_after_Wmass200->Sumw2();
-    hPFMET_pT_after_Wmass200    = new TH1D("hPFMET_pT_after_Wmass200", "hPFMET_pT_after_Wmass200", 4000, 0, 4000);
-    hPFMET_pT_after_Wmass200->Sumw2();
-    hPFMET_pT_after_Wmass200_40GeVBin  = new TH1D("hPFMET_pT_after_Wmass200_40GeVBin", "hPFMET_pT_after_Wmass200_40GeVBin", 100, 0, 4000);
-    hPFMET_pT_after_Wmass200_40GeVBin->Sumw2();
-    hPFMET_pT_after_Wmass200_80GeVBin  = new TH1D("hPFMET_pT_after_Wmass200_80GeVBin", "hPFMET_pT_after_Wmass200_80GeVBin", 50, 0, 4000);
-    hPFMET_pT_after_Wmass200_80GeVBin->Sumw2();
-    hPFMET_sumET_after_Wmass200 = new TH1D("hPFMET_sumET_after_Wmass200", "hPFMET_sumET_after_Wmass200", 4000, 0, 4000);
-    hPFMET_sumET_after_Wmass200->Sumw2();
-
-    hPFMET_corr_phi_after_Wmass200   = new TH1D("hPFMET_corr_phi_after_Wmass200", "hPFMET_corr_phi_after_Wmass200", 72, -M_PI, M_PI);
-    hPFMET_corr_phi_after_Wmass200->Sumw2();
-    hPFMET_corr_pT_after_Wmass200    = new TH1D("hPFMET_corr_pT_after_Wmass200", "hPFMET_corr_pT_after_Wmass200", 4000, 0, 4000);
-    hPFMET_corr_pT_after_Wmass200->Sumw2();
-    hPFMET_corr_pT_after_Wmass200_40GeVBin  = new TH1D("hPFMET_corr_pT_after_Wmass200_40GeVBin", "hPFMET_corr_pT_after_Wmass200_40GeVBin", 100, 0, 4000);
-    hPFMET_corr_pT_after_Wmass200_40GeVBin->Sumw2();
-    hPFMET_corr_pT_after_Wmass200_80GeVBin  = new TH1D("hPFMET_corr_pT_after_Wmass200_80GeVBin", "hPFMET_corr_pT_after_Wmass200_80GeVBin", 50, 0, 4000);
-    hPFMET_corr_pT_after_Wmass200_80GeVBin->Sumw2();
-    hPFMET_corr_sumET_after_Wmass200 = new TH1D("hPFMET_corr_sumET_after_Wmass200", "hPFMET_corr_sumET_after_Wmass200", 4000, 0, 4000);
-    hPFMET_corr_sumET_after_Wmass200->Sumw2();
-
-    // Balance between muon and MET
-    hPt_Mu_over_MET_after_Wmass200 = new TH1D("hPt_Mu_over_MET_after_Wmass200", "hPt_Mu_over_MET_after_Wmass200", 100, 0, 5);
-    hPt_Mu_over_MET_after_Wmass200->Sumw2();
-
-    // Reconstructed W histograms
-    hDeltaPhi_Mu_MET_after_Wmass200 = new TH1D("hDeltaPhi_Mu_MET_after_Wmass200", "hDeltaPhi_Mu_MET_after_Wmass200", 72, 0., M_PI);
-    hDeltaPhi_Mu_MET_after_Wmass200->Sumw2();
-    hW_MT_after_Wmass200            = new TH1D("hW_MT_after_Wmass200", "hW_MT_after_Wmass200", 4000, 0, 4000);
-    hW_MT_after_Wmass200->Sumw2();
-    hW_MT_after_Wmass200_40GeVBin  = new TH1D("hW_MT_after_Wmass200_40GeVBin", "hW_MT_after_Wmass200_40GeVBin", 100, 0, 4000);
-    hW_MT_after_Wmass200_40GeVBin->Sumw2();
-    hW_MT_after_Wmass200_80GeVBin  = new TH1D("hW_MT_after_Wmass200_80GeVBin", "hW_MT_after_Wmass200_80GeVBin", 50, 0, 4000);
-    hW_MT_after_Wmass200_80GeVBin->Sumw2();
-
-    hDeltaPhi_Mu_PFMET_after_Wmass200 = new TH1D("hDeltaPhi_Mu_PFMET_after_Wmass200", "hDeltaPhi_Mu_PFMET_after_Wmass200", 72, 0., M_PI);
-    hDeltaPhi_Mu_PFMET_after_Wmass200->Sumw2();
-    hW_MT_PFMET_after_Wmass200        = new TH1D("hW_MT_PFMET_after_Wmass200", "hW_MT_PFMET_after_Wmass200", 4000, 0, 4000);
-    hW_MT_PFMET_after_Wmass200->Sumw2();
-    hW_MT_PFMET_after_Wmass200_40GeVBin  = new TH1D("hW_MT_PFMET_after_Wmass200_40GeVBin", "hW_MT_PFMET_after_Wmass200_40GeVBin", 100, 0, 4000);
-    hW_MT_PFMET_after_Wmass200_40GeVBin->Sumw2();
-    hW_MT_PFMET_after_Wmass200_80GeVBin  = new TH1D("hW_MT_PFMET_after_Wmass200_80GeVBin", "hW_MT_PFMET_after_Wmass200_80GeVBin", 50, 0, 4000);
-    hW_MT_PFMET_after_Wmass200_80GeVBin->Sumw2();
-
-    hDeltaPhi_Mu_PFMET_corr_after_Wmass200 = new TH1D("hDeltaPhi_Mu_PFMET_corr_after_Wmass200", "hDeltaPhi_Mu_PFMET_corr_after_Wmass200", 72, 0., M_PI);
-    hDeltaPhi_Mu_PFMET_corr_after_Wmass200->Sumw2();
-    hW_MT_PFMET_corr_after_Wmass200        = new TH1D("hW_MT_PFMET_corr_after_Wmass200", "hW_MT_PFMET_corr_after_Wmass200", 4000, 0, 4000);
-    hW_MT_PFMET_corr_after_Wmass200->Sumw2();
-    hW_MT_PFMET_corr_after_Wmass200_40GeVBin  = new TH1D("hW_MT_PFMET_corr_after_Wmass200_40GeVBin", "hW_MT_PFMET_corr_after_Wmass200_40GeVBin", 100, 0, 4000);
-    hW_MT_PFMET_corr_after_Wmass200_40GeVBin->Sumw2();
-    hW_MT_PFMET_corr_after_Wmass200_80GeVBin  = new TH1D("hW_MT_PFMET_corr_after_Wmass200_80GeVBin", "hW_MT_PFMET_corr_after_Wmass200_80GeVBin", 50, 0, 4000);
-    hW_MT_PFMET_corr_after_Wmass200_80GeVBin->Sumw2();
+    hDeltaPhi_Mu_PFMET_corr_after_Wmass50 = BookTH1D("hDeltaPhi_Mu_PFMET_corr_after_Wmass50", 72, 0., M_PI);
+    hW_MT_PFMET_corr_after_Wmass50        = BookSparseTH1D("hW_MT_PFMET_corr_after_Wmass50", 4000, 0, 4000);
+    hW_MT_PFMET_corr_after_Wmass50_40GeVBin  = BookTH1D("hW_MT_PFMET_corr_after_Wmass50_40GeVBin", 100, 0, 4000);
+    hW_MT_PFMET_corr_after_Wmass50_80GeVBin  = BookTH1D("hW_MT_PFMET_corr_after_Wmass50_80GeVBin", 50, 0, 4000);
 
     // For NPV, NPU, NTrueInt before event selection
     // For NTrueInt -> Only present in MC
-    hNPV_after_Wmass200 = new TH1D("hNPV_after_Wmass200", "hNPV_after_Wmass200", 100, 0, 100);
-    hNPV_after_Wmass200->Sumw2();
-    hNPU_after_Wmass200 = new TH1D("hNPU_after_Wmass200", "hNPU_after_Wmass200", 100, 0, 100);
-    hNPU_after_Wmass200->Sumw2();
-    hNTrueInt_after_Wmass200 = new TH1D("hNTrueInt_after_Wmass200", "hNTrueInt_after_Wmass200", 100, 0, 100);
-    hNTrueInt_after_Wmass200->Sumw2();
+    hNPV_after_Wmass50 = BookTH1D("hNPV_after_Wmass50", 100, 0, 100);
+    hNPU_after_Wmass50 = BookTH1D("hNPU_after_Wmass50", 100, 0, 100);
+    hNTrueInt_after_Wmass50 = BookTH1D("hNTrueInt_after_Wmass50", 100, 0, 100);
 
     ////////////////////////////////////////////////////////////
-    // For Z peak mass study
-    ////////////////////////////////////////////////////////////
-    hDilepton_org_mass     = new TH1D("hDilepton_org_mass", "hDilepton_org_mass", 4000, 0, 4000);
-    hDilepton_org_mass->Sumw2();
-    hDilepton_rocco_mass   = new TH1D("hDilepton_rocco_mass", "hDilepton_rocco_mass", 4000, 0, 4000);
-    hDilepton_rocco_mass->Sumw2();
-
-    hDilepton_org_mass_after     = new TH1D("hDilepton_org_mass_after", "hDilepton_org_mass_after", 4000, 0, 4000);
-    hDilepton_org_mass_after->Sumw2();
-    hDilepton_rocco_mass_after   = new TH1D("hDilepton_rocco_mass_after", "hDilepton_rocco_mass_after", 4000, 0, 4000);
-    hDilepton_rocco_mass_after->Sumw2();
-}
-
-// Write histograms to file
-void DYanalyzer::WriteHistograms(TFile* f_output) {
-    f_output->cd();
-
-    ////////////////////////////////////////////////////////////
-    // GenLevel event weights, before and after each correction
-    ////////////////////////////////////////////////////////////
-    hGenEvtWeight->Write();
-
-    ////////////////////////////////////////////////////////////
-    // Before event selection
+    // After event selection (W mass > 200 GeV cut)
     ////////////////////////////////////////////////////////////
 
-    // GenLevel Object histograms
-    hGen_Muon_pT->Write();
-    hGen_Muon_phi->Write();
-    hGen_Muon_eta->Write();
-
-    hGen_Nu_pT->Write();
-    hGen_Nu_phi->Write();
-    hGen_Nu_eta->Write();
-
-    hGen_MET_phi->Write();
-    hGen_MET_pT->Write();
-
-    // For GenLevel W decaying to muon and neutrino
-    hGen_WToMuNu_pT->Write();
-    hGen_WToMuNu_eta->Write();
-    hGen_WToMuNu_phi->Write();
-    hGen_WToMuNu_mass->Write();
-    hGen_WToMuNu_MT->Write();
-
-    // For GenLevel inclusive decaying W
-    hGen_W_pT->Write();
-    hGen_W_eta->Write();
-    hGen_W_phi->Write();
-    hGen_W_mass->Write();
-    hGen_W_MT->Write();
-
-    // For LHE HT
-    hLHE_HT->Write();
-
     // Object histograms
-    hMuon_pT->Write();
-    hMuon_phi->Write();
-    hMuon_eta->Write();
-    hMuon_mass->Write();
-
-    hMET_phi->Write();
-    hMET_pT->Write();
-    hMET_sumET->Write();
-
-    hPFMET_phi->Write();
-    hPFMET_pT->Write();
-    hPFMET_sumET->Write();
-
-    hPFMET_corr_phi->Write();
-    hPFMET_corr_pT->Write();
-    hPFMET_corr_sumET->Write();
+    hMuon_pT_after_Wmass200  = BookSparseTH1D("hMuon_pT_after_Wmass200", 4000, 0, 4000);
+    hMuon_pT_after_Wmass200_40GeVBin  = BookTH1D("hMuon_pT_after_Wmass200_40GeVBin", 100, 0, 4000);
+    hMuon_pT_after_Wmass200_80GeVBin  = BookTH1D("hMuon_pT_after_Wmass200_80GeVBin", 50, 0, 4000);
+    hMuon_phi_after_Wmass200 = BookTH1D("hMuon_phi_after_Wmass200", 72, -M_PI, M_PI);
+    hMuon_eta_after_Wmass200 = BookTH1D("hMuon_eta_after_Wmass200", 50, -2.5, 2.5);
+    hMuon_mass_after_Wmass200 = BookTH1D("hMuon_mass_after_Wmass200", 1000, 0, 1);
+
+    hMET_phi_after_Wmass200   = BookTH1D("hMET_phi_after_Wmass200", 72, -M_PI, M_PI);
+    hMET_pT_after_Wmass200    = BookSparseTH1D("hMET_pT_after_Wmass200", 4000, 0, 4000);
+    hMET_pT_after_Wmass200_40GeVBin  = BookTH1D("hMET_pT_after_Wmass200_40GeVBin", 100, 0, 4000);
+    hMET_pT_after_Wmass200_80GeVBin  = BookTH1D("hMET_pT_after_Wmass200_80GeVBin", 50, 0, 4000);
+    hMET_sumET_after_Wmass200 = BookSparseTH1D("hMET_sumET_after_Wmass200", 4000, 0, 4000);
+    
+    hPFMET_phi_after_Wmass200   = BookTH1D("hPFMET_phi_after_Wmass200", 72, -M_PI, M_PI);
+    hPFMET_pT_after_Wmass200    = BookSparseTH1D("hPFMET_pT_after_Wmass200", 4000, 0, 4000);
+    hPFMET_pT_after_Wmass200_40GeVBin  = BookTH1D("hPFMET_pT_after_Wmass200_40GeVBin", 100, 0, 4000);
+    hPFMET_pT_after_Wmass200_80GeVBin  = BookTH1D("hPFMET_pT_after_Wmass200_80GeVBin", 50, 0, 4000);
+    hPFMET_sumET_after_Wmass200 = BookSparseTH1D("hPFMET_sumET_after_Wmass200", 4000, 0, 4000);
+
+    hPFMET_corr_phi_after_Wmass200   = BookTH1D("hPFMET_corr_phi_after_Wmass200", 72, -M_PI, M_PI);
+    hPFMET_corr_pT_after_Wmass200    = BookSparseTH1D("hPFMET_corr_pT_after_Wmass200", 4000, 0, 4000);
+    hPFMET_corr_pT_after_Wmass200_40GeVBin  = BookTH1D("hPFMET_corr_pT_after_Wmass200_40GeVBin", 100, 0, 4000);
+    hPFMET_corr_pT_after_Wmass200_80GeVBin  = BookTH1D("hPFMET_corr_pT_after_Wmass200_80GeVBin", 50, 0, 4000);
+    hPFMET_corr_sumET_after_Wmass200 = BookSparseTH1D("hPFMET_corr_sumET_after_Wmass200", 4000, 0, 4000);
 
     // Balance between muon and MET
-    hPt_Mu_over_MET->Write();
+    hPt_Mu_over_MET_after_Wmass200 = BookTH1D("hPt_Mu_over_MET_after_Wmass200", 100, 0, 5);
 
     // Reconstructed W histograms
-    hDeltaPhi_Mu_MET->Write();
-    hW_MT->Write();
+    hDeltaPhi_Mu_MET_after_Wmass200 = BookTH1D("hDeltaPhi_Mu_MET_after_Wmass200", 72, 0., M_PI);
+    hW_MT_after_Wmass200            = BookSparseTH1D("hW_MT_after_Wmass200", 4000, 0, 4000);
+    hW_MT_after_Wmass200_40GeVBin  = BookTH1D("hW_MT_after_Wmass200_40GeVBin", 100, 0, 4000);
+    hW_MT_after_Wmass200_80GeVBin  = BookTH1D("hW_MT_after_Wmass200_80GeVBin", 50, 0, 4000);
 
-    hDeltaPhi_Mu_PFMET->Write();
-    hW_MT_PFMET->Write();
+    hDeltaPhi_Mu_PFMET_after_Wmass200 = BookTH1D("hDeltaPhi_Mu_PFMET_after_Wmass200", 72, 0., M_PI);
+    hW_MT_PFMET_after_Wmass200        = BookSparseTH1D("hW_MT_PFMET_after_Wmass200", 4000, 0, 4000);
+    hW_MT_PFMET_after_Wmass200_40GeVBin  = BookTH1D("hW_MT_PFMET_after_Wmass200_40GeVBin", 100, 0, 4000);
+    hW_MT_PFMET_after_Wmass200_80GeVBin  = BookTH1D("hW_MT_PFMET_after_Wmass200_80GeVBin", 50, 0, 4000);
 
-    hDeltaPhi_Mu_PFMET_corr->Write();
-    hW_MT_PFMET_corr->Write();
+    hDeltaPhi_Mu_PFMET_corr_after_Wmass200 = BookTH1D("hDeltaPhi_Mu_PFMET_corr_after_Wmass200", 72, 0., M_PI);
+    hW_MT_PFMET_corr_after_Wmass200        = BookSparseTH1D("hW_MT_PFMET_corr_after_Wmass200", 4000, 0, 4000);
+    hW_MT_PFMET_corr_after_Wmass200_40GeVBin  = BookTH1D("hW_MT_PFMET_corr_after_Wmass200_40GeVBin", 100, 0, 4000);
+    hW_MT_PFMET_corr_after_Wmass200_80GeVBin  = BookTH1D("hW_MT_PFMET_corr_after_Wmass200_80GeVBin", 50, 0, 4000);
 
     // For NPV, NPU, NTrueInt before event selection
     // For NTrueInt -> Only present in MC
-    hNPV->Write();
-    hNPU->Write();
-    hNTrueInt->Write();
+    hNPV_after_Wmass200 = BookTH1D("hNPV_after_Wmass200", 100, 0, 100);
+    hNPU_after_Wmass200 = BookTH1D("hNPU_after_Wmass200", 100, 0, 100);
+    hNTrueInt_after_Wmass200 = BookTH1D("hNTrueInt_after_Wmass200", 100, 0, 100);
 
     ////////////////////////////////////////////////////////////
-    // After event selection (no W mass cut)
+    // For Z peak mass study
     ////////////////////////////////////////////////////////////
+    hDilepton_org_mass     = BookSparseTH1D("hDilepton_org_mass", 4000, 0, 4000);
+    hDilepton_rocco_mass   = BookSparseTH1D("hDilepton_rocco_mass", 4000, 0, 4000);
 
-    // GenLevel Object histograms
-    hGen_Muon_pT_after->Write();
-    hGen_Muon_phi_after->Write();
-    hGen_Muon_eta_after->Write();
-
-    hGen_Nu_pT_after->Write();
-    hGen_Nu_phi_after->Write();
-    hGen_Nu_eta_after->Write();
-
-    hGen_MET_phi_after->Write();
-    hGen_MET_pT_after->Write();
-
-    // For GenLevel W decaying to muon and neutrino
-    hGen_WToMuNu_pT_after->Write();
-    hGen_WToMuNu_eta_after->Write();
-    hGen_WToMuNu_phi_after->Write();
-    hGen_WToMuNu_mass_after->Write();
-    hGen_WToMuNu_MT_after->Write();
-
-    // For GenLevel inclusive decaying W
-    // This cannot exist because after event selection, muon filtering is already done
-    hGen_W_pT_after->Write();
-    hGen_W_eta_after->Write();
-    hGen_W_phi_after->Write();
-    hGen_W_mass_after->Write();
-    hGen_W_MT_after->Write();
-
-    // For LHE HT
-    hLHE_HT_after->Write();
-
-    // Object histograms
-    hMuon_pT_after->Write();
-    hMuon_pT_after_40GeVBin->Write();
-    hMuon_pT_after_80GeVBin->Write();
-    hMuon_phi_after->Write();
-    hMuon_eta_after->Write();
-    hMuon_mass_after->Write();
-
-    hMET_phi_after->Write();
-    hMET_pT_after->Write();
-    hMET_pT_after_40GeVBin->Write();
-    hMET_pT_after_80GeVBin->Write();
-    hMET_sumET_after->Write();
-
-    hPFMET_phi_after->Write();
-    hPFMET_pT_after->Write();
-    hPFMET_pT_after_40GeVBin->Write();
-    hPFMET_pT_after_80GeVBin->Write();
-    hPFMET_sumET_after->Write();
-
-    hPFMET_corr_phi_after->Write();
-    hPFMET_corr_pT_after->Write();
-    hPFMET_corr_pT_after_40GeVBin->Write();
-    hPFMET_corr_pT_after_80GeVBin->Write();
-    hPFMET_corr_sumET_after->Write();
-
-    // Balance between muon and MET
-    hPt_Mu_over_MET_after->Write();
-
-    // Reconstructed W histograms
-    hDeltaPhi_Mu_MET_after->Write();
-    hW_MT_after->Write();
-    hW_MT_after_40GeVBin->Write();
-    hW_MT_after_80GeVBin->Write();
-
-    hDeltaPhi_Mu_PFMET_after->Write();
-    hW_MT_PFMET_after->Write();
-    hW_MT_PFMET_after_40GeVBin->Write();
-    hW_MT_PFMET_after_80GeVBin->Write();
-
-    hDeltaPhi_Mu_PFMET_corr_after->Write();
-    hW_MT_PFMET_corr_after->Write();
-    hW_MT_PFMET_corr_after_40GeVBin->Write();
-    hW_MT_PFMET_corr_after_80GeVBin->Write();
+    hDilepton_org_mass_after     = BookSparseTH1D("hDilepton_org_mass_after", 4000, 0, 4000);
+    hDilepton_rocco_mass_after   = BookSparseTH1D("hDilepton_rocco_mass_after", 4000, 0, 4000);
+}
 
-    // For NPV, NPU, NTrueInt before event selection
-    // For NTrueInt -> Only present in MC
-    hNPV_after->Write();
-    hNPU_after->Write();
-    hNTrueInt_after->Write();
+////////////////////////////////////////////////////////////
+///////////////////// Selection cuts ///////////////////////
+////////////////////////////////////////////////////////////
+std::vector<std::pair<std::string, Double_t*>> SelectionCuts::Fields() {
+    return {
+        {"muon.tightPt", &cMuon.dTightPt},
+        {"muon.tightEta", &cMuon.dTightEta},
+        {"muon.tightIso", &cMuon.dTightIso},
+        {"muon.loosePt", &cMuon.dLoosePt},
+        {"muon.looseEta", &cMuon.dLooseEta},
+        {"wmt.low", &dW_MT_low},
+        {"wmt.high", &dW_MT_high},
+    };
+}
 
-    ////////////////////////////////////////////////////////////
-    // After event selection (W mass > 40 GeV cut)
-    ////////////////////////////////////////////////////////////
-    // Object histograms
-    hMuon_pT_after_Wmass50->Write();
-    hMuon_pT_after_Wmass50_40GeVBin->Write();
-    hMuon_pT_after_Wmass50_80GeVBin->Write();
-    hMuon_phi_after_Wmass50->Write();
-    hMuon_eta_after_Wmass50->Write();
-    hMuon_mass_after_Wmass50->Write();
-
-    hMET_phi_after_Wmass50->Write();
-    hMET_pT_after_Wmass50->Write();
-    hMET_pT_after_Wmass50_40GeVBin->Write();
-    hMET_pT_after_Wmass50_80GeVBin->Write();
-    hMET_sumET_after_Wmass50->Write();
-
-    hPFMET_phi_after_Wmass50->Write();
-    hPFMET_pT_after_Wmass50->Write();
-    hPFMET_pT_after_Wmass50_40GeVBin->Write();
-    hPFMET_pT_after_Wmass50_80GeVBin->Write();
-    hPFMET_sumET_after_Wmass50->Write();
-
-    hPFMET_corr_phi_after_Wmass50->Write();
-    hPFMET_corr_pT_after_Wmass50->Write();
-    hPFMET_corr_pT_after_Wmass50_40GeVBin->Write();
-    hPFMET_corr_pT_after_Wmass50_80GeVBin->Write();
-    hPFMET_corr_sumET_after_Wmass50->Write();
+void SelectionCuts::Set(const std::string& assignment) {
+    std::size_t equal = assignment.find('=');
+    const std::string name = assignment.substr(0, equal);
+    for (auto& field : Fields()) {
+        if (field.first != name) continue;
+        std::size_t nParsed = 0;
+        try {
+            if (equal != std::string::npos) *field.second = std::stod(assignment.substr(equal + 1), &nParsed);
+        } catch (const std::exception&) {
+            nParsed = 0;
+        }
+        if (nParsed == 0 || equal + 1 + nParsed != assignment.size()) {
+            throw std::runtime_error("[Runtime Error] SelectionCuts::Set() - Invalid value of " + name + ": " + assignment);
+        }
+        return;
+    }
+    throw std::runtime_error("[Runtime Error] SelectionCuts::Set() - Unknown cut: " + name);
+}
 
-    // Balance between muon and MET
-    hPt_Mu_over_MET_after_Wmass50->Write();
+std::string SelectionCuts::ToString() const {
+    SelectionCuts cuts = *this;
+    SelectionCuts defaults;
+    std::vector<std::pair<std::string, Double_t*>> fields = cuts.Fields();
+    std::vector<std::pair<std::string, Double_t*>> defaultFields = defaults.Fields();
+    std::ostringstream config;
+    config << std::setprecision(17);
+    for (std::size_t i = 0; i < fields.size(); i++) {
+        if (*fields[i].second == *defaultFields[i].second) continue;
+        if (config.tellp() > 0) config << ",";
+        config << fields[i].first << "=" << *fields[i].second;
+    }
+    return config.str();
+}
 
-    // Reconstructed W histograms
-    hDeltaPhi_Mu_MET_after_Wmass50->Write();
-    hW_MT_after_Wmass50->Write();
-    hW_MT_after_Wmass50_40GeVBin->Write();
-    hW_MT_after_Wmass50_80GeVBin->Write();
+void DYanalyzer::SetHistogramList(const std::string& histograms) {
+    vHistogramList.clear();
+    std::istringstream list(histograms);
+    std::string name;
+    while (std::getline(list, name, ',')) {
+        if (!name.empty()) vHistogramList.push_back(name);
+    }
+}
 
-    hDeltaPhi_Mu_PFMET_after_Wmass50->Write();
-    hW_MT_PFMET_after_Wmass50->Write();
-    hW_MT_PFMET_after_Wmass50_40GeVBin->Write();
-    hW_MT_PFMET_after_Wmass50_80GeVBin->Write();
+Bool_t DYanalyzer::IsHistogramListed(const std::string& name) {
+    if (vHistogramList.empty()) return true;
+    for (const std::string& pattern : vHistogramList) {
+        if (!pattern.empty() && pattern.back() == '*') {
+            if (name.compare(0, pattern.size() - 1, pattern, 0, pattern.size() - 1) == 0) return true;
+        } else if (name == pattern) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    hDeltaPhi_Mu_PFMET_corr_after_Wmass50->Write();
-    hW_MT_PFMET_corr_after_Wmass50->Write();
-    hW_MT_PFMET_corr_after_Wmass50_40GeVBin->Write();
-    hW_MT_PFMET_corr_after_Wmass50_80GeVBin->Write();
+TH1* DYanalyzer::GetWritableHistogram(std::size_t iHist, std::unique_ptr<TH1D>& expanded) {
+    if (vSparseHistograms[iHist] == nullptr) return vHistograms[iHist];
+    expanded.reset(vSparseHistograms[iHist]->ToTH1D());
+    return expanded.get();
+}
 
-    // For NPV, NPU, NTrueInt before event selection
-    // For NTrueInt -> Only present in MC
-    hNPV_after_Wmass50->Write();
-    hNPU_after_Wmass50->Write();
-    hNTrueInt_after_Wmass50->Write();
+// Write histograms to file
+void DYanalyzer::WriteHistograms(TFile* f_output) {
+    f_output->cd();
 
-    ////////////////////////////////////////////////////////////
-    // After event selection (W mass > 200 GeV cut)
-    ////////////////////////////////////////////////////////////
-    // Object histograms
-    hMuon_pT_after_Wmass200->Write();
-    hMuon_pT_after_Wmass200_40GeVBin->Write();
-    hMuon_pT_after_Wmass200_80GeVBin->Write();
-    hMuon_phi_after_Wmass200->Write();
-    hMuon_eta_after_Wmass200->Write();
-    hMuon_mass_after_Wmass200->Write();
-
-    hMET_phi_after_Wmass200->Write();
-    hMET_pT_after_Wmass200->Write();
-    hMET_pT_after_Wmass200_40GeVBin->Write();
-    hMET_pT_after_Wmass200_80GeVBin->Write();
-    hMET_sumET_after_Wmass200->Write();
-
-    hPFMET_phi_after_Wmass200->Write();
-    hPFMET_pT_after_Wmass200->Write();
-    hPFMET_pT_after_Wmass200_40GeVBin->Write();
-    hPFMET_pT_after_Wmass200_80GeVBin->Write();
-    hPFMET_sumET_after_Wmass200->Write();
-
-    hPFMET_corr_phi_after_Wmass200->Write();
-    hPFMET_corr_pT_after_Wmass200->Write();
-    hPFMET_corr_pT_after_Wmass200_40GeVBin->Write();
-    hPFMET_corr_pT_after_Wmass200_80GeVBin->Write();
-    hPFMET_corr_sumET_after_Wmass200->Write();
+    if (dNormalizationScale > 0.) TParameter<Double_t>("NormalizationScale", dNormalizationScale).Write();
+    // Same order as in DeclareHistograms(), the sparse histograms are expanded one at a time
+    std::size_t nSparse = 0, sparseBytes = 0, denseBytes = 0;
+    for (std::size_t iHist = 0; iHist < vHistograms.size(); iHist++) {
+        if (vSparseHistograms[iHist] != nullptr) {
+            nSparse++;
+            sparseBytes += vSparseHistograms[iHist]->GetAllocatedBytes();
+            denseBytes += vSparseHistograms[iHist]->GetDenseBytes();
+        }
+        std::unique_ptr<TH1D> expanded;
+        TH1* h = GetWritableHistogram(iHist, expanded);
+        // Normalized to the luminosity, the sums of weights keep the unscaled values for the merged outputs
+        if (dNormalizationScale > 0. && h != hGenEvtWeight && h != hGenEvtWeight_PUUp && h != hGenEvtWeight_PUDown) h->Scale(dNormalizationScale);
+        if (IsHistogramListed(h->GetName())) h->Write();
+    }
+    std::cout << "[Info] DYanalyzer::WriteHistograms() - " << nSparse << " sparse histograms, " << sparseBytes / 1024 << " KB allocated instead of " << denseBytes / 1024 << " KB" << std::endl;
+    // Summary of the event loop telemetry (JSON)
+    TNamed("Telemetry", cTelemetry->GetSummary().c_str()).Write();
+}
 
-    // Balance between muon and MET
-    hPt_Mu_over_MET_after_Wmass200->Write();
+////////////////////////////////////////////////////////////
+////////////////////// Checkpoints /////////////////////////
+////////////////////////////////////////////////////////////
+std::string DYanalyzer::GetAnalysisConfig() {
+    std::ostringstream config;
+    config << "process=" << sProcessName << ";era=" << sEra
+           << ";flags=" << BuildConfigFlags() << ";fastRocco=" << bFastRocco << ";roccoReplicas=" << (bDoRocco && bRoccoReplicas)
+           << ";rocco=" << iRoccoSet << "," << iRoccoMember
+           << ";puJson=" << sPUCorrectionFileName << ";muonSFJson=" << sMuonSFCorrectionFileName;
+    if (dNormalizationScale > 0.) config << ";normalization=" << std::setprecision(17) << dNormalizationScale;
+    // Only if they are set, the configuration of the default selection is unchanged
+    if (!cCuts.ToString().empty()) config << ";cuts=" << cCuts.ToString();
+    if (!vHistogramList.empty()) {
+        config << ";hists=";
+        for (std::size_t i = 0; i < vHistogramList.size(); i++) config << (i > 0 ? "," : "") << vHistogramList[i];
+    }
+    return config.str();
+}
 
-    // Reconstructed W histograms
-    hDeltaPhi_Mu_MET_after_Wmass200->Write();
-    hW_MT_after_Wmass200->Write();
-    hW_MT_after_Wmass200_40GeVBin->Write();
-    hW_MT_after_Wmass200_80GeVBin->Write();
+Manifest DYanalyzer::GetManifest() {
+    Manifest manifest(GetAnalysisConfig());
+    manifest.AddChain(cData->GetFileNames(), cData->GetFileEntries(), nFirstEntry, nLastEntry);
+    for (const Data::SkippedInput& skipped : cData->GetSkippedInputs()) {
+        manifest.AddSkipped(skipped.sFileName, skipped.nFirstEntry, skipped.nLastEntry, skipped.sReason);
+    }
+    return manifest;
+}
 
-    hDeltaPhi_Mu_PFMET_after_Wmass200->Write();
-    hW_MT_PFMET_after_Wmass200->Write();
-    hW_MT_PFMET_after_Wmass200_40GeVBin->Write();
-    hW_MT_PFMET_after_Wmass200_80GeVBin->Write();
+AnalysisCorrections::Config DYanalyzer::GetCorrectionConfig() {
+    AnalysisCorrections::Config config;
+    config.sEra = sEra;
+    config.sHistName_ID = sHistName_ID;
+    config.sHistName_Iso = sHistName_Iso;
+    config.sHistName_Trig = sHistName_Trig;
+    config.sRoccoFileName = sRoccoFileName;
+    config.sPUCorrectionFileName = sPUCorrectionFileName;
+    config.sMuonSFCorrectionFileName = sMuonSFCorrectionFileName;
+    config.bFastRocco = bDoRocco && bFastRocco;
+    config.bRoccoReplicas = bDoRocco && bRoccoReplicas;
+    config.iRoccoSet = iRoccoSet;
+    config.iRoccoMember = iRoccoMember;
+    return config;
+}
 
-    hDeltaPhi_Mu_PFMET_corr_after_Wmass200->Write();
-    hW_MT_PFMET_corr_after_Wmass200->Write();
-    hW_MT_PFMET_corr_after_Wmass200_40GeVBin->Write();
-    hW_MT_PFMET_corr_after_Wmass200_80GeVBin->Write();
+std::string DYanalyzer::GetCheckpointConfig() {
+    std::ostringstream config;
+    config << GetAnalysisConfig() << ";input=" << sInputFileList << ";skip=" << sSkipInputFiles.size()
+           << ";seed=" << iRandomSeed << ";range=" << nFirstEntry << "," << nLastEntry;
+    return config.str();
+}
 
-    // For NPV, NPU, NTrueInt before event selection
-    // For NTrueInt -> Only present in MC
-    hNPV_after_Wmass200->Write();
-    hNPU_after_Wmass200->Write();
-    hNTrueInt_after_Wmass200->Write();
+Bool_t DYanalyzer::IsCheckpointDue(Long64_t iEvt) {
+    if (iEvt == 0 || sCheckpointFileName.empty()) return false;
+    if (nCheckpointEvents > 0 && iEvt % nCheckpointEvents == 0) return true;
+    // The clock is only read every 1000 events
+    if (dCheckpointSeconds > 0 && iEvt % 1000 == 0) {
+        return std::chrono::duration<Double_t>(std::chrono::steady_clock::now() - tLastCheckpoint).count() >= dCheckpointSeconds;
+    }
+    return false;
+}
 
-    ////////////////////////////////////////////////////////////
-    // For Z peak mass study
-    ////////////////////////////////////////////////////////////
+void DYanalyzer::WriteCheckpoint(Long64_t nextEntry) {
+    // Written to a temporary file and renamed, a job killed while writing keeps the previous checkpoint
+    std::string tmpName = sCheckpointFileName + ".tmp" + std::to_string((long)getpid());
+    TDirectory::TContext context;
+    TFile* f = TFile::Open(tmpName.c_str(), "RECREATE");
+    if (f == nullptr || f->IsZombie()) {
+        std::cerr << "[Warning] DYanalyzer::WriteCheckpoint() - Cannot open " << tmpName << ", checkpoint skipped" << std::endl;
+        delete f;
+        return;
+    }
+    f->cd();
+    // hGenEvtWeight* are filled after the event loop, the sums of weights are written as they are
+    for (std::size_t iHist = 0; iHist < vHistograms.size(); iHist++) {
+        std::unique_ptr<TH1D> expanded;
+        GetWritableHistogram(iHist, expanded)->Write();
+    }
+    TNamed("CheckpointConfig", GetCheckpointConfig().c_str()).Write();
+    TParameter<Long64_t>("CheckpointEntry", nextEntry).Write();
+    Data::InputCheck inputs;
+    inputs.vFileNames = cData->GetFileNames();
+    inputs.vEntries = cData->GetFileEntries();
+    inputs.vSkipped = cData->GetSkippedInputs();
+    TNamed("CheckpointInputs", inputs.ToString().c_str()).Write();
+    TParameter<Double_t>("SumOfGenEvtWeight", dSumOfGenEvtWeight).Write();
+    TParameter<Double_t>("SumOfGenEvtWeight_PUUp", dSumOfGenEvtWeight_PUUp).Write();
+    TParameter<Double_t>("SumOfGenEvtWeight_PUDown", dSumOfGenEvtWeight_PUDown).Write();
+    cRandom.Write("CheckpointRandom");
+    f->Close();
+    delete f;
+    if (std::rename(tmpName.c_str(), sCheckpointFileName.c_str()) != 0) {
+        std::cerr << "[Warning] DYanalyzer::WriteCheckpoint() - Cannot rename " << tmpName << " to " << sCheckpointFileName << std::endl;
+        std::remove(tmpName.c_str());
+        return;
+    }
+    tLastCheckpoint = std::chrono::steady_clock::now();
+    std::cout << std::endl << "[Info] DYanalyzer::WriteCheckpoint() - Checkpoint at entry " << nextEntry << ": " << sCheckpointFileName << std::endl;
+}
 
-    hDilepton_org_mass->Write();
-    hDilepton_rocco_mass->Write();
+void DYanalyzer::OpenCheckpoint() {
+    if (!bResume || sCheckpointFileName.empty()) return;
+    if (access(sCheckpointFileName.c_str(), R_OK) != 0) {
+        std::cout << "[Info] DYanalyzer::OpenCheckpoint() - No checkpoint " << sCheckpointFileName << ", starting from the first entry" << std::endl;
+        return;
+    }
+    TDirectory::TContext context;
+    TFile* f = TFile::Open(sCheckpointFileName.c_str(), "READ");
+    if (f == nullptr || f->IsZombie()) {
+        std::cerr << "[Warning] DYanalyzer::OpenCheckpoint() - Cannot read " << sCheckpointFileName << ", starting from the first entry" << std::endl;
+        delete f;
+        return;
+    }
+    TNamed* config = (TNamed*) f->Get("CheckpointConfig");
+    TParameter<Long64_t>* entry = (TParameter<Long64_t>*) f->Get("CheckpointEntry");
+    TNamed* inputs = (TNamed*) f->Get("CheckpointInputs");
+    std::string reason;
+    std::shared_ptr<Data::InputCheck> savedInputs;
+    if (config == nullptr || entry == nullptr || inputs == nullptr || GetCheckpointConfig() != config->GetTitle()) {
+        reason = "was written with another configuration";
+    } else {
+        savedInputs = std::make_shared<Data::InputCheck>(Data::InputCheck::FromString(inputs->GetTitle()));
+        // The entry range of a slice of --jobs refers to the chain of the input check of all slices
+        if (pInputCheck != nullptr && !pInputCheck->HasSameChain(*savedInputs)) reason = "was written with other readable inputs than the other slices";
+    }
+    if (!reason.empty()) {
+        std::cerr << "[Warning] DYanalyzer::OpenCheckpoint() - " << sCheckpointFileName << " " << reason << ", starting from the first entry" << std::endl;
+        delete config;
+        delete entry;
+        delete inputs;
+        f->Close();
+        delete f;
+        return;
+    }
+    nResumeEntry = entry->GetVal();
+    pResumeInputCheck = savedInputs;
+    delete config;
+    delete entry;
+    delete inputs;
+    fResumeCheckpoint = f;
+    std::cout << "[Info] DYanalyzer::OpenCheckpoint() - Resuming from " << sCheckpointFileName << " at entry " << nResumeEntry << std::endl;
+}
 
-    hDilepton_org_mass_after->Write();
-    hDilepton_rocco_mass_after->Write();
+void DYanalyzer::RestoreCheckpoint() {
+    if (fResumeCheckpoint == nullptr) return;
+    for (std::size_t iHist = 0; iHist < vHistograms.size(); iHist++) {
+        std::unique_ptr<TH1D> expanded;
+        TH1* h = GetWritableHistogram(iHist, expanded);
+        TH1* saved = (TH1*) fResumeCheckpoint->Get(h->GetName());
+        if (saved == nullptr || !HistMerger::HasSameBinning(h, saved)) {
+            delete saved;
+            throw std::runtime_error("[Runtime Error] DYanalyzer::RestoreCheckpoint() - Histogram " + std::string(h->GetName()) + " is missing or different in " + sCheckpointFileName);
+        }
+        // h is empty : contents, sums of squared weights, statistics and entries become those of the checkpoint
+        if (vSparseHistograms[iHist] != nullptr) vSparseHistograms[iHist]->Add(saved);
+        else HistMerger::AddArrays(h, saved);
+        delete saved;
+    }
+    const char* sumNames[] = {"SumOfGenEvtWeight", "SumOfGenEvtWeight_PUUp", "SumOfGenEvtWeight_PUDown"};
+    Double_t* sums[] = {&dSumOfGenEvtWeight, &dSumOfGenEvtWeight_PUUp, &dSumOfGenEvtWeight_PUDown};
+    for (Int_t i = 0; i < 3; i++) {
+        TParameter<Double_t>* sum = (TParameter<Double_t>*) fResumeCheckpoint->Get(sumNames[i]);
+        if (sum == nullptr) throw std::runtime_error("[Runtime Error] DYanalyzer::RestoreCheckpoint() - " + std::string(sumNames[i]) + " is missing in " + sCheckpointFileName);
+        *sums[i] = sum->GetVal();
+        delete sum;
+    }
+    TRandom3* random = (TRandom3*) fResumeCheckpoint->Get("CheckpointRandom");
+    if (random == nullptr) throw std::runtime_error("[Runtime Error] DYanalyzer::RestoreCheckpoint() - CheckpointRandom is missing in " + sCheckpointFileName);
+    cRandom = *random;
+    delete random;
+
+    fResumeCheckpoint->Close();
+    delete fResumeCheckpoint;
+    fResumeCheckpoint = nullptr;
+    std::cout << "[Info] DYanalyzer::RestoreCheckpoint() - Restored " << vHistograms.size() << " histograms, sum of weight: " << dSumOfGenEvtWeight << std::endl;
 }
 
 DYanalyzer::~DYanalyzer() {
@@ -1441,8 +1580,14 @@ DYanalyzer::~DYanalyzer() {
 
 void DYanalyzer::Clear() {
     // delete classes
+    // Telemetry detaches its I/O statistics from the chain of cData
+    delete cTelemetry;
     delete cData;
-    delete cPU;
-    delete cEfficiencySF;
-    delete cRochesterCorrection;
+    // The corrections are deleted with their last analyzer
+    cPU = nullptr;
+    cEfficiencySF = nullptr;
+    cRochesterCorrection = nullptr;
+    pCorrections.reset();
+    delete cEventArena;
+    delete fResumeCheckpoint;
 }
\ No newline at end of file
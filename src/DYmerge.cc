@@ -0,0 +1,141 @@
+#include "HistMerger.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+
+// Samples split in several process directories, merged again into hist_<group>.root (same groups as condor/hadd.sh)
+const std::vector<std::string> kMergeGroups = {
+    "DYJetsToMuMu_M-10to50",
+    "WJetsToLNu_HT-100To200",
+    "WJetsToLNu_HT-200To400",
+    "WJetsToLNu_HT-400To600",
+    "WJetsToLNu_HT600To800",
+    "WJetsToLNu_HT800To1200",
+    "WJetsToLNu_HT1200To2500",
+    "WJetsToLNu_HT2500ToInf",
+    "WToMuNu_M-200",
+};
+
+std::vector<std::string> ListFiles(const std::filesystem::path& directory) {
+    std::vector<std::string> fileNames;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".root") fileNames.push_back(entry.path().string());
+    }
+    std::sort(fileNames.begin(), fileNames.end());
+    return fileNames;
+}
+
+Double_t GetSeconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<Double_t>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    // Usage
+    // ./DYmerge [-j <threads>] <directory> : hist_<process>.root for each process directory, then hist_<group>.root
+    // ./DYmerge [-j <threads>] -o <output file> <input files...>
+    Int_t nThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::string sOutputFileName = "";
+    std::vector<std::string> vArgs;
+    for (int iArg = 1; iArg < argc; iArg++) {
+        std::string option = argv[iArg];
+        if (option == "-j" && iArg + 1 < argc) {
+            nThreads = std::max(1, std::stoi(argv[++iArg]));
+        } else if (option == "-o" && iArg + 1 < argc) {
+            sOutputFileName = argv[++iArg];
+        } else {
+            vArgs.push_back(option);
+        }
+    }
+    if (vArgs.empty() || (sOutputFileName.empty() && vArgs.size() != 1)) {
+        std::cerr << "[Error] DYmerge.cc - Usage: ./DYmerge [-j <threads>] <directory>" << std::endl;
+        std::cerr << "[Error] DYmerge.cc - Usage: ./DYmerge [-j <threads>] -o <output file> <input files...>" << std::endl;
+        return 1;
+    }
+
+    TH1::AddDirectory(kFALSE);
+    auto start = std::chrono::steady_clock::now();
+
+    try {
+        // Plain merge of the given files
+        if (!sOutputFileName.empty()) {
+            HistMerger merger;
+            HistMerger::MergeFiles(vArgs, nThreads, merger);
+            if (!merger.Write(sOutputFileName)) {
+                std::cerr << "[Error] DYmerge.cc - Cannot write " << sOutputFileName << std::endl;
+                return 1;
+            }
+            std::cout << "[Info] DYmerge.cc - " << merger.GetNInputs() << " files merged into " << sOutputFileName << " in " << GetSeconds(start) << " s" << std::endl;
+            return 0;
+        }
+
+        std::filesystem::path inputPath = std::filesystem::absolute(vArgs[0]);
+        if (!std::filesystem::is_directory(inputPath)) {
+            std::cerr << "[Error] DYmerge.cc - Directory " << inputPath.string() << " does not exist" << std::endl;
+            return 1;
+        }
+        std::cout << "[Info] DYmerge.cc - Processing directory: " << inputPath.string() << " with " << nThreads << " threads" << std::endl;
+
+        std::vector<std::filesystem::path> processDirs;
+        for (const auto& entry : std::filesystem::directory_iterator(inputPath)) {
+            if (entry.is_directory()) processDirs.push_back(entry.path());
+        }
+        std::sort(processDirs.begin(), processDirs.end());
+
+        // Group sums are built from the merged processes in memory, the hist_<process>.root files are not read again
+        std::map<std::string, std::unique_ptr<HistMerger>> groupMergers;
+        ULong64_t nFiles = 0;
+        for (const auto& processDir : processDirs) {
+            std::string processName = processDir.filename().string();
+            std::vector<std::string> fileNames = ListFiles(processDir);
+            if (fileNames.empty()) {
+                std::cerr << "[Warning] DYmerge.cc - No ROOT files in " << processDir.string() << std::endl;
+                continue;
+            }
+
+            auto processStart = std::chrono::steady_clock::now();
+            HistMerger merger;
+            HistMerger::MergeFiles(fileNames, nThreads, merger);
+            std::string outputFileName = (inputPath / ("hist_" + processName + ".root")).string();
+            if (!merger.Write(outputFileName)) {
+                std::cerr << "[Error] DYmerge.cc - Cannot write " << outputFileName << std::endl;
+                return 1;
+            }
+            nFiles += fileNames.size();
+            std::cout << "[Info] DYmerge.cc - " << processName << ": " << fileNames.size() << " files merged in " << GetSeconds(processStart) << " s" << std::endl;
+
+            for (const std::string& group : kMergeGroups) {
+                if (processName.rfind(group + "_", 0) != 0) continue;
+                auto& groupMerger = groupMergers[group];
+                if (!groupMerger) groupMerger.reset(new HistMerger());
+                groupMerger->Add(merger);
+            }
+        }
+
+        for (const std::string& group : kMergeGroups) {
+            auto it = groupMergers.find(group);
+            if (it == groupMergers.end()) {
+                std::cerr << "[Warning] DYmerge.cc - No process found for group " << group << std::endl;
+                continue;
+            }
+            std::string outputFileName = (inputPath / ("hist_" + group + ".root")).string();
+            if (!it->second->Write(outputFileName)) {
+                std::cerr << "[Error] DYmerge.cc - Cannot write " << outputFileName << std::endl;
+                return 1;
+            }
+            std::cout << "[Info] DYmerge.cc - Group " << group << ": " << it->second->GetNInputs() << " files" << std::endl;
+        }
+
+        std::cout << "[Info] DYmerge.cc - " << nFiles << " files merged in " << GetSeconds(start) << " s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
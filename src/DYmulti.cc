@@ -0,0 +1,204 @@
+#include "DYanalyzer.h"
+#include "Manifest.h"
+#include "SampleIndex.h"
+
+#include "TROOT.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+// Analysis of several samples of one era in a single process (same histograms as one DYanalysis run per sample)
+// The corrections of the era (PU, muon SF, RoccoR) are built once and shared by the analyzers of all tasks,
+// which only pays off the fixed cost of a job once for the long tail of small samples (ST_*, WGToLNuG, ...).
+// Task file, one task per line, "#" starts a comment :
+//   <process> <IsMC> <input file list> <output file>
+struct Task {
+    std::string sProcessName;
+    bool bIsMC = true;
+    std::string sInputFileList;
+    std::string sOutputFileName;
+};
+
+std::vector<Task> ReadTasks(const std::string& fileName) {
+    std::ifstream file(fileName);
+    if (!file) {
+        throw std::runtime_error("[Runtime Error] DYmulti.cc - Cannot open task file: " + fileName);
+    }
+    std::vector<Task> tasks;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::istringstream fields(line);
+        Task task;
+        if (!(fields >> task.sProcessName)) continue;
+        std::string isMC;
+        std::string extra;
+        if (!(fields >> isMC >> task.sInputFileList >> task.sOutputFileName) || (fields >> extra) || (isMC != "0" && isMC != "1")) {
+            throw std::runtime_error("[Runtime Error] DYmulti.cc - Invalid task: " + line);
+        }
+        task.bIsMC = (isMC == "1");
+        tasks.push_back(task);
+    }
+    return tasks;
+}
+
+int main(int argc, char* argv[]) {
+    // Arguments
+    // 1. Task file
+    // 2. Era
+    // 3. DoPUCorrection
+    // 4. DoL1PreFiringCorrection
+    // 5. DoRocco
+    // 6. DoIDSF
+    // 7. DoIsoSF
+    // 8. DoTrigSF
+    // Options after the positional arguments
+    // --threads <N> : Tasks analyzed by N concurrent threads (I/O statistics of the telemetry are then disabled)
+    // --fast-rocco, --rocco-replicas, --pu-json <file>, --muon-sf-json <file>, --telemetry <file>, --telemetry-interval <S>, --normalize <file> : see Main.cc
+    if (argc < 9) {
+        std::cerr << "[Error] DYmulti.cc - Usage: ./DYmulti <Task file> <Era> <DoPUCorrection> <DoL1PreFiringCorrection> <DoRocco> <DoIDSF> <DoIsoSF> <DoTrigSF> [--threads <N>] [--fast-rocco] [--rocco-replicas] [--pu-json <file>] [--muon-sf-json <file>] [--telemetry <file>] [--telemetry-interval <S>] [--normalize <file>]" << std::endl;
+        return 1;
+    }
+
+    int nThreads = 1;
+    bool bFastRocco = false;
+    bool bRoccoReplicas = false;
+    std::string sPUCorrectionFileName = "";
+    std::string sMuonSFCorrectionFileName = "";
+    std::string sTelemetryFileName = "-";
+    double dTelemetryInterval = 60.;
+    std::string sNormalizeIndexFileName = "";
+    for (int iArg = 9; iArg < argc; iArg++) {
+        std::string option = argv[iArg];
+        if (option == "--threads" && iArg + 1 < argc) {
+            nThreads = std::max(1, std::stoi(argv[++iArg]));
+        } else if (option == "--fast-rocco") {
+            bFastRocco = true;
+        } else if (option == "--rocco-replicas") {
+            bRoccoReplicas = true;
+        } else if ((option == "--pu-json" || option == "--muon-sf-json") && iArg + 1 < argc) {
+            if (option == "--pu-json") sPUCorrectionFileName = argv[++iArg];
+            else sMuonSFCorrectionFileName = argv[++iArg];
+        } else if (option == "--telemetry" && iArg + 1 < argc) {
+            sTelemetryFileName = argv[++iArg];
+        } else if (option == "--telemetry-interval" && iArg + 1 < argc) {
+            dTelemetryInterval = std::max(0., std::stod(argv[++iArg]));
+        } else if (option == "--normalize" && iArg + 1 < argc) {
+            sNormalizeIndexFileName = argv[++iArg];
+        } else {
+            std::cerr << "[Error] DYmulti.cc - Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    std::string sEra = argv[2];
+    bool bDoPUCorrection = std::stoi(argv[3]);
+    bool bDoL1PreFiringCorrection = std::stoi(argv[4]);
+    bool bDoRocco = std::stoi(argv[5]);
+    bool bDoIDSF = std::stoi(argv[6]);
+    bool bDoIsoSF = std::stoi(argv[7]);
+    bool bDoTrigSF = std::stoi(argv[8]);
+    AnalysisCorrections::Config cEraConfig = AnalysisCorrections::Config::ForEra(sEra);
+
+    std::vector<Task> vTasks;
+    SampleIndex cIndex;
+    try {
+        vTasks = ReadTasks(argv[1]);
+        if (!sNormalizeIndexFileName.empty() && !cIndex.Read(sNormalizeIndexFileName)) {
+            std::cerr << "[Error] DYmulti.cc - Cannot open " << sNormalizeIndexFileName << std::endl;
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[Error] DYmulti.cc - " << e.what() << std::endl;
+        return 1;
+    }
+    if (vTasks.empty()) {
+        std::cerr << "[Error] DYmulti.cc - No task in " << argv[1] << std::endl;
+        return 1;
+    }
+    nThreads = std::min<int>(nThreads, vTasks.size());
+
+    std::cout << "---------------------------------------------------------" << std::endl;
+    std::cout << "[Info] DYmulti.cc - Start DY analysis of " << vTasks.size() << " tasks, era " << sEra << ", " << nThreads << " threads" << std::endl;
+    std::cout << "---------------------------------------------------------" << std::endl;
+
+    // Histograms are owned by the analyzers, not by the current directory (thread-local with several threads)
+    TH1::AddDirectory(kFALSE);
+    if (nThreads > 1) ROOT::EnableThreadSafety();
+
+    auto MakeAnalyzer = [&](const Task& task) {
+        std::unique_ptr<DYanalyzer> analyzer(new DYanalyzer(task.sInputFileList, task.sProcessName, sEra, cEraConfig.sHistName_ID, cEraConfig.sHistName_Iso, cEraConfig.sHistName_Trig, cEraConfig.sRoccoFileName, task.bIsMC, bDoPUCorrection, bDoL1PreFiringCorrection, bDoRocco, bDoIDSF, bDoIsoSF, bDoTrigSF));
+        analyzer->SetFastRocco(bFastRocco);
+        analyzer->SetRoccoReplicas(bRoccoReplicas);
+        analyzer->SetPUCorrectionFileName(sPUCorrectionFileName);
+        analyzer->SetMuonSFCorrectionFileName(sMuonSFCorrectionFileName);
+        return analyzer;
+    };
+
+    // Corrections of the era, built once : the configuration does not depend on the task
+    std::shared_ptr<AnalysisCorrections> pCorrections;
+    try {
+        auto start = std::chrono::steady_clock::now();
+        pCorrections = std::make_shared<AnalysisCorrections>(MakeAnalyzer(vTasks[0])->GetCorrectionConfig());
+        std::cout << "[Info] DYmulti.cc - Corrections built in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "[Error] DYmulti.cc - " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Tasks are taken in order by the threads, a failed task does not stop the others
+    std::atomic<std::size_t> iNextTask(0);
+    std::mutex cFailedMutex;
+    std::vector<std::string> vFailed;
+    auto RunTasks = [&]() {
+        for (std::size_t iTask = iNextTask++; iTask < vTasks.size(); iTask = iNextTask++) {
+            const Task& task = vTasks[iTask];
+            try {
+                std::unique_ptr<DYanalyzer> analyzer = MakeAnalyzer(task);
+                if (!sNormalizeIndexFileName.empty() && task.bIsMC) analyzer->SetNormalizationScale(cIndex.GetNormalization(task.sProcessName, sEra));
+                analyzer->SetCorrections(pCorrections);
+                analyzer->SetTelemetry(sTelemetryFileName, dTelemetryInterval, nThreads == 1);
+                analyzer->Init();
+                analyzer->Analyze();
+
+                TFile* f_output = TFile::Open(task.sOutputFileName.c_str(), "RECREATE");
+                if (f_output == nullptr || f_output->IsZombie()) {
+                    delete f_output;
+                    throw std::runtime_error("Cannot open " + task.sOutputFileName);
+                }
+                analyzer->WriteHistograms(f_output);
+                // Inputs covered by this output, as for DYanalysis
+                analyzer->GetManifest().Write(f_output);
+                f_output->Close();
+                delete f_output;
+                std::cout << "[Info] DYmulti.cc - " << task.sProcessName << " is saved as " << task.sOutputFileName << std::endl;
+            } catch (const std::exception& e) {
+                std::cerr << "[Error] DYmulti.cc - " << task.sProcessName << ": " << e.what() << std::endl;
+                std::lock_guard<std::mutex> lock(cFailedMutex);
+                vFailed.push_back(task.sProcessName);
+            }
+        }
+    };
+
+    std::vector<std::thread> vThreads;
+    for (int iThread = 1; iThread < nThreads; iThread++) vThreads.emplace_back(RunTasks);
+    RunTasks();
+    for (std::thread& thread : vThreads) thread.join();
+
+    std::cout << "---------------------------------------------------------" << std::endl;
+    std::cout << "[Info] DYmulti.cc - " << vTasks.size() - vFailed.size() << "/" << vTasks.size() << " tasks are finished" << std::endl;
+    for (const std::string& processName : vFailed) std::cerr << "[Error] DYmulti.cc - Failed task: " << processName << std::endl;
+    std::cout << "---------------------------------------------------------" << std::endl;
+
+    return vFailed.empty() ? 0 : 1;
+}
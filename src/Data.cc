@@ -1,5 +1,54 @@
 #include "Data.h"
 
+// ROOT classes
+#include "TFile.h"
+#include "TROOT.h"
+
+// C++ classes
+#include <sstream>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+
+// POSIX
+#include <unistd.h>
+
+namespace {
+    // Number of entries of the Events tree of a file, false and the reason if it cannot be read
+    Bool_t CheckInput(const std::string& fileName, Int_t nRetries, Double_t retryDelay, Long64_t& entries, std::string& reason) {
+        for (Int_t attempt = 0; ; attempt++) {
+            {
+                TDirectory::TContext context;
+                std::unique_ptr<TFile> file(TFile::Open(fileName.c_str(), "READ"));
+                if (file != nullptr && !file->IsZombie()) {
+                    // The content is wrong, retrying does not help
+                    if (file->TestBit(TFile::kRecovered)) {
+                        reason = "file was not closed properly";
+                        return false;
+                    }
+                    TTree* tree = dynamic_cast<TTree*>(file->Get("Events"));
+                    if (tree == nullptr) {
+                        reason = "no Events tree";
+                        return false;
+                    }
+                    entries = tree->GetEntries();
+                    return true;
+                }
+            }
+            reason = "cannot be opened";
+            if (attempt >= nRetries) return false;
+            Double_t delay = retryDelay * (1 << attempt);
+            // One write per message, several threads report at the same time
+            std::ostringstream message;
+            message << "[Warning] Data::CheckInputs() - Cannot open " << fileName << ", retry " << attempt + 1 << "/" << nRetries << " in " << delay << " s\n";
+            std::cerr << message.str() << std::flush;
+            std::this_thread::sleep_for(std::chrono::duration<Double_t>(delay));
+        }
+    }
+}
+
 void Data::Init() {
     // Check if Data is already initialized
     if (bIsInit) {
@@ -10,44 +59,246 @@ void Data::Init() {
     // Initialize TChain
     fChain = new TChain("Events");
 
-    // Read input file list
-    std::ifstream infile(sInputFileList);
-    if (!infile) {
-        throw std::runtime_error("[Runtime Error] Data::Init() - Cannot open input file list: " + sInputFileList);
-    }
-
     // Add input files to TChain
     std::cout << "-----------------------------------------------------------" << std::endl;
     std::cout << "[Info] Data::Init() - Adding files to TChain" << std::endl;
-    std::string line;
-    int fileCount = 0;
-    while (std::getline(infile, line)) {
-        if (line.empty()) continue; // Skip empty lines
-        fChain->Add(line.c_str());
-        std::cout << "[Info] Data::Init() - Adding file: " << line << std::endl;
-        fileCount++;
+    std::vector<std::string> fileNames = ReadFileList(sInputFileList, sSkipFiles);
+    if (!sSkipFiles.empty()) std::cout << "[Info] Data::Init() - Skipping " << sSkipFiles.size() << " already processed files" << std::endl;
+    // Unreadable files are left out of the chain, the job runs on the others
+    if (!bHasInputCheck) cInputCheck = CheckInputs(fileNames, mKnownEntries, kInputCheckThreads, nInputRetries, dInputRetryDelay);
+    vSkippedInputs = cInputCheck.vSkipped;
+    // A resumed job also starts with the entries skipped before its checkpoint (nLastEntry >= 0)
+    for (const SkippedInput& skipped : vSkippedInputs) {
+        if (skipped.nLastEntry < 0) std::cerr << "[Warning] Data::Init() - Skipping unreadable file: " << skipped.sFileName << " (" << skipped.sReason << ")" << std::endl;
+        else std::cerr << "[Warning] Data::Init() - Entries " << skipped.nFirstEntry << " - " << skipped.nLastEntry << " of " << skipped.sFileName << " were not read (" << skipped.sReason << ")" << std::endl;
+    }
+    vFileNames = cInputCheck.vFileNames;
+    for (std::size_t i = 0; i < vFileNames.size(); i++) {
+        // The tree header is read again at Add() unless the number of entries is given
+        if (cInputCheck.vEntries[i] > 0) fChain->Add(vFileNames[i].c_str(), cInputCheck.vEntries[i]);
+        else fChain->Add(vFileNames[i].c_str());
+        std::cout << "[Info] Data::Init() - Adding file: " << vFileNames[i] << std::endl;
     }
-    infile.close();
-    std::cout << "[Info] Data::Init() - Added " << fileCount << " files to TChain" << std::endl;
+    std::cout << "[Info] Data::Init() - Added " << vFileNames.size() << " files to TChain" << std::endl;
     std::cout << "-----------------------------------------------------------" << std::endl;
 
     // Initialize TTreeReader
     fReader = new TTreeReader(fChain);
     // Load branches
     this->LoadBranches();
-    // Set total events
+    // Set total events, restricted to the entry range if it is set
     nTotalEvents = fChain->GetEntries();
+    if (nFirstEntry > 0 || nLastEntry >= 0) {
+        nLastEntry = (nLastEntry < 0) ? nTotalEvents : std::min(nLastEntry, nTotalEvents);
+        nFirstEntry = std::min(nFirstEntry, nLastEntry);
+        fReader->SetEntriesRange(nFirstEntry, nLastEntry);
+        nTotalEvents = nLastEntry - nFirstEntry;
+    }
     // Print initialization information
     this->PrintInitInfo();
     // Set bIsInit to true
     bIsInit = true;
 }
 
+std::vector<std::string> Data::ReadFileList(const std::string& inputFileList, const std::set<std::string>& skipFiles) {
+    std::ifstream infile(inputFileList);
+    if (!infile) {
+        throw std::runtime_error("[Runtime Error] Data::ReadFileList() - Cannot open input file list: " + inputFileList);
+    }
+    std::vector<std::string> fileNames;
+    std::string line;
+    while (std::getline(infile, line)) {
+        if (line.empty()) continue; // Skip empty lines
+        // List of lists, e.g. fileList/<era>/<process>.txt which lists the lists of the condor jobs
+        if (line.size() > 4 && line.compare(line.size() - 4, 4, ".txt") == 0) {
+            std::vector<std::string> nested = ReadFileList(line, skipFiles);
+            fileNames.insert(fileNames.end(), nested.begin(), nested.end());
+            continue;
+        }
+        if (skipFiles.count(line) > 0) continue;
+        fileNames.push_back(line);
+    }
+    return fileNames;
+}
+
+Long64_t Data::InputCheck::GetTotalEntries() const {
+    Long64_t total = 0;
+    for (Long64_t entries : vEntries) total += entries;
+    return total;
+}
+
+std::string Data::InputCheck::ToString() const {
+    // Tabs and newlines would break the fields, they cannot appear in file names and are replaced in the reasons
+    auto Clean = [](std::string text) {
+        std::replace(text.begin(), text.end(), '\t', ' ');
+        std::replace(text.begin(), text.end(), '\n', ' ');
+        return text;
+    };
+    std::ostringstream text;
+    for (std::size_t i = 0; i < vFileNames.size(); i++) text << "file\t" << vEntries[i] << "\t" << vFileNames[i] << "\n";
+    for (const SkippedInput& skipped : vSkipped) {
+        text << "skipped\t" << skipped.nFirstEntry << "\t" << skipped.nLastEntry << "\t" << skipped.sFileName << "\t" << Clean(skipped.sReason) << "\n";
+    }
+    return text.str();
+}
+
+Data::InputCheck Data::InputCheck::FromString(const std::string& text) {
+    InputCheck result;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.empty()) continue;
+        std::vector<std::string> fields;
+        std::istringstream tokens(line);
+        for (std::string field; std::getline(tokens, field, '\t'); ) fields.push_back(field);
+        try {
+            if (fields.size() == 3 && fields[0] == "file") {
+                result.vEntries.push_back(std::stoll(fields[1]));
+                result.vFileNames.push_back(fields[2]);
+                continue;
+            }
+            if (fields.size() >= 4 && fields[0] == "skipped") {
+                SkippedInput skipped;
+                skipped.nFirstEntry = std::stoll(fields[1]);
+                skipped.nLastEntry = std::stoll(fields[2]);
+                skipped.sFileName = fields[3];
+                if (fields.size() > 4) skipped.sReason = fields[4];
+                result.vSkipped.push_back(skipped);
+                continue;
+            }
+        } catch (const std::exception&) {}
+        throw std::runtime_error("[Runtime Error] Data::InputCheck::FromString() - Invalid line: " + line);
+    }
+    return result;
+}
+
+Bool_t Data::InputCheck::Read(const std::string& fileName) {
+    std::ifstream file(fileName);
+    if (!file.is_open()) return false;
+    std::ostringstream text;
+    text << file.rdbuf();
+    *this = FromString(text.str());
+    return true;
+}
+
+Bool_t Data::InputCheck::Write(const std::string& fileName) const {
+    std::string tmpName = fileName + ".tmp" + std::to_string((long)getpid());
+    std::ofstream file(tmpName);
+    if (!file.is_open()) return false;
+    file << ToString();
+    file.close();
+    if (!file || std::rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+Data::InputCheck Data::CheckInputs(const std::vector<std::string>& fileNames, const std::map<std::string, Long64_t>& knownEntries,
+                                   Int_t nThreads, Int_t nRetries, Double_t retryDelay) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Long64_t> entries(fileNames.size(), 0);
+    std::vector<std::string> reasons(fileNames.size());
+    std::vector<char> isReadable(fileNames.size(), 0); // Not vector<bool> : written by several threads
+    std::vector<std::size_t> toOpen;
+    for (std::size_t i = 0; i < fileNames.size(); i++) {
+        auto known = knownEntries.find(fileNames[i]);
+        if (known != knownEntries.end()) {
+            entries[i] = known->second;
+            isReadable[i] = 1;
+        } else {
+            toOpen.push_back(i);
+        }
+    }
+
+    // Files are taken in order by the threads
+    nThreads = std::max(1, std::min<Int_t>(nThreads, toOpen.size()));
+    if (nThreads > 1) ROOT::EnableThreadSafety();
+    std::atomic<std::size_t> iNext(0);
+    auto CheckFiles = [&]() {
+        for (std::size_t k = iNext++; k < toOpen.size(); k = iNext++) {
+            const std::size_t i = toOpen[k];
+            isReadable[i] = CheckInput(fileNames[i], nRetries, retryDelay, entries[i], reasons[i]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (Int_t iThread = 1; iThread < nThreads; iThread++) threads.emplace_back(CheckFiles);
+    CheckFiles();
+    for (std::thread& thread : threads) thread.join();
+
+    InputCheck result;
+    for (std::size_t i = 0; i < fileNames.size(); i++) {
+        if (isReadable[i]) {
+            result.vFileNames.push_back(fileNames[i]);
+            result.vEntries.push_back(entries[i]);
+        } else {
+            SkippedInput skipped;
+            skipped.sFileName = fileNames[i];
+            skipped.sReason = reasons[i];
+            result.vSkipped.push_back(skipped);
+        }
+    }
+    std::cout << "[Info] Data::CheckInputs() - " << toOpen.size() << " files checked in " << std::chrono::duration<Double_t>(std::chrono::steady_clock::now() - start).count()
+              << " s with " << nThreads << " threads, " << result.vSkipped.size() << " unreadable" << std::endl;
+    return result;
+}
+
+Bool_t Data::RecoverNextEntry() {
+    // Other statuses are the end of the entries, or errors of the setup that skipping a file does not fix
+    TTreeReader::EEntryStatus status = fReader->GetEntryStatus();
+    if (status != TTreeReader::kEntryChainFileError && status != TTreeReader::kEntryUnknownError) return false;
+
+    const Long64_t entry = fReader->GetCurrentEntry();
+    for (Int_t attempt = 0; attempt < nInputRetries; attempt++) {
+        Double_t delay = dInputRetryDelay * (1 << attempt);
+        std::cerr << "[Warning] Data::RecoverNextEntry() - Cannot read entry " << entry << " (status " << status << "), retry " << attempt + 1 << "/" << nInputRetries << " in " << delay << " s" << std::endl;
+        std::this_thread::sleep_for(std::chrono::duration<Double_t>(delay));
+        // The next call of Next() reads the entry after it
+        status = fReader->SetEntry(entry);
+        if (status == TTreeReader::kEntryValid) return true;
+    }
+
+    // File of the entry, the offsets of all files are known since Init()
+    const Long64_t* offsets = fChain->GetTreeOffset();
+    const Int_t nFiles = vFileNames.size();
+    const Int_t iFile = std::upper_bound(offsets, offsets + nFiles + 1, entry) - offsets - 1;
+    if (iFile < 0 || iFile >= nFiles) {
+        throw std::runtime_error("[Runtime Error] Data::RecoverNextEntry() - Entry " + std::to_string(entry) + " is outside the chain");
+    }
+    const Long64_t endEntry = (nLastEntry >= 0) ? nLastEntry : offsets[nFiles];
+    const Long64_t nextFileEntry = offsets[iFile + 1];
+    SkippedInput skipped;
+    skipped.sFileName = vFileNames[iFile];
+    skipped.nFirstEntry = entry - offsets[iFile];
+    skipped.nLastEntry = std::min(nextFileEntry, endEntry) - offsets[iFile];
+    skipped.sReason = "read error at entry " + std::to_string(skipped.nFirstEntry);
+    vSkippedInputs.push_back(skipped);
+    std::cerr << "[Warning] Data::RecoverNextEntry() - Skipping entries " << skipped.nFirstEntry << " - " << skipped.nLastEntry << " of " << skipped.sFileName << std::endl;
+
+    if (nextFileEntry >= endEntry) return false;
+    if (fReader->SetEntry(nextFileEntry) == TTreeReader::kEntryValid) return true;
+    // The next file fails as well
+    return RecoverNextEntry();
+}
+
+std::vector<Long64_t> Data::GetFileEntries() {
+    // Tree offsets are known once the chain has counted its entries (Init())
+    std::vector<Long64_t> fileEntries(vFileNames.size(), 0);
+    const Long64_t* offsets = fChain->GetTreeOffset();
+    if (offsets == nullptr || fChain->GetNtrees() != (Int_t)vFileNames.size()) {
+        throw std::runtime_error("[Runtime Error] Data::GetFileEntries() - Entries of the chain files are not known");
+    }
+    for (std::size_t i = 0; i < vFileNames.size(); i++) fileEntries[i] = offsets[i + 1] - offsets[i];
+    return fileEntries;
+}
+
 void Data::PrintInitInfo() {
     std::cout << "-----------------------------------------------------------" << std::endl;
     std::cout << "[Info] Data::PrintInitInfo() - Data is initialized" << std::endl;
     std::cout << "[Info] Data::PrintInitInfo() - Input File List: " << sInputFileList << std::endl;
     std::cout << "[Info] Data::PrintInitInfo() - Total Events: " << nTotalEvents << std::endl;
+    if (nFirstEntry > 0 || nLastEntry >= 0) std::cout << "[Info] Data::PrintInitInfo() - Entry range: " << nFirstEntry << " - " << nLastEntry << std::endl;
+    if (!vSkippedInputs.empty()) std::cout << "[Info] Data::PrintInitInfo() - Unreadable files skipped: " << vSkippedInputs.size() << std::endl;
     std::cout << "-----------------------------------------------------------" << std::endl;    
 }
 
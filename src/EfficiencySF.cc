@@ -10,38 +10,38 @@ void EfficiencySF::Init() {
         return;
     }
 
-    // Open files
-    fFile_ID = new TFile(Form("../muonSF/%s_ID.root", sEra.c_str()), "READ");
-    fFile_Iso = new TFile(Form("../muonSF/%s_Iso.root", sEra.c_str()), "READ");
-    fFile_Trig = new TFile(Form("../muonSF/%s_Trig.root", sEra.c_str()), "READ");
-
-    // Get histograms
-    hHist_ID   = (TH2F*) fFile_ID->Get(sHistName_ID.c_str());
-    hHist_Iso  = (TH2F*) fFile_Iso->Get(sHistName_Iso.c_str());
-    hHist_Trig = (TH2F*) fFile_Trig->Get(sHistName_Trig.c_str());
-
-    // X-axis : Eta, Y-axis : pT
-    tAxis_ID_pt    = hHist_ID  ->GetYaxis(); tAxis_ID_eta   = hHist_ID  ->GetXaxis();
-    tAxis_Iso_pt   = hHist_Iso ->GetYaxis(); tAxis_Iso_eta  = hHist_Iso ->GetXaxis();
-    tAxis_Trig_pt  = hHist_Trig->GetYaxis(); tAxis_Trig_eta = hHist_Trig->GetXaxis();
-
-    // Get the corresponding pT and Eta range from histograms
-    // Axis minimum : Low edge of the first bin
-    // Axis maximum : Up edge of the last bin = Low edge of the overflow bin (last bin + 1)
-    dValidPtMin_ID  = tAxis_ID_pt ->GetBinLowEdge(1);
-    dValidPtMax_ID  = tAxis_ID_pt ->GetBinLowEdge(tAxis_ID_pt->GetNbins() + 1);
-    dValidEtaMin_ID = tAxis_ID_eta->GetBinLowEdge(1);
-    dValidEtaMax_ID = tAxis_ID_eta->GetBinLowEdge(tAxis_ID_eta->GetNbins() + 1);
-    
-    dValidPtMin_Iso  = tAxis_Iso_pt ->GetBinLowEdge(1);
-    dValidPtMax_Iso  = tAxis_Iso_pt ->GetBinLowEdge(tAxis_Iso_pt->GetNbins() + 1);
-    dValidEtaMin_Iso = tAxis_Iso_eta->GetBinLowEdge(1);
-    dValidEtaMax_Iso = tAxis_Iso_eta->GetBinLowEdge(tAxis_Iso_eta->GetNbins() + 1);
-    
-    dValidPtMin_Trig  = tAxis_Trig_pt ->GetBinLowEdge(1);
-    dValidPtMax_Trig  = tAxis_Trig_pt ->GetBinLowEdge(tAxis_Trig_pt->GetNbins() + 1);
-    dValidEtaMin_Trig = tAxis_Trig_eta->GetBinLowEdge(1);
-    dValidEtaMax_Trig = tAxis_Trig_eta->GetBinLowEdge(tAxis_Trig_eta->GetNbins() + 1);
+    if (!sCorrectionFileName.empty()) {
+        pCorrectionSet = CorrectionSet::Open(sCorrectionFileName);
+        LoadCorrection(sHistName_ID, cCorrection_ID);
+        LoadCorrection(sHistName_Iso, cCorrection_Iso);
+        LoadCorrection(sHistName_Trig, cCorrection_Trig);
+        bUseCorrection = true;
+        PrintInitInfo();
+        bIsInit = true;
+        return;
+    }
+
+    // Relative to the source directory, the ROOT files are read from ../ if the maps are not embedded
+    sFileName_ID   = Form("muonSF/%s_ID.root", sEra.c_str());
+    sFileName_Iso  = Form("muonSF/%s_Iso.root", sEra.c_str());
+    sFileName_Trig = Form("muonSF/%s_Trig.root", sEra.c_str());
+
+    // Convert histograms to flat tables
+    nEmbeddedTables = 0;
+    nSharedTables = 0;
+    LoadTable(sFileName_ID, sHistName_ID, cTable_ID);
+    LoadTable(sFileName_Iso, sHistName_Iso, cTable_Iso);
+    LoadTable(sFileName_Trig, sHistName_Trig, cTable_Trig);
+
+    // Merge the lookups if the binning is shared, and precompute the product of SFs
+    bIsSharedBinning = cTable_ID.HasSameBinning(cTable_Iso) && cTable_ID.HasSameBinning(cTable_Trig);
+    vProduct.clear();
+    if (bIsSharedBinning) {
+        vProduct.resize(cTable_ID.GetNCells());
+        for (std::size_t i = 0; i < vProduct.size(); i++) {
+            vProduct[i] = cTable_ID.pValue[i] * cTable_Iso.pValue[i] * cTable_Trig.pValue[i];
+        }
+    }
 
     // Print initialization information
     PrintInitInfo();
@@ -49,86 +49,226 @@ void EfficiencySF::Init() {
     bIsInit = true;
 }
 
+// Use the map embedded at build time if available,
+// otherwise attach the table of the node-wide correction store, built from the TH2F if it is not there yet
+// X-axis : Eta, Y-axis : pT
+void EfficiencySF::LoadTable(const std::string& fileName, const std::string& histName, SFTable2D& table) {
+    const CalibHist* hist = CalibTables::Find(fileName, histName);
+    if (hist != nullptr && hist->nY > 0) {
+        table.SetView(*hist);
+        nEmbeddedTables++;
+        return;
+    }
+
+    ULong64_t checksum = CorrectionStore::ChecksumFile("../" + fileName, CorrectionStore::Checksum(fileName + ":" + histName));
+    table.SetView(CorrectionStore::Get("SF-" + fileName + "-" + histName, checksum, [&]() {
+        return ReadTable(fileName, histName);
+    }));
+    if (table.pSegment->IsShared()) nSharedTables++;
+}
+
+// Copy the bin edges, contents and errors of the TH2F, then close the file
+std::string EfficiencySF::ReadTable(const std::string& fileName, const std::string& histName) {
+    TFile* f = new TFile(("../" + fileName).c_str(), "READ");
+    TH2F* h = (TH2F*) f->Get(histName.c_str());
+    if (h == nullptr) {
+        delete f;
+        throw std::runtime_error("[Runtime Error] EfficiencySF::ReadTable() - Cannot find " + histName + " in ../" + fileName);
+    }
+
+    TAxis* axis_eta = h->GetXaxis();
+    TAxis* axis_pt  = h->GetYaxis();
+    Int_t nEta = axis_eta->GetNbins();
+    Int_t nPt  = axis_pt->GetNbins();
+
+    // Same layout as SFTable2D::SetView()
+    // Axis maximum : Up edge of the last bin = Low edge of the overflow bin (last bin + 1)
+    std::vector<Double_t> data(2 + (nEta + 1) + (nPt + 1) + 2 * nEta * nPt);
+    Double_t* etaEdges = data.data() + 2;
+    Double_t* ptEdges = etaEdges + nEta + 1;
+    Double_t* value = ptEdges + nPt + 1;
+    Double_t* error = value + nEta * nPt;
+    data[0] = nEta;
+    data[1] = nPt;
+    for (Int_t i = 0; i <= nEta; i++) etaEdges[i] = axis_eta->GetBinLowEdge(i + 1);
+    for (Int_t i = 0; i <= nPt; i++) ptEdges[i] = axis_pt->GetBinLowEdge(i + 1);
+    for (Int_t iEta = 0; iEta < nEta; iEta++) {
+        for (Int_t iPt = 0; iPt < nPt; iPt++) {
+            value[iEta * nPt + iPt] = h->GetBinContent(iEta + 1, iPt + 1);
+            error[iEta * nPt + iPt] = h->GetBinError(iEta + 1, iPt + 1);
+        }
+    }
+
+    // Histogram is owned by the file
+    f->Close();
+    delete f;
+    return std::string((const char*)data.data(), data.size() * sizeof(Double_t));
+}
+
+void EfficiencySF::LoadCorrection(const std::string& histName, SFCorrection& correction) {
+    const std::string suffix = "_abseta_pt";
+    correction = SFCorrection();
+    correction.pCorrection = pCorrectionSet->Find(histName);
+    if (correction.pCorrection == nullptr && histName.size() > suffix.size()
+        && histName.compare(histName.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        correction.pCorrection = pCorrectionSet->Find(histName.substr(0, histName.size() - suffix.size()));
+    }
+    if (correction.pCorrection == nullptr) {
+        throw std::runtime_error("[Runtime Error] EfficiencySF::LoadCorrection() - Cannot find " + histName + " in " + sCorrectionFileName);
+    }
+
+    const Correction& corr = *correction.pCorrection;
+    correction.bIsAbsEta = (corr.GetInputIndex("abseta") >= 0);
+    correction.iEtaInput = corr.GetInputIndex(correction.bIsAbsEta ? "abseta" : "eta");
+    correction.iPtInput = corr.GetInputIndex("pt");
+    correction.iTypeInput = corr.GetInputIndex("scale_factors");
+    if (correction.iTypeInput < 0) correction.iTypeInput = corr.GetInputIndex("ValType");
+    if (corr.GetNInputs() != 3 || correction.iEtaInput < 0 || correction.iPtInput < 0 || correction.iTypeInput < 0) {
+        throw std::runtime_error("[Runtime Error] EfficiencySF::LoadCorrection() - Unexpected inputs of " + corr.GetName());
+    }
+
+    correction.dNominalId = corr.GetStringId(correction.iTypeInput, "nominal");
+    if (correction.dNominalId < 0.) correction.dNominalId = corr.GetStringId(correction.iTypeInput, "sf");
+    if (correction.dNominalId < 0.) {
+        throw std::runtime_error("[Runtime Error] EfficiencySF::LoadCorrection() - No nominal SF in " + corr.GetName());
+    }
+    correction.dSystId = corr.GetStringId(correction.iTypeInput, "syst");
+    correction.dStatId = corr.GetStringId(correction.iTypeInput, "stat");
+    correction.dPtMin = corr.GetInputLowEdge(correction.iPtInput);
+}
+
 void EfficiencySF::Clear() {
-    // Do not manually delete the axes because they are owned by the histograms.
-    delete hHist_ID;
-    delete hHist_Iso;
-    delete hHist_Trig;
-
-    fFile_ID->Close();
-    fFile_Iso->Close();
-    fFile_Trig->Close();
+    cTable_ID = SFTable2D();
+    cTable_Iso = SFTable2D();
+    cTable_Trig = SFTable2D();
+    vProduct.clear();
+    bIsSharedBinning = false;
+    cCorrection_ID = SFCorrection();
+    cCorrection_Iso = SFCorrection();
+    cCorrection_Trig = SFCorrection();
+    pCorrectionSet.reset();
+    bUseCorrection = false;
+    bIsInit = false;
 }
 
 void EfficiencySF::PrintInitInfo() {
     std::cout << "----------------------------------------------------------" << std::endl;
     std::cout << "[Info] EfficiencySF::PrintInitInfo() - EfficiencySF is initialized" << std::endl;
     std::cout << "[Info] EfficiencySF::PrintInitInfo() - Era: " << sEra << std::endl;
-    std::cout << "[Info] EfficiencySF::PrintInitInfo() - ID File: " << fFile_ID->GetName() << std::endl;
+    if (bUseCorrection) {
+        std::cout << "[Info] EfficiencySF::PrintInitInfo() - Correction file: " << sCorrectionFileName << std::endl;
+        std::cout << "[Info] EfficiencySF::PrintInitInfo() - ID Correction: " << cCorrection_ID.pCorrection->GetName() << std::endl;
+        std::cout << "[Info] EfficiencySF::PrintInitInfo() - Iso Correction: " << cCorrection_Iso.pCorrection->GetName() << std::endl;
+        std::cout << "[Info] EfficiencySF::PrintInitInfo() - Trig Correction: " << cCorrection_Trig.pCorrection->GetName() << std::endl;
+        std::cout << "[Info] EfficiencySF::PrintInitInfo() - Trig pT minimum: " << cCorrection_Trig.dPtMin << std::endl;
+        std::cout << "----------------------------------------------------------" << std::endl;
+        return;
+    }
+    std::cout << "[Info] EfficiencySF::PrintInitInfo() - ID File: " << sFileName_ID << std::endl;
     std::cout << "[Info] EfficiencySF::PrintInitInfo() - ID Histogram Name: " << sHistName_ID << std::endl;
-    std::cout << "[Info] EfficiencySF::PrintInitInfo() - Iso File: " << fFile_Iso->GetName() << std::endl;
+    std::cout << "[Info] EfficiencySF::PrintInitInfo() - Iso File: " << sFileName_Iso << std::endl;
     std::cout << "[Info] EfficiencySF::PrintInitInfo() - Iso Histogram Name: " << sHistName_Iso << std::endl;
-    std::cout << "[Info] EfficiencySF::PrintInitInfo() - Trig File: " << fFile_Trig->GetName() << std::endl;
+    std::cout << "[Info] EfficiencySF::PrintInitInfo() - Trig File: " << sFileName_Trig << std::endl;
     std::cout << "[Info] EfficiencySF::PrintInitInfo() - Trig Histogram Name: " << sHistName_Trig << std::endl;
-    std::cout << "[Info] EfficiencySF::PrintInitInfo() - ID pT range: " << dValidPtMin_ID << " - " << dValidPtMax_ID << std::endl;
-    std::cout << "[Info] EfficiencySF::PrintInitInfo() - ID eta range: " << dValidEtaMin_ID << " - " << dValidEtaMax_ID << std::endl;
-    std::cout << "[Info] EfficiencySF::PrintInitInfo() - Iso pT range: " << dValidPtMin_Iso << " - " << dValidPtMax_Iso << std::endl;
-    std::cout << "[Info] EfficiencySF::PrintInitInfo() - Iso eta range: " << dValidEtaMin_Iso << " - " << dValidEtaMax_Iso << std::endl;
-    std::cout << "[Info] EfficiencySF::PrintInitInfo() - Trig pT range: " << dValidPtMin_Trig << " - " << dValidPtMax_Trig << std::endl;
-    std::cout << "[Info] EfficiencySF::PrintInitInfo() - Trig eta range: " << dValidEtaMin_Trig << " - " << dValidEtaMax_Trig << std::endl;
+    std::cout << "[Info] EfficiencySF::PrintInitInfo() - ID pT range: " << cTable_ID.GetPtMin() << " - " << cTable_ID.GetPtMax() << std::endl;
+    std::cout << "[Info] EfficiencySF::PrintInitInfo() - ID eta range: " << cTable_ID.GetEtaMin() << " - " << cTable_ID.GetEtaMax() << std::endl;
+    std::cout << "[Info] EfficiencySF::PrintInitInfo() - Iso pT range: " << cTable_Iso.GetPtMin() << " - " << cTable_Iso.GetPtMax() << std::endl;
+    std::cout << "[Info] EfficiencySF::PrintInitInfo() - Iso eta range: " << cTable_Iso.GetEtaMin() << " - " << cTable_Iso.GetEtaMax() << std::endl;
+    std::cout << "[Info] EfficiencySF::PrintInitInfo() - Trig pT range: " << cTable_Trig.GetPtMin() << " - " << cTable_Trig.GetPtMax() << std::endl;
+    std::cout << "[Info] EfficiencySF::PrintInitInfo() - Trig eta range: " << cTable_Trig.GetEtaMin() << " - " << cTable_Trig.GetEtaMax() << std::endl;
+    std::cout << "[Info] EfficiencySF::PrintInitInfo() - # of maps embedded at build time: " << nEmbeddedTables << " / 3" << std::endl;
+    std::cout << "[Info] EfficiencySF::PrintInitInfo() - # of maps shared through the correction store: " << nSharedTables << " / 3" << std::endl;
+    std::cout << "[Info] EfficiencySF::PrintInitInfo() - Shared binning of ID, Iso and Trig: " << (bIsSharedBinning ? "true" : "false") << std::endl;
     std::cout << "----------------------------------------------------------" << std::endl;
 }   
 
-std::vector<Double_t> EfficiencySF::GetEfficiency(Double_t pt, Double_t eta) {
+std::array<Double_t, 3> EfficiencySF::GetEfficiency(Double_t pt, Double_t eta) {
+    EfficiencySFResult sf = GetSF(pt, eta);
+    return std::array<Double_t, 3> {sf.dID, sf.dIso, sf.dTrig};
+}
+
+// pt and |eta| outside of the maps are clamped to the first or the last bin
+// For Trigger SF, if pt is underflow, efficiency is 0.
+// This is to use trigger efficiency after its turn-on curve
+EfficiencySFResult EfficiencySF::GetSF(Double_t pt, Double_t eta) {
+    EfficiencySFResult sf;
+    GetSF(1, &pt, &eta, &sf);
+    return sf;
+}
+
+Double_t EfficiencySF::GetSFProduct(Double_t pt, Double_t eta) {
+    Double_t sfProduct = 0.;
+    GetSFProduct(1, &pt, &eta, &sfProduct);
+    return sfProduct;
+}
+
+void EfficiencySF::GetSF(std::size_t n, const Double_t* pt, const Double_t* eta, EfficiencySFResult* sf) {
+    // Check if initialized
+    if (!bIsInit) {
+        std::cerr << "[ERROR] EfficiencySF::GetSF() - Not initialized" << std::endl;
+        std::fill(sf, sf + n, EfficiencySFResult());
+        return;
+    }
+
+    if (bUseCorrection) {
+        for (std::size_t i = 0; i < n; i++) {
+            Bool_t isTrigValid = (pt[i] >= cCorrection_Trig.dPtMin);
+            sf[i].dID      = cCorrection_ID.Evaluate(pt[i], eta[i], cCorrection_ID.dNominalId);
+            sf[i].dIDErr   = cCorrection_ID.EvaluateError(pt[i], eta[i]);
+            sf[i].dIso     = cCorrection_Iso.Evaluate(pt[i], eta[i], cCorrection_Iso.dNominalId);
+            sf[i].dIsoErr  = cCorrection_Iso.EvaluateError(pt[i], eta[i]);
+            sf[i].dTrig    = isTrigValid ? cCorrection_Trig.Evaluate(pt[i], eta[i], cCorrection_Trig.dNominalId) : 0.;
+            sf[i].dTrigErr = isTrigValid ? cCorrection_Trig.EvaluateError(pt[i], eta[i]) : 0.;
+        }
+        return;
+    }
+
+    const Double_t trigPtMin = cTable_Trig.GetPtMin();
+    for (std::size_t i = 0; i < n; i++) {
+        Double_t abs_eta = std::abs(eta[i]);
+        Int_t cell_ID = cTable_ID.FindCell(pt[i], abs_eta);
+        Int_t cell_Iso = bIsSharedBinning ? cell_ID : cTable_Iso.FindCell(pt[i], abs_eta);
+        Int_t cell_Trig = bIsSharedBinning ? cell_ID : cTable_Trig.FindCell(pt[i], abs_eta);
+
+        Bool_t isTrigValid = (pt[i] >= trigPtMin);
+        sf[i].dID      = cTable_ID.pValue[cell_ID];
+        sf[i].dIDErr   = cTable_ID.pError[cell_ID];
+        sf[i].dIso     = cTable_Iso.pValue[cell_Iso];
+        sf[i].dIsoErr  = cTable_Iso.pError[cell_Iso];
+        sf[i].dTrig    = isTrigValid ? cTable_Trig.pValue[cell_Trig] : 0.;
+        sf[i].dTrigErr = isTrigValid ? cTable_Trig.pError[cell_Trig] : 0.;
+    }
+}
+
+void EfficiencySF::GetSFProduct(std::size_t n, const Double_t* pt, const Double_t* eta, Double_t* sfProduct) {
     // Check if initialized
     if (!bIsInit) {
-        std::cerr << "[ERROR] EfficiencySF::GetEfficiency() - Not initialized" << std::endl;
-        return std::vector<Double_t> {0., 0., 0.};
-    }
-
-    // Set variables
-    Double_t abs_eta = std::abs(eta);
-    
-    // Clamp : std::clamp(value, min, max) : return value if value is between min and max, otherwise return min or max
-    // Clamp the pt and eta to the valid range
-    // For lower edge, it is okay to find the bin with the lower edge
-    // But for the upper edge, FindBin(upper edge) will return the overflow bin number so we subtract a small number from the upper edge
-    // Double_t clampedPt_ID  = std::clamp(pt, dValidPtMin_ID, dValidPtMax_ID - dValidPtMax_ID/1000.);
-    Double_t clampedPt_ID = (pt >= dValidPtMax_ID) ? dValidPtMax_ID - dValidPtMax_ID/1000. : (pt < dValidPtMin_ID) ? dValidPtMin_ID : pt;
-    // Double_t clampedEta_ID = std::clamp(abs_eta, dValidEtaMin_ID, dValidEtaMax_ID - dValidEtaMax_ID/1000.);
-    Double_t clampedEta_ID = (abs_eta >= dValidEtaMax_ID) ? dValidEtaMax_ID - dValidEtaMax_ID/1000. : (abs_eta < dValidEtaMin_ID) ? dValidEtaMin_ID : abs_eta;
-
-    // Double_t clampedPt_Iso  = std::clamp(pt, dValidPtMin_Iso, dValidPtMax_Iso - dValidPtMax_Iso/1000.);
-    // Double_t clampedEta_Iso = std::clamp(abs_eta, dValidEtaMin_Iso, dValidEtaMax_Iso - dValidEtaMax_Iso/1000.);
-    Double_t clampedPt_Iso = (pt >= dValidPtMax_Iso) ? dValidPtMax_Iso - dValidPtMax_Iso/1000. : (pt < dValidPtMin_Iso) ? dValidPtMin_Iso : pt;
-    Double_t clampedEta_Iso = (abs_eta >= dValidEtaMax_Iso) ? dValidEtaMax_Iso - dValidEtaMax_Iso/1000. : (abs_eta < dValidEtaMin_Iso) ? dValidEtaMin_Iso : abs_eta;
-
-    // Double_t clampedPt_Trig  = std::clamp(pt, dValidPtMin_Trig, dValidPtMax_Trig - dValidPtMax_Trig/1000.);
-    // Double_t clampedEta_Trig = std::clamp(abs_eta, dValidEtaMin_Trig, dValidEtaMax_Trig - dValidEtaMax_Trig/1000.);
-    Double_t clampedPt_Trig = (pt >= dValidPtMax_Trig) ? dValidPtMax_Trig - dValidPtMax_Trig/1000. : (pt < dValidPtMin_Trig) ? dValidPtMin_Trig : pt;
-    Double_t clampedEta_Trig = (abs_eta >= dValidEtaMax_Trig) ? dValidEtaMax_Trig - dValidEtaMax_Trig/1000. : (abs_eta < dValidEtaMin_Trig) ? dValidEtaMin_Trig : abs_eta;
-
-    // Get the bin number using the clamped values
-    Int_t bin_ID   = hHist_ID  ->FindBin(clampedEta_ID, clampedPt_ID);
-    Int_t bin_Iso  = hHist_Iso ->FindBin(clampedEta_Iso, clampedPt_Iso);
-    Int_t bin_Trig = hHist_Trig->FindBin(clampedEta_Trig, clampedPt_Trig);
-    // Get the bin content
-    Double_t eff_ID   = hHist_ID  ->GetBinContent(bin_ID);
-    Double_t eff_Iso  = hHist_Iso ->GetBinContent(bin_Iso);
-    Double_t eff_Trig = hHist_Trig->GetBinContent(bin_Trig);
-    // For Trigger SF, if pt is underflow, efficiency is 0.
-    // This is to use trigger efficiency after its turn-on curve
-    if (pt < dValidPtMin_Trig) {
-        eff_Trig = 0.;
-    }
-    
-    // // For debugging
-    // std::cout << "----------------------------------------------------------" << std::endl;
-    // std::cout << "pt: " << pt << ", eta: " << eta << ", eff_ID: " << eff_ID << ", eff_Iso: " << eff_Iso << ", eff_Trig: " << eff_Trig << std::endl;
-    // std::cout << "ID bin: " << bin_ID << ", clampedEta_ID: " << clampedEta_ID << ", clampedPt_ID: " << clampedPt_ID << std::endl;
-    // std::cout << "Iso bin: " << bin_Iso << ", clampedEta_Iso: " << clampedEta_Iso << ", clampedPt_Iso: " << clampedPt_Iso << std::endl;
-    // std::cout << "Trig bin: " << bin_Trig << ", clampedEta_Trig: " << clampedEta_Trig << ", clampedPt_Trig: " << clampedPt_Trig << std::endl;
-    // std::cout << "----------------------------------------------------------" << std::endl;
-    // return vector of efficiencies
-    return std::vector<Double_t> {eff_ID, eff_Iso, eff_Trig};
-}
\ No newline at end of file
+        std::cerr << "[ERROR] EfficiencySF::GetSFProduct() - Not initialized" << std::endl;
+        std::fill(sfProduct, sfProduct + n, 0.);
+        return;
+    }
+
+    if (bUseCorrection) {
+        for (std::size_t i = 0; i < n; i++) {
+            sfProduct[i] = (pt[i] < cCorrection_Trig.dPtMin) ? 0.
+                         : cCorrection_ID.Evaluate(pt[i], eta[i], cCorrection_ID.dNominalId)
+                         * cCorrection_Iso.Evaluate(pt[i], eta[i], cCorrection_Iso.dNominalId)
+                         * cCorrection_Trig.Evaluate(pt[i], eta[i], cCorrection_Trig.dNominalId);
+        }
+        return;
+    }
+
+    const Double_t trigPtMin = cTable_Trig.GetPtMin();
+    for (std::size_t i = 0; i < n; i++) {
+        Double_t abs_eta = std::abs(eta[i]);
+        if (pt[i] < trigPtMin) {
+            sfProduct[i] = 0.;
+        } else if (bIsSharedBinning) {
+            sfProduct[i] = vProduct[cTable_ID.FindCell(pt[i], abs_eta)];
+        } else {
+            sfProduct[i] = cTable_ID.pValue[cTable_ID.FindCell(pt[i], abs_eta)]
+                         * cTable_Iso.pValue[cTable_Iso.FindCell(pt[i], abs_eta)]
+                         * cTable_Trig.pValue[cTable_Trig.FindCell(pt[i], abs_eta)];
+        }
+    }
+}
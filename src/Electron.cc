@@ -37,6 +37,7 @@ void Electrons::Init() {
     }
 
     vElectronVec.clear();
+    vElectronVec.reserve(**(cData->nElectron)); // Preallocate memory
     for (Int_t idx = 0; idx < **(cData->nElectron); idx++) {
         // Define electron fourvector
         TLorentzVector vec;
@@ -82,7 +83,7 @@ void Electrons::DoObjSel() {
     bDidObjSel = true;
 }
 
-std::vector<ElectronHolder>& Electrons::GetElectrons() {
+ArenaVector<ElectronHolder>& Electrons::GetElectrons() {
     if (!bIsInit) {
         std::cerr << "[ERROR] Electrons::GetElectrons() - Electrons are not initialized" << std::endl;
         return vElectronVec;
@@ -90,13 +91,15 @@ std::vector<ElectronHolder>& Electrons::GetElectrons() {
     return vElectronVec;
 }
 
-std::vector<ElectronHolder> Electrons::GetLooseElectrons() {
+// Selected electrons are copied into a vector allocated from the same arena as the electrons
+ArenaVector<ElectronHolder> Electrons::GetLooseElectrons() {
     if (!bDidObjSel) {
         std::cerr << "[ERROR] Electrons::GetLooseElectrons() - Object selection is not done" << std::endl;
-        return vElectronVec;
+        return ArenaVector<ElectronHolder>(vElectronVec, vElectronVec.get_allocator());
     }
 
-    std::vector<ElectronHolder> selectedElectrons;
+    ArenaVector<ElectronHolder> selectedElectrons(vElectronVec.get_allocator());
+    selectedElectrons.reserve(vElectronVec.size());
     for (auto& electron : vElectronVec) {
         if (electron.PassLooseObjSel()) {
             selectedElectrons.push_back(electron);
@@ -0,0 +1,50 @@
+#include "EventArena.h"
+
+EventArena::~EventArena() {
+    for (auto& block : vBlocks) {
+        delete[] block.pBegin;
+    }
+    vBlocks.clear();
+}
+
+void EventArena::AddBlock(std::size_t minSize) {
+    std::size_t size = (minSize > nBlockSize) ? minSize : nBlockSize;
+    vBlocks.push_back(Block{new char[size], size});
+    nUpstreamAllocations++;
+}
+
+void* EventArena::do_allocate(std::size_t bytes, std::size_t alignment) {
+    nAllocations++;
+    if (vBlocks.empty()) {
+        AddBlock(bytes + alignment);
+        iCurBlock = 0;
+        pCur = vBlocks[0].pBegin;
+        pEnd = vBlocks[0].pBegin + vBlocks[0].nSize;
+    }
+    while (true) {
+        // Align the current pointer
+        std::size_t misalign = reinterpret_cast<std::uintptr_t>(pCur) % alignment;
+        char* pAligned = (misalign == 0) ? pCur : pCur + (alignment - misalign);
+        if (pAligned + bytes <= pEnd) {
+            nBytesInUse += (pAligned + bytes) - pCur;
+            if (nBytesInUse > nPeakBytesInUse) nPeakBytesInUse = nBytesInUse;
+            pCur = pAligned + bytes;
+            return pAligned;
+        }
+        // Current block is exhausted : move to the next block kept from the previous events, or add a new one
+        iCurBlock++;
+        if (iCurBlock >= vBlocks.size()) AddBlock(bytes + alignment);
+        pCur = vBlocks[iCurBlock].pBegin;
+        pEnd = vBlocks[iCurBlock].pBegin + vBlocks[iCurBlock].nSize;
+    }
+}
+
+void EventArena::PrintStats() {
+    std::cout << "----------------------------------------------------------" << std::endl;
+    std::cout << "[Info] EventArena::PrintStats() - # of resets: " << nResets << std::endl;
+    std::cout << "[Info] EventArena::PrintStats() - # of allocations: " << nAllocations << std::endl;
+    std::cout << "[Info] EventArena::PrintStats() - # of upstream (malloc) allocations: " << nUpstreamAllocations << std::endl;
+    std::cout << "[Info] EventArena::PrintStats() - # of blocks: " << vBlocks.size() << std::endl;
+    std::cout << "[Info] EventArena::PrintStats() - Peak bytes in use per event: " << nPeakBytesInUse << std::endl;
+    std::cout << "----------------------------------------------------------" << std::endl;
+}
@@ -82,9 +82,170 @@ bool GenPtcHolder::IsDirectPromptTauDecayProduct() {
     return (iGenPtcStatusFlags & (1 << 5)) != 0;
 }
 
+////////////////////////////////////////////////////////////
+/////////////////// GenPtcTree functions ///////////////////
+////////////////////////////////////////////////////////////
+void GenPtcTree::Init() {
+    if (bIsInit) {
+        std::cerr << "[Warning] GenPtcTree::Init() - GenPtcTree is already initialized" << std::endl;
+        return;
+    }
+    nGenPtcs = **(cData->nGenPart);
+    vPdgId.resize(nGenPtcs);
+    vMotherIdx.resize(nGenPtcs);
+    vChildOffset.assign(nGenPtcs + 1, 0);
+    vChildIdx.resize(nGenPtcs);
+    vCopyChildIdx.assign(nGenPtcs, -1);
+    vFirstCopyIdx.resize(nGenPtcs);
+    vLastCopyIdx.resize(nGenPtcs);
+
+    // Read the columns and count the children of each mother
+    // Mother index is -1 for the initial particles, out-of-range or self-referencing indices are treated the same way
+    for (Int_t idx = 0; idx < nGenPtcs; idx++) {
+        Int_t motherIdx = cData->GenPart_genPartIdxMother->At(idx);
+        if (motherIdx < 0 || motherIdx >= nGenPtcs || motherIdx == idx) motherIdx = -1;
+        vPdgId[idx] = cData->GenPart_pdgId->At(idx);
+        vMotherIdx[idx] = motherIdx;
+        if (motherIdx >= 0) vChildOffset[motherIdx + 1]++;
+    }
+    // Prefix sum of the counts gives the offsets
+    for (Int_t idx = 0; idx < nGenPtcs; idx++) {
+        vChildOffset[idx + 1] += vChildOffset[idx];
+    }
+    // Fill the children, in increasing index order for each mother
+    std::vector<Int_t>& fillPos = vFirstCopyIdx; // Used as a scratch buffer before the copy links are built
+    for (Int_t idx = 0; idx < nGenPtcs; idx++) fillPos[idx] = vChildOffset[idx];
+    for (Int_t idx = 0; idx < nGenPtcs; idx++) {
+        Int_t motherIdx = vMotherIdx[idx];
+        if (motherIdx < 0) continue;
+        vChildIdx[fillPos[motherIdx]++] = idx;
+        // The first child with the same pdgId is the next copy of the mother
+        if (vCopyChildIdx[motherIdx] < 0 && vPdgId[motherIdx] == vPdgId[idx]) vCopyChildIdx[motherIdx] = idx;
+    }
+
+    // First-copy links : NanoAOD stores the mothers before their daughters, so a forward pass is enough
+    // Fall back to walking up the chain for anything stored out of order
+    // Only the next copy of the mother is a copy : another child with the same pdgId (e.g. the second gluon of g -> g g) starts its own chain,
+    // so that the first-copy links and the next-copy links describe the same chains
+    for (Int_t idx = 0; idx < nGenPtcs; idx++) {
+        Int_t motherIdx = vMotherIdx[idx];
+        if (motherIdx < 0 || vCopyChildIdx[motherIdx] != idx) {
+            vFirstCopyIdx[idx] = idx;
+        }
+        else if (motherIdx < idx) {
+            vFirstCopyIdx[idx] = vFirstCopyIdx[motherIdx];
+        }
+        else {
+            Int_t copyIdx = idx;
+            for (Int_t step = 0; step < nGenPtcs; step++) {
+                Int_t upIdx = vMotherIdx[copyIdx];
+                if (upIdx < 0 || vCopyChildIdx[upIdx] != copyIdx) break;
+                copyIdx = upIdx;
+            }
+            vFirstCopyIdx[idx] = copyIdx;
+        }
+    }
+    // Last-copy links : backward pass, same fallback
+    for (Int_t idx = nGenPtcs - 1; idx >= 0; idx--) {
+        Int_t copyChildIdx = vCopyChildIdx[idx];
+        if (copyChildIdx < 0) {
+            vLastCopyIdx[idx] = idx;
+        }
+        else if (copyChildIdx > idx) {
+            vLastCopyIdx[idx] = vLastCopyIdx[copyChildIdx];
+        }
+        else {
+            Int_t copyIdx = idx;
+            for (Int_t step = 0; step < nGenPtcs && vCopyChildIdx[copyIdx] >= 0; step++) {
+                copyIdx = vCopyChildIdx[copyIdx];
+            }
+            vLastCopyIdx[idx] = copyIdx;
+        }
+    }
+
+    // Set the initialization flag
+    bIsInit = true;
+}
+
+std::pair<const Int_t*, const Int_t*> GenPtcTree::GetChildren(Int_t idx) const {
+    if (!IsValidIdx(idx)) return std::make_pair(nullptr, nullptr);
+    const Int_t* begin = vChildIdx.data() + vChildOffset[idx];
+    const Int_t* end = vChildIdx.data() + vChildOffset[idx + 1];
+    return std::make_pair(begin, end);
+}
+
+Int_t GenPtcTree::GetParentIdx(Int_t idx) const {
+    if (!IsValidIdx(idx)) return -1;
+    return vMotherIdx[vFirstCopyIdx[idx]];
+}
+
+Bool_t GenPtcTree::IsAncestor(Int_t ancestorIdx, Int_t idx) const {
+    if (!IsValidIdx(ancestorIdx) || !IsValidIdx(idx)) return false;
+    // Step limit protects against malformed (cyclic) mother indices
+    Int_t motherIdx = vMotherIdx[idx];
+    for (Int_t step = 0; step < nGenPtcs && motherIdx >= 0; step++) {
+        if (motherIdx == ancestorIdx) return true;
+        motherIdx = vMotherIdx[motherIdx];
+    }
+    return false;
+}
+
+// Returns the closest ancestor with the given |pdgId| which is not a copy of idx itself, -1 if there is none
+Int_t GenPtcTree::FindAncestor(Int_t idx, Int_t absPdgId) const {
+    Int_t motherIdx = GetParentIdx(idx);
+    for (Int_t step = 0; step < nGenPtcs && motherIdx >= 0; step++) {
+        if (std::abs(vPdgId[motherIdx]) == absPdgId) return motherIdx;
+        motherIdx = vMotherIdx[motherIdx];
+    }
+    return -1;
+}
+
+// Checks the chain of parents, skipping the copies, e.g. IsFromDecayChain(idx, {15, 24}) for a muon from tau from W
+Bool_t GenPtcTree::IsFromDecayChain(Int_t idx, std::initializer_list<Int_t> absPdgIds) const {
+    Int_t curIdx = idx;
+    for (Int_t absPdgId : absPdgIds) {
+        curIdx = GetParentIdx(curIdx);
+        if (curIdx < 0 || std::abs(vPdgId[curIdx]) != absPdgId) return false;
+    }
+    return true;
+}
+
+// Walks down the copies from the first copy, and stops at the first copy which radiates : its children are its next copy and
+// at least one other particle (e.g. mu -> mu gamma), i.e. it has more than one child. A copy with a single child only recoils.
+// The last copy is returned if no copy radiates
+Int_t GenPtcTree::GetLastCopyBeforeFSR(Int_t idx) const {
+    if (!IsValidIdx(idx)) return -1;
+    Int_t copyIdx = vFirstCopyIdx[idx];
+    for (Int_t step = 0; step < nGenPtcs; step++) {
+        Int_t copyChildIdx = vCopyChildIdx[copyIdx];
+        if (copyChildIdx < 0 || GetNChildren(copyIdx) > 1) break;
+        copyIdx = copyChildIdx;
+    }
+    return copyIdx;
+}
+
 ////////////////////////////////////////////////////////////
 ///////////////////// GenPtcs functions ////////////////////
 ////////////////////////////////////////////////////////////
+GenPtcHolder GenPtcs::MakeGenPtcHolder(Int_t idx) {
+    // Define Gen particle fourvector
+    TLorentzVector vec;
+    vec.SetPtEtaPhiM(cData->GenPart_pt->At(idx), cData->GenPart_eta->At(idx), cData->GenPart_phi->At(idx), cData->GenPart_mass->At(idx));
+    // Define the gen particle holder
+    // FIXME: This is a hack to get the charge of the particle, only works for elec, muon and tau.
+    Int_t pdgId = cData->GenPart_pdgId->At(idx);
+    Int_t charge = (pdgId != 0) ? (int) -1 * (pdgId / std::abs(pdgId)) : 0;
+    GenPtcHolder genPtc(vec, idx, charge, pdgId, cData->GenPart_status->At(idx), cData->GenPart_statusFlags->At(idx));
+    // Set the mother index and PDGID and status, mother index is -1 for the initial particles
+    Int_t motherIdx = cData->GenPart_genPartIdxMother->At(idx);
+    genPtc.SetGenPtcMotherIdx(motherIdx);
+    if (motherIdx >= 0 && motherIdx < (Int_t) **(cData->nGenPart)) {
+        genPtc.SetGenPtcMotherPDGID(cData->GenPart_pdgId->At(motherIdx));
+        genPtc.SetGenPtcMotherStatus(cData->GenPart_status->At(motherIdx));
+    }
+    return genPtc;
+}
+
 void GenPtcs::Init() {
     if (bIsInit) {
         std::cerr << "[Warning] GenPtcs::Init() - GenPtcs is already initialized" << std::endl;
@@ -94,19 +255,33 @@ void GenPtcs::Init() {
     bDoPatching = (bIsInclusiveW || bIsBoostedW || bIsOffshellW || bIsOffshellWToTauNu);
     // Initialize the class
     vGenPtcVec.clear();
-    vGenPtcVec.reserve(**(cData->nGenPart)); // Preallocate memory
-    // Initialize the gen particles
-    for (Int_t idx = 0; idx < **(cData->nGenPart); idx++) {
-        // Define Gen particle fourvector
-        TLorentzVector vec;
-        vec.SetPtEtaPhiM(cData->GenPart_pt->At(idx), cData->GenPart_eta->At(idx), cData->GenPart_phi->At(idx), cData->GenPart_mass->At(idx));
-        // Define the gen particle holder
-        // FIXME: This is a hack to get the charge of the particle, only works for elec, muon and tau.
-        GenPtcHolder genPtc(vec, idx, (int) -1 * (cData->GenPart_pdgId->At(idx) / std::abs(cData->GenPart_pdgId->At(idx))), cData->GenPart_pdgId->At(idx), cData->GenPart_status->At(idx), cData->GenPart_statusFlags->At(idx));
-        // Set the mother index and PDGID and status
-        genPtc.SetGenPtcMotherIdx(cData->GenPart_genPartIdxMother->At(idx));
-        genPtc.SetGenPtcMotherPDGID(cData->GenPart_pdgId->At(cData->GenPart_genPartIdxMother->At(idx)));
-        genPtc.SetGenPtcMotherStatus(cData->GenPart_status->At(cData->GenPart_genPartIdxMother->At(idx)));
+
+    // Prefilter : copy the pdgId and statusFlags columns into contiguous buffers and build the selection mask
+    // Only leptons and neutrinos (|pdgId| in 11-16) with prompt, hard process or tau decay statusFlags bits survive
+    const Int_t nGenPart = **(cData->nGenPart);
+    vPdgIdBuf.resize(nGenPart);
+    vStatusFlagsBuf.resize(nGenPart);
+    vSelMask.resize(nGenPart);
+    for (Int_t idx = 0; idx < nGenPart; idx++) {
+        vPdgIdBuf[idx] = cData->GenPart_pdgId->At(idx);
+        vStatusFlagsBuf[idx] = cData->GenPart_statusFlags->At(idx);
+    }
+    const Int_t* pdgIds = vPdgIdBuf.data();
+    const Int_t* statusFlags = vStatusFlagsBuf.data();
+    UChar_t* selMask = vSelMask.data();
+    Int_t nSelected = 0;
+    for (Int_t idx = 0; idx < nGenPart; idx++) {
+        // Branch-free so that the loop can be vectorized
+        UInt_t absPdgId = (UInt_t) std::abs(pdgIds[idx]);
+        selMask[idx] = (UChar_t) ( ((absPdgId - 11u) <= 5u) & ((statusFlags[idx] & iSelStatusFlags) != 0) );
+        nSelected += selMask[idx];
+    }
+    vGenPtcVec.reserve(nSelected); // Preallocate memory
+
+    // Initialize the gen particles passing the prefilter
+    for (Int_t idx = 0; idx < nGenPart; idx++) {
+        if (!selMask[idx]) continue;
+        GenPtcHolder genPtc = MakeGenPtcHolder(idx);
         vGenPtcVec.push_back(genPtc);
 
         // Do Gen-lv patching for W samples (inclusive W, boosted W, offshell W->Mu+Nu, offshell W->Tau+Nu)
@@ -236,7 +411,7 @@ Bool_t GenPtcs::PassMuonFiltering() {
     return passed;
 }
 
-std::vector<GenPtcHolder>& GenPtcs::GetGenPtcs() {
+ArenaVector<GenPtcHolder>& GenPtcs::GetGenPtcs() {
     if (!bIsInit) {
         std::cerr << "[ERROR] GenPtcs::GetGenPtcs() - GenPtcs are not initialized" << std::endl;
         return vGenPtcVec;
@@ -244,48 +419,75 @@ std::vector<GenPtcHolder>& GenPtcs::GetGenPtcs() {
     return vGenPtcVec;
 }
 
-std::vector<GenPtcHolder> GenPtcs::GetGenMuons() {
-    std::vector<GenPtcHolder> vGenMuons;
-    for (auto& genPtc : vGenPtcVec) {
-        if (std::abs(genPtc.GetGenPtcPDGID()) == 13) {
-            vGenMuons.push_back(genPtc);
-        }
+// Decode every gen particle, without the prefilter
+// This is for debugging purposes
+void GenPtcs::DecodeAll() {
+    if (bIsFullDecoded) return;
+    const Int_t nGenPart = **(cData->nGenPart);
+    vGenPtcVecFull.clear();
+    vGenPtcVecFull.reserve(nGenPart);
+    for (Int_t idx = 0; idx < nGenPart; idx++) {
+        vGenPtcVecFull.push_back(MakeGenPtcHolder(idx));
     }
-    return vGenMuons;
+    bIsFullDecoded = true;
 }
 
-std::vector<GenPtcHolder> GenPtcs::GetGenElectrons() {
-    std::vector<GenPtcHolder> vGenElectrons;
-    for (auto& genPtc : vGenPtcVec) {
-        if (std::abs(genPtc.GetGenPtcPDGID()) == 11) {
-            vGenElectrons.push_back(genPtc);
-        }
+ArenaVector<GenPtcHolder>& GenPtcs::GetAllGenPtcs() {
+    if (!bIsInit) {
+        std::cerr << "[ERROR] GenPtcs::GetAllGenPtcs() - GenPtcs are not initialized" << std::endl;
+        return vGenPtcVecFull;
     }
-    return vGenElectrons;
+    DecodeAll();
+    return vGenPtcVecFull;
 }
 
-std::vector<GenPtcHolder> GenPtcs::GetGenTaus() {
-    std::vector<GenPtcHolder> vGenTaus;
-    for (auto& genPtc : vGenPtcVec) {
-        if (std::abs(genPtc.GetGenPtcPDGID()) == 15) {
-            vGenTaus.push_back(genPtc);
-        }
+const GenPtcTree& GenPtcs::GetDecayTree() {
+    if (!bIsInit) {
+        std::cerr << "[ERROR] GenPtcs::GetDecayTree() - GenPtcs are not initialized" << std::endl;
+        return cGenPtcTree;
     }
-    return vGenTaus;
+    if (!cGenPtcTree.IsInit()) cGenPtcTree.Init();
+    return cGenPtcTree;
 }
 
-std::vector<GenPtcHolder> GenPtcs::GetGenNeutrinos() {
-    std::vector<GenPtcHolder> vGenNeutrinos;
-    for (auto& genPtc : vGenPtcVec) {
-        if (std::abs(genPtc.GetGenPtcPDGID()) == 12 || std::abs(genPtc.GetGenPtcPDGID()) == 14 || std::abs(genPtc.GetGenPtcPDGID()) == 16) {
-            vGenNeutrinos.push_back(genPtc);
+// Gen particles of the given |pdgId| (bits of absPdgIdMask), over all gen particles and not only the prefiltered ones :
+// the gen histograms and the Rocco gen matching see the same particles as without the prefilter
+// Only the selected particles are decoded, into a vector allocated from the same arena as the gen particles
+ArenaVector<GenPtcHolder> GenPtcs::SelectGenPtcs(UInt_t absPdgIdMask) {
+    ArenaVector<GenPtcHolder> vSelected(vGenPtcVec.get_allocator());
+    if (!bIsInit) {
+        std::cerr << "[ERROR] GenPtcs::SelectGenPtcs() - GenPtcs are not initialized" << std::endl;
+        return vSelected;
+    }
+    const Int_t nGenPart = vPdgIdBuf.size();
+    for (Int_t idx = 0; idx < nGenPart; idx++) {
+        UInt_t absPdgId = (UInt_t) std::abs(vPdgIdBuf[idx]);
+        if (absPdgId < 32 && ((absPdgIdMask >> absPdgId) & 1u)) {
+            vSelected.push_back(MakeGenPtcHolder(idx));
         }
     }
-    return vGenNeutrinos;
+    return vSelected;
+}
+
+ArenaVector<GenPtcHolder> GenPtcs::GetGenMuons() {
+    return SelectGenPtcs(1u << 13);
+}
+
+ArenaVector<GenPtcHolder> GenPtcs::GetGenElectrons() {
+    return SelectGenPtcs(1u << 11);
+}
+
+ArenaVector<GenPtcHolder> GenPtcs::GetGenTaus() {
+    return SelectGenPtcs(1u << 15);
+}
+
+ArenaVector<GenPtcHolder> GenPtcs::GetGenNeutrinos() {
+    return SelectGenPtcs((1u << 12) | (1u << 14) | (1u << 16));
 }
 
 void GenPtcs::PrintGenPtcChain() {
-    for (auto& genPtc : vGenPtcVec) {
+    // Print the full chain, not only the prefiltered particles
+    for (auto& genPtc : GetAllGenPtcs()) {
         Int_t pdgId = genPtc.GetGenPtcPDGID();
         Int_t idx   = genPtc.GetGenPtcIdx();
         Int_t status = genPtc.GetGenPtcStatus();
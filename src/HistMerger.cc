@@ -0,0 +1,231 @@
+#include "HistMerger.h"
+
+// ROOT classes
+#include "TROOT.h"
+
+// C++ classes
+#include <set>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+
+// POSIX
+#include <unistd.h>
+
+HistMerger::~HistMerger() {
+    Clear();
+}
+
+void HistMerger::Clear() {
+    for (TH1* h : vHists) delete h;
+    for (TObject* obj : vObjects) delete obj;
+    vHists.clear();
+    vObjects.clear();
+    mHistIndex.clear();
+    nInputs = 0;
+}
+
+Bool_t HistMerger::HasSameBinning(const TH1* a, const TH1* b) {
+    if (std::strcmp(a->ClassName(), b->ClassName()) != 0 || a->GetDimension() != b->GetDimension() || a->GetNcells() != b->GetNcells()) return false;
+    for (Int_t iAxis = 0; iAxis < a->GetDimension() && iAxis < 2; iAxis++) {
+        const TAxis* axisA = (iAxis == 0) ? a->GetXaxis() : a->GetYaxis();
+        const TAxis* axisB = (iAxis == 0) ? b->GetXaxis() : b->GetYaxis();
+        if (axisA->GetNbins() != axisB->GetNbins() || axisA->GetXmin() != axisB->GetXmin() || axisA->GetXmax() != axisB->GetXmax()) return false;
+        const TArrayD* edgesA = axisA->GetXbins();
+        const TArrayD* edgesB = axisB->GetXbins();
+        if (edgesA->GetSize() != edgesB->GetSize() || !std::equal(edgesA->GetArray(), edgesA->GetArray() + edgesA->GetSize(), edgesB->GetArray())) return false;
+    }
+    return true;
+}
+
+// Same result as TH1::Add(source) for histograms of the same binning, without the per-bin function calls
+void HistMerger::AddArrays(TH1* target, const TH1* source) {
+    TArrayD* targetArray = dynamic_cast<TArrayD*>(target);
+    const TArrayD* sourceArray = dynamic_cast<const TArrayD*>(source);
+    if (targetArray == nullptr || sourceArray == nullptr) {
+        // Not a double histogram, never booked by DYanalyzer
+        target->Add(source);
+        return;
+    }
+
+    // Statistics are read before the contents change (GetStats() may compute them from the contents)
+    Double_t stats[TH1::kNstat] = {0.};
+    Double_t statsSource[TH1::kNstat] = {0.};
+    target->GetStats(stats);
+    source->GetStats(statsSource);
+    for (Int_t i = 0; i < TH1::kNstat; i++) stats[i] += statsSource[i];
+    Double_t entries = target->GetEntries() + source->GetEntries();
+
+    Int_t n = targetArray->GetSize();
+    Double_t* content = targetArray->GetArray();
+    const Double_t* contentSource = sourceArray->GetArray();
+    if (target->GetSumw2N() > 0) {
+        Double_t* sumw2 = target->GetSumw2()->GetArray();
+        // Without Sumw2() the source was filled with unit weights
+        const Double_t* sumw2Source = (source->GetSumw2N() > 0) ? source->GetSumw2()->GetArray() : contentSource;
+        for (Int_t i = 0; i < n; i++) sumw2[i] += sumw2Source[i];
+    }
+    for (Int_t i = 0; i < n; i++) content[i] += contentSource[i];
+
+    target->PutStats(stats);
+    target->SetEntries(entries);
+}
+
+void HistMerger::AddHist(const TH1* h) {
+    auto it = mHistIndex.find(h->GetName());
+    if (it == mHistIndex.end()) {
+        TH1* clone = (TH1*)h->Clone();
+        clone->SetDirectory(nullptr);
+        mHistIndex[h->GetName()] = vHists.size();
+        vHists.push_back(clone);
+        return;
+    }
+    TH1* target = vHists[it->second];
+    if (!HasSameBinning(target, h)) {
+        throw std::runtime_error(std::string("[Runtime Error] HistMerger::AddHist() - Different binning of ") + h->GetName());
+    }
+    AddArrays(target, h);
+}
+
+Bool_t HistMerger::AddFile(const std::string& fileName) {
+    TFile* f = TFile::Open(fileName.c_str(), "READ");
+    if (f == nullptr || f->IsZombie()) {
+        delete f;
+        return false;
+    }
+    AddDirectory(f);
+    f->Close();
+    delete f;
+    return true;
+}
+
+void HistMerger::AddDirectory(TDirectory* dir) {
+    // Keys are sorted by cycle, keep the first (highest) cycle of each name
+    std::set<std::string> seen;
+    TIter next(dir->GetListOfKeys());
+    while (TKey* key = (TKey*)next()) {
+        if (!seen.insert(key->GetName()).second) continue;
+        // Trees are not part of the outputs
+        if (std::strcmp(key->GetClassName(), "TTree") == 0) continue;
+        TObject* obj = key->ReadObj();
+        TH1* h = dynamic_cast<TH1*>(obj);
+        if (h != nullptr) {
+            AddHist(h);
+            delete obj;
+            continue;
+        }
+        AddObject(obj);
+    }
+    nInputs++;
+}
+
+void HistMerger::AddObject(TObject* obj) {
+    auto it = std::find_if(vObjects.begin(), vObjects.end(), [&](const TObject* o) { return std::strcmp(o->GetName(), obj->GetName()) == 0; });
+    if (it == vObjects.end()) {
+        vObjects.push_back(obj);
+        return;
+    }
+    // Union of the inputs covered by the outputs
+    TNamed* named = dynamic_cast<TNamed*>(*it);
+    TNamed* other = dynamic_cast<TNamed*>(obj);
+    if (named != nullptr && other != nullptr && std::strcmp(named->GetName(), Manifest::kObjectName) == 0) {
+        Manifest manifest;
+        manifest.FromString(named->GetTitle());
+        Manifest otherManifest;
+        otherManifest.FromString(other->GetTitle());
+        manifest.Merge(otherManifest);
+        named->SetTitle(manifest.ToString().c_str());
+    }
+    delete obj;
+}
+
+void HistMerger::Add(const HistMerger& other) {
+    for (const TH1* h : other.vHists) AddHist(h);
+    for (const TObject* obj : other.vObjects) AddObject(obj->Clone());
+    nInputs += other.nInputs;
+}
+
+Bool_t HistMerger::Write(const std::string& fileName) const {
+    std::string tmpName = fileName + ".tmp" + std::to_string((long)getpid());
+    TFile* f = TFile::Open(tmpName.c_str(), "RECREATE");
+    if (f == nullptr || f->IsZombie()) {
+        delete f;
+        return false;
+    }
+    f->cd();
+    for (const TH1* h : vHists) h->Write();
+    for (const TObject* obj : vObjects) obj->Write();
+    f->Close();
+    delete f;
+    if (std::rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+void HistMerger::MergeFiles(const std::vector<std::string>& fileNames, Int_t nThreads, HistMerger& result) {
+    result.Clear();
+    if (fileNames.empty()) return;
+    nThreads = std::max(1, std::min(nThreads, (Int_t)fileNames.size()));
+    if (nThreads > 1) ROOT::EnableThreadSafety();
+
+    // Partial sums, the first one is the result
+    std::vector<std::unique_ptr<HistMerger>> partials;
+    std::vector<HistMerger*> mergers = {&result};
+    for (Int_t i = 1; i < nThreads; i++) {
+        partials.emplace_back(new HistMerger());
+        mergers.push_back(partials.back().get());
+    }
+
+    std::mutex errorMutex;
+    std::vector<std::string> errors;
+    auto RunParallel = [&](const std::vector<std::function<void()>>& tasks) {
+        std::vector<std::thread> threads;
+        for (const auto& task : tasks) {
+            threads.emplace_back([&, task]() {
+                try {
+                    task();
+                } catch (const std::exception& e) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    errors.push_back(e.what());
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        if (!errors.empty()) {
+            throw std::runtime_error("[Runtime Error] HistMerger::MergeFiles() - " + errors.front());
+        }
+    };
+
+    // Contiguous slices of the files, one per thread
+    std::vector<std::function<void()>> tasks;
+    for (Int_t i = 0; i < nThreads; i++) {
+        std::size_t first = fileNames.size() * i / nThreads;
+        std::size_t last = fileNames.size() * (i + 1) / nThreads;
+        HistMerger* merger = mergers[i];
+        tasks.push_back([&fileNames, merger, first, last]() {
+            for (std::size_t iFile = first; iFile < last; iFile++) {
+                if (!merger->AddFile(fileNames[iFile])) {
+                    throw std::runtime_error("Cannot read " + fileNames[iFile]);
+                }
+            }
+        });
+    }
+    RunParallel(tasks);
+
+    // Pairwise reduction of the partial sums
+    for (Int_t stride = 1; stride < nThreads; stride *= 2) {
+        tasks.clear();
+        for (Int_t i = 0; i + stride < nThreads; i += 2 * stride) {
+            HistMerger* target = mergers[i];
+            const HistMerger* source = mergers[i + stride];
+            tasks.push_back([target, source]() { target->Add(*source); });
+        }
+        RunParallel(tasks);
+    }
+}
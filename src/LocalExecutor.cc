@@ -0,0 +1,163 @@
+#include "LocalExecutor.h"
+
+// ROOT classes
+#include "TMemFile.h"
+#include "TString.h"
+
+// C++ classes
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+// POSIX
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    Bool_t WriteAll(int fd, const char* data, std::size_t size) {
+        while (size > 0) {
+            ssize_t n = write(fd, data, size);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+}
+
+// Worker output : size of the TMemFile (8 bytes), then the TMemFile
+LocalExecutor::Worker LocalExecutor::Spawn(Int_t iSlice, Long64_t firstEntry, Long64_t lastEntry, const SliceFunc& func, const std::vector<Worker>& running) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        throw std::runtime_error("[Runtime Error] LocalExecutor::Spawn() - Cannot create a pipe");
+    }
+    // Buffered output would be printed by both processes
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        throw std::runtime_error("[Runtime Error] LocalExecutor::Spawn() - Cannot fork a worker");
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        for (const Worker& worker : running) close(worker.fd);
+        int status = 0;
+        try {
+            // Histograms are written explicitly by func, they must not be attached to the output (written again by Write())
+            TH1::AddDirectory(kFALSE);
+            TMemFile output(Form("DYanalysis_slice%d.root", iSlice), "RECREATE");
+            func(firstEntry, lastEntry, iSlice, &output);
+            output.Write();
+            Long64_t size = output.GetSize();
+            std::string buffer(sizeof(Long64_t) + size, '\0');
+            std::memcpy(&buffer[0], &size, sizeof(Long64_t));
+            output.CopyTo(&buffer[sizeof(Long64_t)], size);
+            if (!WriteAll(fds[1], buffer.data(), buffer.size())) status = 1;
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] LocalExecutor::Spawn() - Worker of slice " << iSlice << ": " << e.what() << std::endl;
+            status = 1;
+        }
+        close(fds[1]);
+        std::cout.flush();
+        std::cerr.flush();
+        // Skip the exit handlers of the parent (ROOT cleanup, static destructors)
+        _exit(status);
+    }
+
+    close(fds[1]);
+    std::cout << "[Info] LocalExecutor::Spawn() - Worker " << pid << " : slice " << iSlice << ", entries " << firstEntry << " - " << lastEntry << std::endl;
+    Worker worker;
+    worker.pid = pid;
+    worker.fd = fds[0];
+    worker.iSlice = iSlice;
+    return worker;
+}
+
+void LocalExecutor::Run(Long64_t nEntries, const SliceFunc& func, HistMerger& result) {
+    result.Clear();
+
+    // Balanced slices of the entry range, none of them empty
+    Int_t nSlices = (Int_t)std::max<Long64_t>(1, std::min<Long64_t>(nJobs, nEntries));
+    std::vector<Long64_t> bounds(nSlices + 1);
+    for (Int_t i = 0; i <= nSlices; i++) bounds[i] = nEntries * i / nSlices;
+
+    std::vector<std::string> outputs(nSlices);
+    std::vector<Int_t> nAttempts(nSlices, 1);
+    std::vector<Worker> running;
+    for (Int_t i = 0; i < nSlices; i++) running.push_back(Spawn(i, bounds[i], bounds[i + 1], func, running));
+
+    char chunk[1 << 16];
+    while (!running.empty()) {
+        std::vector<pollfd> pollFds(running.size());
+        for (std::size_t i = 0; i < running.size(); i++) {
+            pollFds[i].fd = running[i].fd;
+            pollFds[i].events = POLLIN;
+            pollFds[i].revents = 0;
+        }
+        if (poll(pollFds.data(), pollFds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("[Runtime Error] LocalExecutor::Run() - poll() failed");
+        }
+
+        // Read what is available, a worker is done at the end of its pipe
+        std::vector<Worker> finished;
+        for (std::size_t i = 0; i < running.size(); i++) {
+            if (pollFds[i].revents == 0) continue;
+            ssize_t n = read(running[i].fd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR) continue;
+            if (n > 0) {
+                running[i].sBuffer.append(chunk, n);
+                continue;
+            }
+            close(running[i].fd);
+            finished.push_back(std::move(running[i]));
+            running[i].fd = -1;
+        }
+        running.erase(std::remove_if(running.begin(), running.end(), [](const Worker& w) { return w.fd < 0; }), running.end());
+
+        for (Worker& worker : finished) {
+            int status = 0;
+            waitpid(worker.pid, &status, 0);
+            Long64_t size = -1;
+            if (worker.sBuffer.size() >= sizeof(Long64_t)) std::memcpy(&size, worker.sBuffer.data(), sizeof(Long64_t));
+            Bool_t isValid = WIFEXITED(status) && WEXITSTATUS(status) == 0 && size >= 0
+                          && worker.sBuffer.size() == sizeof(Long64_t) + (std::size_t)size;
+            Int_t iSlice = worker.iSlice;
+            if (isValid) {
+                outputs[iSlice] = worker.sBuffer.substr(sizeof(Long64_t));
+                std::cout << "[Info] LocalExecutor::Run() - Slice " << iSlice << " is done" << std::endl;
+                continue;
+            }
+
+            std::cerr << "[Warning] LocalExecutor::Run() - Worker " << worker.pid << " of slice " << iSlice << " failed ("
+                      << (WIFSIGNALED(status) ? "signal " + std::to_string(WTERMSIG(status)) : "exit code " + std::to_string(WEXITSTATUS(status))) << ")" << std::endl;
+            if (nAttempts[iSlice] > nMaxRetries) {
+                for (const Worker& other : running) {
+                    kill(other.pid, SIGKILL);
+                    close(other.fd);
+                    waitpid(other.pid, nullptr, 0);
+                }
+                throw std::runtime_error("[Runtime Error] LocalExecutor::Run() - Slice " + std::to_string(iSlice) + " failed after " + std::to_string(nAttempts[iSlice]) + " attempts");
+            }
+            nAttempts[iSlice]++;
+            running.push_back(Spawn(iSlice, bounds[iSlice], bounds[iSlice + 1], func, running));
+        }
+    }
+
+    // Sum in slice order
+    for (Int_t i = 0; i < nSlices; i++) {
+        TMemFile input(Form("DYanalysis_slice%d.root", i), &outputs[i][0], outputs[i].size(), "READ");
+        result.AddDirectory(&input);
+        input.Close();
+        std::string().swap(outputs[i]);
+    }
+}
@@ -1,8 +1,21 @@
 #include "DYanalyzer.h"
+#include "CorrectionStore.h"
+#include "LocalExecutor.h"
+#include "Manifest.h"
+#include "SampleIndex.h"
+#include "AnalysisServer.h"
 
 #include <iostream>
 #include <string>
+#include <vector>
 #include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <set>
+#include <algorithm>
+#include <stdexcept>
 
 int main(int argc, char* argv[]) {
     // Arguments
@@ -17,16 +30,157 @@ int main(int argc, char* argv[]) {
     // 9. DoTrigSF
     // 10. DoRocco
     // 11. Output file name
+    // Options after the positional arguments
+    // --fast-rocco : Tabulated CrystalBall in Rochester correction
+    // --rocco-replicas : Histograms for all Rochester correction replicas
+    // --pu-json <file> : PU weights from a correctionlib file instead of the pileup/ profiles
+    // --muon-sf-json <file> : Muon SFs from a correctionlib file instead of the muonSF/ maps
+    // --no-correction-store : Do not share the correction state with the other jobs of the node (see CorrectionStore.h)
+    // --jobs <N> : Split the entries into N slices processed by forked workers, merged into a single output (see LocalExecutor.h)
+    // --checkpoint-events <N> : Checkpoint of the histograms every N events
+    // --checkpoint-seconds <S> : Checkpoint of the histograms every S seconds
+    // --checkpoint <file> : Checkpoint file, <Output file name>.checkpoint.root by default (one per slice with --jobs)
+    // --resume : Restart from the checkpoint if it exists, on the inputs it was written with, the output is the same as without interruption
+    // --telemetry <file> : JSON lines of throughput, memory and I/O of the event loop, "-" for stderr (default), "none" to disable
+    // --telemetry-interval <S> : Minimum interval between two telemetry lines, 60 s by default
+    // --incremental : Only process the inputs that are not in the manifest of the existing output, and add them to it (see Manifest.h)
+    // --plan : Only compare the manifest of the existing output with the inputs, exit code 0 if it is up to date, 3 otherwise
+    // --build-index <file> : Only count the entries and the sum of generator weights of the input files, and add them to the sample index (see SampleIndex.h)
+    // --normalize <file> : Histograms of MC normalized to the luminosity of the era, with the sums of weights of the sample index
+    // --input-retries <N> : Retries of an input that cannot be opened or read, 3 by default, the file is then skipped and recorded in the manifest
+    // --cut <name>=<value> : Selection threshold instead of its default, can be repeated (see SelectionCuts in DYanalyzer.h)
+    // --hists <list> : Only write the histograms of the comma-separated list, a trailing "*" matches any suffix
+    // --alloc-check : Exit code 4 if the event loop allocates on the heap after the warm-up, needs a build with -DDYANALYSIS_ALLOC_PROBE=ON (see AllocProbe.h)
+    // Resident analysis process (see AnalysisServer.h)
+    // ./DYanalysis --daemon <socket> : Serve the requests of the clients until SIGINT or SIGTERM
+    // ./DYanalysis --client <socket> <arguments and options as above> : Analysis done by the daemon, only --fast-rocco, --rocco-replicas, --pu-json,
+    //                                                                    --muon-sf-json, --normalize, --cut and --hists are supported
+
+    if (argc == 3 && std::string(argv[1]) == "--daemon") {
+        try {
+            AnalysisServer server(argv[2]);
+            server.Serve();
+        } catch (const std::exception& e) {
+            std::cerr << "[Error] Main.cc - " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--client") {
+        if (argc < 14) {
+            std::cerr << "[Error] Main.cc - Usage: ./DYanalysis --client <socket> <Input file list> <Era> <Process name> <IsMC> <DoPUCorrection> <DoL1PreFiringCorrection> <DoIDSF> <DoIsoSF> <DoTrigSF> <DoRocco> <Output file name> [options]" << std::endl;
+            return 1;
+        }
+        // Same arguments as the request of the daemon, without the output file name
+        std::vector<std::string> args(argv + 3, argv + 13);
+        args.insert(args.end(), argv + 14, argv + argc);
+        std::string sOutputFileName = argv[13];
+        try {
+            std::string output = AnalysisServer::Send(argv[2], args);
+            std::ofstream file(sOutputFileName, std::ios::binary);
+            if (!file.write(output.data(), output.size())) {
+                std::cerr << "[Error] Main.cc - Cannot write " << sOutputFileName << std::endl;
+                return 1;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[Error] Main.cc - " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "[Info] Main.cc - Output file is saved as " << sOutputFileName << std::endl;
+        return 0;
+    }
 
     // Check if the number of arguments is correct
-    if (argc != 12) {
+    if (argc < 12) {
         std::cerr << "---------------------------------------------------------" << std::endl;
         std::cerr << "[Error] Main.cc - The number of arguments is incorrect" << std::endl;
-        std::cerr << "[Error] Main.cc - Usage: ./DYanalysis <Input file list> <Era> <Process name> <IsMC> <DoPUCorrection> <DoL1PreFiringCorrection> <DoIDSF> <DoIsoSF> <DoTrigSF> <DoRocco> <Output file name>" << std::endl;
+        std::cerr << "[Error] Main.cc - Usage: ./DYanalysis <Input file list> <Era> <Process name> <IsMC> <DoPUCorrection> <DoL1PreFiringCorrection> <DoIDSF> <DoIsoSF> <DoTrigSF> <DoRocco> <Output file name> [--fast-rocco] [--rocco-replicas] [--pu-json <file>] [--muon-sf-json <file>] [--no-correction-store] [--jobs <N>] [--checkpoint-events <N>] [--checkpoint-seconds <S>] [--checkpoint <file>] [--resume] [--telemetry <file>] [--telemetry-interval <S>] [--incremental] [--plan] [--build-index <file>] [--normalize <file>] [--cut <name>=<value>] [--hists <list>] [--input-retries <N>] [--alloc-check]" << std::endl;
+        std::cerr << "[Error] Main.cc -        ./DYanalysis --daemon <socket>, ./DYanalysis --client <socket> <arguments>" << std::endl;
         std::cerr << "---------------------------------------------------------" << std::endl;
         return 1;
     }
 
+    // Parse options
+    bool bFastRocco = false;
+    bool bRoccoReplicas = false;
+    std::string sPUCorrectionFileName = "";
+    std::string sMuonSFCorrectionFileName = "";
+    int nJobs = 1;
+    std::string sCheckpointFileName = "";
+    Long64_t nCheckpointEvents = 0;
+    double dCheckpointSeconds = 0;
+    bool bResume = false;
+    std::string sTelemetryFileName = "-";
+    double dTelemetryInterval = 60.;
+    bool bIncremental = false;
+    bool bPlan = false;
+    std::string sBuildIndexFileName = "";
+    std::string sNormalizeIndexFileName = "";
+    SelectionCuts cCuts;
+    std::string sHistogramList = "";
+    int nInputRetries = 3;
+    bool bAllocCheck = false;
+    for (int iArg = 12; iArg < argc; iArg++) {
+        std::string option = argv[iArg];
+        if (option == "--fast-rocco") {
+            bFastRocco = true;
+        } else if (option == "--rocco-replicas") {
+            bRoccoReplicas = true;
+        } else if ((option == "--pu-json" || option == "--muon-sf-json") && iArg + 1 < argc) {
+            if (option == "--pu-json") sPUCorrectionFileName = argv[++iArg];
+            else sMuonSFCorrectionFileName = argv[++iArg];
+        } else if (option == "--no-correction-store") {
+            CorrectionStore::SetEnabled(false);
+        } else if (option == "--jobs" && iArg + 1 < argc) {
+            nJobs = std::max(1, std::stoi(argv[++iArg]));
+        } else if (option == "--checkpoint-events" && iArg + 1 < argc) {
+            nCheckpointEvents = std::max(0LL, std::stoll(argv[++iArg]));
+        } else if (option == "--checkpoint-seconds" && iArg + 1 < argc) {
+            dCheckpointSeconds = std::max(0., std::stod(argv[++iArg]));
+        } else if (option == "--checkpoint" && iArg + 1 < argc) {
+            sCheckpointFileName = argv[++iArg];
+        } else if (option == "--resume") {
+            bResume = true;
+        } else if (option == "--telemetry" && iArg + 1 < argc) {
+            sTelemetryFileName = argv[++iArg];
+        } else if (option == "--telemetry-interval" && iArg + 1 < argc) {
+            dTelemetryInterval = std::max(0., std::stod(argv[++iArg]));
+        } else if (option == "--incremental") {
+            bIncremental = true;
+        } else if (option == "--plan") {
+            bPlan = true;
+        } else if ((option == "--build-index" || option == "--normalize") && iArg + 1 < argc) {
+            if (option == "--build-index") sBuildIndexFileName = argv[++iArg];
+            else sNormalizeIndexFileName = argv[++iArg];
+        } else if (option == "--cut" && iArg + 1 < argc) {
+            try {
+                cCuts.Set(argv[++iArg]);
+            } catch (const std::exception& e) {
+                std::cerr << "[Error] Main.cc - " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (option == "--hists" && iArg + 1 < argc) {
+            sHistogramList = argv[++iArg];
+        } else if (option == "--input-retries" && iArg + 1 < argc) {
+            nInputRetries = std::max(0, std::stoi(argv[++iArg]));
+        } else if (option == "--alloc-check") {
+            bAllocCheck = true;
+        } else {
+            std::cerr << "[Error] Main.cc - Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    // The allocations are counted in this process, the slices of --jobs run in forked workers
+    if (bAllocCheck && !AllocProbe::IsEnabled()) {
+        std::cerr << "[Error] Main.cc - --alloc-check needs a build with -DDYANALYSIS_ALLOC_PROBE=ON" << std::endl;
+        return 1;
+    }
+    if (bAllocCheck && nJobs > 1) {
+        std::cerr << "[Error] Main.cc - --alloc-check is not supported with --jobs" << std::endl;
+        return 1;
+    }
+
     std::cout << "---------------------------------------------------------" << std::endl;
     std::cout << "[Info] Main.cc - Start DY analysis" << std::endl;
     std::cout << "[Info] Main.cc - Input file list: " << argv[1] << std::endl;
@@ -40,6 +194,7 @@ int main(int argc, char* argv[]) {
     std::cout << "[Info] Main.cc - DoIsoSF: " << argv[9] << std::endl;
     std::cout << "[Info] Main.cc - DoTrigSF: " << argv[10] << std::endl;
     std::cout << "[Info] Main.cc - Output file name: " << argv[11] << std::endl;
+    for (int iArg = 12; iArg < argc; iArg++) std::cout << "[Info] Main.cc - Option: " << argv[iArg] << std::endl;
     std::cout << "---------------------------------------------------------" << std::endl;
 
     // Get arguments
@@ -54,43 +209,192 @@ int main(int argc, char* argv[]) {
     bool bDoIsoSF = std::stoi(argv[9]);
     bool bDoTrigSF = std::stoi(argv[10]);
     std::string sOutputFileName = argv[11];
-    // Set Muon Eff SF histogram names
-    std::string sHistName_ID = "NUM_TightID_DEN_TrackerMuons_abseta_pt";
-    std::string sHistName_Iso = "NUM_TightRelIso_DEN_TightIDandIPCut_abseta_pt";
-    std::string sHistName_Trig = "NUM_IsoMu24_DEN_CutBasedIdTight_and_PFIsoTight_abseta_pt";
+    if (sCheckpointFileName.empty()) sCheckpointFileName = sOutputFileName + ".checkpoint.root";
+    // Muon Eff SF histogram names and Rocco file name of the era
+    AnalysisCorrections::Config cEraConfig = AnalysisCorrections::Config::ForEra(sEra);
+    std::string sHistName_ID = cEraConfig.sHistName_ID;
+    std::string sHistName_Iso = cEraConfig.sHistName_Iso;
+    std::string sHistName_Trig = cEraConfig.sHistName_Trig;
+    std::string sRoccoFileName = cEraConfig.sRoccoFileName;
 
-    if (sEra.find("2016") != std::string::npos) {
-        sHistName_Trig = "NUM_IsoMu24_or_IsoTkMu24_DEN_CutBasedIdTight_and_PFIsoTight_abseta_pt";
+    // Sum of generator weights of the whole sample, the input file list is usually fileList/<era>/<process>.txt
+    // The index is read and rewritten, it should be built by one process at a time
+    if (!sBuildIndexFileName.empty()) {
+        SampleIndex index;
+        try {
+            index.Read(sBuildIndexFileName);
+            SampleIndex::Entry entry = SampleIndex::Count(sInputFileList, bIsMC);
+            index.Set(sProcessName, sEra, entry);
+            std::cout << "[Info] Main.cc - " << sProcessName << " (" << sEra << "): " << entry.nFiles << " files, " << entry.nEntries
+                      << " entries, sum of weight " << entry.dSumOfGenEvtWeight << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "[Error] Main.cc - " << e.what() << std::endl;
+            return 1;
+        }
+        if (!index.Write(sBuildIndexFileName)) {
+            std::cerr << "[Error] Main.cc - Cannot write " << sBuildIndexFileName << std::endl;
+            return 1;
+        }
+        std::cout << "[Info] Main.cc - Sample index is saved as " << sBuildIndexFileName << std::endl;
+        return 0;
     }
-    else if (sEra == "2017") {
-        sHistName_Trig = "NUM_IsoMu27_DEN_CutBasedIdTight_and_PFIsoTight_abseta_pt";
+
+    // Normalization of the histograms to the luminosity, data are not scaled
+    double dNormalizationScale = 0.;
+    if (!sNormalizeIndexFileName.empty() && bIsMC) {
+        SampleIndex index;
+        try {
+            if (!index.Read(sNormalizeIndexFileName)) {
+                std::cerr << "[Error] Main.cc - Cannot open " << sNormalizeIndexFileName << std::endl;
+                return 1;
+            }
+            dNormalizationScale = index.GetNormalization(sProcessName, sEra);
+        } catch (const std::exception& e) {
+            std::cerr << "[Error] Main.cc - " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "[Info] Main.cc - Histograms are normalized to the luminosity, scale " << dNormalizationScale << std::endl;
     }
-    
-    // Set Rocco file name
-    std::string sRoccoFileName = "";
-    if (sEra == "2016APV") {
-        sRoccoFileName = "../RoccoR/RoccoR2016aUL.txt";
-    } else if (sEra == "2016") {
-        sRoccoFileName = "../RoccoR/RoccoR2016bUL.txt";
-    } else if (sEra == "2017") {
-        sRoccoFileName = "../RoccoR/RoccoR2017UL.txt";
-    } else if (sEra == "2018") {
-        sRoccoFileName = "../RoccoR/RoccoR2018UL.txt";
+
+    // Analyzer of the input files, not initialized
+    std::set<std::string> sSkipFiles;
+    std::shared_ptr<const Data::InputCheck> pInputCheck;
+    auto MakeAnalyzer = [&]() {
+        std::unique_ptr<DYanalyzer> analyzer(new DYanalyzer(sInputFileList, sProcessName, sEra, sHistName_ID, sHistName_Iso, sHistName_Trig, sRoccoFileName, bIsMC, bDoPUCorrection, bDoL1PreFiringCorrection, bDoRocco, bDoIDSF, bDoIsoSF, bDoTrigSF));
+        analyzer->SetFastRocco(bFastRocco);
+        analyzer->SetRoccoReplicas(bRoccoReplicas);
+        analyzer->SetPUCorrectionFileName(sPUCorrectionFileName);
+        analyzer->SetMuonSFCorrectionFileName(sMuonSFCorrectionFileName);
+        analyzer->SetSkipInputFiles(sSkipFiles);
+        analyzer->SetNormalizationScale(dNormalizationScale);
+        analyzer->SetCuts(cCuts);
+        analyzer->SetHistogramList(sHistogramList);
+        analyzer->SetInputRetries(nInputRetries, 2.);
+        analyzer->SetInputCheck(pInputCheck);
+        return analyzer;
+    };
+
+    // Compare the manifest of the existing output with the input file list (see Manifest.h)
+    // Only the new files are processed if the other inputs, the configuration and the code version did not change
+    std::string sRunOutputFileName = sOutputFileName;
+    if (bIncremental || bPlan) {
+        Manifest previous;
+        if (!previous.Read(sOutputFileName)) {
+            std::cout << "[Info] Main.cc - No manifest in " << sOutputFileName << ", all inputs are processed" << std::endl;
+            if (bPlan) return 3;
+        } else {
+            Manifest::Plan plan = previous.MakePlan(Data::ReadFileList(sInputFileList), MakeAnalyzer()->GetAnalysisConfig());
+            if (plan.bUpToDate) {
+                std::cout << "[Info] Main.cc - " << sOutputFileName << " is up to date (" << plan.sCovered.size() << " inputs)" << std::endl;
+                return 0;
+            }
+            if (plan.bFull) {
+                std::cout << "[Info] Main.cc - All inputs are processed again: " << plan.sReason << std::endl;
+            } else {
+                std::cout << "[Info] Main.cc - " << plan.vNew.size() << " new inputs, " << plan.sCovered.size() << " inputs already in " << sOutputFileName << std::endl;
+                for (const std::string& fileName : plan.vNew) std::cout << "[Info] Main.cc - New input: " << fileName << std::endl;
+                sSkipFiles = plan.sCovered;
+                sRunOutputFileName = sOutputFileName + ".delta.root";
+            }
+            if (bPlan) return 3;
+        }
     }
 
-    DYanalyzer analyzer(sInputFileList, sProcessName, sEra, sHistName_ID, sHistName_Iso, sHistName_Trig, sRoccoFileName, bIsMC, bDoPUCorrection, bDoL1PreFiringCorrection, bDoRocco, bDoIDSF, bDoIsoSF, bDoTrigSF);
-    analyzer.Init();
-    analyzer.Analyze();
+    // Analysis of the entries [firstEntry, lastEntry) of the input files, all entries if lastEntry < 0
+    ULong64_t nHeapAllocs = 0;
+    auto RunAnalyzer = [&](Long64_t firstEntry, Long64_t lastEntry, UInt_t randomSeed, const std::string& checkpointFileName, const std::function<TFile*()>& openOutput) {
+        std::unique_ptr<DYanalyzer> analyzer = MakeAnalyzer();
+        analyzer->SetEntryRange(firstEntry, lastEntry);
+        analyzer->SetRandomSeed(randomSeed);
+        analyzer->SetCheckpoint(checkpointFileName, nCheckpointEvents, dCheckpointSeconds);
+        analyzer->SetResume(bResume);
+        analyzer->SetTelemetry(sTelemetryFileName, dTelemetryInterval);
+        analyzer->Init();
+        analyzer->Analyze();
+        nHeapAllocs += analyzer->GetNHeapAllocs();
+
+        TFile* f_output = openOutput();
+        if (f_output == nullptr || f_output->IsZombie()) throw std::runtime_error("[Runtime Error] Main.cc - Cannot open the output file");
+        f_output->cd();
+        analyzer->WriteHistograms(f_output);
+        // Inputs covered by this output, and the inputs that could not be read
+        analyzer->GetManifest().Write(f_output);
+    };
 
-    TFile* f_output = TFile::Open(sOutputFileName.c_str(), "RECREATE");
-    f_output->cd();
-    analyzer.WriteHistograms(f_output);
-    f_output->Close();
+    if (nJobs > 1) {
+        const std::string sInputCheckFileName = sCheckpointFileName + ".inputs";
+        LocalExecutor executor(nJobs);
+        HistMerger merger;
+        try {
+            // Inputs are checked once, all slices split the entries of the same readable files
+            // The check is kept with the checkpoints, the slices of a resumed job then split the same entries as before
+            auto inputCheck = std::make_shared<Data::InputCheck>();
+            if (bResume && inputCheck->Read(sInputCheckFileName)) {
+                std::cout << "[Info] Main.cc - Inputs of the checkpoints: " << sInputCheckFileName << std::endl;
+            } else {
+                *inputCheck = Data::CheckInputs(Data::ReadFileList(sInputFileList, sSkipFiles), {}, Data::kInputCheckThreads, nInputRetries, 2.);
+                if ((nCheckpointEvents > 0 || dCheckpointSeconds > 0) && !inputCheck->Write(sInputCheckFileName)) {
+                    std::cerr << "[Warning] Main.cc - Cannot write " << sInputCheckFileName << ", a resumed job checks the inputs again" << std::endl;
+                }
+            }
+            pInputCheck = inputCheck;
+            executor.Run(pInputCheck->GetTotalEntries(), [&](Long64_t firstEntry, Long64_t lastEntry, Int_t iSlice, TFile* output) {
+                // Independent random numbers in each slice, slice 0 keeps the default seed of TRandom3
+                RunAnalyzer(firstEntry, lastEntry, 4357 + iSlice, sCheckpointFileName + ".slice" + std::to_string(iSlice), [output]() { return output; });
+            }, merger);
+        } catch (const std::exception& e) {
+            std::cerr << "[Error] Main.cc - " << e.what() << std::endl;
+            return 1;
+        }
+        // The manifests of the slices are merged into the manifest of the whole entry range
+        if (!merger.Write(sRunOutputFileName)) {
+            std::cerr << "[Error] Main.cc - Cannot write " << sRunOutputFileName << std::endl;
+            return 1;
+        }
+        // The checkpoints are not needed once the output is written
+        for (int iSlice = 0; iSlice < nJobs; iSlice++) std::remove((sCheckpointFileName + ".slice" + std::to_string(iSlice)).c_str());
+        std::remove(sInputCheckFileName.c_str());
+    } else {
+        TFile* f_output = nullptr;
+        try {
+            RunAnalyzer(0, -1, 4357, sCheckpointFileName, [&]() {
+                f_output = TFile::Open(sRunOutputFileName.c_str(), "RECREATE");
+                return f_output;
+            });
+            f_output->Close();
+        } catch (const std::exception& e) {
+            std::cerr << "[Error] Main.cc - " << e.what() << std::endl;
+            // An incomplete output is not left behind, the checkpoint is kept for --resume
+            if (f_output != nullptr) {
+                delete f_output;
+                std::remove(sRunOutputFileName.c_str());
+            }
+            return 1;
+        }
+        delete f_output;
+        std::remove(sCheckpointFileName.c_str());
+    }
+
+    // Sum of the existing output and of the new inputs, with the union of their manifests
+    if (sRunOutputFileName != sOutputFileName) {
+        HistMerger merger;
+        if (!merger.AddFile(sOutputFileName) || !merger.AddFile(sRunOutputFileName) || !merger.Write(sOutputFileName)) {
+            std::cerr << "[Error] Main.cc - Cannot merge " << sRunOutputFileName << " into " << sOutputFileName << std::endl;
+            return 1;
+        }
+        std::remove(sRunOutputFileName.c_str());
+        std::cout << "[Info] Main.cc - New inputs merged into " << sOutputFileName << std::endl;
+    }
     
     std::cout << "---------------------------------------------------------" << std::endl;
     std::cout << "[Info] Main.cc - DY analysis is finished" << std::endl;
     std::cout << "[Info] Main.cc - Output file is saved as " << sOutputFileName << std::endl;
     std::cout << "---------------------------------------------------------" << std::endl;
+
+    if (bAllocCheck && nHeapAllocs > 0) {
+        std::cerr << "[Error] Main.cc - The event loop made " << nHeapAllocs << " heap allocations after the warm-up" << std::endl;
+        return 4;
+    }
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "Manifest.h"
+
+// DYanalysis classes
+#include "CorrectionStore.h"
+
+// ROOT classes
+#include "TFile.h"
+
+// C++ classes
+#include <sstream>
+#include <algorithm>
+
+// POSIX
+#include <sys/stat.h>
+
+#ifndef DYANALYSIS_CODE_VERSION
+#define DYANALYSIS_CODE_VERSION "unknown"
+#endif
+
+std::string Manifest::CurrentCodeVersion() {
+    return DYANALYSIS_CODE_VERSION;
+}
+
+std::string Manifest::Hash(const std::string& text) {
+    std::ostringstream hash;
+    hash << std::hex << CorrectionStore::Checksum(text);
+    return hash.str();
+}
+
+void Manifest::Stat(const std::string& path, Long64_t& size, Long64_t& mtime) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        size = -1;
+        mtime = -1;
+        return;
+    }
+    size = st.st_size;
+    mtime = st.st_mtime;
+}
+
+void Manifest::Coalesce(std::vector<std::pair<Long64_t, Long64_t>>& ranges) {
+    std::sort(ranges.begin(), ranges.end());
+    std::vector<std::pair<Long64_t, Long64_t>> result;
+    for (const auto& range : ranges) {
+        if (range.second <= range.first) continue;
+        if (!result.empty() && range.first <= result.back().second) result.back().second = std::max(result.back().second, range.second);
+        else result.push_back(range);
+    }
+    ranges.swap(result);
+}
+
+void Manifest::Subtract(std::vector<std::pair<Long64_t, Long64_t>>& ranges, const std::vector<std::pair<Long64_t, Long64_t>>& removed) {
+    std::vector<std::pair<Long64_t, Long64_t>> result;
+    for (std::pair<Long64_t, Long64_t> range : ranges) {
+        for (const auto& cut : removed) {
+            if (cut.second <= range.first || cut.first >= range.second) continue;
+            if (cut.first > range.first) result.emplace_back(range.first, cut.first);
+            range.first = cut.second;
+            if (range.first >= range.second) break;
+        }
+        if (range.first < range.second) result.push_back(range);
+    }
+    ranges.swap(result);
+}
+
+void Manifest::AddChain(const std::vector<std::string>& fileNames, const std::vector<Long64_t>& fileEntries, Long64_t firstEntry, Long64_t lastEntry) {
+    if (fileNames.size() != fileEntries.size()) {
+        throw std::runtime_error("[Runtime Error] Manifest::AddChain() - Different numbers of files and entry counts");
+    }
+    Long64_t offset = 0;
+    for (std::size_t i = 0; i < fileNames.size(); i++) {
+        // Part of the chain entry range inside this file
+        Long64_t first = std::max(firstEntry, offset) - offset;
+        Long64_t last = ((lastEntry < 0) ? offset + fileEntries[i] : std::min(lastEntry, offset + fileEntries[i])) - offset;
+        offset += fileEntries[i];
+        if (last <= first && fileEntries[i] > 0) continue;
+
+        Input& input = mInputs[fileNames[i]];
+        Stat(fileNames[i], input.nSize, input.nMTime);
+        input.nEntries = fileEntries[i];
+        input.vRanges.emplace_back(first, last);
+        Coalesce(input.vRanges);
+    }
+}
+
+void Manifest::AddSkipped(const std::string& fileName, Long64_t firstEntry, Long64_t lastEntry, const std::string& reason) {
+    Skipped& skipped = mSkipped[fileName];
+    skipped.vRanges.emplace_back(firstEntry, (lastEntry < 0) ? kUnknownEntry : lastEntry);
+    Coalesce(skipped.vRanges);
+    skipped.sReason = reason;
+    auto it = mInputs.find(fileName);
+    if (it == mInputs.end()) return;
+    Subtract(it->second.vRanges, skipped.vRanges);
+    if (it->second.vRanges.empty() && it->second.nEntries > 0) mInputs.erase(it);
+}
+
+void Manifest::DropCoveredSkipped() {
+    for (auto it = mSkipped.begin(); it != mSkipped.end();) {
+        auto input = mInputs.find(it->first);
+        if (input != mInputs.end()) {
+            // The file was opened by another job, its number of entries is known
+            for (auto& range : it->second.vRanges) {
+                if (range.second == kUnknownEntry) range.second = input->second.nEntries;
+            }
+            Coalesce(it->second.vRanges);
+            Subtract(it->second.vRanges, input->second.vRanges);
+        }
+        if (it->second.vRanges.empty()) it = mSkipped.erase(it);
+        else ++it;
+    }
+}
+
+void Manifest::Merge(const Manifest& other) {
+    if (mInputs.empty() && sCodeVersion.empty() && sConfig.empty()) {
+        sCodeVersion = other.sCodeVersion;
+        sConfig = other.sConfig;
+    }
+    if (sCodeVersion != other.sCodeVersion) sCodeVersion = "mixed";
+    if (sConfig != other.sConfig) sConfig = "mixed";
+    for (const auto& entry : other.mInputs) {
+        auto it = mInputs.find(entry.first);
+        if (it == mInputs.end()) {
+            mInputs[entry.first] = entry.second;
+            continue;
+        }
+        Input& input = it->second;
+        // The same file with another content : the output mixes both, it will never be unchanged
+        if (input.nSize != entry.second.nSize || input.nMTime != entry.second.nMTime || input.nEntries != entry.second.nEntries) {
+            input.nSize = -1;
+            input.nMTime = -1;
+        }
+        input.vRanges.insert(input.vRanges.end(), entry.second.vRanges.begin(), entry.second.vRanges.end());
+        Coalesce(input.vRanges);
+    }
+    for (const auto& entry : other.mSkipped) {
+        Skipped& skipped = mSkipped[entry.first];
+        skipped.vRanges.insert(skipped.vRanges.end(), entry.second.vRanges.begin(), entry.second.vRanges.end());
+        Coalesce(skipped.vRanges);
+        if (skipped.sReason.empty()) skipped.sReason = entry.second.sReason;
+    }
+    DropCoveredSkipped();
+}
+
+Manifest::Plan Manifest::MakePlan(const std::vector<std::string>& fileNames, const std::string& config) const {
+    Plan plan;
+    auto Full = [&plan](const std::string& reason) {
+        plan.bFull = true;
+        plan.sReason = reason;
+        plan.sCovered.clear();
+        plan.vNew.clear();
+        return plan;
+    };
+    if (sCodeVersion != CurrentCodeVersion()) return Full("code version " + sCodeVersion + " -> " + CurrentCodeVersion());
+    if (sConfig != config) return Full("configuration changed");
+
+    std::set<std::string> current(fileNames.begin(), fileNames.end());
+    for (const auto& entry : mInputs) {
+        const Input& input = entry.second;
+        if (current.count(entry.first) == 0) return Full("input removed from the list: " + entry.first);
+        if (!input.IsComplete()) return Full("input partially processed: " + entry.first);
+        Long64_t size, mtime;
+        Stat(entry.first, size, mtime);
+        if (input.nSize < 0 || size < 0) return Full("input cannot be checked: " + entry.first);
+        if (size != input.nSize || mtime != input.nMTime) return Full("input changed: " + entry.first);
+    }
+    for (const std::string& fileName : fileNames) {
+        if (mInputs.count(fileName) > 0) plan.sCovered.insert(fileName);
+        else plan.vNew.push_back(fileName);
+    }
+    plan.bUpToDate = plan.vNew.empty();
+    return plan;
+}
+
+std::string Manifest::ToString() const {
+    std::ostringstream text;
+    text << "code\t" << sCodeVersion << "\n";
+    text << "config\t" << Hash(sConfig) << "\t" << sConfig << "\n";
+    for (const auto& entry : mInputs) {
+        const Input& input = entry.second;
+        for (const auto& range : input.vRanges) {
+            text << "input\t" << entry.first << "\t" << input.nSize << "\t" << input.nMTime << "\t" << input.nEntries
+                 << "\t" << range.first << "\t" << range.second << "\n";
+        }
+    }
+    for (const auto& entry : mSkipped) {
+        // The reason is the last field, without separators
+        std::string reason = entry.second.sReason;
+        std::replace(reason.begin(), reason.end(), '\t', ' ');
+        std::replace(reason.begin(), reason.end(), '\n', ' ');
+        for (const auto& range : entry.second.vRanges) {
+            text << "skipped\t" << entry.first << "\t" << range.first << "\t" << ((range.second == kUnknownEntry) ? -1 : range.second) << "\t" << reason << "\n";
+        }
+    }
+    return text.str();
+}
+
+void Manifest::FromString(const std::string& text) {
+    sCodeVersion.clear();
+    sConfig.clear();
+    mInputs.clear();
+    mSkipped.clear();
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::vector<std::string> fields;
+        std::istringstream fieldStream(line);
+        std::string field;
+        while (std::getline(fieldStream, field, '\t')) fields.push_back(field);
+        if (fields.empty()) continue;
+        if (fields[0] == "code" && fields.size() == 2) {
+            sCodeVersion = fields[1];
+        } else if (fields[0] == "config" && fields.size() == 3) {
+            sConfig = fields[2];
+        } else if (fields[0] == "input" && fields.size() == 7) {
+            Input& input = mInputs[fields[1]];
+            input.nSize = std::stoll(fields[2]);
+            input.nMTime = std::stoll(fields[3]);
+            input.nEntries = std::stoll(fields[4]);
+            input.vRanges.emplace_back(std::stoll(fields[5]), std::stoll(fields[6]));
+            Coalesce(input.vRanges);
+        } else if (fields[0] == "skipped" && (fields.size() == 5 || fields.size() == 4)) {
+            Skipped& skipped = mSkipped[fields[1]];
+            Long64_t last = std::stoll(fields[3]);
+            skipped.vRanges.emplace_back(std::stoll(fields[2]), (last < 0) ? kUnknownEntry : last);
+            Coalesce(skipped.vRanges);
+            skipped.sReason = (fields.size() == 5) ? fields[4] : "";
+        } else {
+            throw std::runtime_error("[Runtime Error] Manifest::FromString() - Invalid line: " + line);
+        }
+    }
+}
+
+Bool_t Manifest::Read(const std::string& fileName) {
+    TFile* f = TFile::Open(fileName.c_str(), "READ");
+    if (f == nullptr || f->IsZombie()) {
+        delete f;
+        return false;
+    }
+    TNamed* named = (TNamed*) f->Get(kObjectName);
+    Bool_t found = (named != nullptr);
+    if (found) FromString(named->GetTitle());
+    delete named;
+    f->Close();
+    delete f;
+    return found;
+}
+
+void Manifest::Write(TDirectory* dir) const {
+    dir->cd();
+    TNamed(kObjectName, ToString().c_str()).Write();
+}
@@ -4,68 +4,31 @@
 ///////////////// MuonHolder functions ///////////////////////
 //////////////////////////////////////////////////////////////
 
-Bool_t MuonHolder::DoTightObjSel() {
-    // If RoccoSF is not set, use the original muon fourvector
-    if (dMuonRoccoSF == -1) {
-        if (    (MuonOrgVec.Pt() > 30.0)
-            &&  (std::abs(MuonOrgVec.Eta()) < 2.4)
-            &&  (bTightId)
-            &&  (fPfRelIso04_all < 0.1) ) {
-            return true;
-        }
-        else {
-            return false;
-        }
-    }
-
+Bool_t MuonHolder::DoTightObjSel(const MuonCuts& cuts) {
     // Tight obj sel components : 
     // 1. muon ID
     // 2. muon isolation
     // 3. muon pT
     // 4. muon eta
-    // TODO: Need to update the cut values flexibly
-    TLorentzVector RoccoVec = MuonOrgVec * dMuonRoccoSF;
-    if (    (RoccoVec.Pt() > 30.0)
-        &&  (std::abs(RoccoVec.Eta()) < 2.4)
+    // If RoccoSF is not set, use the original muon fourvector
+    const TLorentzVector muonVec = (dMuonRoccoSF == -1) ? MuonOrgVec : MuonOrgVec * dMuonRoccoSF;
+    return  (muonVec.Pt() > cuts.dTightPt)
+        &&  (std::abs(muonVec.Eta()) < cuts.dTightEta)
         &&  (bTightId)
-        &&  (fPfRelIso04_all < 0.1) ) {
-        return true;
-    }
-    else {
-        return false;
-    }
+        &&  (fPfRelIso04_all < cuts.dTightIso);
 }
 
-Bool_t MuonHolder::DoLooseObjSel() {
-    // If RoccoSF is not set, use the original muon fourvector
-    if (dMuonRoccoSF == -1) {
-        if (    (MuonOrgVec.Pt() > 10.0)
-            &&  (std::abs(MuonOrgVec.Eta()) < 2.4)
-            &&  (bIsGlobal || bIsTracker)
-            &&  (bIsPFcand) ) {
-            return true;
-        }
-        else {
-            return false;
-        }
-    }
-
+Bool_t MuonHolder::DoLooseObjSel(const MuonCuts& cuts) {
     // Loose obj sel components : 
     // 1. muon Type
-    // 2. muon isolation
-    // 3. muon pT
-    // 4. muon eta
-    // TODO: Need to update the cut values flexibly
-    TLorentzVector RoccoVec = MuonOrgVec * dMuonRoccoSF;
-    if (    (RoccoVec.Pt() > 10.0)
-        &&  (std::abs(RoccoVec.Eta()) < 2.4)
+    // 2. muon pT
+    // 3. muon eta
+    // If RoccoSF is not set, use the original muon fourvector
+    const TLorentzVector muonVec = (dMuonRoccoSF == -1) ? MuonOrgVec : MuonOrgVec * dMuonRoccoSF;
+    return  (muonVec.Pt() > cuts.dLoosePt)
+        &&  (std::abs(muonVec.Eta()) < cuts.dLooseEta)
         &&  (bIsGlobal || bIsTracker)
-        &&  (bIsPFcand) ) {
-        return true;
-    }
-    else {
-        return false;
-    }
+        &&  (bIsPFcand);
 }
 
 //////////////////////////////////////////////////////////////
@@ -81,6 +44,7 @@ void Muons::Init() {
 
     // Loop over all muons, set their properties and collect them in a vector
     vMuonVec.clear();
+    vMuonVec.reserve(**(cData->nMuon)); // Preallocate memory
     for (Int_t idx = 0; idx < **(cData->nMuon); idx++) {
         // Define muon fourvector
         TLorentzVector vec;
@@ -109,7 +73,7 @@ void Muons::Init() {
     bIsInit = true;
 }
 
-void Muons::DoObjSel() {
+void Muons::DoObjSel(const MuonCuts& cuts) {
     // Check if muons are initialized
     if (!bIsInit) {
         std::cerr << "[ERROR] Muons::DoObjSel() - Muons are not initialized" << std::endl;
@@ -125,10 +89,10 @@ void Muons::DoObjSel() {
     // Do object selection
     for (auto& muon : vMuonVec) {
         // Set obj sel
-        if (muon.DoTightObjSel()) { 
+        if (muon.DoTightObjSel(cuts)) { 
             muon.SetObjSel(true, false); // Is tight muon
         }
-        else if (muon.DoLooseObjSel()) {
+        else if (muon.DoLooseObjSel(cuts)) {
             muon.SetObjSel(false, true); // Is loose muon
         }
         else {
@@ -139,7 +103,7 @@ void Muons::DoObjSel() {
 }
 
 // Get all muons
-std::vector<MuonHolder>& Muons::GetMuons() {
+ArenaVector<MuonHolder>& Muons::GetMuons() {
     // Check if muons are initialized
     if (!bIsInit) {
         std::cerr << "[ERROR] Muons::GetMuons() - Muons are not initialized" << std::endl;
@@ -148,14 +112,16 @@ std::vector<MuonHolder>& Muons::GetMuons() {
     return vMuonVec;
 }
 
-std::vector<MuonHolder> Muons::GetTightMuons() {
+// Selected muons are copied into a vector allocated from the same arena as the muons
+ArenaVector<MuonHolder> Muons::GetTightMuons() {
+    ArenaVector<MuonHolder> selectedMuons(vMuonVec.get_allocator());
     // Check if object selection is done
     if (!bDidObjSel) {
         std::cerr << "[ERROR] Muons::GetTightMuons() - Object selection is not done" << std::endl;
-        return std::vector<MuonHolder> {};
+        return selectedMuons;
     }
 
-    std::vector<MuonHolder> selectedMuons;
+    selectedMuons.reserve(vMuonVec.size());
     for (auto& muon : vMuonVec) {
         if (muon.PassTightObjSel()) {
             selectedMuons.push_back(muon);
@@ -164,14 +130,15 @@ std::vector<MuonHolder> Muons::GetTightMuons() {
     return selectedMuons;
 }
 
-std::vector<MuonHolder> Muons::GetLooseMuons() {
+ArenaVector<MuonHolder> Muons::GetLooseMuons() {
+    ArenaVector<MuonHolder> looseMuons(vMuonVec.get_allocator());
     // Check if object selection is done
     if (!bDidObjSel) {
         std::cerr << "[ERROR] Muons::GetLooseMuons() - Object selection is not done" << std::endl;
-        return std::vector<MuonHolder> {};
+        return looseMuons;
     }
 
-    std::vector<MuonHolder> looseMuons;
+    looseMuons.reserve(vMuonVec.size());
     for (auto& muon : vMuonVec) {
         if (muon.PassLooseObjSel()) {
             looseMuons.push_back(muon);
@@ -5,12 +5,13 @@ PU::~PU() {
 }
 
 void PU::Clear() {
-    delete hDataPUHist;
-    delete hMCPUHist;
-    delete hPUWeights;
-
-    fDataPUFile->Close();
-    fMCPUFile->Close();
+    vPUWeights.clear();
+    pPUWeights = nullptr;
+    pSegment.reset();
+    pCorrection = nullptr;
+    pCorrectionSet.reset();
+    nBins = 0;
+    bIsInit = false;
 }
 
 void PU::Init() {
@@ -23,45 +24,249 @@ void PU::Init() {
     if (sEra.find("2016") != std::string::npos)
         sEra = "2016";
 
-    fDataPUFile = TFile::Open( ("../pileup/PileupHistogram-goldenJSON-13tev-" + sEra + "-69200ub-99bins.root").c_str() );
-    fMCPUFile = TFile::Open( ("../pileup/pileup_" + sEra + "_UL_MC_99bins.root").c_str() );
+    if (!sCorrectionFileName.empty()) {
+        InitCorrection();
+        PrintInitInfo();
+        bIsInit = true;
+        return;
+    }
 
-    hDataPUHist = (TH1D*)fDataPUFile->Get("pileup");
-    hMCPUHist = (TH1D*)fMCPUFile->Get("pileup");
+    // Relative to the source directory, the ROOT files are read from ../ if the profiles are not embedded
+    sDataPUFileName      = "pileup/PileupHistogram-goldenJSON-13tev-" + sEra + "-" + kXSecNom + "-99bins.root";
+    sDataPUFileName_Up   = "pileup/PileupHistogram-goldenJSON-13tev-" + sEra + "-" + kXSecUp + "-99bins.root";
+    sDataPUFileName_Down = "pileup/PileupHistogram-goldenJSON-13tev-" + sEra + "-" + kXSecDown + "-99bins.root";
+    sMCPUFileName        = "pileup/pileup_" + sEra + "_UL_MC_99bins.root";
 
-    hPUWeights = static_cast<TH1D*>(hDataPUHist->Clone());
-    hPUWeights->Scale(1. / hDataPUHist->Integral()); // Normalize data PU hist
-    
-    hPUWeights->Divide(hMCPUHist); // Divide data PU hist by MC PU hist
+    // Profiles read from the ROOT files : the weight table is shared between the jobs of the node
+    // The checksum covers the content of every profile that is not embedded
+    Bool_t useStore = false;
+    ULong64_t checksum = CorrectionStore::Checksum("PU-" + sEra);
+    for (const std::string& fileName : {sDataPUFileName, sDataPUFileName_Up, sDataPUFileName_Down, sMCPUFileName}) {
+        if (CalibTables::Find(fileName, "pileup") != nullptr) continue;
+        ULong64_t fileChecksum = CorrectionStore::ChecksumFile("../" + fileName, CorrectionStore::Checksum(fileName, checksum));
+        if (fileChecksum != 0) useStore = true;
+        checksum = (fileChecksum != 0) ? fileChecksum : CorrectionStore::Checksum(fileName, checksum);
+    }
+
+    if (useStore && CorrectionStore::IsEnabled()) {
+        pSegment = CorrectionStore::Get("PU-" + sEra, checksum, [this]() {
+            BuildWeights();
+            return SerializeWeights();
+        });
+        ReadWeights(*pSegment);
+        vPUWeights.clear();
+        vPUWeights.shrink_to_fit();
+    } else {
+        BuildWeights();
+        pPUWeights = vPUWeights.data();
+    }
 
     PrintInitInfo();
 
     bIsInit = true;
 }
 
+void PU::InitCorrection() {
+    if (sCorrectionName.empty()) sCorrectionName = "Collisions" + sEra.substr(2, 2) + "_UltraLegacy_goldenJSON";
+    pCorrectionSet = CorrectionSet::Open(sCorrectionFileName);
+    pCorrection = &pCorrectionSet->At(sCorrectionName);
+
+    // First real input is the true number of interactions, the string input selects the variation
+    iNTrueIntInput = -1;
+    iWeightsInput = -1;
+    for (Int_t i = 0; i < pCorrection->GetNInputs(); i++) {
+        if (pCorrection->GetInputType(i) == Correction::InputType::kString) {
+            if (iWeightsInput < 0) iWeightsInput = i;
+        } else if (iNTrueIntInput < 0) {
+            iNTrueIntInput = i;
+        }
+    }
+    if (pCorrection->GetNInputs() != 2 || iNTrueIntInput < 0 || iWeightsInput < 0) {
+        throw std::runtime_error("[Runtime Error] PU::InitCorrection() - Unexpected inputs of " + sCorrectionName);
+    }
+    dNomId = pCorrection->GetStringId(iWeightsInput, "nominal");
+    dUpId = pCorrection->GetStringId(iWeightsInput, "up");
+    dDownId = pCorrection->GetStringId(iWeightsInput, "down");
+    if (dNomId < 0.) {
+        throw std::runtime_error("[Runtime Error] PU::InitCorrection() - No nominal weights in " + sCorrectionName);
+    }
+    bHasVariations = (dUpId >= 0. && dDownId >= 0.);
+    if (!bHasVariations) {
+        std::cerr << "[Warning] PU::InitCorrection() - No up/down PU weights in " << sCorrectionName << ", PU up/down weights are set to nominal and the PU up/down histograms are not written" << std::endl;
+        dUpId = dNomId;
+        dDownId = dNomId;
+    }
+}
+
+void PU::BuildWeights() {
+    // MC profiles (see pileup/create_pileup_hist.C) are already normalized to 1
+    nEmbeddedProfiles = 0;
+    std::vector<Double_t> dataProfile = ReadProfile(sDataPUFileName, true);
+    std::vector<Double_t> mcProfile = ReadProfile(sMCPUFileName, false);
+    if (dataProfile.size() != mcProfile.size()) {
+        throw std::runtime_error("[Runtime Error] PU::Init() - Data and MC PU profiles have different number of bins");
+    }
+
+    // Up/down profiles of the minimum-bias cross-section, fall back to the nominal one if they are not available
+    std::vector<Double_t> dataProfile_Up = dataProfile;
+    std::vector<Double_t> dataProfile_Down = dataProfile;
+    bHasVariations = HasProfile(sDataPUFileName_Up) && HasProfile(sDataPUFileName_Down);
+    if (bHasVariations) {
+        dataProfile_Up = ReadProfile(sDataPUFileName_Up, true);
+        dataProfile_Down = ReadProfile(sDataPUFileName_Down, true);
+        if (dataProfile_Up.size() != mcProfile.size() || dataProfile_Down.size() != mcProfile.size()) {
+            throw std::runtime_error("[Runtime Error] PU::Init() - Up/down data PU profiles have different number of bins");
+        }
+    } else {
+        std::cerr << "[Warning] PU::Init() - No up/down data PU profiles for " << sEra << ", PU up/down weights are set to nominal and the PU up/down histograms are not written" << std::endl;
+    }
+
+    // Data / MC, 0 where the MC profile is empty (same as TH1::Divide)
+    nBins = mcProfile.size();
+    vPUWeights.assign(nBins + 1, PUWeights());
+    for (Int_t i = 0; i < nBins; i++) {
+        if (mcProfile[i] == 0.) continue;
+        vPUWeights[i].dNom  = dataProfile[i] / mcProfile[i];
+        vPUWeights[i].dUp   = dataProfile_Up[i] / mcProfile[i];
+        vPUWeights[i].dDown = dataProfile_Down[i] / mcProfile[i];
+    }
+}
+
+// Layout : nBins, dPUMin, dPUBinWidth, bHasVariations as doubles, then the nBins + 1 weights
+std::string PU::SerializeWeights() const {
+    const Double_t header[4] = {(Double_t)nBins, dPUMin, dPUBinWidth, (Double_t)bHasVariations};
+    std::string payload((const char*)header, sizeof(header));
+    payload.append((const char*)vPUWeights.data(), vPUWeights.size() * sizeof(PUWeights));
+    return payload;
+}
+
+void PU::ReadWeights(const CorrectionSegment& segment) {
+    const Double_t* header = (const Double_t*)segment.GetData();
+    if (segment.GetSize() < 4 * sizeof(Double_t)) {
+        throw std::runtime_error("[Runtime Error] PU::ReadWeights() - Invalid PU weight table");
+    }
+    nBins = (Int_t)header[0];
+    dPUMin = header[1];
+    dPUBinWidth = header[2];
+    bHasVariations = (header[3] != 0.);
+    if (segment.GetSize() != 4 * sizeof(Double_t) + (nBins + 1) * sizeof(PUWeights)) {
+        throw std::runtime_error("[Runtime Error] PU::ReadWeights() - Invalid PU weight table");
+    }
+    pPUWeights = (const PUWeights*)(header + 4);
+}
+
+Bool_t PU::HasProfile(const std::string& fileName) {
+    if (CalibTables::Find(fileName, "pileup") != nullptr) return true;
+    TFile* f = TFile::Open(("../" + fileName).c_str());
+    Bool_t isValid = (f != nullptr && !f->IsZombie());
+    if (f) f->Close();
+    delete f;
+    return isValid;
+}
+
+std::vector<Double_t> PU::ReadProfile(const std::string& fileName, Bool_t normalize) {
+    // Profile embedded at build time, no file I/O
+    const CalibHist* hist = CalibTables::Find(fileName, "pileup");
+    if (hist != nullptr && hist->nY == 0) {
+        nEmbeddedProfiles++;
+        return MakeProfile(fileName, hist->nX, hist->pXEdges, hist->pContent, normalize);
+    }
+
+    TFile* f = TFile::Open(("../" + fileName).c_str());
+    if (f == nullptr || f->IsZombie()) {
+        delete f;
+        throw std::runtime_error("[Runtime Error] PU::ReadProfile() - Cannot open ../" + fileName);
+    }
+    TH1D* h = (TH1D*)f->Get("pileup");
+    if (h == nullptr) {
+        f->Close();
+        delete f;
+        throw std::runtime_error("[Runtime Error] PU::ReadProfile() - Cannot find pileup histogram in ../" + fileName);
+    }
+
+    Int_t n = h->GetNbinsX();
+    std::vector<Double_t> edges(n + 1), content(n);
+    for (Int_t i = 0; i <= n; i++) edges[i] = h->GetBinLowEdge(i + 1);
+    for (Int_t i = 0; i < n; i++) content[i] = h->GetBinContent(i + 1);
+
+    f->Close();
+    delete f;
+    return MakeProfile(fileName, n, edges.data(), content.data(), normalize);
+}
+
+std::vector<Double_t> PU::MakeProfile(const std::string& fileName, Int_t n, const Double_t* edges, const Double_t* content, Bool_t normalize) {
+    // Direct indexing needs uniform bins
+    dPUMin = edges[0];
+    dPUBinWidth = (edges[n] - dPUMin) / n;
+    for (Int_t i = 0; i < n; i++) {
+        if (std::abs((edges[i + 1] - edges[i]) - dPUBinWidth) > 1e-6 * dPUBinWidth) {
+            throw std::runtime_error("[Runtime Error] PU::MakeProfile() - Non-uniform binning in " + fileName);
+        }
+    }
+
+    // Same as TH1::Integral() over the bins in range
+    Double_t integral = 1.;
+    if (normalize) {
+        integral = 0.;
+        for (Int_t i = 0; i < n; i++) integral += content[i];
+    }
+    std::vector<Double_t> profile(n);
+    for (Int_t i = 0; i < n; i++) {
+        profile[i] = content[i] / integral;
+    }
+    return profile;
+}
+
 void PU::PrintInitInfo() {
     std::cout << "-----------------------------------------------" << std::endl;
     std::cout << "[Info] PU::PrintInitInfo() - PU is initialized" << std::endl;
     std::cout << "[Info] PU::PrintInitInfo() - Era: " << sEra << std::endl;
-    std::cout << "[Info] PU::PrintInitInfo() - Data PU file: " << fDataPUFile->GetName() << std::endl;
-    std::cout << "[Info] PU::PrintInitInfo() - MC PU file: " << fMCPUFile->GetName() << std::endl;
+    if (pCorrection != nullptr) {
+        std::cout << "[Info] PU::PrintInitInfo() - Correction file: " << sCorrectionFileName << std::endl;
+        std::cout << "[Info] PU::PrintInitInfo() - Correction: " << sCorrectionName << std::endl;
+        std::cout << "[Info] PU::PrintInitInfo() - Has up/down variations: " << bHasVariations << std::endl;
+        std::cout << "-----------------------------------------------" << std::endl;
+        return;
+    }
+    std::cout << "[Info] PU::PrintInitInfo() - Data PU file: " << sDataPUFileName << std::endl;
+    if (bHasVariations) {
+        std::cout << "[Info] PU::PrintInitInfo() - Data PU file (up): " << sDataPUFileName_Up << std::endl;
+        std::cout << "[Info] PU::PrintInitInfo() - Data PU file (down): " << sDataPUFileName_Down << std::endl;
+    }
+    std::cout << "[Info] PU::PrintInitInfo() - MC PU file: " << sMCPUFileName << std::endl;
+    std::cout << "[Info] PU::PrintInitInfo() - # of profiles embedded at build time: " << nEmbeddedProfiles << std::endl;
+    std::cout << "[Info] PU::PrintInitInfo() - Weight table: " << (pSegment ? (pSegment->IsShared() ? "node-wide store" : "private copy") : "built in memory") << std::endl;
+    std::cout << "[Info] PU::PrintInitInfo() - # of bins: " << nBins << ", range: " << dPUMin << " - " << dPUMin + nBins * dPUBinWidth << std::endl;
     std::cout << "-----------------------------------------------" << std::endl;
 }
 
 Double_t PU::GetPUWeight(Float_t nTrueInt) {
+    return GetPUWeights(nTrueInt).dNom;
+}
+
+// Out of range nTrueInt gives the zero sentinel, reported once
+PUWeights PU::GetPUWeights(Float_t nTrueInt) {
     if (!bIsInit) {
-        std::cerr << "PU::GetPUWeight() - PU is not initialized" << std::endl;
-        return 0;
+        std::cerr << "PU::GetPUWeights() - PU is not initialized" << std::endl;
+        return PUWeights();
     }
 
-    // Check if nTrueInt is within valid range
-    Float_t fPUWeight_min = hPUWeights->GetBinLowEdge(1);
-    Float_t fPUWeight_max = hPUWeights->GetBinLowEdge(hPUWeights->GetNbinsX() + 1);
-    if (nTrueInt < fPUWeight_min || nTrueInt >= fPUWeight_max) {
-        std::cerr << "PU::GetPUWeight() - True interaction number out of range" << std::endl;
-        return 0;
+    if (pCorrection != nullptr) {
+        Double_t inputs[2];
+        inputs[iNTrueIntInput] = nTrueInt;
+        PUWeights weights;
+        inputs[iWeightsInput] = dNomId;
+        weights.dNom = pCorrection->Evaluate(inputs);
+        inputs[iWeightsInput] = dUpId;
+        weights.dUp = pCorrection->Evaluate(inputs);
+        inputs[iWeightsInput] = dDownId;
+        weights.dDown = pCorrection->Evaluate(inputs);
+        return weights;
     }
 
-    Int_t bin = hPUWeights->GetXaxis()->FindBin(nTrueInt);
-    return hPUWeights->GetBinContent(bin);
-}
\ No newline at end of file
+    Int_t idx = GetIndex(nTrueInt);
+    if (idx == nBins) {
+        if (nOutOfRange.fetch_add(1, std::memory_order_relaxed) == 0) std::cerr << "PU::GetPUWeights() - True interaction number out of range: " << nTrueInt << std::endl;
+    }
+    return pPUWeights[idx];
+}
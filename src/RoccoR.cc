@@ -5,12 +5,21 @@
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
+#include <cstring>
+#include <iterator>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "RoccoR.h"
+#include "CorrectionStore.h"
 #include "TString.h"
 
-const double CrystalBall::pi = 3.14159;
-const double CrystalBall::sqrtPiOver2 = sqrt(CrystalBall::pi/2.0);
-const double CrystalBall::sqrt2 = sqrt(2.0);
+const double CrystalBallPar::pi = 3.14159;
+const double CrystalBallPar::sqrtPiOver2 = sqrt(CrystalBallPar::pi/2.0);
+const double CrystalBallPar::sqrt2 = sqrt(2.0);
+const double CrystalBallTab::TABDMAX = 7.0;
 
 RocRes::RocRes(){
     reset();
@@ -109,7 +118,9 @@ double RocRes::kExtra(double pt, double eta, int n, double u) const{
 }
 
 
-RoccoR::RoccoR(){}
+RoccoR::RoccoR(){
+    reset();
+}
 
 RoccoR::RoccoR(std::string filename){
     init(filename);
@@ -118,20 +129,134 @@ RoccoR::RoccoR(std::string filename){
 void RoccoR::reset(){
     NETA=0;
     NPHI=0;
-    std::vector<double>().swap(etabin);
+    DPHI=0;
+    etabin=nullptr;
+    RETA=0;
+    NTRK=0;
+    NMIN=0;
+    resEta=nullptr;
     nset=0;
     std::vector<int>().swap(nmem);
-    std::vector<std::vector<RocOne>>().swap(RC);
-
+    std::vector<int>().swap(tvar);
+    std::vector<std::vector<FlatOne>>().swap(FL);
+    version.clear();
+    segment.reset();
+    std::vector<double>().swap(image);
+    imageData=nullptr;
+    imageSize=0;
 }
 
 
+const char RoccoR::CACHEMAGIC[8] = {'R','O','C','C','O','B','I','N'};
+const unsigned RoccoR::CACHEVERSION = 2;
+
+// FNV-1a, 64 bits
+unsigned long long RoccoR::checksum(const char* data, size_t size){
+    unsigned long long h = 14695981039346656037ULL;
+    for(size_t i=0; i<size; ++i){
+	h ^= (unsigned char)data[i];
+	h *= 1099511628211ULL;
+    }
+    return h;
+}
+
 void RoccoR::init(std::string filename){
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if(in.fail()) throw std::invalid_argument("RoccoR::init could not open file " + filename);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    unsigned long long sourceHash = checksum(text.data(), text.size());
+
+    reset();
+    std::string cachename = filename + ".bin";
+    if(CorrectionStore::IsEnabled()){
+	// Node-wide store: the first job of the node publishes the cache image, the others map it and read the tables in place
+	bool built = false;
+	std::string basename = filename.substr(filename.find_last_of('/')+1);
+	auto stored = CorrectionStore::Get("RoccoR-" + basename, sourceHash, [&](){
+	    initLocal(filename, cachename, text.size(), sourceHash);
+	    built = true;
+	    return std::string(imageData, imageSize);
+	});
+	if(attach(stored->GetData(), stored->GetSize(), text.size(), sourceHash)){
+	    segment = stored;
+	    std::vector<double>().swap(image);
+	    if(!built){
+		if(!version.empty()) std::cout << Form("%-8s %s", "RoccoR:", version.c_str()) << std::endl;
+		std::cout << Form("%-8s loaded from the correction store", "RoccoR:") << std::endl;
+	    }
+	    return;
+	}
+    }
+    initLocal(filename, cachename, text.size(), sourceHash);
+}
+
+void RoccoR::initLocal(const std::string& filename, const std::string& cachename, unsigned long long sourceSize, unsigned long long sourceHash){
+    if(readCache(cachename, sourceSize, sourceHash)){
+	if(!version.empty()) std::cout << Form("%-8s %s", "RoccoR:", version.c_str()) << std::endl;
+	std::cout << Form("%-8s loaded from cache %s", "RoccoR:", cachename.c_str()) << std::endl;
+	return;
+    }
+    std::string data = parseText(filename, sourceSize, sourceHash);
+    image.resize(data.size()/sizeof(double));
+    memcpy(image.data(), data.data(), data.size());
+    if(!attach((const char*)image.data(), data.size(), sourceSize, sourceHash))
+	throw std::invalid_argument("RoccoR::init could not read the parameters of file " + filename);
+    if(writeImage(cachename, data))
+	std::cout << Form("%-8s cache written to %s", "RoccoR:", cachename.c_str()) << std::endl;
+}
+
+// Cache layout: header, then the payload written by parseText, all in native byte order
+// Payload: ints (version length, NETA, NPHI, RETA, NTRK, NMIN, nset, nmem[nset], tvar[nset]), version, then doubles
+// (DPHI, etabin[NETA+1], resEta[RETA], one block per set/member in the order of FlatOne), each part padded to 8 bytes
+namespace {
+    struct RoccoCacheHeader{
+	char magic[8];
+	unsigned version;
+	unsigned sizeofDouble;
+	unsigned long long sourceSize;
+	unsigned long long sourceHash;
+	unsigned long long payloadSize;
+    };
+    static_assert(sizeof(RoccoCacheHeader)%sizeof(double)==0, "the doubles of the payload are read in place");
+
+    struct RoccoCacheWriter{
+	std::string buf;
+	void put(const void* p, size_t n){ buf.append((const char*)p, n); }
+	void putInt(int x){ put(&x, sizeof(x)); }
+	void putDouble(double x){ put(&x, sizeof(x)); }
+	void pad(){ buf.append((sizeof(double)-buf.size()%sizeof(double))%sizeof(double), '\0'); }
+    };
+
+    struct RoccoCacheReader{
+	const char* begin;
+	const char* p;
+	const char* end;
+	bool ok;
+	const char* skip(size_t n){
+	    if(!ok || (size_t)(end-p)<n){ ok=false; return nullptr; }
+	    const char* q = p;
+	    p += n;
+	    return q;
+	}
+	int getInt(){ int x=0; const char* q = skip(sizeof(x)); if(q) memcpy(&x, q, sizeof(x)); return x; }
+	const double* getDoubles(size_t n){ return (const double*)skip(n*sizeof(double)); }
+	void pad(){ skip((sizeof(double)-(p-begin)%sizeof(double))%sizeof(double)); }
+    };
+
+    // Number of doubles of one set/member: CP (M, A, X for MC and DT), kRes, nTrk edges, rsPar, CrystalBall
+    size_t roccoMemberSize(int NETA, int NPHI, int RETA, int NTRK){
+	return 6*NETA*NPHI + 2*RETA + 2*RETA*(NTRK+1) + 3*RETA*NTRK + RETA*NTRK*sizeof(CrystalBallPar)/sizeof(double);
+    }
+}
+
+std::string RoccoR::parseText(const std::string& filename, unsigned long long sourceSize, unsigned long long sourceHash){
     std::ifstream in(filename.c_str());
     if(in.fail()) throw std::invalid_argument("RoccoR::init could not open file " + filename);
 
-    int RMIN(0), RTRK(0), RETA(0);
+    std::vector<double> CETA;
     std::vector<double> BETA;
+    std::vector<std::vector<RocOne>> RC;
 
     std::string tag;
     int type, sys, mem, var, bin;	
@@ -141,6 +266,7 @@ void RoccoR::init(std::string filename){
 	std::stringstream ss(s); 
 	if(s.substr(0,7)=="VERSION") {
 	    ss >> s >> s;
+	    version = s;
 	    std::cout << Form("%-8s %s", "RoccoR:", s.c_str()) << std::endl; 
 	    continue;
 	}
@@ -162,8 +288,8 @@ void RoccoR::init(std::string filename){
 	    ss >> tag;
 	    for(int i=0; i<nset; ++i) ss >> tvar[i];
 	}
-	else if(first4=="RMIN") ss >> tag >> RMIN;
-	else if(first4=="RTRK") ss >> tag >> RTRK;
+	else if(first4=="RMIN") ss >> tag >> NMIN;
+	else if(first4=="RTRK") ss >> tag >> NTRK;
 	else if(first4=="RETA") {
 	    ss >> tag >> RETA;
 	    BETA.resize(RETA+1);
@@ -176,24 +302,24 @@ void RoccoR::init(std::string filename){
 	}
 	else if(first4=="CETA")  {
 	    ss >> tag >> NETA;
-	    etabin.resize(NETA+1);
-	    for(auto& h: etabin) ss >> h;
+	    CETA.resize(NETA+1);
+	    for(auto& h: CETA) ss >> h;
 	}
 	else{ 
 	    ss >> sys >> mem >> tag;
 	    auto &rc = RC[sys][mem]; 
 	    rc.RR.NETA=RETA;
-	    rc.RR.NTRK=RTRK;
-	    rc.RR.NMIN=RMIN;
+	    rc.RR.NTRK=NTRK;
+	    rc.RR.NMIN=NMIN;
 	    auto &resol = rc.RR.resol;
 	    if(resol.empty()){
 		resol.resize(RETA);
 		for(size_t ir=0; ir<resol.size(); ++ir){
 		    auto &r = resol[ir];
 		    r.eta = BETA[ir];
-		    r.cb.resize(RTRK);
-		    for(auto i:{0,1})r.nTrk[i].resize(RTRK+1);
-		    for(auto i:{0,1,2})r.rsPar[i].resize(RTRK);
+		    r.cb.resize(NTRK);
+		    for(auto i:{0,1})r.nTrk[i].resize(NTRK+1);
+		    for(auto i:{0,1,2})r.rsPar[i].resize(NTRK);
 		}
 	    }
 	    auto &cp = rc.CP;
@@ -206,7 +332,7 @@ void RoccoR::init(std::string filename){
 
 	    if(tag=="R"){
 		ss >> var >> bin; 
-		for(int i=0; i<RTRK; ++i) {
+		for(int i=0; i<NTRK; ++i) {
 		    switch(var){
 			case 0: ss >> resol[bin].rsPar[var][i]; break;
 			case 1: ss >> resol[bin].rsPar[var][i]; break;
@@ -220,7 +346,7 @@ void RoccoR::init(std::string filename){
 	    }
 	    else if(tag=="T") {
 		ss >> type >> bin; 
-		for(int i=0; i<RTRK+1; ++i) ss >> resol[bin].nTrk[type][i];
+		for(int i=0; i<NTRK+1; ++i) ss >> resol[bin].nTrk[type][i];
 	    }
 	    else if(tag=="F") {
 		ss >> type; 
@@ -252,6 +378,182 @@ void RoccoR::init(std::string filename){
 		for(auto &i: r.cb) i.init();
 
     in.close();
+
+    RoccoCacheWriter w;
+    for(int x: {(int)version.size(), NETA, NPHI, RETA, NTRK, NMIN, nset}) w.putInt(x);
+    for(int x: nmem) w.putInt(x);
+    for(int x: tvar) w.putInt(x);
+    w.pad();
+    w.put(version.data(), version.size());
+    w.pad();
+    w.putDouble(DPHI);
+    for(double x: CETA) w.putDouble(x);
+    for(int H=0; H<RETA; ++H) w.putDouble(BETA[H]);
+    for(int is=0; is<nset; ++is){
+	for(int im=0; im<nmem[is]; ++im){
+	    const RocOne& rc = RC[is][im];
+	    const auto& resol = rc.RR.resol;
+	    if(resol.empty()) throw std::invalid_argument(Form("RoccoR::init set %d member %d is missing in file %s", is, im, filename.c_str()));
+	    for(int var=0; var<3; ++var){
+		for(TYPE T:{MC,DT}){
+		    for(const auto& cpEta: rc.CP[T]){
+			for(const auto& cp: cpEta) w.putDouble(var==0 ? cp.M : var==1 ? cp.A : cp.X);
+		    }
+		}
+	    }
+	    for(int i:{0,1}) for(const auto& r: resol) w.putDouble(r.kRes[i]);
+	    for(int i:{0,1}) for(const auto& r: resol) for(double x: r.nTrk[i]) w.putDouble(x);
+	    for(int i:{0,1,2}) for(const auto& r: resol) for(double x: r.rsPar[i]) w.putDouble(x);
+	    for(const auto& r: resol){
+		for(const CrystalBallPar& cb: r.cb) w.put(&cb, sizeof(cb));
+	    }
+	}
+    }
+
+    RoccoCacheHeader header;
+    memcpy(header.magic, CACHEMAGIC, sizeof(header.magic));
+    header.version = CACHEVERSION;
+    header.sizeofDouble = sizeof(double);
+    header.sourceSize = sourceSize;
+    header.sourceHash = sourceHash;
+    header.payloadSize = w.buf.size();
+    return std::string((const char*)&header, sizeof(header)) + w.buf;
+}
+
+bool RoccoR::writeCache(const std::string& cachename, unsigned long long sourceSize, unsigned long long sourceHash) const{
+    if(imageData==nullptr) return false;
+    RoccoCacheHeader header;
+    memcpy(&header, imageData, sizeof(header));
+    header.sourceSize = sourceSize;
+    header.sourceHash = sourceHash;
+    return writeImage(cachename, std::string((const char*)&header, sizeof(header)) + std::string(imageData+sizeof(header), imageSize-sizeof(header)));
+}
+
+bool RoccoR::writeImage(const std::string& cachename, const std::string& data){
+    // Write to a temporary file and rename, so that concurrent jobs never see a partial cache
+    std::string tmpname = cachename + Form(".tmp%d", (int)getpid());
+    std::ofstream out(tmpname.c_str(), std::ios::binary);
+    if(out.fail()) return false;
+    out.write(data.data(), data.size());
+    out.close();
+    if(out.fail() || std::rename(tmpname.c_str(), cachename.c_str())!=0){
+	std::remove(tmpname.c_str());
+	return false;
+    }
+    return true;
+}
+
+bool RoccoR::readCache(const std::string& cachename, unsigned long long sourceSize, unsigned long long sourceHash){
+    int fd = open(cachename.c_str(), O_RDONLY);
+    if(fd<0) return false;
+    struct stat st;
+    if(fstat(fd, &st)!=0 || (size_t)st.st_size<sizeof(RoccoCacheHeader)){
+	close(fd);
+	return false;
+    }
+    size_t size = st.st_size;
+    image.resize((size+sizeof(double)-1)/sizeof(double));
+    size_t nread = 0;
+    while(nread<size){
+	ssize_t n = read(fd, (char*)image.data()+nread, size-nread);
+	if(n<=0) break;
+	nread += n;
+    }
+    close(fd);
+
+    bool ok = nread==size && attach((const char*)image.data(), size, sourceSize, sourceHash);
+    if(!ok){
+	std::vector<double>().swap(image);
+	std::cout << Form("%-8s cache %s is outdated or invalid, reading the text file", "RoccoR:", cachename.c_str()) << std::endl;
+    }
+    return ok;
+}
+
+// Points the views to the image, nothing is copied: the image must outlive them (segment or image)
+bool RoccoR::attach(const char* data, size_t size, unsigned long long sourceSize, unsigned long long sourceHash){
+    if(size<sizeof(RoccoCacheHeader) || (size_t)data%alignof(double)!=0) return false;
+    RoccoCacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    bool valid = memcmp(header.magic, CACHEMAGIC, sizeof(header.magic))==0
+	      && header.version==CACHEVERSION
+	      && header.sizeofDouble==sizeof(double)
+	      && header.sourceSize==sourceSize
+	      && header.sourceHash==sourceHash
+	      && header.payloadSize==size-sizeof(header);
+    if(!valid) return false;
+
+    RoccoCacheReader r{data+sizeof(header), data+sizeof(header), data+size, true};
+    int versionLen = r.getInt();
+    NETA = r.getInt();
+    NPHI = r.getInt();
+    RETA = r.getInt();
+    NTRK = r.getInt();
+    NMIN = r.getInt();
+    nset = r.getInt();
+    r.ok = r.ok && versionLen>=0 && NETA>0 && NPHI>0 && RETA>0 && NTRK>0 && nset>=0 && (size_t)nset<=size;
+    nmem.assign(r.ok ? nset : 0, 0);
+    tvar.assign(r.ok ? nset : 0, 0);
+    for(auto& x: nmem) x = r.getInt();
+    for(auto& x: tvar) x = r.getInt();
+    r.pad();
+    const char* versionData = r.skip(r.ok ? versionLen : 0);
+    r.pad();
+    const double* binning = r.getDoubles(1+NETA+1+RETA);
+    if(r.ok){
+	version.assign(versionData, versionLen);
+	DPHI = binning[0];
+	etabin = binning+1;
+	resEta = binning+1+NETA+1;
+	FL.assign(nset, std::vector<FlatOne>());
+    }
+
+    size_t memberSize = roccoMemberSize(NETA, NPHI, RETA, NTRK);
+    for(int is=0; r.ok && is<nset; ++is){
+	if(nmem[is]<0){ r.ok = false; break; }
+	FL[is].resize(nmem[is]);
+	for(auto& fl: FL[is]){
+	    const double* p = r.getDoubles(memberSize);
+	    if(p==nullptr) break;
+	    for(const double** cp: {fl.cpM, fl.cpA, fl.cpX}){
+		for(TYPE T:{MC,DT}){
+		    cp[T] = p;
+		    p += NETA*NPHI;
+		}
+	    }
+	    for(int i:{0,1}){
+		fl.kRes[i] = p;
+		p += RETA;
+	    }
+	    for(int i:{0,1}){
+		fl.nTrk[i] = p;
+		p += RETA*(NTRK+1);
+	    }
+	    for(int i:{0,1,2}){
+		fl.rsPar[i] = p;
+		p += RETA*NTRK;
+	    }
+	    fl.cb = (const CrystalBallPar*)p;
+	}
+    }
+
+    if(!r.ok || r.p!=r.end){
+	NETA=0;
+	NPHI=0;
+	etabin=nullptr;
+	RETA=0;
+	NTRK=0;
+	NMIN=0;
+	resEta=nullptr;
+	nset=0;
+	std::vector<int>().swap(nmem);
+	std::vector<int>().swap(tvar);
+	std::vector<std::vector<FlatOne>>().swap(FL);
+	version.clear();
+	return false;
+    }
+    imageData = data;
+    imageSize = size;
+    return true;
 }
 
 const double RoccoR::MPHI=-CrystalBall::pi;
@@ -269,37 +571,47 @@ int RoccoR::phiBin(double x) const{
 }
 
 double RoccoR::kScaleDT(int Q, double pt, double eta, double phi, int s, int m) const{
-    int H = etaBin(eta);
-    int F = phiBin(phi);
-    return RC[s][m].CP[DT][H][F].k(Q, pt);
+    const FlatOne& fl = FL[s][m];
+    int C = etaBin(eta)*NPHI + phiBin(phi);
+    return 1.0/(fl.cpM[DT][C] + Q*fl.cpA[DT][C]*pt + fl.cpX[DT][C]/pt);
 }
 
 double RoccoR::kScaleMC(int Q, double pt, double eta, double phi, int s, int m) const{
-    int H = etaBin(eta);
-    int F = phiBin(phi);
-    return RC[s][m].CP[MC][H][F].k(Q, pt);
+    const FlatOne& fl = FL[s][m];
+    int C = etaBin(eta)*NPHI + phiBin(phi);
+    return 1.0/(fl.cpM[MC][C] + Q*fl.cpA[MC][C]*pt + fl.cpX[MC][C]/pt);
 }
 
 double RoccoR::kSpreadMC(int Q, double pt, double eta, double phi, double gt, int s, int m) const{
-    const auto& rc=RC[s][m];
-    int H = etaBin(eta);
-    int F = phiBin(phi);
-    double k = rc.CP[MC][H][F].k(Q, pt);
-    return k*rc.RR.kSpread(gt, k*pt, eta);
+    const FlatOne& fl = FL[s][m];
+    double k = kScaleMC(Q, pt, eta, phi, s, m);
+    int R = countBin(resEta, RETA, fabs(eta));
+    double x = gt/(k*pt);
+    return k*(x / (1.0 + (x-1.0)*fl.kRes[RocRes::Data][R]/fl.kRes[RocRes::MC][R]));
 }
 
 double RoccoR::kSmearMC(int Q, double pt, double eta, double phi, int n, double u, int s, int m) const{
-    const auto& rc=RC[s][m];
-    int H = etaBin(eta);
-    int F = phiBin(phi);
-    double k = rc.CP[MC][H][F].k(Q, pt);
-    return k * rc.RR.kExtra(k*pt, eta, n, u);
+    const FlatOne& fl = FL[s][m];
+    double k = kScaleMC(Q, pt, eta, phi, s, m);
+    int R = countBin(resEta, RETA, fabs(eta));
+    int RT = R*NTRK + std::min(n>NMIN ? n-NMIN : 0, NTRK-1);
+    double d = fl.kRes[RocRes::Data][R];
+    double mc = fl.kRes[RocRes::MC][R];
+    double dpt = k*pt-45;
+    double x = d>mc ? sqrt(d*d-mc*mc) * (fl.rsPar[0][RT] + fl.rsPar[1][RT]*dpt + fl.rsPar[2][RT]*dpt*dpt) * fl.invcdf(RT, u) : 0;
+    if(x<=-1) return k;
+    return k*(1.0/(1.0 + x));
 }
 
 
 double RoccoR::kGenSmear(double pt, double eta, double v, double u, RocRes::TYPE TT, int s, int m) const{
     if(empty()) return 1.0;
-    return RC[s][m].RR.kSmear(pt, eta, TT, v, u);
+    const FlatOne& fl = FL[s][m];
+    int R = countBin(resEta, RETA, fabs(eta));
+    int RT = R*NTRK + countBin(fl.nTrk[RocRes::MC]+R*(NTRK+1), NTRK, v);
+    double dpt = pt-45;
+    double x = fl.kRes[TT][R] * (fl.rsPar[0][RT] + fl.rsPar[1][RT]*dpt + fl.rsPar[2][RT]*dpt*dpt) * fl.invcdf(RT, u);
+    return 1.0/(1.0+x);
 }
 
 template <typename T>
@@ -326,5 +638,209 @@ double RoccoR::kSmearMCerror(int Q, double pt, double eta, double phi, int n, do
     return error([this, Q, pt, eta, phi, n, u](int s, int m){return kSmearMC(Q, pt, eta, phi, n, u, s, m);});
 }
 
-#endif
+// Correction factor k of CorParams, and bins of the scale correction
+#define ROCCOR_BATCH_SCALE(T) \
+	int H = countBin(etabin, NETA, eta[i]); \
+	int F = std::min(std::max((int)((phi[i]-MPHI)/DPHI), 0), NPHI-1); \
+	int C = H*NPHI+F; \
+	double kk = 1.0/(fl.cpM[T][C] + Q[i]*fl.cpA[T][C]*pt[i] + fl.cpX[T][C]/pt[i]);
+
+void RoccoR::kScaleDT(int nmu, const int* Q, const double* pt, const double* eta, const double* phi, double* k, int s, int m) const{
+    const FlatOne& fl = FL[s][m];
+    for(int i=0; i<nmu; ++i){
+	ROCCOR_BATCH_SCALE(DT)
+	k[i] = kk;
+    }
+}
+
+void RoccoR::kSpreadMC(int nmu, const int* Q, const double* pt, const double* eta, const double* phi, const double* gt, double* k, int s, int m) const{
+    const FlatOne& fl = FL[s][m];
+    for(int i=0; i<nmu; ++i){
+	ROCCOR_BATCH_SCALE(MC)
+	int R = countBin(resEta, RETA, fabs(eta[i]));
+	double x = gt[i]/(kk*pt[i]);
+	k[i] = kk * x / (1.0 + (x-1.0)*fl.kRes[RocRes::Data][R]/fl.kRes[RocRes::MC][R]);
+    }
+}
+
+void RoccoR::kSmearMC(int nmu, const int* Q, const double* pt, const double* eta, const double* phi, const int* n, const double* u, double* k, int s, int m) const{
+    const FlatOne& fl = FL[s][m];
+    for(int i=0; i<nmu; ++i){
+	ROCCOR_BATCH_SCALE(MC)
+	int R = countBin(resEta, RETA, fabs(eta[i]));
+	int T = std::min(n[i]>NMIN ? n[i]-NMIN : 0, NTRK-1);
+	int RT = R*NTRK+T;
+	double d = fl.kRes[RocRes::Data][R];
+	double mc = fl.kRes[RocRes::MC][R];
+	double dpt = kk*pt[i]-45;
+	double sigma = fl.rsPar[0][RT] + fl.rsPar[1][RT]*dpt + fl.rsPar[2][RT]*dpt*dpt;
+	double x = d>mc ? sqrt(d*d-mc*mc) * sigma * fl.invcdf(RT, u[i]) : 0;
+	k[i] = x<=-1 ? kk : kk/(1.0 + x);
+    }
+}
+
+void RoccoR::kCorrectMC(int nmu, const int* Q, const double* pt, const double* eta, const double* phi, const double* gt, const int* n, const double* u, double* k, int s, int m) const{
+    const FlatOne& fl = FL[s][m];
+    for(int i=0; i<nmu; ++i){
+	ROCCOR_BATCH_SCALE(MC)
+	int R = countBin(resEta, RETA, fabs(eta[i]));
+	double d = fl.kRes[RocRes::Data][R];
+	double mc = fl.kRes[RocRes::MC][R];
+	if(gt[i]>0){
+	    double x = gt[i]/(kk*pt[i]);
+	    k[i] = kk * x / (1.0 + (x-1.0)*d/mc);
+	}
+	else{
+	    int T = std::min(n[i]>NMIN ? n[i]-NMIN : 0, NTRK-1);
+	    int RT = R*NTRK+T;
+	    double dpt = kk*pt[i]-45;
+	    double sigma = fl.rsPar[0][RT] + fl.rsPar[1][RT]*dpt + fl.rsPar[2][RT]*dpt*dpt;
+	    double x = d>mc ? sqrt(d*d-mc*mc) * sigma * fl.invcdf(RT, u[i]) : 0;
+	    k[i] = x<=-1 ? kk : kk/(1.0 + x);
+	}
+    }
+}
+
+#undef ROCCOR_BATCH_SCALE
+
+int RoccoR::nReplicas() const{
+    int n=0;
+    for(int is=0; is<nset; ++is) n += nmem[is];
+    return n;
+}
+
+int RoccoR::replicaIndex(int s, int m) const{
+    int idx=0;
+    for(int is=0; is<s; ++is) idx += nmem[is];
+    return idx+m;
+}
+
+// The binning (CETA, CPHI, RETA, RTRK, RMIN) is shared by all sets and members, only the parameters differ
+void RoccoR::kScaleDTReplicas(int Q, double pt, double eta, double phi, double* k) const{
+    int H = countBin(etabin, NETA, eta);
+    int F = std::min(std::max((int)((phi-MPHI)/DPHI), 0), NPHI-1);
+    int C = H*NPHI+F;
+    for(const auto& fls: FL){
+	for(const auto& fl: fls){
+	    *k++ = 1.0/(fl.cpM[DT][C] + Q*fl.cpA[DT][C]*pt + fl.cpX[DT][C]/pt);
+	}
+    }
+}
 
+void RoccoR::kCorrectMCReplicas(int Q, double pt, double eta, double phi, double gt, int n, double u, double* k) const{
+    if(FL.empty()) return;
+    int H = countBin(etabin, NETA, eta);
+    int F = std::min(std::max((int)((phi-MPHI)/DPHI), 0), NPHI-1);
+    int C = H*NPHI+F;
+    int R = countBin(resEta, RETA, fabs(eta));
+    int RT = R*NTRK + std::min(n>NMIN ? n-NMIN : 0, NTRK-1);
+    for(const auto& fls: FL){
+	for(const auto& fl: fls){
+	    double kk = 1.0/(fl.cpM[MC][C] + Q*fl.cpA[MC][C]*pt + fl.cpX[MC][C]/pt);
+	    double d = fl.kRes[RocRes::Data][R];
+	    double mc = fl.kRes[RocRes::MC][R];
+	    if(gt>0){
+		double x = gt/(kk*pt);
+		*k++ = kk * x / (1.0 + (x-1.0)*d/mc);
+	    }
+	    else{
+		double dpt = kk*pt-45;
+		double sigma = fl.rsPar[0][RT] + fl.rsPar[1][RT]*dpt + fl.rsPar[2][RT]*dpt*dpt;
+		double x = d>mc ? sqrt(d*d-mc*mc) * sigma * fl.invcdf(RT, u) : 0;
+		*k++ = x<=-1 ? kk : kk/(1.0 + x);
+	    }
+	}
+    }
+}
+
+double RoccoR::replicaError(const double* k, int s, int m) const{
+    double sum=0;
+    const double* kr = k;
+    const double nominal = k[replicaIndex(s, m)];
+    for(int is=0; is<nset; ++is){
+	for(int im=0; im<nmem[is]; ++im){
+	    double d = *kr++ - nominal;
+	    sum += d*d/nmem[is];
+	}
+    }
+    return sqrt(sum);
+}
+
+void RoccoR::setFast(bool fast, int s, int m, int npoints){
+    for(int is=0; is<nset; ++is){
+	if(s>=0 && is!=s) continue;
+	for(int im=0; im<nmem[is]; ++im){
+	    if(m>=0 && im!=m) continue;
+	    FlatOne& fl = FL[is][im];
+	    if(fast) fl.cbTab.resize(RETA*NTRK);
+	    for(int i=0; i<(int)fl.cbTab.size(); ++i){
+		CrystalBallTab& tab = fl.cbTab[i];
+		if(!fast) tab.useTab = false;
+		else if(tab.tabN==npoints) tab.useTab = true;
+		else tab.init(fl.cb[i], npoints);
+	    }
+	}
+    }
+}
+
+RoccoR::FastDeviation RoccoR::validateFast(int s, int m, int nsample){
+    FastDeviation dev{0, 0, 0};
+    if(empty()) return dev;
+
+    // Current mode of each CrystalBall, restored at the end
+    std::vector<CrystalBallTab>& tabs = FL[s][m].cbTab;
+    std::vector<bool> wasFast;
+    for(auto &tab: tabs) wasFast.push_back(tab.useTab);
+    bool built = !tabs.empty();
+    for(auto &tab: tabs) built = built && tab.tabN>0;
+    if(!built) setFast(true, s, m);
+    for(auto &tab: tabs) if(tab.tabN==0) ++dev.nExact;
+
+    // Deterministic pseudo-random muons, so that the validation does not touch gRandom
+    // They go through kCorrectMC as in DYanalyzer, without gen match, so that every muon is smeared
+    unsigned long long state = 0x9E3779B97F4A7C15ULL;
+    auto rndm = [&state]() {
+	state = state*6364136223846793005ULL + 1442695040888963407ULL;
+	return ((state >> 11) + 0.5) / 9007199254740992.0;
+    };
+    const int NBLOCK = 1024;
+    int Q[NBLOCK], n[NBLOCK];
+    double pt[NBLOCK], eta[NBLOCK], phi[NBLOCK], gt[NBLOCK], u[NBLOCK], kFast[NBLOCK], kExact[NBLOCK];
+    for(int i0=0; i0<nsample; i0+=NBLOCK){
+	int nmu = std::min(NBLOCK, nsample-i0);
+	for(int i=0; i<nmu; ++i){
+	    Q[i] = rndm()<0.5 ? -1 : 1;
+	    pt[i] = 20 + 180*rndm();
+	    eta[i] = -2.4 + 4.8*rndm();
+	    phi[i] = -CrystalBall::pi + 2*CrystalBall::pi*rndm();
+	    gt[i] = -1;
+	    n[i] = 6 + (int)(13*rndm());
+	    u[i] = rndm();
+	}
+
+	for(auto &tab: tabs) tab.useTab = tab.tabN>0;
+	kCorrectMC(nmu, Q, pt, eta, phi, gt, n, u, kFast, s, m);
+	for(auto &tab: tabs) tab.useTab = false;
+	kCorrectMC(nmu, Q, pt, eta, phi, gt, n, u, kExact, s, m);
+	for(int i=0; i<nmu; ++i) dev.smear = std::max(dev.smear, fabs(kFast[i]-kExact[i]));
+    }
+
+    // invcdf of each CrystalBall, on a grid in u that covers the tables and both tails
+    const int NGRID = 4096;
+    const CrystalBallPar* cb = FL[s][m].cb;
+    for(size_t i=0; i<tabs.size(); ++i){
+	if(tabs[i].tabN==0) continue;
+	tabs[i].useTab = true;
+	for(int j=1; j<NGRID; ++j){
+	    double uj = (double)j/NGRID;
+	    dev.invcdf = std::max(dev.invcdf, fabs(tabs[i].invcdf(cb[i], uj)-cb[i].invcdfExact(uj)));
+	}
+    }
+
+    if(wasFast.empty()) wasFast.assign(tabs.size(), false);
+    size_t i=0;
+    for(auto &tab: tabs) tab.useTab = wasFast[i++];
+    return dev;
+}
+
+#endif
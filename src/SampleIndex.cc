@@ -0,0 +1,102 @@
+#include "SampleIndex.h"
+
+// DYanalysis classes
+#include "Data.h"
+
+// ROOT classes
+#include "TChain.h"
+#include "TTreeReader.h"
+#include "TTreeReaderValue.h"
+
+// C++ classes
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+
+// POSIX
+#include <unistd.h>
+
+SampleIndex::Entry SampleIndex::Count(const std::string& inputFileList, Bool_t isMC) {
+    Entry entry;
+    TChain chain("Events");
+    for (const std::string& fileName : Data::ReadFileList(inputFileList)) {
+        chain.Add(fileName.c_str());
+        entry.nFiles++;
+    }
+    entry.nEntries = chain.GetEntries();
+    if (!isMC) return entry;
+
+    // Only genWeight is read
+    TTreeReader reader(&chain);
+    TTreeReaderValue<Float_t> genWeight(reader, "genWeight");
+    while (reader.Next()) entry.dSumOfGenEvtWeight += (*genWeight < 0) ? -1.0 : 1.0;
+    return entry;
+}
+
+const SampleIndex::Entry* SampleIndex::Find(const std::string& processName, const std::string& era) const {
+    auto it = mEntries.find(era + "/" + processName);
+    return (it != mEntries.end()) ? &it->second : nullptr;
+}
+
+Double_t SampleIndex::GetGroupSumOfGenEvtWeight(const SampleInfo& info, const std::string& era) const {
+    // Every member of the group must be indexed, a partial sum would overestimate the normalization of the group
+    Double_t sum = 0.;
+    for (const std::string& processName : SampleRegistry::Get().GetGroupMembers(info.sGroup, era)) {
+        const Entry* entry = Find(processName, era);
+        if (entry == nullptr) {
+            throw std::runtime_error("[Runtime Error] SampleIndex::GetGroupSumOfGenEvtWeight() - " + processName + " (" + era + ") of the group " + info.sGroup
+                                     + " is not in the index, run --build-index for it");
+        }
+        std::cout << "[Info] SampleIndex::GetGroupSumOfGenEvtWeight() - " << info.sGroup << " (" << era << "): " << processName
+                  << ", sum of weight " << entry->dSumOfGenEvtWeight << std::endl;
+        sum += entry->dSumOfGenEvtWeight;
+    }
+    if (sum <= 0.) {
+        throw std::runtime_error("[Runtime Error] SampleIndex::GetGroupSumOfGenEvtWeight() - No sum of weight for " + info.sGroup + " (" + era + ") in the index");
+    }
+    return sum;
+}
+
+Double_t SampleIndex::GetNormalization(const std::string& processName, const std::string& era) const {
+    const SampleRegistry& registry = SampleRegistry::Get();
+    const SampleInfo& info = registry.At(processName, era);
+    if (info.bIsData) return 1.;
+    return info.dCrossSection * registry.GetLumi(era) / GetGroupSumOfGenEvtWeight(info, era);
+}
+
+Bool_t SampleIndex::Read(const std::string& fileName) {
+    std::ifstream file(fileName);
+    if (!file.is_open()) return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string era, processName;
+        Entry entry;
+        if (!(fields >> era >> processName >> entry.nFiles >> entry.nEntries >> entry.dSumOfGenEvtWeight)) {
+            throw std::runtime_error("[Runtime Error] SampleIndex::Read() - Invalid line of " + fileName + ": " + line);
+        }
+        Set(processName, era, entry);
+    }
+    return true;
+}
+
+Bool_t SampleIndex::Write(const std::string& fileName) const {
+    std::string tmpName = fileName + ".tmp" + std::to_string((long)getpid());
+    std::ofstream file(tmpName);
+    if (!file.is_open()) return false;
+    file << "# <era> <process> <files> <entries> <sum of generator weights>\n";
+    file << std::setprecision(17);
+    for (const auto& entry : mEntries) {
+        std::size_t slash = entry.first.find('/');
+        file << entry.first.substr(0, slash) << " " << entry.first.substr(slash + 1) << " " << entry.second.nFiles << " "
+             << entry.second.nEntries << " " << entry.second.dSumOfGenEvtWeight << "\n";
+    }
+    file.close();
+    if (!file || std::rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
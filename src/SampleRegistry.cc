@@ -0,0 +1,138 @@
+#include "SampleRegistry.h"
+#include "CalibTables.h"
+
+// C++ classes
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+const SampleRegistry& SampleRegistry::Get() {
+    // Initialization of a function-local static is thread-safe
+    static const SampleRegistry* registry = []() {
+        SampleRegistry* r = new SampleRegistry();
+        std::string text;
+        const CalibText* embedded = CalibTables::FindText(kFileName);
+        if (embedded != nullptr) {
+            text.assign(embedded->pText, embedded->nSize);
+        } else {
+            std::ifstream file(kFileName);
+            if (!file.is_open()) file.open(std::string("../") + kFileName);
+            if (!file.is_open()) {
+                throw std::runtime_error(std::string("[Runtime Error] SampleRegistry::Get() - Cannot open ") + kFileName);
+            }
+            std::ostringstream buffer;
+            buffer << file.rdbuf();
+            text = buffer.str();
+        }
+        r->Parse(text);
+        std::cout << "[Info] SampleRegistry::Get() - " << r->mSamples.size() << " samples loaded from " << kFileName
+                  << ((embedded != nullptr) ? " (embedded)" : "") << std::endl;
+        return r;
+    }();
+    return *registry;
+}
+
+void SampleRegistry::Parse(const std::string& text) {
+    std::istringstream lines(text);
+    std::string line;
+    Int_t iLine = 0;
+    while (std::getline(lines, line)) {
+        iLine++;
+        std::size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::istringstream fieldStream(line);
+        std::vector<std::string> fields;
+        std::string field;
+        while (fieldStream >> field) fields.push_back(field);
+        if (fields.empty()) continue;
+
+        auto Invalid = [&]() {
+            return std::runtime_error("[Runtime Error] SampleRegistry::Parse() - Invalid line " + std::to_string(iLine) + " of " + kFileName);
+        };
+        // "-" : default value
+        auto Number = [&](const std::string& value, Double_t defaultValue) {
+            if (value == "-") return defaultValue;
+            try {
+                return std::stod(value);
+            } catch (const std::exception&) {
+                throw Invalid();
+            }
+        };
+
+        if (fields[0] == "lumi") {
+            if (fields.size() != 3) throw Invalid();
+            mLumi[fields[1]] = Number(fields[2], 0.);
+            continue;
+        }
+        if (fields.size() != 10 || (fields[2] != "mc" && fields[2] != "data")) throw Invalid();
+        SampleInfo info;
+        info.sProcessName = fields[0];
+        info.sEra = fields[1];
+        info.bIsData = (fields[2] == "data");
+        info.sGroup = (fields[3] == "-") ? info.sProcessName : fields[3];
+        info.dCrossSection = Number(fields[4], 0.);
+        info.eStitch = ParseStitch(fields[5]);
+        info.dW_mass_cut_low = Number(fields[6], 0.);
+        info.dW_mass_cut_high = Number(fields[7], 1e9);
+        info.dHT_cut_high = Number(fields[8], 1e9);
+        info.sMETKey = (fields[9] == "-") ? "" : fields[9];
+        if (!mSamples.emplace(info.sEra + "/" + info.sProcessName, info).second) {
+            throw std::runtime_error("[Runtime Error] SampleRegistry::Parse() - Duplicate sample " + info.sProcessName + " (" + info.sEra + ") in " + kFileName);
+        }
+    }
+}
+
+const SampleInfo* SampleRegistry::Find(const std::string& processName, const std::string& era) const {
+    auto it = mSamples.find(era + "/" + processName);
+    if (it == mSamples.end()) it = mSamples.find("*/" + processName);
+    return (it != mSamples.end()) ? &it->second : nullptr;
+}
+
+const SampleInfo& SampleRegistry::At(const std::string& processName, const std::string& era) const {
+    const SampleInfo* info = Find(processName, era);
+    if (info == nullptr) {
+        throw std::runtime_error("[Runtime Error] SampleRegistry::At() - Unknown process " + processName + " (" + era + "), add it to " + kFileName);
+    }
+    return *info;
+}
+
+std::vector<std::string> SampleRegistry::GetGroupMembers(const std::string& group, const std::string& era) const {
+    std::vector<std::string> members;
+    for (const auto& sample : mSamples) {
+        const SampleInfo& info = sample.second;
+        if (info.sGroup != group || (info.sEra != era && info.sEra != "*")) continue;
+        // A line for all eras is overridden by the era-specific line of the same process
+        if (Find(info.sProcessName, era) != &info) continue;
+        members.push_back(info.sProcessName);
+    }
+    std::sort(members.begin(), members.end());
+    return members;
+}
+
+Double_t SampleRegistry::GetLumi(const std::string& era) const {
+    auto it = mLumi.find(era);
+    if (it == mLumi.end()) {
+        throw std::runtime_error("[Runtime Error] SampleRegistry::GetLumi() - No luminosity for era " + era + " in " + kFileName);
+    }
+    return it->second;
+}
+
+Stitch SampleRegistry::ParseStitch(const std::string& stitch) {
+    if (stitch == "none") return Stitch::kNone;
+    if (stitch == "inclusiveW") return Stitch::kInclusiveW;
+    if (stitch == "boostedW") return Stitch::kBoostedW;
+    if (stitch == "offshellW") return Stitch::kOffshellW;
+    if (stitch == "offshellWToTauNu") return Stitch::kOffshellWToTauNu;
+    throw std::runtime_error("[Runtime Error] SampleRegistry::ParseStitch() - Unknown stitching rule: " + stitch);
+}
+
+const char* SampleRegistry::StitchName(Stitch stitch) {
+    switch (stitch) {
+        case Stitch::kInclusiveW: return "inclusiveW";
+        case Stitch::kBoostedW: return "boostedW";
+        case Stitch::kOffshellW: return "offshellW";
+        case Stitch::kOffshellWToTauNu: return "offshellWToTauNu";
+        default: return "none";
+    }
+}
@@ -0,0 +1,64 @@
+#include "SparseHist.h"
+
+SparseTH1D::SparseTH1D(const std::string& name, Int_t nBins, Double_t xLow, Double_t xHigh)
+    : sName(name), nBinsX(nBins), dXLow(xLow), dXHigh(xHigh) {
+    if (nBins <= 0 || !(xLow < xHigh)) {
+        throw std::runtime_error("[Runtime Error] SparseTH1D::SparseTH1D() - Invalid binning of " + name);
+    }
+    // Bins 0 (underflow) to nBins + 1 (overflow)
+    vPages.resize(((nBins + 1) >> kPageBits) + 1);
+}
+
+void SparseTH1D::Add(const TH1* h) {
+    if (h->GetDimension() != 1 || h->GetNbinsX() != nBinsX || h->GetXaxis()->GetXmin() != dXLow || h->GetXaxis()->GetXmax() != dXHigh) {
+        throw std::runtime_error("[Runtime Error] SparseTH1D::Add() - Binning of " + std::string(h->GetName()) + " is different from " + sName);
+    }
+    // Statistics are read before anything else (GetStats() may compute them from the contents)
+    Double_t stats[TH1::kNstat] = {0.};
+    h->GetStats(stats);
+    dTsumw += stats[0];
+    dTsumw2 += stats[1];
+    dTsumwx += stats[2];
+    dTsumwx2 += stats[3];
+    dEntries += h->GetEntries();
+
+    // Without Sumw2() the histogram was filled with unit weights
+    const Bool_t hasSumw2 = h->GetSumw2N() > 0;
+    for (Int_t bin = 0; bin <= nBinsX + 1; bin++) {
+        const Double_t content = h->GetBinContent(bin);
+        const Double_t sumw2 = hasSumw2 ? h->GetSumw2()->At(bin) : content;
+        if (content == 0. && sumw2 == 0.) continue;
+        Double_t* page = GetPage(bin);
+        const Int_t offset = bin & (kPageSize - 1);
+        page[offset] += content;
+        page[kPageSize + offset] += sumw2;
+    }
+}
+
+TH1D* SparseTH1D::ToTH1D() const {
+    TH1D* h = new TH1D(sName.c_str(), sName.c_str(), nBinsX, dXLow, dXHigh);
+    h->SetDirectory(nullptr);
+    h->Sumw2();
+    Double_t* content = h->GetArray();
+    Double_t* sumw2 = h->GetSumw2()->GetArray();
+    for (std::size_t iPage = 0; iPage < vPages.size(); iPage++) {
+        if (vPages[iPage] == nullptr) continue;
+        const Int_t firstBin = iPage << kPageBits;
+        for (Int_t offset = 0; offset < kPageSize && firstBin + offset <= nBinsX + 1; offset++) {
+            content[firstBin + offset] = vPages[iPage][offset];
+            sumw2[firstBin + offset] = vPages[iPage][kPageSize + offset];
+        }
+    }
+    Double_t stats[TH1::kNstat] = {dTsumw, dTsumw2, dTsumwx, dTsumwx2};
+    h->PutStats(stats);
+    h->SetEntries(dEntries);
+    return h;
+}
+
+std::size_t SparseTH1D::GetAllocatedBytes() const {
+    std::size_t nPages = 0;
+    for (const auto& page : vPages) {
+        if (page != nullptr) nPages++;
+    }
+    return nPages * 2 * kPageSize * sizeof(Double_t);
+}
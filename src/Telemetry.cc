@@ -0,0 +1,136 @@
+#include "Telemetry.h"
+
+// C++ classes
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+
+// POSIX
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+    std::string EscapeJSON(const std::string& s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            if ((unsigned char)c < 0x20) continue;
+            out += c;
+        }
+        return out;
+    }
+}
+
+Telemetry::~Telemetry() {
+    Stop();
+}
+
+Double_t Telemetry::GetRSS() {
+    // Second field of statm : resident pages
+    long pages = 0, resident = 0;
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (f == nullptr) return 0.;
+    if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    std::fclose(f);
+    return (Double_t)resident * sysconf(_SC_PAGESIZE) / (1024. * 1024.);
+}
+
+Double_t Telemetry::GetPeakRSS() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.;
+    return usage.ru_maxrss / 1024.; // kB on Linux
+}
+
+std::ostream& Telemetry::GetStream() {
+    if (sOutputFileName.empty() || sOutputFileName == "-") return std::cerr;
+    if (!fOutput.is_open()) {
+        fOutput.open(sOutputFileName, std::ios::app);
+        if (!fOutput) {
+            std::cerr << "[Warning] Telemetry::GetStream() - Cannot open " << sOutputFileName << ", using stderr" << std::endl;
+            sOutputFileName = "-";
+            return std::cerr;
+        }
+    }
+    return fOutput;
+}
+
+void Telemetry::Start(Long64_t totalEvents, TTree* tree) {
+    nTotalEvents = totalEvents;
+    nEvents = 0;
+    nNextCheck = kCheckEvery;
+    nEventsLastReport = 0;
+    for (auto& time : vStageTimes) time = Clock::duration::zero();
+    tStart = tLap = tLastReport = Clock::now();
+    bHasIOStats = false;
+    if (IsEnabled() && bIOStats && tree != nullptr) {
+        // Attached to the chain, passed on to each tree it loads
+        fTree = tree;
+        cPerfStats = new TTreePerfStats("DYanalysisIOPerfStats", tree);
+        bHasIOStats = true;
+    }
+    bIsRunning = true;
+    if (IsEnabled()) Report("start");
+}
+
+void Telemetry::Stop() {
+    if (!bIsRunning) return;
+    tStop = Clock::now();
+    if (cPerfStats != nullptr) {
+        cPerfStats->Finish();
+        UpdateIOStats();
+        fTree->SetPerfStats(nullptr);
+        delete cPerfStats;
+        cPerfStats = nullptr;
+        fTree = nullptr;
+    }
+    bIsRunning = false;
+    if (IsEnabled()) GetStream() << ToJSON("summary", tStop) << std::endl;
+}
+
+std::string Telemetry::GetSummary() {
+    return ToJSON("summary", bIsRunning ? Clock::now() : tStop);
+}
+
+void Telemetry::UpdateIOStats() {
+    if (cPerfStats == nullptr) return;
+    nBytesRead = cPerfStats->GetBytesRead();
+    nReadCalls = cPerfStats->GetReadCalls();
+    nBytesUnzipped = cPerfStats->GetUnzipObjSize();
+    dUnzipTime = cPerfStats->GetUnzipTime();
+}
+
+void Telemetry::Report(const char* type) {
+    Clock::time_point now = Clock::now();
+    UpdateIOStats();
+    GetStream() << ToJSON(type, now) << std::endl;
+    tLastReport = now;
+    nEventsLastReport = nEvents;
+}
+
+std::string Telemetry::ToJSON(const char* type, Clock::time_point now) {
+    Double_t elapsed = std::chrono::duration<Double_t>(now - tStart).count();
+    Double_t sinceReport = std::chrono::duration<Double_t>(now - tLastReport).count();
+    Double_t rateAvg = (elapsed > 0) ? nEvents / elapsed : 0.;
+    Double_t rate = (sinceReport > 0) ? (nEvents - nEventsLastReport) / sinceReport : rateAvg;
+    Double_t eta = (rateAvg > 0 && nTotalEvents > nEvents) ? (nTotalEvents - nEvents) / rateAvg : 0.;
+
+    char hostName[256] = "";
+    gethostname(hostName, sizeof(hostName) - 1);
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3);
+    json << "{\"type\":\"" << type << "\",\"label\":\"" << EscapeJSON(sLabel) << "\",\"host\":\"" << EscapeJSON(hostName) << "\",\"pid\":" << getpid()
+         << ",\"elapsed_s\":" << elapsed << ",\"events\":" << nEvents << ",\"total\":" << nTotalEvents
+         << ",\"rate\":" << rate << ",\"rate_avg\":" << rateAvg << ",\"eta_s\":" << eta
+         << ",\"rss_mb\":" << GetRSS() << ",\"peak_rss_mb\":" << GetPeakRSS();
+    if (bHasIOStats) {
+        json << ",\"bytes_read\":" << nBytesRead << ",\"read_calls\":" << nReadCalls
+             << ",\"bytes_unzipped\":" << nBytesUnzipped << ",\"unzip_s\":" << dUnzipTime;
+    }
+    json << ",\"stages_s\":{";
+    for (std::size_t i = 0; i < vStageNames.size(); i++) {
+        json << (i > 0 ? "," : "") << "\"" << vStageNames[i] << "\":" << std::chrono::duration<Double_t>(vStageTimes[i]).count();
+    }
+    json << "}}";
+    return json.str();
+}
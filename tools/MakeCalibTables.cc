@@ -0,0 +1,177 @@
+// Build-time generator of the embedded calibration tables (see include/CalibTables.h)
+// Usage : MakeCalibTables <output.cc> <source dir> <file relative to source dir> ...
+// Every TH1 and TH2 at the top level of the ROOT files is written as constexpr arrays,
+// bin edges and contents are printed as hexadecimal floating literals so that the values are exact.
+// JSON files (correctionlib) and .txt files (sample registry) are embedded as text.
+
+// ROOT classes
+#include "TFile.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TH1.h"
+#include "TH2.h"
+#include "TAxis.h"
+
+// C++ classes
+#include <string>
+#include <vector>
+#include <set>
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+void WriteArray(FILE* out, const std::string& name, const std::vector<double>& values) {
+    std::fprintf(out, "constexpr double %s[] = {", name.c_str());
+    for (std::size_t i = 0; i < values.size(); i++) {
+        std::fprintf(out, "%s%a", (i % 4 == 0) ? "\n    " : " ", values[i]);
+        if (i + 1 < values.size()) std::fprintf(out, ",");
+    }
+    std::fprintf(out, "\n};\n");
+}
+
+std::vector<double> GetEdges(const TAxis* axis) {
+    std::vector<double> edges(axis->GetNbins() + 1);
+    for (int i = 0; i <= axis->GetNbins(); i++) edges[i] = axis->GetBinLowEdge(i + 1);
+    return edges;
+}
+
+struct Entry {
+    std::string sFileName;
+    std::string sHistName;
+    int nX = 0;
+    int nY = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "[ERROR] MakeCalibTables - Usage: " << argv[0] << " <output.cc> <source dir> [files...]" << std::endl;
+        return 1;
+    }
+    const std::string outName = argv[1];
+    const std::string srcDir = argv[2];
+
+    // Write to a temporary file first, so that a failed run does not leave a partial source behind
+    const std::string tmpName = outName + ".tmp";
+    FILE* out = std::fopen(tmpName.c_str(), "w");
+    if (out == nullptr) {
+        std::cerr << "[ERROR] MakeCalibTables - Cannot open " << tmpName << std::endl;
+        return 1;
+    }
+    std::fprintf(out, "// Generated by tools/MakeCalibTables.cc, do not edit\n");
+    std::fprintf(out, "#include \"CalibTables.h\"\n\n");
+    std::fprintf(out, "namespace {\n\n");
+
+    std::vector<Entry> entries;
+    std::vector<std::string> textFiles;
+    for (int iArg = 3; iArg < argc; iArg++) {
+        const std::string fileName = argv[iArg];
+
+        // Text file (correctionlib JSON, sample registry), as a raw string literal
+        if ((fileName.size() > 5 && fileName.compare(fileName.size() - 5, 5, ".json") == 0) || (fileName.size() > 4 && fileName.compare(fileName.size() - 4, 4, ".txt") == 0)) {
+            std::ifstream in(srcDir + "/" + fileName, std::ios::binary);
+            std::ostringstream text;
+            text << in.rdbuf();
+            if (!in.is_open() || text.str().find(")calib\"") != std::string::npos) {
+                std::cerr << "[ERROR] MakeCalibTables - Cannot embed " << fileName << std::endl;
+                std::fclose(out);
+                std::remove(tmpName.c_str());
+                return 1;
+            }
+            std::fprintf(out, "// %s\n", fileName.c_str());
+            std::fprintf(out, "constexpr char kText%zu[] = R\"calib(", textFiles.size());
+            std::fwrite(text.str().data(), 1, text.str().size(), out);
+            std::fprintf(out, ")calib\";\n\n");
+            textFiles.push_back(fileName);
+            continue;
+        }
+
+        TFile* f = TFile::Open((srcDir + "/" + fileName).c_str(), "READ");
+        if (f == nullptr || f->IsZombie()) {
+            std::cerr << "[ERROR] MakeCalibTables - Cannot open " << fileName << std::endl;
+            delete f;
+            std::fclose(out);
+            std::remove(tmpName.c_str());
+            return 1;
+        }
+
+        // Keys are sorted by cycle, keep the first (highest) cycle of each name
+        std::set<std::string> seen;
+        TIter next(f->GetListOfKeys());
+        while (TKey* key = (TKey*)next()) {
+            if (!seen.insert(key->GetName()).second) continue;
+            TObject* obj = key->ReadObj();
+            TH1* h = dynamic_cast<TH1*>(obj);
+            if (h == nullptr || h->GetDimension() > 2) {
+                delete obj;
+                continue;
+            }
+
+            Entry entry;
+            entry.sFileName = fileName;
+            entry.sHistName = key->GetName();
+            entry.nX = h->GetNbinsX();
+            entry.nY = (h->GetDimension() == 2) ? h->GetNbinsY() : 0;
+
+            std::vector<double> content, error;
+            for (int iX = 1; iX <= entry.nX; iX++) {
+                if (entry.nY == 0) {
+                    content.push_back(h->GetBinContent(iX));
+                    error.push_back(h->GetBinError(iX));
+                    continue;
+                }
+                for (int iY = 1; iY <= entry.nY; iY++) {
+                    content.push_back(h->GetBinContent(iX, iY));
+                    error.push_back(h->GetBinError(iX, iY));
+                }
+            }
+
+            const std::string prefix = "kHist" + std::to_string(entries.size());
+            std::fprintf(out, "// %s : %s\n", fileName.c_str(), entry.sHistName.c_str());
+            WriteArray(out, prefix + "_XEdges", GetEdges(h->GetXaxis()));
+            if (entry.nY > 0) WriteArray(out, prefix + "_YEdges", GetEdges(h->GetYaxis()));
+            WriteArray(out, prefix + "_Content", content);
+            WriteArray(out, prefix + "_Error", error);
+            std::fprintf(out, "\n");
+
+            entries.push_back(entry);
+            delete obj;
+        }
+        f->Close();
+        delete f;
+    }
+
+    std::fprintf(out, "} // namespace\n\n");
+    // An empty array is not valid C++, keep a terminating null entry
+    std::fprintf(out, "const CalibHist CalibTables::kHists[] = {\n");
+    for (std::size_t i = 0; i < entries.size(); i++) {
+        const std::string prefix = "kHist" + std::to_string(i);
+        std::fprintf(out, "    {\"%s\", \"%s\", %d, %d, %s_XEdges, %s, %s_Content, %s_Error},\n",
+                     entries[i].sFileName.c_str(), entries[i].sHistName.c_str(), entries[i].nX, entries[i].nY,
+                     prefix.c_str(), (entries[i].nY > 0) ? (prefix + "_YEdges").c_str() : "nullptr", prefix.c_str(), prefix.c_str());
+    }
+    std::fprintf(out, "    {\"\", \"\", 0, 0, nullptr, nullptr, nullptr, nullptr}\n");
+    std::fprintf(out, "};\n");
+    std::fprintf(out, "const int CalibTables::nHists = %zu;\n\n", entries.size());
+
+    std::fprintf(out, "const CalibText CalibTables::kTexts[] = {\n");
+    for (std::size_t i = 0; i < textFiles.size(); i++) {
+        std::fprintf(out, "    {\"%s\", kText%zu, sizeof(kText%zu) - 1},\n", textFiles[i].c_str(), i, i);
+    }
+    std::fprintf(out, "    {\"\", nullptr, 0}\n");
+    std::fprintf(out, "};\n");
+    std::fprintf(out, "const int CalibTables::nTexts = %zu;\n", textFiles.size());
+    std::fclose(out);
+
+    if (std::rename(tmpName.c_str(), outName.c_str()) != 0) {
+        std::cerr << "[ERROR] MakeCalibTables - Cannot write " << outName << std::endl;
+        std::remove(tmpName.c_str());
+        return 1;
+    }
+    std::cout << "[Info] MakeCalibTables - " << entries.size() << " histograms and " << textFiles.size() << " text files written to " << outName << std::endl;
+    return 0;
+}